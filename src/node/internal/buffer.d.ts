@@ -1,16 +1,15 @@
 // Type definitions for c++ implementation
 
-interface CompareOptions {
-  aStart?: number;
-  aEnd?: number;
-  bStart?: number;
-  bEnd?: number
-}
-
 type BufferSource = ArrayBufferView | ArrayBuffer;
 
 export function byteLength(value: string): number;
-export function compare(a: Uint8Array, b: Uint8Array, options?: CompareOptions): number;
+export function compare(a: Uint8Array, b: Uint8Array): number;
+export function compareOffset(source: Uint8Array,
+                              target: Uint8Array,
+                              targetStart: number,
+                              sourceStart: number,
+                              targetEnd: number,
+                              sourceEnd: number): number;
 export function concat(list: Uint8Array[], length: number): ArrayBuffer;
 export function decodeString(value: string, encoding: string): ArrayBuffer;
 export function fillImpl(buffer: Uint8Array,
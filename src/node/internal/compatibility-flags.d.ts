@@ -30,3 +30,4 @@ export const specCompliantResponseRedirect: boolean;
 export const workerdExperimental: boolean;
 export const durableObjectGetExisting: boolean;
 export const vectorizeQueryMetadataOptional: boolean;
+export const nodeJsZlib: boolean;
@@ -70,10 +70,14 @@ export function getHkdf(hash: string, key: ArrayLike, salt: ArrayLike, info: Arr
 // pbkdf2
 export function getPbkdf(password: ArrayLike, salt: ArrayLike, iterations: number, keylen: number,
                          digest: string): ArrayBuffer;
+export function getPbkdfAsync(password: ArrayLike, salt: ArrayLike, iterations: number,
+                              keylen: number, digest: string): Promise<ArrayBuffer>;
 
 // scrypt
 export function getScrypt(password: ArrayLike, salt: ArrayLike, N: number, r: number, p: number,
                           maxmem: number, keylen: number): ArrayBuffer;
+export function getScryptAsync(password: ArrayLike, salt: ArrayLike, N: number, r: number,
+                               p: number, maxmem: number, keylen: number): Promise<ArrayBuffer>;
 
 // Keys
 export function exportKey(key: CryptoKey, options?: InnerExportOptions): KeyExportResult;
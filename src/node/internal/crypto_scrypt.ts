@@ -171,7 +171,7 @@ export function scrypt(password: ArrayLike, salt: ArrayLike,
 
   new Promise<ArrayBuffer>((res, rej) => {
     try {
-      res(cryptoImpl.getScrypt(password, salt, N, r, p, maxmem, keylen));
+      res(cryptoImpl.getScryptAsync(password, salt, N, r, p, maxmem, keylen));
     } catch(err) {
       rej(err);
     }
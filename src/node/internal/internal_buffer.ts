@@ -664,12 +664,8 @@ Buffer.prototype.compare = function compare(
     validateOffset(thisEnd as number, "sourceEnd", 0, this.length);
   }
 
-  return bufferUtil.compare(this, target, {
-    aStart: thisStart as number,
-    aEnd: thisEnd as number,
-    bStart: start as number,
-    bEnd: end as number,
-  });
+  return bufferUtil.compareOffset(this, target, start as number, thisStart as number,
+                                 end as number, thisEnd as number);
 };
 
 function includes(
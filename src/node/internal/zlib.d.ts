@@ -0,0 +1,20 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+export interface Options {
+  level?: number;
+  windowBits?: number;
+  memLevel?: number;
+  strategy?: number;
+  params?: Record<string, number>;
+}
+
+export function crc32(data: ArrayBufferView, value: number): number;
+export function processSync(data: ArrayBufferView, mode: number, options: Options,
+                            finishFlush: number, maxOutputLength?: number): ArrayBuffer;
+
+export class ZlibStream {
+  public constructor(mode: number, options?: Options);
+  public push(data: ArrayBufferView, flush: number): ArrayBuffer;
+}
@@ -0,0 +1,603 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+//
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+/* todo: the following is adopted code, enabling linting one day */
+/* eslint-disable */
+
+import { default as flags } from 'workerd:compatibility-flags';
+import { default as zlibUtil } from 'node-internal:zlib';
+
+import {
+  Buffer,
+  kMaxLength,
+} from 'node-internal:internal_buffer';
+
+import {
+  ERR_INVALID_ARG_TYPE,
+  ERR_INVALID_ARG_VALUE,
+  ERR_METHOD_NOT_IMPLEMENTED,
+  ERR_OUT_OF_RANGE,
+} from 'node-internal:internal_errors';
+
+import {
+  isAnyArrayBuffer,
+  isArrayBufferView,
+} from 'node-internal:internal_types';
+
+import {
+  validateFunction,
+} from 'node-internal:validators';
+
+import {
+  Transform,
+  TransformOptions,
+  TransformCallback,
+} from 'node-internal:streams_transform';
+
+if (!flags.nodeJsZlib) {
+  throw new Error('node:zlib is experimental and requires the "nodejs_zlib" compatibility flag');
+}
+
+export const constants = Object.freeze({
+  Z_NO_FLUSH: 0,
+  Z_PARTIAL_FLUSH: 1,
+  Z_SYNC_FLUSH: 2,
+  Z_FULL_FLUSH: 3,
+  Z_FINISH: 4,
+  Z_BLOCK: 5,
+  Z_OK: 0,
+  Z_STREAM_END: 1,
+  Z_NEED_DICT: 2,
+  Z_ERRNO: -1,
+  Z_STREAM_ERROR: -2,
+  Z_DATA_ERROR: -3,
+  Z_MEM_ERROR: -4,
+  Z_BUF_ERROR: -5,
+  Z_VERSION_ERROR: -6,
+  Z_NO_COMPRESSION: 0,
+  Z_BEST_SPEED: 1,
+  Z_BEST_COMPRESSION: 9,
+  Z_DEFAULT_COMPRESSION: -1,
+  Z_FILTERED: 1,
+  Z_HUFFMAN_ONLY: 2,
+  Z_RLE: 3,
+  Z_FIXED: 4,
+  Z_DEFAULT_STRATEGY: 0,
+  DEFLATE: 1,
+  INFLATE: 2,
+  GZIP: 3,
+  GUNZIP: 4,
+  DEFLATERAW: 5,
+  INFLATERAW: 6,
+  UNZIP: 7,
+  BROTLI_DECODE: 8,
+  BROTLI_ENCODE: 9,
+  Z_MIN_WINDOWBITS: 8,
+  Z_MAX_WINDOWBITS: 15,
+  Z_DEFAULT_WINDOWBITS: 15,
+  Z_MIN_CHUNK: 64,
+  Z_MAX_CHUNK: Infinity,
+  Z_DEFAULT_CHUNK: 16384,
+  Z_MIN_MEMLEVEL: 1,
+  Z_MAX_MEMLEVEL: 9,
+  Z_DEFAULT_MEMLEVEL: 8,
+  Z_MIN_LEVEL: -1,
+  Z_MAX_LEVEL: 9,
+  Z_DEFAULT_LEVEL: -1,
+  BROTLI_OPERATION_PROCESS: 0,
+  BROTLI_OPERATION_FLUSH: 1,
+  BROTLI_OPERATION_FINISH: 2,
+  BROTLI_OPERATION_EMIT_METADATA: 3,
+  BROTLI_PARAM_MODE: 0,
+  BROTLI_MODE_GENERIC: 0,
+  BROTLI_MODE_TEXT: 1,
+  BROTLI_MODE_FONT: 2,
+  BROTLI_DEFAULT_MODE: 0,
+  BROTLI_PARAM_QUALITY: 1,
+  BROTLI_MIN_QUALITY: 0,
+  BROTLI_MAX_QUALITY: 11,
+  BROTLI_DEFAULT_QUALITY: 11,
+  BROTLI_PARAM_LGWIN: 2,
+  BROTLI_MIN_WINDOW_BITS: 10,
+  BROTLI_MAX_WINDOW_BITS: 24,
+  BROTLI_LARGE_MAX_WINDOW_BITS: 30,
+  BROTLI_DEFAULT_WINDOW: 22,
+  BROTLI_PARAM_LGBLOCK: 3,
+  BROTLI_MIN_INPUT_BLOCK_BITS: 16,
+  BROTLI_MAX_INPUT_BLOCK_BITS: 24,
+  BROTLI_PARAM_DISABLE_LITERAL_CONTEXT_MODELING: 4,
+  BROTLI_PARAM_SIZE_HINT: 5,
+  BROTLI_PARAM_LARGE_WINDOW: 6,
+  BROTLI_PARAM_NPOSTFIX: 7,
+  BROTLI_PARAM_NDIRECT: 8,
+  BROTLI_DECODER_PARAM_DISABLE_RING_BUFFER_REALLOCATION: 0,
+  BROTLI_DECODER_PARAM_LARGE_WINDOW: 1,
+});
+
+const {
+  Z_NO_FLUSH, Z_BLOCK, Z_FULL_FLUSH, Z_FINISH,
+  Z_MIN_WINDOWBITS, Z_MAX_WINDOWBITS, Z_DEFAULT_WINDOWBITS,
+  Z_MIN_LEVEL, Z_MAX_LEVEL, Z_DEFAULT_LEVEL,
+  Z_MIN_MEMLEVEL, Z_MAX_MEMLEVEL, Z_DEFAULT_MEMLEVEL,
+  Z_DEFAULT_STRATEGY, Z_FIXED,
+  Z_MIN_CHUNK, Z_DEFAULT_CHUNK,
+  DEFLATE, INFLATE, GZIP, GUNZIP, DEFLATERAW, INFLATERAW, UNZIP,
+  BROTLI_DECODE, BROTLI_ENCODE,
+  BROTLI_OPERATION_PROCESS, BROTLI_OPERATION_EMIT_METADATA, BROTLI_OPERATION_FINISH,
+} = constants;
+
+export const codes = Object.freeze({
+  Z_OK: constants.Z_OK,
+  Z_STREAM_END: constants.Z_STREAM_END,
+  Z_NEED_DICT: constants.Z_NEED_DICT,
+  Z_ERRNO: constants.Z_ERRNO,
+  Z_STREAM_ERROR: constants.Z_STREAM_ERROR,
+  Z_DATA_ERROR: constants.Z_DATA_ERROR,
+  Z_MEM_ERROR: constants.Z_MEM_ERROR,
+  Z_BUF_ERROR: constants.Z_BUF_ERROR,
+  Z_VERSION_ERROR: constants.Z_VERSION_ERROR,
+  '0': 'Z_OK',
+  '1': 'Z_STREAM_END',
+  '2': 'Z_NEED_DICT',
+  '-1': 'Z_ERRNO',
+  '-2': 'Z_STREAM_ERROR',
+  '-3': 'Z_DATA_ERROR',
+  '-4': 'Z_MEM_ERROR',
+  '-5': 'Z_BUF_ERROR',
+  '-6': 'Z_VERSION_ERROR',
+});
+
+type InputType = string | ArrayBuffer | ArrayBufferView;
+type CompressCallback = (error: Error | null, result?: Buffer) => void;
+
+export interface ZlibOptions extends TransformOptions {
+  flush?: number;
+  finishFlush?: number;
+  chunkSize?: number;
+  windowBits?: number;
+  level?: number;
+  memLevel?: number;
+  strategy?: number;
+  dictionary?: ArrayBufferView | ArrayBuffer;
+  maxOutputLength?: number;
+}
+
+export interface BrotliOptions extends TransformOptions {
+  flush?: number;
+  finishFlush?: number;
+  chunkSize?: number;
+  params?: Record<number, number | boolean>;
+  maxOutputLength?: number;
+}
+
+function toBuffer(data: unknown, name: string): ArrayBufferView {
+  if (typeof data === 'string') {
+    return Buffer.from(data);
+  } else if (isAnyArrayBuffer(data)) {
+    return new Uint8Array(data as ArrayBuffer);
+  } else if (!isArrayBufferView(data)) {
+    throw new ERR_INVALID_ARG_TYPE(
+      name, ['string', 'Buffer', 'TypedArray', 'DataView', 'ArrayBuffer'], data);
+  }
+  return data as ArrayBufferView;
+}
+
+// Returns `def` if `value` is unset, otherwise checks that it is a number in [lower, upper].
+function checkRangesOrGetDefault(value: unknown, name: string, lower: number, upper: number,
+                                 def: number): number {
+  if (value === undefined || Number.isNaN(value)) {
+    return def;
+  }
+  if (typeof value !== 'number') {
+    throw new ERR_INVALID_ARG_TYPE(name, 'number', value);
+  }
+  if (!Number.isFinite(value) || value < lower || value > upper) {
+    throw new ERR_OUT_OF_RANGE(name, `>= ${lower} and <= ${upper}`, value);
+  }
+  return value;
+}
+
+function isBrotliMode(mode: number): boolean {
+  return mode === BROTLI_DECODE || mode === BROTLI_ENCODE;
+}
+
+function isInflateMode(mode: number): boolean {
+  return mode === INFLATE || mode === GUNZIP || mode === INFLATERAW || mode === UNZIP;
+}
+
+// Validates the user-facing options and translates them into what the native codecs expect.
+function nativeOptions(mode: number, opts?: ZlibOptions | BrotliOptions): zlibUtil.Options {
+  if (isBrotliMode(mode)) {
+    const params: Record<string, number> = {};
+    const userParams = (opts as BrotliOptions | undefined)?.params;
+    if (userParams !== undefined) {
+      if (typeof userParams !== 'object' || userParams === null) {
+        throw new ERR_INVALID_ARG_TYPE('options.params', 'Object', userParams);
+      }
+      for (const key of Object.keys(userParams)) {
+        const id = Number(key);
+        if (!Number.isInteger(id) || id < 0) {
+          throw new ERR_INVALID_ARG_VALUE('options.params', key, 'is not a valid parameter');
+        }
+        const value = (userParams as Record<string, unknown>)[key];
+        if (typeof value !== 'number' && typeof value !== 'boolean') {
+          throw new ERR_INVALID_ARG_TYPE('options.params[key]', 'number', value);
+        }
+        params[key] = Number(value);
+      }
+    }
+    return { params };
+  }
+
+  const zlibOpts = opts as ZlibOptions | undefined;
+  if (zlibOpts?.dictionary !== undefined) {
+    throw new ERR_METHOD_NOT_IMPLEMENTED('options.dictionary');
+  }
+
+  // zlib allows a windowBits of 0 when inflating a stream with a header, meaning "use whatever the
+  // header says". Raw streams have no header, so like Node we only allow it for the others.
+  let windowBits: number;
+  if (isInflateMode(mode) && mode !== INFLATERAW && zlibOpts?.windowBits === 0) {
+    windowBits = 0;
+  } else {
+    windowBits = checkRangesOrGetDefault(zlibOpts?.windowBits, 'options.windowBits',
+        Z_MIN_WINDOWBITS, Z_MAX_WINDOWBITS, Z_DEFAULT_WINDOWBITS);
+  }
+  // zlib doesn't support 256 byte windows for raw deflate and quietly bumps them to 512, which
+  // would produce output the matching inflate rejects. Node makes the same adjustment.
+  if (mode === DEFLATERAW && windowBits === 8) {
+    windowBits = 9;
+  }
+
+  return {
+    level: checkRangesOrGetDefault(zlibOpts?.level, 'options.level',
+        Z_MIN_LEVEL, Z_MAX_LEVEL, Z_DEFAULT_LEVEL),
+    windowBits,
+    memLevel: checkRangesOrGetDefault(zlibOpts?.memLevel, 'options.memLevel',
+        Z_MIN_MEMLEVEL, Z_MAX_MEMLEVEL, Z_DEFAULT_MEMLEVEL),
+    strategy: checkRangesOrGetDefault(zlibOpts?.strategy, 'options.strategy',
+        Z_DEFAULT_STRATEGY, Z_FIXED, Z_DEFAULT_STRATEGY),
+  };
+}
+
+function checkMaxOutputLength(opts?: ZlibOptions | BrotliOptions): number | undefined {
+  if (opts?.maxOutputLength === undefined) return undefined;
+  return checkRangesOrGetDefault(opts.maxOutputLength, 'options.maxOutputLength',
+      1, kMaxLength, kMaxLength);
+}
+
+function processSync(mode: number, buffer: InputType,
+                     opts?: ZlibOptions | BrotliOptions): Buffer {
+  const data = toBuffer(buffer, 'buffer');
+  let finishFlush: number;
+  if (isBrotliMode(mode)) {
+    finishFlush = checkRangesOrGetDefault(opts?.finishFlush, 'options.finishFlush',
+        BROTLI_OPERATION_PROCESS, BROTLI_OPERATION_EMIT_METADATA, BROTLI_OPERATION_FINISH);
+  } else {
+    finishFlush = checkRangesOrGetDefault(opts?.finishFlush, 'options.finishFlush',
+        Z_NO_FLUSH, Z_BLOCK, Z_FINISH);
+  }
+  const result = zlibUtil.processSync(data, mode, nativeOptions(mode, opts), finishFlush,
+      checkMaxOutputLength(opts) as number);
+  return Buffer.from(result);
+}
+
+// The native codecs run synchronously, so the callback APIs only defer delivering the result.
+function processAsync(mode: number, buffer: InputType,
+                      optsOrCallback: ZlibOptions | BrotliOptions | CompressCallback,
+                      callback?: CompressCallback): void {
+  let opts: ZlibOptions | BrotliOptions | undefined;
+  if (typeof optsOrCallback === 'function') {
+    callback = optsOrCallback;
+  } else {
+    opts = optsOrCallback;
+  }
+  validateFunction(callback, 'callback');
+  let result: Buffer;
+  try {
+    result = processSync(mode, buffer, opts);
+  } catch (err) {
+    queueMicrotask(() => callback!(err as Error));
+    return;
+  }
+  queueMicrotask(() => callback!(null, result));
+}
+
+export function crc32(data: string | ArrayBufferView, value: number = 0): number {
+  if (typeof value !== 'number' || !Number.isInteger(value) || value < 0 ||
+      value > 0xffffffff) {
+    throw new ERR_OUT_OF_RANGE('value', `>= 0 and <= ${0xffffffff}`, value);
+  }
+  return zlibUtil.crc32(toBuffer(data, 'data'), value);
+}
+
+export function deflateSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(DEFLATE, buffer, opts);
+}
+export function inflateSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(INFLATE, buffer, opts);
+}
+export function gzipSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(GZIP, buffer, opts);
+}
+export function gunzipSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(GUNZIP, buffer, opts);
+}
+export function deflateRawSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(DEFLATERAW, buffer, opts);
+}
+export function inflateRawSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(INFLATERAW, buffer, opts);
+}
+export function unzipSync(buffer: InputType, opts?: ZlibOptions): Buffer {
+  return processSync(UNZIP, buffer, opts);
+}
+export function brotliCompressSync(buffer: InputType, opts?: BrotliOptions): Buffer {
+  return processSync(BROTLI_ENCODE, buffer, opts);
+}
+export function brotliDecompressSync(buffer: InputType, opts?: BrotliOptions): Buffer {
+  return processSync(BROTLI_DECODE, buffer, opts);
+}
+
+export function deflate(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                        callback?: CompressCallback): void {
+  processAsync(DEFLATE, buffer, opts, callback);
+}
+export function inflate(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                        callback?: CompressCallback): void {
+  processAsync(INFLATE, buffer, opts, callback);
+}
+export function gzip(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                     callback?: CompressCallback): void {
+  processAsync(GZIP, buffer, opts, callback);
+}
+export function gunzip(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                       callback?: CompressCallback): void {
+  processAsync(GUNZIP, buffer, opts, callback);
+}
+export function deflateRaw(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                           callback?: CompressCallback): void {
+  processAsync(DEFLATERAW, buffer, opts, callback);
+}
+export function inflateRaw(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                           callback?: CompressCallback): void {
+  processAsync(INFLATERAW, buffer, opts, callback);
+}
+export function unzip(buffer: InputType, opts: ZlibOptions | CompressCallback,
+                      callback?: CompressCallback): void {
+  processAsync(UNZIP, buffer, opts, callback);
+}
+export function brotliCompress(buffer: InputType, opts: BrotliOptions | CompressCallback,
+                               callback?: CompressCallback): void {
+  processAsync(BROTLI_ENCODE, buffer, opts, callback);
+}
+export function brotliDecompress(buffer: InputType, opts: BrotliOptions | CompressCallback,
+                                 callback?: CompressCallback): void {
+  processAsync(BROTLI_DECODE, buffer, opts, callback);
+}
+
+const kFlushFlag = Symbol('kFlushFlag');
+
+type FlushBuffer = Buffer & { [kFlushFlag]?: number };
+
+class ZlibBase extends Transform {
+  public bytesWritten = 0;
+
+  #mode: number;
+  #nativeOptions: zlibUtil.Options;
+  #handle: zlibUtil.ZlibStream | null;
+  #flushFlag: number;
+  #finishFlushFlag: number;
+
+  public constructor(mode: number, opts: ZlibOptions | BrotliOptions | undefined,
+                     defaultFlush: number, defaultFinishFlush: number, maxFlush: number) {
+    if (opts !== undefined && (typeof opts !== 'object' || opts === null)) {
+      throw new ERR_INVALID_ARG_TYPE('options', 'Object', opts);
+    }
+    const flush = checkRangesOrGetDefault(opts?.flush, 'options.flush',
+        defaultFlush, maxFlush, defaultFlush);
+    const finishFlush = checkRangesOrGetDefault(opts?.finishFlush, 'options.finishFlush',
+        defaultFlush, maxFlush, defaultFinishFlush);
+    const chunkSize = checkRangesOrGetDefault(opts?.chunkSize, 'options.chunkSize',
+        Z_MIN_CHUNK, Infinity, Z_DEFAULT_CHUNK);
+    const nativeOpts = nativeOptions(mode, opts);
+
+    super({ ...opts, readableHighWaterMark: chunkSize } as TransformOptions);
+    this.#mode = mode;
+    this.#nativeOptions = nativeOpts;
+    this.#handle = new zlibUtil.ZlibStream(mode, nativeOpts);
+    this.#flushFlag = flush;
+    this.#finishFlushFlag = finishFlush;
+  }
+
+  public get _closed(): boolean {
+    return this.#handle === null;
+  }
+
+  public override _transform(chunk: FlushBuffer | string, encoding: BufferEncoding,
+                              callback: TransformCallback): void {
+    const data = typeof chunk === 'string' ? Buffer.from(chunk, encoding) : chunk;
+    const flushFlag = (chunk as FlushBuffer)[kFlushFlag] ?? this.#flushFlag;
+    this.#process(data, flushFlag, callback);
+  }
+
+  public override _flush(callback: TransformCallback): void {
+    this.#process(Buffer.alloc(0), this.#finishFlushFlag, callback);
+  }
+
+  public override _destroy(err: Error | null, callback: (error?: Error | null) => void): void {
+    this.#handle = null;
+    callback(err);
+  }
+
+  // Emits everything compressed so far. Queued behind any pending writes, like in Node.
+  public flush(kind?: number | (() => void), callback?: () => void): void {
+    if (typeof kind === 'function' || kind === undefined) {
+      callback = kind as (() => void) | undefined;
+      kind = isBrotliMode(this.#mode) ? constants.BROTLI_OPERATION_FLUSH : Z_FULL_FLUSH;
+    }
+    if (this.writableFinished) {
+      if (callback) queueMicrotask(callback);
+      return;
+    }
+    const flushBuffer: FlushBuffer = Buffer.alloc(0);
+    flushBuffer[kFlushFlag] = kind;
+    this.write(flushBuffer, callback as any);
+  }
+
+  public reset(): void {
+    if (this.#handle === null) {
+      throw new ERR_INVALID_ARG_VALUE('this', this, 'zlib binding closed');
+    }
+    this.#handle = new zlibUtil.ZlibStream(this.#mode, this.#nativeOptions);
+  }
+
+  public close(callback?: () => void): void {
+    if (callback) {
+      this.once('close', callback);
+    }
+    this.destroy();
+  }
+
+  public params(_level: number, _strategy: number, _callback: () => void): void {
+    throw new ERR_METHOD_NOT_IMPLEMENTED('params');
+  }
+
+  #process(data: ArrayBufferView, flushFlag: number, callback: TransformCallback): void {
+    if (this.#handle === null) {
+      callback(new ERR_INVALID_ARG_VALUE('this', this, 'zlib binding closed'));
+      return;
+    }
+    let result: ArrayBuffer;
+    try {
+      result = this.#handle.push(data, flushFlag);
+    } catch (err) {
+      callback(err as Error);
+      return;
+    }
+    this.bytesWritten += data.byteLength;
+    if (result.byteLength > 0) {
+      this.push(Buffer.from(result));
+    }
+    callback();
+  }
+}
+
+class Zlib extends ZlibBase {
+  public constructor(mode: number, opts?: ZlibOptions) {
+    super(mode, opts, Z_NO_FLUSH, Z_FINISH, Z_BLOCK);
+  }
+}
+
+class Brotli extends ZlibBase {
+  public constructor(mode: number, opts?: BrotliOptions) {
+    super(mode, opts, BROTLI_OPERATION_PROCESS, BROTLI_OPERATION_FINISH,
+          BROTLI_OPERATION_EMIT_METADATA);
+  }
+}
+
+export class Deflate extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(DEFLATE, opts); }
+}
+export class Inflate extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(INFLATE, opts); }
+}
+export class Gzip extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(GZIP, opts); }
+}
+export class Gunzip extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(GUNZIP, opts); }
+}
+export class DeflateRaw extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(DEFLATERAW, opts); }
+}
+export class InflateRaw extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(INFLATERAW, opts); }
+}
+export class Unzip extends Zlib {
+  public constructor(opts?: ZlibOptions) { super(UNZIP, opts); }
+}
+export class BrotliCompress extends Brotli {
+  public constructor(opts?: BrotliOptions) { super(BROTLI_ENCODE, opts); }
+}
+export class BrotliDecompress extends Brotli {
+  public constructor(opts?: BrotliOptions) { super(BROTLI_DECODE, opts); }
+}
+
+export function createDeflate(opts?: ZlibOptions): Deflate { return new Deflate(opts); }
+export function createInflate(opts?: ZlibOptions): Inflate { return new Inflate(opts); }
+export function createGzip(opts?: ZlibOptions): Gzip { return new Gzip(opts); }
+export function createGunzip(opts?: ZlibOptions): Gunzip { return new Gunzip(opts); }
+export function createDeflateRaw(opts?: ZlibOptions): DeflateRaw { return new DeflateRaw(opts); }
+export function createInflateRaw(opts?: ZlibOptions): InflateRaw { return new InflateRaw(opts); }
+export function createUnzip(opts?: ZlibOptions): Unzip { return new Unzip(opts); }
+export function createBrotliCompress(opts?: BrotliOptions): BrotliCompress {
+  return new BrotliCompress(opts);
+}
+export function createBrotliDecompress(opts?: BrotliOptions): BrotliDecompress {
+  return new BrotliDecompress(opts);
+}
+
+export default {
+  constants,
+  codes,
+  crc32,
+  deflate,
+  deflateSync,
+  inflate,
+  inflateSync,
+  gzip,
+  gzipSync,
+  gunzip,
+  gunzipSync,
+  deflateRaw,
+  deflateRawSync,
+  inflateRaw,
+  inflateRawSync,
+  unzip,
+  unzipSync,
+  brotliCompress,
+  brotliCompressSync,
+  brotliDecompress,
+  brotliDecompressSync,
+  Deflate,
+  Inflate,
+  Gzip,
+  Gunzip,
+  DeflateRaw,
+  InflateRaw,
+  Unzip,
+  BrotliCompress,
+  BrotliDecompress,
+  createDeflate,
+  createInflate,
+  createGzip,
+  createGunzip,
+  createDeflateRaw,
+  createInflateRaw,
+  createUnzip,
+  createBrotliCompress,
+  createBrotliDecompress,
+};
@@ -892,6 +892,21 @@ kj::Array<jsg::Ref<api::WebSocket>> DurableObjectState::getWebSockets(
   return kj::Array<jsg::Ref<api::WebSocket>>();
 }
 
+uint32_t DurableObjectState::broadcast(
+    jsg::Lock& js,
+    kj::OneOf<kj::Array<byte>, kj::String> message,
+    jsg::Optional<BroadcastOptions> options) {
+  auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
+  KJ_IF_SOME(manager, a.getHibernationManager()) {
+    kj::Maybe<kj::StringPtr> tag;
+    KJ_IF_SOME(o, options) {
+      tag = o.tag.map([](kj::StringPtr t) { return t; });
+    }
+    return manager.broadcast(js, kj::mv(message), tag);
+  }
+  return 0;
+}
+
 void DurableObjectState::setWebSocketAutoResponse(
       jsg::Optional<jsg::Ref<WebSocketRequestResponsePair>> maybeReqResp) {
   auto& a = KJ_REQUIRE_NONNULL(IoContext::current().getActor());
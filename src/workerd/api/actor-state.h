@@ -470,6 +470,19 @@ public:
   // Disconnected WebSockets are automatically removed from the list.
   kj::Array<jsg::Ref<api::WebSocket>> getWebSockets(jsg::Lock& js, jsg::Optional<kj::String> tag);
 
+  struct BroadcastOptions {
+    jsg::Optional<kj::String> tag;
+
+    JSG_STRUCT(tag);
+  };
+
+  // Sends a message to every accepted WebSocket matching the given tag (or all of them, if no tag
+  // is provided), and returns how many it was sent to. This is equivalent to calling send() on
+  // each WebSocket returned by getWebSockets(), except that hibernating WebSockets are not woken
+  // up to do it. WebSockets that have been closed are skipped.
+  uint32_t broadcast(jsg::Lock& js, kj::OneOf<kj::Array<byte>, kj::String> message,
+      jsg::Optional<BroadcastOptions> options);
+
   // Sets an object-wide websocket auto response message for a specific
   // request string. All websockets belonging to the same object must
   // reply to the request with the matching response, then store the timestamp at which
@@ -513,6 +526,7 @@ public:
       //   useful to apps in actual production? It's a convenient way to bail out when you discover
       //   your state is inconsistent.
       JSG_METHOD(abort);
+      JSG_METHOD(broadcast);
     }
 
     JSG_TS_ROOT();
@@ -551,6 +565,7 @@ private:
 #define EW_ACTOR_STATE_ISOLATE_TYPES                     \
   api::ActorState,                                       \
   api::DurableObjectState,                               \
+  api::DurableObjectState::BroadcastOptions,             \
   api::DurableObjectTransaction,                         \
   api::DurableObjectStorage,                             \
   api::DurableObjectStorage::TransactionOptions,         \
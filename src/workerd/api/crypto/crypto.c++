@@ -4,6 +4,7 @@
 
 #include "crypto.h"
 #include "impl.h"
+#include "offload.h"
 #include <workerd/api/streams/standard.h>
 #include <openssl/crypto.h>
 #include <openssl/err.h>
@@ -105,9 +106,12 @@ static kj::Maybe<const CryptoAlgorithm&> lookupAlgorithm(kj::StringPtr name) {
     {"HMAC"_kj,              &CryptoKey::Impl::importHmac, &CryptoKey::Impl::generateHmac},
     {"PBKDF2"_kj,            &CryptoKey::Impl::importPbkdf2},
     {"HKDF"_kj,              &CryptoKey::Impl::importHkdf},
-    {"RSASSA-PKCS1-v1_5"_kj, &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
-    {"RSA-PSS"_kj,           &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
-    {"RSA-OAEP"_kj,          &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa},
+    {"RSASSA-PKCS1-v1_5"_kj, &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+     &CryptoKey::Impl::generateRsaAsync},
+    {"RSA-PSS"_kj,           &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+     &CryptoKey::Impl::generateRsaAsync},
+    {"RSA-OAEP"_kj,          &CryptoKey::Impl::importRsa, &CryptoKey::Impl::generateRsa,
+     &CryptoKey::Impl::generateRsaAsync},
     {"ECDSA"_kj,             &CryptoKey::Impl::importEcdsa, &CryptoKey::Impl::generateEcdsa},
     {"ECDH"_kj,              &CryptoKey::Impl::importEcdh, &CryptoKey::Impl::generateEcdh},
     {"NODE-ED25519"_kj,      &CryptoKey::Impl::importEddsa, &CryptoKey::Impl::generateEddsa},
@@ -383,6 +387,27 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::digest(
   });
 }
 
+namespace {
+
+void validateGeneratedKeyUsages(
+    const kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>& cryptoKeyOrPair, size_t keyUsageCount) {
+  KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
+    KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
+      if (keyUsageCount == 0) {
+        auto type = cryptoKey->getType();
+        JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
+            "Secret/private CryptoKeys must have at least one usage.");
+      }
+    }
+    KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
+      JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
+        "Attempt to generate asymmetric keys with no valid private key usages.");
+    }
+  }
+}
+
+}  // namespace
+
 jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> SubtleCrypto::generateKey(
     jsg::Lock& js,
     kj::OneOf<kj::String, GenerateKeyAlgorithm> algorithmParam,
@@ -397,22 +422,20 @@ jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> SubtleCrypto::genera
     JSG_REQUIRE(algoImpl.generateFunc != nullptr, DOMNotSupportedError,
         "Unrecognized key generation algorithm \"", algorithm.name, "\" requested.");
 
+    if (algoImpl.generateAsyncFunc != nullptr && isCryptoOffloadEnabled()) {
+      return algoImpl.generateAsyncFunc(js, algoImpl.name, kj::mv(algorithm), extractable,
+                                        keyUsages)
+          .then(js, [keyUsageCount = keyUsages.size()](jsg::Lock& js,
+              kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> cryptoKeyOrPair) {
+        validateGeneratedKeyUsages(cryptoKeyOrPair, keyUsageCount);
+        return kj::mv(cryptoKeyOrPair);
+      });
+    }
+
     auto cryptoKeyOrPair = algoImpl.generateFunc(js, algoImpl.name, kj::mv(algorithm), extractable,
                                                  keyUsages);
-    KJ_SWITCH_ONEOF(cryptoKeyOrPair) {
-      KJ_CASE_ONEOF(cryptoKey, jsg::Ref<CryptoKey>) {
-        if (keyUsages.size() == 0) {
-          auto type = cryptoKey->getType();
-          JSG_REQUIRE(type != "secret" && type != "private", DOMSyntaxError,
-              "Secret/private CryptoKeys must have at least one usage.");
-        }
-      }
-      KJ_CASE_ONEOF(keyPair, CryptoKeyPair) {
-        JSG_REQUIRE(keyPair.privateKey->getUsageSet().size() != 0, DOMSyntaxError,
-          "Attempt to generate asymmetric keys with no valid private key usages.");
-      }
-    }
-    return cryptoKeyOrPair;
+    validateGeneratedKeyUsages(cryptoKeyOrPair, keyUsages.size());
+    return js.resolvedPromise(kj::mv(cryptoKeyOrPair));
   });
 }
 
@@ -433,13 +456,22 @@ jsg::Promise<jsg::Ref<CryptoKey>> SubtleCrypto::deriveKey(
 
     auto length = getKeyLength(derivedKeyAlgorithm);
 
+    KJ_IF_SOME(kernel, baseKey.impl->prepareDeriveBits(js, kj::mv(algorithm), length)) {
+      return offloadCrypto(js, kj::mv(kernel)).then(js,
+          [self = JSG_THIS, derivedKeyAlgorithm = kj::mv(derivedKeyAlgorithm), extractable,
+           keyUsages = kj::mv(keyUsages)](jsg::Lock& js, kj::Array<kj::byte> secret) mutable {
+        return self->importKeySync(js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm),
+            extractable, kj::mv(keyUsages));
+      });
+    }
+
     auto secret = baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
 
     // TODO(perf): For conformance, importKey() makes a copy of `secret`. In this case we really
     //   don't need to, but rather we ought to call the appropriate CryptoKey::Impl::import*()
     //   function directly.
-    return importKeySync(
-        js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages));
+    return js.resolvedPromise(importKeySync(
+        js, "raw", kj::mv(secret), kj::mv(derivedKeyAlgorithm), extractable, kj::mv(keyUsages)));
   });
 }
 
@@ -462,7 +494,10 @@ jsg::Promise<kj::Array<kj::byte>> SubtleCrypto::deriveBits(
 
   return js.evalNow([&] {
     validateOperation(baseKey, algorithm.name, CryptoKeyUsageSet::deriveBits());
-    return baseKey.impl->deriveBits(js, kj::mv(algorithm), length);
+    KJ_IF_SOME(kernel, baseKey.impl->prepareDeriveBits(js, kj::mv(algorithm), length)) {
+      return offloadCrypto(js, kj::mv(kernel));
+    }
+    return js.resolvedPromise(baseKey.impl->deriveBits(js, kj::mv(algorithm), length));
   });
 }
 
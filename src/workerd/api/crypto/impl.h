@@ -128,6 +128,15 @@ public:
   static GenerateFunc generateEcdh;
   static GenerateFunc generateEddsa;
 
+  // Like GenerateFunc, but may run the expensive part of key generation on the crypto thread pool
+  // (see offload.h). Provided only for algorithms where generation is slow enough to matter.
+  using GenerateAsyncFunc = jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>>(
+      jsg::Lock& js, kj::StringPtr normalizedName,
+      SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
+      kj::ArrayPtr<const kj::String> keyUsages);
+
+  static GenerateAsyncFunc generateRsaAsync;
+
   Impl(bool extractable, CryptoKeyUsageSet usages) : extractable(extractable), usages(usages) {}
 
   static kj::Own<CryptoKey::Impl> from(kj::Own<EVP_PKEY> key);
@@ -169,6 +178,20 @@ public:
         getAlgorithmName(), "\".");
   }
 
+  // A derivation that has been validated and has copied everything it needs, so that it can run
+  // on any thread, after the key and the algorithm object are gone. See offload.h.
+  using DeriveBitsKernel = kj::Function<kj::Array<kj::byte>()>;
+
+  // Implemented by keys whose derivation is expensive enough to be worth running off the isolate
+  // thread. Performs the same validation as deriveBits() and throws the same errors, but returns
+  // the derivation itself as a kernel. Returns kj::none if the algorithm doesn't support this, in
+  // which case deriveBits() should be used.
+  virtual kj::Maybe<DeriveBitsKernel> prepareDeriveBits(
+      jsg::Lock& js,
+      SubtleCrypto::DeriveKeyAlgorithm&& algorithm, kj::Maybe<uint32_t> length) const {
+    return kj::none;
+  }
+
   virtual kj::Array<kj::byte> wrapKey(SubtleCrypto::EncryptAlgorithm&& algorithm,
       kj::ArrayPtr<const kj::byte> unwrappedKey) const {
     // For many algorithms, wrapKey() is the same as encrypt(), so as a convenience the default
@@ -249,6 +272,9 @@ struct CryptoAlgorithm {
   //   template metaprogramming cannot recognize it as const). Maybe we can fix this in KJ, by
   //   making `RemoveConstOrDisable` recognize function references are inherenly const.
 
+  // Optional offloaded variant of `generateFunc`, preferred by generateKey() when present.
+  CryptoKey::Impl::GenerateAsyncFunc* generateAsyncFunc = nullptr;
+
   // Allow comparison by name, case-insensitive. This is a convenience for placing in an std::set.
   inline bool operator==(const CryptoAlgorithm& other) const {
     return strcasecmp(name.cStr(), other.name.cStr()) == 0;
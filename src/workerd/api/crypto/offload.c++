@@ -0,0 +1,113 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "offload.h"
+#include <workerd/util/autogate.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+#include <kj/vector.h>
+#include <openssl/err.h>
+#include <deque>
+#include <thread>
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace workerd::api {
+
+namespace {
+
+// A fixed-size pool of threads pulling jobs off a shared queue. Jobs are short-lived and
+// independent, so a plain FIFO is all we need.
+class CryptoThreadPool {
+public:
+  explicit CryptoThreadPool(uint threadCount) {
+    threads.reserve(threadCount);
+    for (uint i = 0; i < threadCount; i++) {
+      threads.add(kj::heap<kj::Thread>([this]() { run(); }));
+    }
+  }
+
+  ~CryptoThreadPool() noexcept(false) {
+    state.lockExclusive()->shuttingDown = true;
+    // Joins each thread. Any jobs still queued at this point are dropped, which rejects their
+    // cross-thread fulfillers.
+    threads.clear();
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(CryptoThreadPool);
+
+  void queue(kj::Function<void()> job) {
+    state.lockExclusive()->queue.push_back(kj::mv(job));
+  }
+
+private:
+  struct State {
+    std::deque<kj::Function<void()>> queue;
+    bool shuttingDown = false;
+  };
+  kj::MutexGuarded<State> state;
+  kj::Vector<kj::Own<kj::Thread>> threads;
+
+  void run() {
+    for (;;) {
+      auto maybeJob = state.when([](const State& s) {
+        return s.shuttingDown || !s.queue.empty();
+      }, [](State& s) -> kj::Maybe<kj::Function<void()>> {
+        if (s.shuttingDown) return kj::none;
+        auto job = kj::mv(s.queue.front());
+        s.queue.pop_front();
+        return kj::mv(job);
+      });
+      KJ_IF_SOME(job, maybeJob) {
+        job();
+      } else {
+        return;
+      }
+      // Don't let errors from one job leak into the next job run on this thread.
+      ERR_clear_error();
+    }
+  }
+};
+
+CryptoThreadPool& getCryptoThreadPool() {
+  // Keep a couple of cores free for the event loop threads; the pool only needs to absorb the
+  // occasional burst of expensive operations.
+  static CryptoThreadPool pool(kj::max(1u, kj::min(std::thread::hardware_concurrency() / 2, 4u)));
+  return pool;
+}
+
+}  // namespace
+
+bool isCryptoOffloadEnabled() {
+  return util::Autogate::isEnabled(util::AutogateKey::CRYPTO_OFFLOAD);
+}
+
+namespace _ {  // private
+
+void queueCryptoJob(kj::Function<void()> job) {
+  getCryptoThreadPool().queue(kj::mv(job));
+}
+
+kj::Duration getThreadCpuTime() {
+#if _WIN32
+  FILETIME creation, exit, kernel, user;
+  KJ_ASSERT(GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user));
+  auto toNanos = [](FILETIME t) {
+    return ((uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime) * 100;
+  };
+  return (toNanos(kernel) + toNanos(user)) * kj::NANOSECONDS;
+#else
+  struct timespec ts;
+  KJ_SYSCALL(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts));
+  return ts.tv_sec * kj::SECONDS + ts.tv_nsec * kj::NANOSECONDS;
+#endif
+}
+
+}  // namespace _
+
+}  // namespace workerd::api
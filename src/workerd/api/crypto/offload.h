@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// Offloading of CPU-heavy crypto work (PBKDF2, scrypt, RSA key generation) to a small pool of
+// background threads, so that it doesn't hold the isolate lock while other requests wait.
+//
+// The unit of work is a "kernel": a function that performs the expensive part of an operation
+// using only data it owns. A kernel must not touch JS values, the isolate, the IoContext, or
+// anything borrowed from a CryptoKey, since it may run on another thread after those are gone.
+// Callers validate parameters and copy their inputs on the isolate thread, then hand the kernel to
+// offloadCrypto().
+//
+// Offloading is opt-in, controlled by the `crypto-offload` autogate. When it is off, or when there
+// is no IoContext to deliver the result to, the kernel simply runs on the calling thread and the
+// returned promise is already settled, exactly as if the operation had been synchronous.
+
+#include <workerd/io/io-context.h>
+#include <workerd/jsg/jsg.h>
+#include <kj/async.h>
+#include <kj/function.h>
+
+namespace workerd::api {
+
+// Whether offloadCrypto() currently runs kernels on the background pool.
+bool isCryptoOffloadEnabled();
+
+namespace _ {  // private
+
+// Queues `job` to run on the crypto thread pool. The job must not throw.
+void queueCryptoJob(kj::Function<void()> job);
+
+// CPU time consumed by the calling thread so far.
+kj::Duration getThreadCpuTime();
+
+template <typename T>
+struct OffloadedResult {
+  T value;
+  kj::Duration cpuTime;
+};
+
+}  // namespace _
+
+// Runs `kernel` on the crypto thread pool when offloading is enabled, and resolves the returned
+// promise back in the current IoContext. The CPU time the kernel used is charged to the request
+// through LimitEnforcer::reportOffloadedCpuTime(), since it wasn't covered by enterJs().
+template <typename T>
+jsg::Promise<T> offloadCrypto(jsg::Lock& js, kj::Function<T()> kernel) {
+  if (!isCryptoOffloadEnabled() || !IoContext::hasCurrent()) {
+    return js.evalNow([&] { return kernel(); });
+  }
+
+  auto& context = IoContext::current();
+  auto paf = kj::newPromiseAndCrossThreadFulfiller<_::OffloadedResult<T>>();
+  _::queueCryptoJob([kernel = kj::mv(kernel), fulfiller = kj::mv(paf.fulfiller)]() mutable {
+    // If the request has gone away in the meantime the fulfiller is simply ignored.
+    auto start = _::getThreadCpuTime();
+    KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+      auto value = kernel();
+      fulfiller->fulfill(_::OffloadedResult<T> {
+        .value = kj::mv(value),
+        .cpuTime = _::getThreadCpuTime() - start,
+      });
+    })) {
+      fulfiller->reject(kj::mv(exception));
+    }
+  });
+
+  return context.awaitIo(js, paf.promise.then(
+      [&context](_::OffloadedResult<T> result) -> T {
+    context.getLimitEnforcer().reportOffloadedCpuTime(result.cpuTime);
+    return kj::mv(result.value);
+  }));
+}
+
+}  // namespace workerd::api
@@ -27,6 +27,13 @@ private:
   kj::Array<kj::byte> deriveBits(
       jsg::Lock& js, SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
       kj::Maybe<uint32_t> maybeLength) const override {
+    auto kernel = KJ_ASSERT_NONNULL(prepareDeriveBits(js, kj::mv(algorithm), maybeLength));
+    return kernel();
+  }
+
+  kj::Maybe<DeriveBitsKernel> prepareDeriveBits(
+      jsg::Lock& js, SubtleCrypto::DeriveKeyAlgorithm&& algorithm,
+      kj::Maybe<uint32_t> maybeLength) const override {
     kj::StringPtr hashName = api::getAlgorithmName(JSG_REQUIRE_NONNULL(algorithm.hash, TypeError,
         "Missing field \"hash\" in \"algorithm\"."));
     auto hashType = lookupDigestAlgorithm(hashName).second;
@@ -53,8 +60,13 @@ private:
     // wisest.
     checkPbkdfLimits(js, iterations);
 
-    return JSG_REQUIRE_NONNULL(pbkdf2(length / 8, iterations, hashType, keyData, salt),
-        Error, "PBKDF2 deriveBits failed.");
+    // The kernel may outlive both this key and the algorithm object, so it gets its own copies.
+    auto password = kj::heap<ZeroOnFree>(kj::heapArray(keyData.asPtr()));
+    return DeriveBitsKernel([length, iterations, hashType, password = kj::mv(password),
+                             salt = kj::heapArray<kj::byte>(salt)]() -> kj::Array<kj::byte> {
+      return JSG_REQUIRE_NONNULL(pbkdf2(length / 8, iterations, hashType, *password, salt),
+          Error, "PBKDF2 deriveBits failed.");
+    });
   }
 
   // TODO(bug): Possibly by mistake, PBKDF2 was historically not on the allow list of
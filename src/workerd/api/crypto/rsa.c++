@@ -1,6 +1,7 @@
 #include "rsa.h"
 #include "impl.h"
 #include "keys.h"
+#include "offload.h"
 #include <kj/common.h>
 #include <kj/array.h>
 #include <openssl/bn.h>
@@ -813,13 +814,17 @@ kj::Own<EVP_PKEY> rsaJwkReader(SubtleCrypto::JsonWebKey&& keyDataJwk) {
   OSSLCALL(EVP_PKEY_set1_RSA(evpPkey.get(), rsaKey.get()));
   return evpPkey;
 }
-}  // namespace
 
-kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
-    jsg::Lock& js, kj::StringPtr normalizedName,
-    SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
-    kj::ArrayPtr<const kj::String> keyUsages) {
+struct RsaKeygenParams {
+  int modulusLength;
+  kj::Own<BIGNUM> exponent;
+  CryptoKey::RsaKeyAlgorithm keyAlgorithm;
+  CryptoKeyUsageSet usages;
+};
 
+// Validates the parameters of an RSA generateKey() call, throwing the appropriate errors.
+RsaKeygenParams validateRsaKeygen(jsg::Lock& js, kj::StringPtr normalizedName,
+    SubtleCrypto::GenerateKeyAlgorithm&& algorithm, kj::ArrayPtr<const kj::String> keyUsages) {
   KJ_ASSERT(normalizedName == "RSASSA-PKCS1-v1_5" ||
             normalizedName == "RSA-PSS" ||
             normalizedName == "RSA-OAEP",
@@ -856,24 +861,64 @@ kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
   auto bnExponent = JSG_REQUIRE_NONNULL(toBignum(publicExponent), InternalDOMOperationError,
       "Error setting up RSA keygen.");
 
+  return {
+    .modulusLength = modulusLength,
+    .exponent = kj::mv(bnExponent),
+    .keyAlgorithm = {
+      .name = normalizedName,
+      .modulusLength = static_cast<uint16_t>(modulusLength),
+      .publicExponent = kj::mv(publicExponent),
+      .hash = KeyAlgorithm { normalizedHashName }
+    },
+    .usages = usages,
+  };
+}
+
+struct RsaEvpKeys {
+  kj::Own<EVP_PKEY> privateKey;
+  kj::Own<EVP_PKEY> publicKey;
+};
+
+// The expensive part of RSA key generation. Touches nothing but its arguments, so it can run on
+// the crypto thread pool.
+RsaEvpKeys generateRsaEvpKeys(int modulusLength, const BIGNUM& exponent) {
   auto rsaPrivateKey = OSSL_NEW(RSA);
-  OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, bnExponent.get(), 0));
+  OSSLCALL(RSA_generate_key_ex(rsaPrivateKey, modulusLength, &exponent, 0));
   auto privateEvpPKey = OSSL_NEW(EVP_PKEY);
   OSSLCALL(EVP_PKEY_set1_RSA(privateEvpPKey.get(), rsaPrivateKey.get()));
   kj::Own<RSA> rsaPublicKey = OSSLCALL_OWN(RSA, RSAPublicKey_dup(rsaPrivateKey.get()),
       InternalDOMOperationError, "Error finalizing RSA keygen", internalDescribeOpensslErrors());
   auto publicEvpPKey = OSSL_NEW(EVP_PKEY);
   OSSLCALL(EVP_PKEY_set1_RSA(publicEvpPKey.get(), rsaPublicKey));
+  return { .privateKey = kj::mv(privateEvpPKey), .publicKey = kj::mv(publicEvpPKey) };
+}
+}  // namespace
 
-  auto keyAlgorithm = CryptoKey::RsaKeyAlgorithm {
-    .name = normalizedName,
-    .modulusLength = static_cast<uint16_t>(modulusLength),
-    .publicExponent = kj::mv(publicExponent),
-    .hash = KeyAlgorithm { normalizedHashName }
-  };
+kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> CryptoKey::Impl::generateRsa(
+    jsg::Lock& js, kj::StringPtr normalizedName,
+    SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
+    kj::ArrayPtr<const kj::String> keyUsages) {
+  auto params = validateRsaKeygen(js, normalizedName, kj::mv(algorithm), keyUsages);
+  auto keys = generateRsaEvpKeys(params.modulusLength, *params.exponent);
+  return generateRsaPair(js, normalizedName, kj::mv(keys.privateKey), kj::mv(keys.publicKey),
+      kj::mv(params.keyAlgorithm), extractable, params.usages);
+}
 
-  return generateRsaPair(js, normalizedName, kj::mv(privateEvpPKey), kj::mv(publicEvpPKey),
-      kj::mv(keyAlgorithm), extractable, usages);
+jsg::Promise<kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair>> CryptoKey::Impl::generateRsaAsync(
+    jsg::Lock& js, kj::StringPtr normalizedName,
+    SubtleCrypto::GenerateKeyAlgorithm&& algorithm, bool extractable,
+    kj::ArrayPtr<const kj::String> keyUsages) {
+  auto params = validateRsaKeygen(js, normalizedName, kj::mv(algorithm), keyUsages);
+  auto kernel = [modulusLength = params.modulusLength, exponent = kj::mv(params.exponent)]() {
+    return generateRsaEvpKeys(modulusLength, *exponent);
+  };
+  return offloadCrypto<RsaEvpKeys>(js, kj::mv(kernel)).then(js,
+      [normalizedName, keyAlgorithm = kj::mv(params.keyAlgorithm), extractable,
+       usages = params.usages](jsg::Lock& js, RsaEvpKeys keys) mutable
+      -> kj::OneOf<jsg::Ref<CryptoKey>, CryptoKeyPair> {
+    return generateRsaPair(js, normalizedName, kj::mv(keys.privateKey), kj::mv(keys.publicKey),
+        kj::mv(keyAlgorithm), extractable, usages);
+  });
 }
 
 kj::Own<CryptoKey::Impl> CryptoKey::Impl::importRsa(
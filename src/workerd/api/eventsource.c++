@@ -8,6 +8,7 @@
 #include <workerd/io/features.h>
 #include <workerd/jsg/exception.h>
 #include <workerd/util/mimetype.h>
+#include <limits>
 
 namespace workerd::api {
 
@@ -17,11 +18,11 @@ public:
   EventSourceSink(EventSource& eventSource) : eventSource(eventSource) {}
 
   kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override {
-    // The event stream is a new-line delimited format where each line represents an event.
-    // We need to scan the buffer for end-of-line characters. When we find one, everything before
-    // it is pushed into the event queue and we keep scanning. If we do not find an end-of-line
-    // sequence in the remaining input, we buffer it and wait for the next write to continue
-    // scanning, or until the stream is ended or aborted.
+    // The event stream is a new-line delimited format where each line represents a field. We
+    // scan the buffer in place for end-of-line characters and process each complete line
+    // directly out of the buffer. Only a trailing partial line is copied, into `kept`, to be
+    // completed by the next write. All messages completed by this write are handed to the
+    // EventSource as a single batch.
 
     if (eventSource == kj::none) {
       // Write was received after end() or abort() was called.
@@ -45,17 +46,27 @@ public:
       }
     }
 
-    while (input != nullptr) {
-      KJ_IF_SOME(found, findEndOfLine(input)) {
-          auto prefix = kept.releaseAsArray();
-          // Feed the line into the processor.
-          feed(kj::str(prefix, input.slice(0, found.pos)));
-          input = found.remaining;
-          // If we've reached the end of the input, input will == nullptr here.
+    // A CR ending the previous write may be the first half of a CRLF pair.
+    if (skipLeadingLf && input.size() > 0) {
+      skipLeadingLf = false;
+      if (input[0] == '\n') input = input.slice(1);
+    }
+
+    LineScanner scanner(input);
+    while (scanner.hasMore()) {
+      KJ_IF_SOME(line, scanner.next(skipLeadingLf)) {
+        if (kept.size() > 0) {
+          kept.addAll(line);
+          feed(kept.asPtr());
+          kept.clear();
+        } else {
+          feed(line);
+        }
       } else {
-        // No end-of-line found, buffer the input.
-        kept.addAll(input.begin(), input.end());
-        input = nullptr;
+        // No end-of-line found, buffer the rest of the input.
+        auto rest = scanner.rest();
+        kept.addAll(rest.begin(), rest.end());
+        break;
       }
     }
 
@@ -93,20 +104,67 @@ private:
   // The collected messages that are pending to be dispatched as events
   kj::Vector<EventSource::PendingMessage> pendingMessages;
 
-  // The message that is currently being processed.
-  kj::Maybe<EventSource::PendingMessage> currentPendingMessage;
+  // The message that is currently being processed. Data lines are appended directly to
+  // `currentData`, each followed by a line feed, per the spec's "data buffer".
+  kj::Maybe<kj::String> currentEvent;
+  kj::Vector<char> currentData;
+  bool hasCurrentMessage = false;
 
   // Set to true once the byte-order-mark has been checked
   bool bomChecked = false;
 
-  EventSource::PendingMessage& getPendingMessage() {
-    KJ_IF_SOME(pending, currentPendingMessage) {
-      return pending;
+  // Set when the last write ended in a CR, in which case an LF starting the next write belongs
+  // to the same end-of-line sequence.
+  bool skipLeadingLf = false;
+
+  // Splits a chunk into lines ending with \n, \r, or \r\n. Uses memchr() to find each kind of
+  // line terminator, remembering the next position of each so that every byte is scanned at most
+  // once per terminator kind no matter how many lines the chunk contains.
+  class LineScanner {
+  public:
+    explicit LineScanner(kj::ArrayPtr<const char> input)
+        : pos(input.begin()), end(input.end()) {}
+
+    bool hasMore() const { return pos < end; }
+    kj::ArrayPtr<const char> rest() const { return kj::arrayPtr(pos, end); }
+
+    // Returns the next complete line, without its terminator, or none if the remaining input has
+    // no terminator. Sets `endsWithCr` if the input ended on a CR that may be followed by an LF
+    // at the start of the next chunk.
+    kj::Maybe<kj::ArrayPtr<const char>> next(bool& endsWithCr) {
+      const char* lf = find(nextLf, '\n');
+      const char* cr = find(nextCr, '\r');
+      const char* eol = kj::min(lf, cr);
+      if (eol == end) return kj::none;
+
+      auto line = kj::arrayPtr(pos, eol);
+      pos = eol + 1;
+      if (eol == cr) {
+        if (pos == end) {
+          endsWithCr = true;
+        } else if (*pos == '\n') {
+          ++pos;
+        }
+      }
+      return line;
     }
-    return currentPendingMessage.emplace();
-  }
 
-  void feed(kj::String line) {
+  private:
+    const char* pos;
+    const char* end;
+    const char* nextLf = nullptr;
+    const char* nextCr = nullptr;
+
+    const char* find(const char*& cached, char c) {
+      if (cached == nullptr || (cached < pos && cached != end)) {
+        auto found = memchr(pos, c, end - pos);
+        cached = found == nullptr ? end : static_cast<const char*>(found);
+      }
+      return cached;
+    }
+  };
+
+  void feed(kj::ArrayPtr<const char> line) {
     // Parse line according to the event stream format and dispatch the event.
 
     // stream        = [ bom ] *event
@@ -133,49 +191,70 @@ private:
     if (line.size() == 0) {
       // Dispatch the current pending message and clear it. If there is no
       // pending message, we'll just ignore the line.
-      KJ_IF_SOME(pending, currentPendingMessage) {
+      if (hasCurrentMessage) {
         // This message is done and ready to be dispatched. Add it to the
         // pendingMessages list. The next time release() is called, it will
         // be passed off to the EventSource.
-        pending.id = kj::str(KJ_ASSERT_NONNULL(eventSource).getLastEventId());
-        pendingMessages.add(kj::mv(pending));
-        currentPendingMessage = kj::none;
+        if (currentData.size() > 0) {
+          // Drop the line feed following the last data line.
+          currentData.removeLast();
+        }
+        currentData.add('\0');
+        pendingMessages.add(EventSource::PendingMessage {
+          .data = kj::String(currentData.releaseAsArray()),
+          .event = kj::mv(currentEvent),
+          .id = kj::str(KJ_ASSERT_NONNULL(eventSource).getLastEventId()),
+        });
+        currentEvent = kj::none;
+        hasCurrentMessage = false;
       }
     } else if (line[0] == ':') {
       // Ignore the line.
     } else {
-      static constexpr auto handle =
-          [](auto& self, kj::ArrayPtr<const char> field, kj::ArrayPtr<const char> value) {
-        auto& pending = self.getPendingMessage();
-        auto& ev = KJ_ASSERT_NONNULL(self.eventSource);
+      kj::ArrayPtr<const char> field = line;
+      kj::ArrayPtr<const char> value;
+      auto colon = memchr(line.begin(), ':', line.size());
+      if (colon != nullptr) {
+        size_t pos = static_cast<const char*>(colon) - line.begin();
+        field = line.slice(0, pos);
+        value = line.slice(pos + 1);
         // Per the spec, only one space after the colon is optional and trimmed.
         // Any other whitespace, or additional spaces aren't accounted for so would
         // be part of the value.
         if (value.size() > 0 && value[0] == ' ') {
           value = value.slice(1);
         }
-        if (field == "data"_kjc) {
-          pending.data.add(kj::str(value));
-        } else if (field == "event"_kjc) {
-          pending.event = kj::str(value);
-        } else if (field == "id"_kjc) {
-          ev.setLastEventId(kj::str(value));
-        } else if (field == "retry"_kjc) {
-          KJ_IF_SOME(time, kj::str(value).tryParseAs<uint32_t>()) {
-            KJ_ASSERT_NONNULL(self.eventSource).setReconnectionTime(time);
-          }
-          // Ignore the line if it cannot be successfully parsed as a uint32_t
-        }
-      };
+      }
 
-      KJ_IF_SOME(pos, line.findFirst(':')) {
-        handle(*this, line.slice(0, pos), line.slice(pos + 1));
-      } else {
-        handle(*this, line, ""_kjc);
+      hasCurrentMessage = true;
+      auto& ev = KJ_ASSERT_NONNULL(eventSource);
+      if (field == "data"_kjc) {
+        currentData.addAll(value);
+        currentData.add('\n');
+      } else if (field == "event"_kjc) {
+        currentEvent = kj::str(value);
+      } else if (field == "id"_kjc) {
+        ev.setLastEventId(kj::str(value));
+      } else if (field == "retry"_kjc) {
+        KJ_IF_SOME(time, parseRetry(value)) {
+          ev.setReconnectionTime(time);
+        }
+        // Ignore the line if it cannot be successfully parsed as a uint32_t
       }
     }
   }
 
+  static kj::Maybe<uint32_t> parseRetry(kj::ArrayPtr<const char> value) {
+    if (value.size() == 0) return kj::none;
+    uint64_t result = 0;
+    for (char c: value) {
+      if (c < '0' || c > '9') return kj::none;
+      result = result * 10 + (c - '0');
+      if (result > std::numeric_limits<uint32_t>::max()) return kj::none;
+    }
+    return static_cast<uint32_t>(result);
+  }
+
   void release() {
     if (pendingMessages.size() == 0) return;
     auto pending = pendingMessages.releaseAsArray();
@@ -189,28 +268,9 @@ private:
     eventSource = kj::none;
     kept.clear();
     pendingMessages.clear();
-    currentPendingMessage = kj::none;
-  }
-
-  struct EndOfLine {
-    size_t pos;
-    kj::ArrayPtr<const char> remaining;
-  };
-  kj::Maybe<EndOfLine> findEndOfLine(kj::ArrayPtr<const char> input) {
-    // The end-of-line marker is either \n, \r, or \r\n
-    size_t pos = 0;
-    while (pos < input.size()) {
-      if (input[pos] == '\n') {
-        return EndOfLine{pos, input.slice(pos + 1)};
-      } else if (input[pos] == '\r') {
-        if (pos + 1 < input.size() && input[pos + 1] == '\n') {
-          return EndOfLine{pos, input.slice(pos + 2)};
-        }
-        return EndOfLine{pos, input.slice(pos + 1)};
-      }
-      pos++;
-    }
-    return kj::none;
+    currentEvent = kj::none;
+    currentData.clear();
+    hasCurrentMessage = false;
   }
 };
 
@@ -307,11 +367,10 @@ void EventSource::notifyMessages(jsg::Lock& js, kj::Array<PendingMessage> messag
   if (readyState == State::CLOSED) return;
   js.tryCatch([&] {
     for (auto& message : messages) {
-        auto data = kj::str(kj::delimited(kj::mv(message.data), "\n"_kjc));
-        if (data.size() == 0) continue;
+        if (message.data.size() == 0) continue;
         dispatchEventImpl(js, jsg::alloc<MessageEvent>(
             kj::mv(message.event),
-            kj::mv(data),
+            kj::mv(message.data),
             kj::mv(message.id),
             impl.map([](FetchImpl& i) -> jsg::Url& { return i.url; })));
     }
@@ -176,7 +176,8 @@ public:
   }
 
   struct PendingMessage {
-    kj::Vector<kj::String> data;
+    // The message's data lines, joined with line feeds.
+    kj::String data;
     kj::Maybe<kj::String> event;
     kj::String id;
   };
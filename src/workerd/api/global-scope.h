@@ -102,7 +102,7 @@ public:
 
   JSG_RESOURCE_TYPE(Performance) {
     JSG_READONLY_INSTANCE_PROPERTY(timeOrigin, getTimeOrigin);
-    JSG_METHOD(now);
+    JSG_FAST_METHOD(now);
   }
 };
 
@@ -8,6 +8,10 @@
 #include "c-api/include/lol_html.h"
 #include <workerd/io/features.h>
 #include <workerd/io/io-context.h>
+#include <workerd/util/uuid.h>
+#include <kj/mutex.h>
+#include <kj/table.h>
+#include <algorithm>
 
 struct lol_html_HtmlRewriter {};
 struct lol_html_HtmlRewriterBuilder {};
@@ -137,6 +141,96 @@ decltype(auto) checkToken(kj::Maybe<T>& impl) {
 
 }  // namespace
 
+// =======================================================================================
+// HTMLRewriterSelectorCache
+
+class HTMLRewriterSelectorCache::Selector final: public kj::AtomicRefcounted {
+public:
+  explicit Selector(kj::StringPtr source)
+      : selector(LOL_HTML_OWN(selector, lol_html_selector_parse(source.cStr(), source.size()))) {}
+
+  const lol_html_Selector& get() const { return *selector; }
+
+private:
+  kj::Own<lol_html_Selector> selector;
+};
+
+struct HTMLRewriterSelectorCache::Impl {
+  struct Entry {
+    kj::String source;
+    kj::Own<const Selector> selector;
+  };
+
+  struct EntryCallbacks {
+    inline kj::StringPtr keyForRow(const Entry& entry) const { return entry.source; }
+    inline bool matches(const Entry& entry, kj::StringPtr source) const {
+      return entry.source == source;
+    }
+    inline uint hashCode(kj::StringPtr source) const { return kj::hashCode(source); }
+  };
+
+  struct State {
+    // Insertion order doubles as recency order: hits are released and re-inserted at the back, so
+    // the front of the insertion-order index is always the least-recently-used entry.
+    kj::Table<Entry, kj::HashIndex<EntryCallbacks>, kj::InsertionOrderIndex> entries;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  explicit Impl(size_t maxEntries): maxEntries(maxEntries) {}
+
+  const size_t maxEntries;
+  kj::MutexGuarded<State> state;
+};
+
+HTMLRewriterSelectorCache::HTMLRewriterSelectorCache(size_t maxEntries)
+    : impl(kj::heap<Impl>(maxEntries)) {}
+HTMLRewriterSelectorCache::~HTMLRewriterSelectorCache() noexcept(false) {}
+
+const HTMLRewriterSelectorCache& HTMLRewriterSelectorCache::getShared() {
+  static const HTMLRewriterSelectorCache SHARED;
+  return SHARED;
+}
+
+kj::Own<const HTMLRewriterSelectorCache::Selector> HTMLRewriterSelectorCache::get(
+    kj::StringPtr source) const {
+  {
+    auto lock = impl->state.lockExclusive();
+    KJ_IF_SOME(entry, lock->entries.find(source)) {
+      ++lock->hits;
+      auto result = kj::atomicAddRef(*entry.selector);
+      // Move to the back of the recency order.
+      lock->entries.insert(lock->entries.release(entry));
+      return result;
+    }
+    ++lock->misses;
+  }
+
+  // Parse outside the lock. Invalid selectors throw here, before anything is evicted.
+  kj::Own<const Selector> selector = kj::atomicRefcounted<Selector>(source);
+  auto result = kj::atomicAddRef(*selector);
+  if (impl->maxEntries == 0) {
+    return result;
+  }
+
+  auto lock = impl->state.lockExclusive();
+  auto& entries = lock->entries;
+  if (entries.find(source) != kj::none) {
+    // Another thread parsed the same selector concurrently; keep its copy.
+    return result;
+  }
+  if (entries.size() >= impl->maxEntries) {
+    entries.erase(*entries.ordered<1>().begin());
+  }
+  entries.insert(Impl::Entry { kj::str(source), kj::mv(selector) });
+  return result;
+}
+
+HTMLRewriterSelectorCache::Stats HTMLRewriterSelectorCache::getStats() const {
+  auto lock = impl->state.lockShared();
+  return { lock->entries.size(), lock->hits, lock->misses };
+}
+
 // =======================================================================================
 // HTMLRewriter::TokenScope
 
@@ -166,7 +260,7 @@ namespace {
 using ElementCallbackFunction = HTMLRewriter::ElementCallbackFunction;
 
 struct UnregisteredElementHandlers {
-  kj::Own<lol_html_Selector> selector;
+  kj::Own<const HTMLRewriterSelectorCache::Selector> selector;
 
   // The actual handler functions. We store them as jsg::Values for compatibility with GcVisitor.
 
@@ -232,6 +326,18 @@ public:
   // Implementation for `Element::onEndTag` to avoid exposing private details of Rewriter.
   void onEndTag(lol_html_element_t *element, ElementCallbackFunction&& callback);
 
+  // Content to hand to one of lol-html's content mutation functions.
+  struct UnwrappedContent {
+    kj::String content;
+    bool html;
+  };
+
+  // Implementation for the content token mutation functions. Strings are passed through. Streams
+  // and Responses are replaced by a marker (which is always HTML, so that lol-html won't escape
+  // it); when the marker reaches `outputImpl()`, the stream is pumped into the output in its place.
+  UnwrappedContent unwrapContent(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+
 private:
   // Wait for the write promise (if any) produced by our `output()` callback, then, if there is a
   // stored exception, abort the wrapped WritableStreamSink with it, then return the exception.
@@ -245,6 +351,14 @@ private:
   static void output(const char* buffer, size_t size, void* userdata);
   void outputImpl(kj::ArrayPtr<const byte> buffer);
 
+  // Chain a write of `buffer` (copied) or of the pending stream content with the given ID onto
+  // `writePromise`.
+  void queueWrite(kj::ArrayPtr<const byte> buffer);
+  void queueStreamContent(uint id);
+
+  static kj::Promise<void> writeStreamContent(
+      WritableStreamSink& output, kj::Own<ReadableStreamSource> source, bool html);
+
   void tryHandleCancellation(int rc) {
     if (canceled) {
       canceled = false;
@@ -280,6 +394,11 @@ private:
   kj::Vector<kj::Own<RegisteredHandler>> registeredEndTagHandlers;
   // TODO(perf) Don't store Owns, same as `registeredHandlers` above.
 
+  // The selectors our handlers were registered with. These are shared with the
+  // HTMLRewriterSelectorCache, which may evict them while we're still running, so we hold our own
+  // references for as long as the native rewriter exists.
+  kj::Vector<kj::Own<const HTMLRewriterSelectorCache::Selector>> selectors;
+
   template <typename T, typename CType = typename T::CType>
   static lol_html_rewriter_directive_t thunk(CType* content, void* userdata);
   template <typename T, typename CType = typename T::CType>
@@ -309,6 +428,20 @@ private:
 
   kj::Maybe<jsg::Ref<jsg::AsyncContextFrame>> maybeAsyncContext;
 
+  // Stream content which has been inserted into the document but whose marker has not been output
+  // yet. See unwrapContent().
+  struct PendingStreamContent {
+    uint id;
+    kj::Own<ReadableStreamSource> source;
+    bool html;
+  };
+  kj::Vector<PendingStreamContent> pendingStreamContent;
+  uint nextStreamContentId = 0;
+
+  // Markers are `<prefix><id>-->`. The prefix includes a random UUID so that document content can't
+  // forge one. Generated on first use.
+  kj::String streamContentMarkerPrefix;
+
   bool isPoisoned() {
     // If a call to `lol-html` returned an error or propagated a user error from a handler
     // (LOL_HTML_STOP for instance); we consider its instance as poisoned. Future calls to
@@ -341,10 +474,11 @@ kj::Own<lol_html_HtmlRewriter> Rewriter::buildRewriter(
         auto element = elementHandlers.element.map(registerCallback);
         auto comments = elementHandlers.comments.map(registerCallback);
         auto text = elementHandlers.text.map(registerCallback);
+        auto& selector = *rewriter.selectors.add(kj::atomicAddRef(*elementHandlers.selector));
 
         check(lol_html_rewriter_builder_add_element_content_handlers(
             builder,
-            elementHandlers.selector,
+            &selector.get(),
             element == kj::none ? nullptr : &Rewriter::thunk<Element>,
             element.orDefault(nullptr),
             comments == kj::none ? nullptr : &Rewriter::thunk<Comment>,
@@ -468,7 +602,16 @@ kj::Promise<void> Rewriter::end() {
         maybePoison(getLastError());
       }
     }
-    return finishWrite().then([this]() { return inner->end(); });
+    return finishWrite().then([this]() {
+      // Any stream content whose marker never made it to the output (e.g. because the element it
+      // was attached to was later removed) is dropped.
+      for (auto& pending: pendingStreamContent) {
+        pending.source->cancel(JSG_KJ_EXCEPTION(FAILED, TypeError,
+            "The HTML content this stream was inserted into was removed."));
+      }
+      pendingStreamContent.clear();
+      return inner->end();
+    });
   });
 }
 
@@ -614,6 +757,37 @@ void Rewriter::outputImpl(kj::ArrayPtr<const byte> buffer) {
     return;
   }
 
+  // lol-html outputs each piece of inserted content as its own chunk, so a marker is never split
+  // across calls.
+  auto prefix = streamContentMarkerPrefix.asBytes();
+  static constexpr kj::StringPtr MARKER_SUFFIX = "-->"_kj;
+  while (!pendingStreamContent.empty()) {
+    auto found = std::search(buffer.begin(), buffer.end(), prefix.begin(), prefix.end());
+    if (found == buffer.end()) break;
+
+    size_t markerStart = found - buffer.begin();
+    auto rest = buffer.slice(markerStart + prefix.size(), buffer.size());
+    size_t digits = 0;
+    uint id = 0;
+    while (digits < rest.size() && '0' <= rest[digits] && rest[digits] <= '9') {
+      id = id * 10 + (rest[digits++] - '0');
+    }
+    if (digits == 0 || rest.size() - digits < MARKER_SUFFIX.size() ||
+        rest.slice(digits, digits + MARKER_SUFFIX.size()) != MARKER_SUFFIX.asBytes()) {
+      break;
+    }
+
+    queueWrite(buffer.slice(0, markerStart));
+    queueStreamContent(id);
+    buffer = rest.slice(digits + MARKER_SUFFIX.size(), rest.size());
+  }
+
+  queueWrite(buffer);
+}
+
+void Rewriter::queueWrite(kj::ArrayPtr<const byte> buffer) {
+  if (buffer.size() == 0) return;
+
   auto bufferCopy = kj::heapArray(buffer);
   KJ_IF_SOME(wp, writePromise) {
     writePromise = wp.then([this, bufferCopy = kj::mv(bufferCopy)]() mutable {
@@ -624,6 +798,97 @@ void Rewriter::outputImpl(kj::ArrayPtr<const byte> buffer) {
   }
 }
 
+void Rewriter::queueStreamContent(uint id) {
+  for (auto i: kj::indices(pendingStreamContent)) {
+    if (pendingStreamContent[i].id != id) continue;
+
+    auto source = kj::mv(pendingStreamContent[i].source);
+    bool html = pendingStreamContent[i].html;
+    if (i != pendingStreamContent.size() - 1) {
+      pendingStreamContent[i] = kj::mv(pendingStreamContent.back());
+    }
+    pendingStreamContent.removeLast();
+
+    KJ_IF_SOME(wp, writePromise) {
+      writePromise = wp.then([this, source = kj::mv(source), html]() mutable {
+        return writeStreamContent(*inner, kj::mv(source), html);
+      });
+    } else {
+      writePromise = writeStreamContent(*inner, kj::mv(source), html);
+    }
+    return;
+  }
+}
+
+kj::Promise<void> Rewriter::writeStreamContent(
+    WritableStreamSink& output, kj::Own<ReadableStreamSource> source, bool html) {
+  if (html) {
+    auto proxy = co_await source->pumpTo(output, false);
+    co_await proxy.proxyTask;
+    co_return;
+  }
+
+  // Not HTML: entity-encode the same characters lol-html would for string content.
+  kj::FixedArray<byte, 4096> buffer;
+  kj::Vector<char> escaped;
+  for (;;) {
+    auto amount = co_await source->tryRead(buffer.begin(), 1, buffer.size());
+    if (amount == 0) break;
+
+    escaped.clear();
+    for (auto c: kj::arrayPtr(buffer.begin(), amount).asChars()) {
+      switch (c) {
+        case '<': escaped.addAll("&lt;"_kj); break;
+        case '>': escaped.addAll("&gt;"_kj); break;
+        case '&': escaped.addAll("&amp;"_kj); break;
+        default: escaped.add(c); break;
+      }
+    }
+    co_await output.write(escaped.asPtr().asBytes());
+  }
+}
+
+Rewriter::UnwrappedContent Rewriter::unwrapContent(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  bool html = options.orDefault({}).html.orDefault(false);
+
+  kj::Maybe<jsg::Ref<ReadableStream>> maybeStream;
+  KJ_SWITCH_ONEOF(content) {
+    KJ_CASE_ONEOF(string, kj::String) {
+      return { kj::mv(string), html };
+    }
+    KJ_CASE_ONEOF(stream, jsg::Ref<ReadableStream>) {
+      maybeStream = kj::mv(stream);
+    }
+    KJ_CASE_ONEOF(response, jsg::Ref<Response>) {
+      maybeStream = response->getBody();
+    }
+  }
+
+  KJ_IF_SOME(stream, maybeStream) {
+    JSG_REQUIRE(!stream->isDisturbed(), TypeError,
+        "Cannot insert HTML content from a stream that has already been read from.");
+
+    // Pump through a pipe rather than buffering: the pump only makes progress as fast as
+    // writeStreamContent() reads the other end. Errors are ignored here because they reach the
+    // output through the pipe anyway -- or, if the content was dropped, there is nobody to tell.
+    auto pipe = newIdentityPipe();
+    ioContext.addTask(ioContext.waitForDeferredProxy(
+        stream->pumpTo(js, kj::mv(pipe.out), true)).catch_([](kj::Exception&&) {}));
+
+    if (streamContentMarkerPrefix == nullptr) {
+      streamContentMarkerPrefix = kj::str(
+          "<!--workerd-html-content-", randomUUID(ioContext.getEntropySource()), "-");
+    }
+    auto id = nextStreamContentId++;
+    pendingStreamContent.add(PendingStreamContent { id, kj::mv(pipe.in), html });
+    return { kj::str(streamContentMarkerPrefix, id, "-->"), true };
+  } else {
+    // A Response without a body.
+    return { kj::str(), html };
+  }
+}
+
 // =======================================================================================
 // Element
 
@@ -699,23 +964,15 @@ jsg::Ref<Element> Element::removeAttribute(kj::String name) {
   return JSG_THIS;
 }
 
-namespace {
-
-kj::String unwrapContent(Content content) {
-return kj::mv(JSG_REQUIRE_NONNULL(content.tryGet<kj::String>(),
-    TypeError, "Replacing HTML content using a ReadableStream or Response object is not "
-    "implemented. You must provide a string."));
-}
-
-}  // namespace
-
 #define DEFINE_CONTENT_REWRITER_FUNCTION(camel, snake) \
-    jsg::Ref<Element> Element::camel(Content content, jsg::Optional<ContentOptions> options) { \
-      auto stringContent = unwrapContent(kj::mv(content)); \
+    jsg::Ref<Element> Element::camel( \
+        jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) { \
+      auto& knownImpl = checkToken(impl); \
+      auto unwrapped = knownImpl.rewriter.unwrapContent(js, kj::mv(content), kj::mv(options)); \
       check(lol_html_element_##snake( \
-          &checkToken(impl).element, \
-          stringContent.cStr(), stringContent.size(), \
-          options.orDefault({}).html.orDefault(false))); \
+          &knownImpl.element, \
+          unwrapped.content.cStr(), unwrapped.content.size(), \
+          unwrapped.html)); \
       return JSG_THIS; \
     }
 
@@ -743,10 +1000,11 @@ void Element::onEndTag(ElementCallbackFunction&& callback) {
   knownImpl.rewriter.onEndTag(&knownImpl.element, kj::mv(callback));
 }
 
-EndTag::EndTag(CType& endTag, Rewriter&): impl(endTag) {}
+EndTag::EndTag(CType& endTag, Rewriter& rewriter): impl(endTag), rewriter(rewriter) {}
 
 void EndTag::htmlContentScopeEnd() {
   impl = kj::none;
+  rewriter = kj::none;
 }
 
 kj::String EndTag::getName() {
@@ -758,22 +1016,26 @@ void EndTag::setName(kj::String text) {
   check(lol_html_end_tag_name_set(&checkToken(impl), text.cStr(), text.size()));
 }
 
-jsg::Ref<EndTag> EndTag::before(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<EndTag> EndTag::before(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_end_tag_before(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
-jsg::Ref<EndTag> EndTag::after(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<EndTag> EndTag::after(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_end_tag_after(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
@@ -828,7 +1090,7 @@ void Element::AttributesIterator::htmlContentScopeEnd() {
 // =======================================================================================
 // Comment
 
-Comment::Comment(CType& comment, Rewriter&): impl(comment) {}
+Comment::Comment(CType& comment, Rewriter& rewriter): impl(comment), rewriter(rewriter) {}
 
 kj::String Comment::getText() {
   auto text = LolString(lol_html_comment_text_get(&checkToken(impl)));
@@ -844,32 +1106,38 @@ bool Comment::getRemoved() {
   return lol_html_comment_is_removed(&checkToken(impl));
 }
 
-jsg::Ref<Comment> Comment::before(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Comment> Comment::before(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_comment_before(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
-jsg::Ref<Comment> Comment::after(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Comment> Comment::after(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_comment_after(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
-jsg::Ref<Comment> Comment::replace(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Comment> Comment::replace(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_comment_replace(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
@@ -882,12 +1150,13 @@ jsg::Ref<Comment> Comment::remove() {
 
 void Comment::htmlContentScopeEnd() {
   impl = kj::none;
+  rewriter = kj::none;
 }
 
 // =======================================================================================
 // Text
 
-Text::Text(CType& text, Rewriter&): impl(text) {}
+Text::Text(CType& text, Rewriter& rewriter): impl(text), rewriter(rewriter) {}
 
 kj::String Text::getText() {
   auto content = lol_html_text_chunk_content_get(&checkToken(impl));
@@ -904,32 +1173,38 @@ bool Text::getRemoved() {
   return lol_html_text_chunk_is_removed(&checkToken(impl));
 }
 
-jsg::Ref<Text> Text::before(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Text> Text::before(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_text_chunk_before(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
-jsg::Ref<Text> Text::after(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Text> Text::after(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_text_chunk_after(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
-jsg::Ref<Text> Text::replace(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<Text> Text::replace(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_text_chunk_replace(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
@@ -942,6 +1217,7 @@ jsg::Ref<Text> Text::remove() {
 
 void Text::htmlContentScopeEnd() {
   impl = kj::none;
+  rewriter = kj::none;
 }
 
 // =======================================================================================
@@ -971,20 +1247,24 @@ void Doctype::htmlContentScopeEnd() {
 // =======================================================================================
 // DocumentEnd
 
-DocumentEnd::DocumentEnd(CType& documentEnd, Rewriter&): impl(documentEnd) {}
+DocumentEnd::DocumentEnd(CType& documentEnd, Rewriter& rewriter)
+    : impl(documentEnd), rewriter(rewriter) {}
 
-jsg::Ref<DocumentEnd> DocumentEnd::append(Content content, jsg::Optional<ContentOptions> options) {
-  auto stringContent = unwrapContent(kj::mv(content));
+jsg::Ref<DocumentEnd> DocumentEnd::append(
+    jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options) {
+  auto& token = checkToken(impl);
+  auto unwrapped = KJ_ASSERT_NONNULL(rewriter).unwrapContent(js, kj::mv(content), kj::mv(options));
   check(lol_html_doc_end_append(
-      &checkToken(impl),
-      stringContent.cStr(), stringContent.size(),
-      options.orDefault({}).html.orDefault(false)));
+      &token,
+      unwrapped.content.cStr(), unwrapped.content.size(),
+      unwrapped.html));
 
   return JSG_THIS;
 }
 
 void DocumentEnd::htmlContentScopeEnd() {
   impl = kj::none;
+  rewriter = kj::none;
 }
 
 // =======================================================================================
@@ -1000,7 +1280,8 @@ struct HTMLRewriter::Impl {
   //   builder which created them, lest the process deadlock.
   //
   //   In the meantime, we keep this list of handlers around and "replay" their registration, in
-  //   order, on the builder object that we create inside of .transform().
+  //   order, on the builder object that we create inside of .transform(). The selectors, at least,
+  //   are parsed only once per process: see HTMLRewriterSelectorCache.
 
   JSG_MEMORY_INFO(HTMLRewriter::Impl) {
     for (const auto& handlers : unregisteredHandlers) {
@@ -1028,9 +1309,7 @@ jsg::Ref<HTMLRewriter> HTMLRewriter::constructor() {
 }
 
 jsg::Ref<HTMLRewriter> HTMLRewriter::on(kj::String stringSelector, ElementContentHandlers&& handlers) {
-  kj::Own<lol_html_Selector> selector =
-      LOL_HTML_OWN(selector, lol_html_selector_parse(stringSelector.cStr(),
-                                                         stringSelector.size()));
+  auto selector = HTMLRewriterSelectorCache::getShared().get(stringSelector);
 
   impl->unregisteredHandlers.add(UnregisteredElementHandlers {
     kj::mv(selector),
@@ -31,6 +31,49 @@ class Text;
 class Doctype;
 class DocumentEnd;
 
+// =======================================================================================
+// HTMLRewriterSelectorCache
+
+// Cache of parsed selectors, keyed by selector text. Rewriting workers tend to call
+// `HTMLRewriter.on()` with the same few dozen selectors for every response they transform; with
+// this cache, only the first call for each distinct selector pays for lol_html_selector_parse().
+//
+// HTMLRewriter uses a single process-wide instance (see getShared()). Parsed selectors are
+// immutable and carry no per-worker state, so sharing them between isolates is safe. This class is
+// thread-safe.
+class HTMLRewriterSelectorCache {
+public:
+  // A parsed selector, shared between the cache and every rewriter that registered handlers with
+  // it.
+  class Selector;
+
+  // Upper bound on the number of distinct selectors retained. Beyond this, the least-recently-used
+  // selector is evicted from the cache; rewriters still referencing it keep it alive.
+  static constexpr size_t DEFAULT_MAX_ENTRIES = 1024;
+
+  explicit HTMLRewriterSelectorCache(size_t maxEntries = DEFAULT_MAX_ENTRIES);
+  ~HTMLRewriterSelectorCache() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(HTMLRewriterSelectorCache);
+
+  // The cache used by HTMLRewriter.on().
+  static const HTMLRewriterSelectorCache& getShared();
+
+  // Returns the parsed form of `selector`, parsing and caching it on a miss. Throws a TypeError if
+  // the selector is invalid. Parse failures are not cached.
+  kj::Own<const Selector> get(kj::StringPtr selector) const;
+
+  struct Stats {
+    size_t size;
+    uint64_t hits;
+    uint64_t misses;
+  };
+  Stats getStats() const;
+
+private:
+  struct Impl;
+  kj::Own<const Impl> impl;
+};
+
 // =======================================================================================
 // HTMLRewriter
 
@@ -142,8 +185,12 @@ public:
 };
 
 // A chunk of text or HTML which can be passed to content token mutation functions.
+//
+// Streams (and Response bodies) are not buffered: the rewriter inserts a placeholder in their
+// place and splices the stream's bytes into the output when the placeholder is written, so the
+// stream is only consumed as fast as the transformed response is. Streamed content is inserted
+// as-is, without transcoding, so it must already be in the document's encoding.
 using Content = kj::OneOf<kj::String, jsg::Ref<ReadableStream>, jsg::Ref<Response>>;
-// TODO(soon): Support ReadableStream/Response types. Requires fibers or lol-html saveable state.
 
 // Options bag which can be passed to content token mutation functions.
 struct ContentOptions {
@@ -177,14 +224,20 @@ public:
   jsg::Ref<Element> setAttribute(kj::String name, kj::String value);
   jsg::Ref<Element> removeAttribute(kj::String name);
 
-  jsg::Ref<Element> before(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Element> after(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> before(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> after(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
 
-  jsg::Ref<Element> prepend(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Element> append(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> prepend(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> append(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
 
-  jsg::Ref<Element> replace(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Element> setInnerContent(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> replace(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Element> setInnerContent(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
 
   jsg::Ref<Element> remove();
   jsg::Ref<Element> removeAndKeepContent();
@@ -213,17 +266,17 @@ public:
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
-      before(content: string, options?: ContentOptions): Element;
-      after(content: string, options?: ContentOptions): Element;
-      prepend(content: string, options?: ContentOptions): Element;
-      append(content: string, options?: ContentOptions): Element;
-      replace(content: string, options?: ContentOptions): Element;
-      setInnerContent(content: string, options?: ContentOptions): Element;
+      before(content: string | ReadableStream | Response, options?: ContentOptions): Element;
+      after(content: string | ReadableStream | Response, options?: ContentOptions): Element;
+      prepend(content: string | ReadableStream | Response, options?: ContentOptions): Element;
+      append(content: string | ReadableStream | Response, options?: ContentOptions): Element;
+      replace(content: string | ReadableStream | Response, options?: ContentOptions): Element;
+      setInnerContent(
+          content: string | ReadableStream | Response, options?: ContentOptions): Element;
 
       onEndTag(handler: (tag: EndTag) => void | Promise<void>): void;
     });
-    // Require content to be a string, and specify parameter type for onEndTag
-    // callback function
+    // Specify content types, and parameter type for onEndTag callback function
   }
 
 private:
@@ -282,8 +335,10 @@ public:
   kj::String getName();
   void setName(kj::String);
 
-  jsg::Ref<EndTag> before(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<EndTag> after(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<EndTag> before(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<EndTag> after(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
   jsg::Ref<EndTag> remove();
 
   JSG_RESOURCE_TYPE(EndTag) {
@@ -295,14 +350,15 @@ public:
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
-      before(content: string, options?: ContentOptions): EndTag;
-      after(content: string, options?: ContentOptions): EndTag;
+      before(content: string | ReadableStream | Response, options?: ContentOptions): EndTag;
+      after(content: string | ReadableStream | Response, options?: ContentOptions): EndTag;
     });
-    // Require content to be a string
+    // Specify content types
   }
 
 private:
   kj::Maybe<CType&> impl;
+  kj::Maybe<Rewriter&> rewriter;
 
   void htmlContentScopeEnd() override;
 };
@@ -318,9 +374,12 @@ public:
 
   bool getRemoved();
 
-  jsg::Ref<Comment> before(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Comment> after(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Comment> replace(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Comment> before(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Comment> after(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Comment> replace(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
   jsg::Ref<Comment> remove();
 
   JSG_RESOURCE_TYPE(Comment) {
@@ -334,15 +393,16 @@ public:
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
-      before(content: string, options?: ContentOptions): Comment;
-      after(content: string, options?: ContentOptions): Comment;
-      replace(content: string, options?: ContentOptions): Comment;
+      before(content: string | ReadableStream | Response, options?: ContentOptions): Comment;
+      after(content: string | ReadableStream | Response, options?: ContentOptions): Comment;
+      replace(content: string | ReadableStream | Response, options?: ContentOptions): Comment;
     });
-    // Require content to be a string
+    // Specify content types
   }
 
 private:
   kj::Maybe<CType&> impl;
+  kj::Maybe<Rewriter&> rewriter;
 
   void htmlContentScopeEnd() override;
 };
@@ -359,9 +419,12 @@ public:
 
   bool getRemoved();
 
-  jsg::Ref<Text> before(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Text> after(Content content, jsg::Optional<ContentOptions> options);
-  jsg::Ref<Text> replace(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Text> before(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Text> after(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<Text> replace(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
   jsg::Ref<Text> remove();
 
   JSG_RESOURCE_TYPE(Text) {
@@ -376,15 +439,16 @@ public:
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
-      before(content: string, options?: ContentOptions): Text;
-      after(content: string, options?: ContentOptions): Text;
-      replace(content: string, options?: ContentOptions): Text;
+      before(content: string | ReadableStream | Response, options?: ContentOptions): Text;
+      after(content: string | ReadableStream | Response, options?: ContentOptions): Text;
+      replace(content: string | ReadableStream | Response, options?: ContentOptions): Text;
     });
-    // Require content to be a string
+    // Specify content types
   }
 
 private:
   kj::Maybe<CType&> impl;
+  kj::Maybe<Rewriter&> rewriter;
 
   void htmlContentScopeEnd() override;
 };
@@ -419,20 +483,22 @@ public:
 
   explicit DocumentEnd(CType& documentEnd, Rewriter&);
 
-  jsg::Ref<DocumentEnd> append(Content content, jsg::Optional<ContentOptions> options);
+  jsg::Ref<DocumentEnd> append(
+      jsg::Lock& js, Content content, jsg::Optional<ContentOptions> options);
 
   JSG_RESOURCE_TYPE(DocumentEnd) {
     JSG_METHOD(append);
 
     JSG_TS_ROOT();
     JSG_TS_OVERRIDE({
-      append(content: string, options?: ContentOptions): DocumentEnd;
+      append(content: string | ReadableStream | Response, options?: ContentOptions): DocumentEnd;
     });
-    // Require content to be a string
+    // Specify content types
   }
 
 private:
   kj::Maybe<CType&> impl;
+  kj::Maybe<Rewriter&> rewriter;
 
   void htmlContentScopeEnd() override;
 };
@@ -281,24 +281,8 @@ uint32_t BufferUtil::byteLength(jsg::Lock& js, jsg::JsString str) {
   return str.utf8Length(js);
 }
 
-int BufferUtil::compare(
-    jsg::Lock& js,
-    kj::Array<kj::byte> one,
-    kj::Array<kj::byte> two,
-    jsg::Optional<CompareOptions> maybeOptions) {
-  kj::ArrayPtr<kj::byte> ptrOne = one;
-  kj::ArrayPtr<kj::byte> ptrTwo = two;
-
-  // The options allow comparing subranges within the two inputs.
-  KJ_IF_SOME(options, maybeOptions) {
-    auto end = options.aEnd.orDefault(ptrOne.size());
-    auto start = kj::min(end, options.aStart.orDefault(0));
-    ptrOne = ptrOne.slice(start, end);
-    end = options.bEnd.orDefault(ptrTwo.size());
-    start = kj::min(end, options.bStart.orDefault(0));
-    ptrTwo = ptrTwo.slice(start, end);
-  }
-
+namespace {
+int compareBytes(kj::ArrayPtr<const kj::byte> ptrOne, kj::ArrayPtr<const kj::byte> ptrTwo) {
   size_t toCompare = kj::min(ptrOne.size(), ptrTwo.size());
   auto result = toCompare > 0 ? memcmp(ptrOne.begin(), ptrTwo.begin(), toCompare) : 0;
 
@@ -312,6 +296,26 @@ int BufferUtil::compare(
 
   return result > 0 ? 1 : -1;
 }
+}  // namespace
+
+int BufferUtil::compare(kj::Array<kj::byte> one, kj::Array<kj::byte> two) {
+  return compareBytes(one, two);
+}
+
+int BufferUtil::compareOffset(kj::Array<kj::byte> source,
+                              kj::Array<kj::byte> target,
+                              uint32_t targetStart,
+                              uint32_t sourceStart,
+                              uint32_t targetEnd,
+                              uint32_t sourceEnd) {
+  // The offsets have been validated in JavaScript, but this is a fast method, which must not
+  // throw, so clamp them rather than trusting them.
+  auto sourceLimit = kj::min<size_t>(sourceEnd, source.size());
+  auto targetLimit = kj::min<size_t>(targetEnd, target.size());
+  return compareBytes(
+      source.slice(kj::min<size_t>(sourceStart, sourceLimit), sourceLimit),
+      target.slice(kj::min<size_t>(targetStart, targetLimit), targetLimit));
+}
 
 kj::Array<kj::byte> BufferUtil::concat(
     jsg::Lock& js,
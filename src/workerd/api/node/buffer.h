@@ -15,19 +15,16 @@ public:
 
   uint32_t byteLength(jsg::Lock& js, jsg::JsString str);
 
-  struct CompareOptions {
-    jsg::Optional<uint32_t> aStart;
-    jsg::Optional<uint32_t> aEnd;
-    jsg::Optional<uint32_t> bStart;
-    jsg::Optional<uint32_t> bEnd;
+  int compare(kj::Array<kj::byte> one, kj::Array<kj::byte> two);
 
-    JSG_STRUCT(aStart, aEnd, bStart, bEnd);
-  };
-
-  int compare(jsg::Lock& js,
-              kj::Array<kj::byte> one,
-              kj::Array<kj::byte> two,
-              jsg::Optional<CompareOptions> maybeOptions);
+  // Like compare(), but only compares source[sourceStart, sourceEnd) with
+  // target[targetStart, targetEnd). The argument order follows Node.js' internal binding.
+  int compareOffset(kj::Array<kj::byte> source,
+                    kj::Array<kj::byte> target,
+                    uint32_t targetStart,
+                    uint32_t sourceStart,
+                    uint32_t targetEnd,
+                    uint32_t sourceEnd);
 
   kj::Array<kj::byte> concat(jsg::Lock& js,
                              kj::Array<kj::Array<kj::byte>> list,
@@ -84,7 +81,8 @@ public:
 
   JSG_RESOURCE_TYPE(BufferUtil) {
     JSG_METHOD(byteLength);
-    JSG_METHOD(compare);
+    JSG_FAST_METHOD(compare);
+    JSG_FAST_METHOD(compareOffset);
     JSG_METHOD(concat);
     JSG_METHOD(decodeString);
     JSG_METHOD(fillImpl);
@@ -92,8 +90,8 @@ public:
     JSG_METHOD(swap);
     JSG_METHOD(toString);
     JSG_METHOD(write);
-    JSG_METHOD(isAscii);
-    JSG_METHOD(isUtf8);
+    JSG_FAST_METHOD(isAscii);
+    JSG_FAST_METHOD(isUtf8);
 
     // For StringDecoder
     JSG_METHOD(decode);
@@ -102,7 +100,6 @@ public:
 };
 
 #define EW_NODE_BUFFER_ISOLATE_TYPES       \
-    api::node::BufferUtil,                 \
-    api::node::BufferUtil::CompareOptions
+    api::node::BufferUtil
 
 }  // namespace workerd::api::node
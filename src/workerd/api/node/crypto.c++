@@ -5,9 +5,11 @@
 #include <workerd/api/crypto/digest.h>
 #include <workerd/api/crypto/impl.h>
 #include <workerd/api/crypto/kdf.h>
+#include <workerd/api/crypto/offload.h>
 #include <workerd/api/crypto/prime.h>
 #include <workerd/jsg/jsg.h>
 #include <workerd/api/crypto/spkac.h>
+#include <openssl/crypto.h>
 
 namespace workerd::api::node {
 
@@ -45,18 +47,17 @@ kj::Array<kj::byte> CryptoImpl::getHkdf(kj::String hash,
   return JSG_REQUIRE_NONNULL(hkdf(length, digest, key, salt, info), Error, "Hkdf failed");
 }
 
-kj::Array<kj::byte> CryptoImpl::getPbkdf(jsg::Lock& js,
-                                         kj::Array<const kj::byte> password,
-                                         kj::Array<const kj::byte> salt,
-                                         uint32_t num_iterations,
-                                         uint32_t keylen,
-                                         kj::String name) {
+namespace {
+const EVP_MD* validatePbkdf(jsg::Lock& js,
+                            kj::ArrayPtr<const kj::byte> password,
+                            kj::ArrayPtr<const kj::byte> salt,
+                            uint32_t num_iterations,
+                            kj::StringPtr name) {
   // The Node.js version of the PBKDF2 is a bit different from the Web Crypto API.
   // For one, the Node.js implementation allows for a broader range of possible
   // digest algorithms whereas the Web Crypto API only allows for a few specific ones.
   // Second, the Node.js implementation enforces max size limits on the password and
   // salt parameters.
-  ClearErrorOnReturn clearErrorOnReturn;
   const EVP_MD* digest = EVP_get_digestbyname(name.begin());
   JSG_REQUIRE(digest != nullptr, TypeError, "Invalid Pbkdf2 digest: ", name,
               internalDescribeOpensslErrors());
@@ -66,12 +67,48 @@ kj::Array<kj::byte> CryptoImpl::getPbkdf(jsg::Lock& js,
   // Note: The user could DoS us by selecting a very high iteration count. As with the Web Crypto
   // API, intentionally limit the maximum iteration count.
   checkPbkdfLimits(js, num_iterations);
+  return digest;
+}
+
+void validateScrypt(kj::ArrayPtr<const kj::byte> password, kj::ArrayPtr<const kj::byte> salt) {
+  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Scrypt failed: password is too large");
+  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Scrypt failed: salt is too large");
+}
+}  // namespace
+
+kj::Array<kj::byte> CryptoImpl::getPbkdf(jsg::Lock& js,
+                                         kj::Array<const kj::byte> password,
+                                         kj::Array<const kj::byte> salt,
+                                         uint32_t num_iterations,
+                                         uint32_t keylen,
+                                         kj::String name) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto digest = validatePbkdf(js, password, salt, num_iterations, name);
 
   // Both pass and salt may be zero length here.
   return JSG_REQUIRE_NONNULL(pbkdf2(keylen, num_iterations, digest, password, salt),
       Error, "Pbkdf2 failed");
 }
 
+jsg::Promise<kj::Array<kj::byte>> CryptoImpl::getPbkdfAsync(jsg::Lock& js,
+                                                            kj::Array<const kj::byte> password,
+                                                            kj::Array<const kj::byte> salt,
+                                                            uint32_t num_iterations,
+                                                            uint32_t keylen,
+                                                            kj::String name) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  auto digest = validatePbkdf(js, password, salt, num_iterations, name);
+
+  // The arrays passed in are views of JS-owned buffers, which the kernel must not touch.
+  return offloadCrypto<kj::Array<kj::byte>>(js,
+      [password = kj::heapArray(password.asPtr()), salt = kj::heapArray(salt.asPtr()),
+       num_iterations, keylen, digest]() mutable {
+    KJ_DEFER(OPENSSL_cleanse(password.begin(), password.size()));
+    return JSG_REQUIRE_NONNULL(pbkdf2(keylen, num_iterations, digest, password, salt),
+        Error, "Pbkdf2 failed");
+  });
+}
+
 kj::Array<kj::byte> CryptoImpl::getScrypt(jsg::Lock& js,
                                           kj::Array<const kj::byte> password,
                                           kj::Array<const kj::byte> salt,
@@ -81,13 +118,32 @@ kj::Array<kj::byte> CryptoImpl::getScrypt(jsg::Lock& js,
                                           uint32_t maxmem,
                                           uint32_t keylen) {
   ClearErrorOnReturn clearErrorOnReturn;
-  JSG_REQUIRE(password.size() <= INT32_MAX, RangeError, "Scrypt failed: password is too large");
-  JSG_REQUIRE(salt.size() <= INT32_MAX, RangeError, "Scrypt failed: salt is too large");
+  validateScrypt(password, salt);
 
   return JSG_REQUIRE_NONNULL(scrypt(keylen, N, r, p, maxmem, password, salt),
       Error, "Scrypt failed");
 }
 
+jsg::Promise<kj::Array<kj::byte>> CryptoImpl::getScryptAsync(jsg::Lock& js,
+                                                             kj::Array<const kj::byte> password,
+                                                             kj::Array<const kj::byte> salt,
+                                                             uint32_t N,
+                                                             uint32_t r,
+                                                             uint32_t p,
+                                                             uint32_t maxmem,
+                                                             uint32_t keylen) {
+  ClearErrorOnReturn clearErrorOnReturn;
+  validateScrypt(password, salt);
+
+  return offloadCrypto<kj::Array<kj::byte>>(js,
+      [password = kj::heapArray(password.asPtr()), salt = kj::heapArray(salt.asPtr()),
+       N, r, p, maxmem, keylen]() mutable {
+    KJ_DEFER(OPENSSL_cleanse(password.begin(), password.size()));
+    return JSG_REQUIRE_NONNULL(scrypt(keylen, N, r, p, maxmem, password, salt),
+        Error, "Scrypt failed");
+  });
+}
+
 bool CryptoImpl::verifySpkac(kj::Array<const kj::byte> input) {
   return workerd::api::verifySpkac(input);
 }
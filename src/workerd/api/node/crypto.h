@@ -128,6 +128,15 @@ public:
                                uint32_t keylen,
                                kj::String name);
 
+  // Like getPbkdf(), but may run the derivation on the crypto thread pool (see
+  // api/crypto/offload.h). Validation errors are still thrown synchronously.
+  jsg::Promise<kj::Array<kj::byte>> getPbkdfAsync(jsg::Lock& js,
+                                                  kj::Array<const kj::byte> password,
+                                                  kj::Array<const kj::byte> salt,
+                                                  uint32_t num_iterations,
+                                                  uint32_t keylen,
+                                                  kj::String name);
+
   // Scrypt
   kj::Array<kj::byte> getScrypt(jsg::Lock& js,
                                 kj::Array<const kj::byte> password,
@@ -138,6 +147,16 @@ public:
                                 uint32_t maxmem,
                                 uint32_t keylen);
 
+  // Like getScrypt(), but may run the derivation on the crypto thread pool.
+  jsg::Promise<kj::Array<kj::byte>> getScryptAsync(jsg::Lock& js,
+                                                   kj::Array<const kj::byte> password,
+                                                   kj::Array<const kj::byte> salt,
+                                                   uint32_t N,
+                                                   uint32_t r,
+                                                   uint32_t p,
+                                                   uint32_t maxmem,
+                                                   uint32_t keylen);
+
   // Keys
   struct KeyExportOptions {
     jsg::Optional<kj::String> type;
@@ -227,8 +246,10 @@ public:
     JSG_METHOD(getHkdf);
     // Pbkdf2
     JSG_METHOD(getPbkdf);
+    JSG_METHOD(getPbkdfAsync);
     // Scrypt
     JSG_METHOD(getScrypt);
+    JSG_METHOD(getScryptAsync);
     // Keys
     JSG_METHOD(exportKey);
     JSG_METHOD(equals);
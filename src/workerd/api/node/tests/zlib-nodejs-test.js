@@ -0,0 +1,193 @@
+import { strictEqual, deepStrictEqual, throws, ok } from 'node:assert';
+import { Buffer } from 'node:buffer';
+import * as zlib from 'node:zlib';
+
+const input = Buffer.from('hello world, hello zlib, hello brotli. '.repeat(200));
+
+async function collect(stream, chunks) {
+  const output = [];
+  stream.on('data', (chunk) => output.push(chunk));
+  const done = new Promise((resolve, reject) => {
+    stream.on('end', resolve);
+    stream.on('error', reject);
+  });
+  for (const chunk of chunks) stream.write(chunk);
+  stream.end();
+  await done;
+  return Buffer.concat(output);
+}
+
+export const crc32Test = {
+  test() {
+    strictEqual(zlib.crc32(''), 0);
+    strictEqual(zlib.crc32('hello'), 907060870);
+    // Continuing from a previous value is the same as hashing the concatenation.
+    strictEqual(zlib.crc32('world', zlib.crc32('hello ')), zlib.crc32('hello world'));
+    strictEqual(zlib.crc32(Buffer.from('hello')), 907060870);
+  }
+};
+
+export const syncRoundTrip = {
+  test() {
+    const pairs = [
+      [zlib.deflateSync, zlib.inflateSync],
+      [zlib.gzipSync, zlib.gunzipSync],
+      [zlib.deflateRawSync, zlib.inflateRawSync],
+      [zlib.deflateSync, zlib.unzipSync],
+      [zlib.gzipSync, zlib.unzipSync],
+      [zlib.brotliCompressSync, zlib.brotliDecompressSync],
+    ];
+    for (const [compress, decompress] of pairs) {
+      const compressed = compress(input);
+      ok(compressed.length < input.length / 10, compress.name);
+      deepStrictEqual(decompress(compressed), input, compress.name);
+      // Strings and ArrayBuffers are accepted too.
+      strictEqual(decompress(compress('abc')).toString(), 'abc');
+      strictEqual(decompress(compress(new TextEncoder().encode('abc').buffer)).toString(), 'abc');
+    }
+
+    // The gzip header magic.
+    const gz = zlib.gzipSync(input);
+    strictEqual(gz[0], 0x1f);
+    strictEqual(gz[1], 0x8b);
+  }
+};
+
+export const syncOptions = {
+  test() {
+    const fast = zlib.deflateSync(input, { level: 1 });
+    const best = zlib.deflateSync(input, { level: 9, memLevel: 9, windowBits: 15 });
+    deepStrictEqual(zlib.inflateSync(fast), input);
+    deepStrictEqual(zlib.inflateSync(best), input);
+    deepStrictEqual(zlib.inflateSync(best, { windowBits: 0 }), input);
+    deepStrictEqual(zlib.inflateRawSync(zlib.deflateRawSync(input, { windowBits: 8 })), input);
+
+    const brotli = zlib.brotliCompressSync(input, {
+      params: {
+        [zlib.constants.BROTLI_PARAM_QUALITY]: 5,
+        [zlib.constants.BROTLI_PARAM_MODE]: zlib.constants.BROTLI_MODE_TEXT,
+        [zlib.constants.BROTLI_PARAM_SIZE_HINT]: input.length,
+      },
+    });
+    deepStrictEqual(zlib.brotliDecompressSync(brotli), input);
+
+    throws(() => zlib.deflateSync(input, { level: 10 }), { code: 'ERR_OUT_OF_RANGE' });
+    throws(() => zlib.deflateSync(input, { windowBits: 16 }), { code: 'ERR_OUT_OF_RANGE' });
+    // A windowBits of 0 means "from the header", which raw streams don't have.
+    throws(() => zlib.inflateRawSync(zlib.deflateRawSync(input), { windowBits: 0 }),
+        { code: 'ERR_OUT_OF_RANGE' });
+    deepStrictEqual(zlib.gunzipSync(zlib.gzipSync(input), { windowBits: 0 }), input);
+    throws(() => zlib.deflateSync(input, { memLevel: 0 }), { code: 'ERR_OUT_OF_RANGE' });
+    throws(() => zlib.deflateSync(input, { strategy: 5 }), { code: 'ERR_OUT_OF_RANGE' });
+    throws(() => zlib.deflateSync(123), { code: 'ERR_INVALID_ARG_TYPE' });
+    throws(() => zlib.brotliCompressSync(input, {
+      params: { 1000: 1 },
+    }), RangeError);
+  }
+};
+
+export const syncErrors = {
+  test() {
+    const compressed = zlib.gzipSync(input);
+    // Truncated input.
+    throws(() => zlib.gunzipSync(compressed.subarray(0, compressed.length - 4)));
+    // Not compressed at all.
+    throws(() => zlib.inflateSync(input));
+    throws(() => zlib.brotliDecompressSync(input));
+    // Output limit.
+    throws(() => zlib.inflateSync(zlib.deflateSync(input), { maxOutputLength: 100 }),
+           RangeError);
+    deepStrictEqual(
+        zlib.inflateSync(zlib.deflateSync(input), { maxOutputLength: input.length }), input);
+  }
+};
+
+export const callbackApis = {
+  async test() {
+    const compressed = await new Promise((resolve, reject) => {
+      zlib.gzip(input, (err, result) => err ? reject(err) : resolve(result));
+    });
+    const decompressed = await new Promise((resolve, reject) => {
+      zlib.gunzip(compressed, {}, (err, result) => err ? reject(err) : resolve(result));
+    });
+    deepStrictEqual(decompressed, input);
+
+    const error = await new Promise((resolve) => {
+      zlib.inflate(input, (err) => resolve(err));
+    });
+    ok(error instanceof Error);
+  }
+};
+
+export const streams = {
+  async test() {
+    const chunks = [];
+    for (let i = 0; i < input.length; i += 1000) {
+      chunks.push(input.subarray(i, i + 1000));
+    }
+
+    const pairs = [
+      [zlib.createDeflate, zlib.createInflate],
+      [zlib.createGzip, zlib.createGunzip],
+      [zlib.createDeflateRaw, zlib.createInflateRaw],
+      [zlib.createGzip, zlib.createUnzip],
+      [zlib.createBrotliCompress, zlib.createBrotliDecompress],
+    ];
+    for (const [compress, decompress] of pairs) {
+      const compressed = await collect(compress(), chunks);
+      const split = [compressed.subarray(0, 10), compressed.subarray(10)];
+      deepStrictEqual(await collect(decompress(), split), input, compress.name);
+    }
+
+    // Streaming and one-shot output are interchangeable.
+    deepStrictEqual(await collect(new zlib.Gunzip(), [zlib.gzipSync(input)]), input);
+    deepStrictEqual(zlib.gunzipSync(await collect(new zlib.Gzip(), chunks)), input);
+  }
+};
+
+export const streamFlush = {
+  async test() {
+    const gzip = zlib.createGzip();
+    const output = [];
+    gzip.on('data', (chunk) => output.push(chunk));
+    gzip.write('hello ');
+    await new Promise((resolve) => gzip.flush(resolve));
+
+    // Everything written before the flush can be decoded without the end of the stream.
+    const partial = zlib.gunzipSync(Buffer.concat(output), {
+      finishFlush: zlib.constants.Z_SYNC_FLUSH,
+    });
+    strictEqual(partial.toString(), 'hello ');
+
+    gzip.end('world');
+    await new Promise((resolve) => gzip.on('end', resolve));
+    strictEqual(zlib.gunzipSync(Buffer.concat(output)).toString(), 'hello world');
+  }
+};
+
+export const streamErrors = {
+  async test() {
+    const inflate = zlib.createInflate();
+    let error;
+    try {
+      await collect(inflate, [input]);
+    } catch (err) {
+      error = err;
+    }
+    ok(error instanceof Error);
+
+    throws(() => zlib.createGzip({ chunkSize: 1 }), { code: 'ERR_OUT_OF_RANGE' });
+    throws(() => zlib.createGzip({ flush: 6 }), { code: 'ERR_OUT_OF_RANGE' });
+  }
+};
+
+export const compatibleWithCompressionStream = {
+  async test() {
+    const stream = new Blob([zlib.gzipSync(input)]).stream()
+        .pipeThrough(new DecompressionStream('gzip'));
+    deepStrictEqual(Buffer.from(await new Response(stream).arrayBuffer()), input);
+
+    const compressed = new Blob([input]).stream().pipeThrough(new CompressionStream('deflate'));
+    deepStrictEqual(zlib.inflateSync(await new Response(compressed).arrayBuffer()), input);
+  }
+};
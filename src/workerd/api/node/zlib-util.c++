@@ -0,0 +1,148 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "zlib-util.h"
+#include <brotli/encode.h>
+#include <kj/vector.h>
+#include <zlib.h>
+
+namespace workerd::api::node {
+
+namespace {
+
+using Mode = ZlibUtil::Mode;
+using Flush = CompressionContext::Flush;
+
+Mode validateMode(int mode) {
+  JSG_REQUIRE(mode >= static_cast<int>(Mode::DEFLATE) &&
+              mode <= static_cast<int>(Mode::BROTLI_ENCODE), TypeError,
+      "Invalid zlib mode ", mode, ".");
+  return static_cast<Mode>(mode);
+}
+
+bool isBrotli(Mode mode) {
+  return mode == Mode::BROTLI_DECODE || mode == Mode::BROTLI_ENCODE;
+}
+
+kj::Own<CompressionContext> newContext(Mode mode, ZlibUtil::Options options) {
+  // Node reports truncated input as an error rather than returning what it has decoded so far,
+  // which is what the strict flag does for DecompressionStream.
+  auto flags = CompressionContext::ContextFlags::STRICT;
+
+  if (isBrotli(mode)) {
+    kj::Vector<BrotliParam> params;
+    KJ_IF_SOME(dict, options.params) {
+      params.reserve(dict.fields.size());
+      for (auto& field: dict.fields) {
+        auto key = JSG_REQUIRE_NONNULL(field.name.tryParseAs<uint32_t>(), RangeError,
+            "Invalid brotli parameter ", field.name, ".");
+        params.add(BrotliParam { .key = key, .value = field.value });
+      }
+    }
+    auto contextMode = mode == Mode::BROTLI_ENCODE ?
+        CompressionContext::Mode::COMPRESS : CompressionContext::Mode::DECOMPRESS;
+    return newBrotliContext(contextMode, flags, params.asPtr());
+  }
+
+  ZlibParams params;
+  KJ_IF_SOME(level, options.level) params.level = level;
+  KJ_IF_SOME(windowBits, options.windowBits) params.windowBits = windowBits;
+  KJ_IF_SOME(memLevel, options.memLevel) params.memLevel = memLevel;
+  KJ_IF_SOME(strategy, options.strategy) params.strategy = strategy;
+
+  auto compress = CompressionContext::Mode::COMPRESS;
+  auto decompress = CompressionContext::Mode::DECOMPRESS;
+  switch (mode) {
+    case Mode::DEFLATE: return newZlibContext(compress, ZlibFormat::DEFLATE, flags, params);
+    case Mode::INFLATE: return newZlibContext(decompress, ZlibFormat::DEFLATE, flags, params);
+    case Mode::GZIP: return newZlibContext(compress, ZlibFormat::GZIP, flags, params);
+    case Mode::GUNZIP: return newZlibContext(decompress, ZlibFormat::GZIP, flags, params);
+    case Mode::DEFLATERAW: return newZlibContext(compress, ZlibFormat::DEFLATE_RAW, flags, params);
+    case Mode::INFLATERAW:
+      return newZlibContext(decompress, ZlibFormat::DEFLATE_RAW, flags, params);
+    case Mode::UNZIP: return newZlibContext(decompress, ZlibFormat::AUTO, flags, params);
+    case Mode::NONE:
+    case Mode::BROTLI_DECODE:
+    case Mode::BROTLI_ENCODE:
+      break;
+  }
+  KJ_UNREACHABLE;
+}
+
+Flush toFlush(Mode mode, int flush) {
+  if (isBrotli(mode)) {
+    switch (flush) {
+      case BROTLI_OPERATION_PROCESS: return Flush::NONE;
+      case BROTLI_OPERATION_FLUSH: return Flush::SYNC;
+      case BROTLI_OPERATION_FINISH: return Flush::FINISH;
+    }
+  } else {
+    switch (flush) {
+      case Z_NO_FLUSH: return Flush::NONE;
+      // Z_PARTIAL_FLUSH and Z_BLOCK only exist for compatibility with old zlib releases; a sync
+      // flush produces output that is at least as complete.
+      case Z_PARTIAL_FLUSH: return Flush::SYNC;
+      case Z_SYNC_FLUSH: return Flush::SYNC;
+      case Z_BLOCK: return Flush::SYNC;
+      case Z_FULL_FLUSH: return Flush::FULL;
+      case Z_FINISH: return Flush::FINISH;
+    }
+  }
+  JSG_FAIL_REQUIRE(RangeError, "Invalid flush value ", flush, ".");
+}
+
+kj::Array<kj::byte> pump(CompressionContext& context, kj::ArrayPtr<const kj::byte> input,
+                         Flush flush, size_t maxOutputLength = kj::maxValue) {
+  context.setInput(input.begin(), input.size());
+
+  kj::Vector<kj::byte> output;
+  for (;;) {
+    auto result = context.pumpOnce(flush);
+    JSG_REQUIRE(output.size() + result.buffer.size() <= maxOutputLength, RangeError,
+        "Cannot create a Buffer larger than ", maxOutputLength, " bytes.");
+    output.addAll(result.buffer);
+    if (!result.success) break;
+  }
+  return output.releaseAsArray();
+}
+
+}  // namespace
+
+jsg::Ref<ZlibUtil::ZlibStream> ZlibUtil::ZlibStream::constructor(
+    int mode, jsg::Optional<Options> options) {
+  auto validMode = validateMode(mode);
+  return jsg::alloc<ZlibStream>(validMode,
+      newContext(validMode, kj::mv(options).orDefault(Options {})));
+}
+
+kj::Array<kj::byte> ZlibUtil::ZlibStream::push(kj::Array<kj::byte> data, int flush) {
+  return pump(*context, data, toFlush(mode, flush));
+}
+
+uint32_t ZlibUtil::crc32(kj::Array<kj::byte> data, uint32_t value) {
+  // zlib's crc32() takes a uInt length, so feed it in pieces in case `data` is larger than that.
+  auto remaining = data.asPtr();
+  while (remaining.size() > 0) {
+    auto chunk = kj::min(remaining.size(), size_t(uInt(kj::maxValue)));
+    value = ::crc32(value, remaining.begin(), chunk);
+    remaining = remaining.slice(chunk, remaining.size());
+  }
+  return value;
+}
+
+kj::Array<kj::byte> ZlibUtil::processSync(kj::Array<kj::byte> data, int mode,
+                                          jsg::Optional<Options> options, int finishFlush,
+                                          jsg::Optional<double> maxOutputLength) {
+  auto validMode = validateMode(mode);
+  auto context = newContext(validMode, kj::mv(options).orDefault(Options {}));
+  size_t limit = kj::maxValue;
+  KJ_IF_SOME(max, maxOutputLength) {
+    JSG_REQUIRE(max >= 1 && max <= static_cast<double>(size_t(kj::maxValue)),
+        RangeError, "The value of \"options.maxOutputLength\" is out of range.");
+    limit = static_cast<size_t>(max);
+  }
+  return pump(*context, data, toFlush(validMode, finishFlush), limit);
+}
+
+}  // namespace workerd::api::node
@@ -0,0 +1,87 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+#pragma once
+
+#include <workerd/api/streams/compression-context.h>
+#include <workerd/jsg/jsg.h>
+#include <workerd/jsg/url.h>
+
+namespace workerd::api::node {
+
+// Native backing for node:zlib. The codecs are the same ones behind CompressionStream; this just
+// exposes them synchronously, one buffer at a time, which is what both the *Sync() functions and
+// the Transform stream classes need.
+class ZlibUtil final: public jsg::Object {
+public:
+  ZlibUtil() = default;
+  ZlibUtil(jsg::Lock&, const jsg::Url&) {}
+
+  // Same numbering as the mode constants of Node's zlib binding (zlib.constants.DEFLATE etc).
+  enum class Mode {
+    NONE,
+    DEFLATE,
+    INFLATE,
+    GZIP,
+    GUNZIP,
+    DEFLATERAW,
+    INFLATERAW,
+    UNZIP,
+    BROTLI_DECODE,
+    BROTLI_ENCODE,
+  };
+
+  struct Options {
+    jsg::Optional<int> level;
+    jsg::Optional<int> windowBits;
+    jsg::Optional<int> memLevel;
+    jsg::Optional<int> strategy;
+    // Brotli only: BROTLI_PARAM_* / BROTLI_DECODER_PARAM_* values, keyed by parameter number.
+    jsg::Optional<jsg::Dict<uint32_t>> params;
+
+    JSG_STRUCT(level, windowBits, memLevel, strategy, params);
+  };
+
+  // A compressor or decompressor that keeps its state between calls, for the Transform streams.
+  class ZlibStream final: public jsg::Object {
+  public:
+    ZlibStream(Mode mode, kj::Own<CompressionContext> context)
+        : mode(mode), context(kj::mv(context)) {}
+
+    static jsg::Ref<ZlibStream> constructor(int mode, jsg::Optional<Options> options);
+
+    // Feeds `data` through the codec and returns all the output it produces. `flush` is one of
+    // the Z_*_FLUSH constants, or a BROTLI_OPERATION_* constant for the brotli modes.
+    kj::Array<kj::byte> push(kj::Array<kj::byte> data, int flush);
+
+    JSG_RESOURCE_TYPE(ZlibStream) {
+      JSG_METHOD(push);
+    }
+
+  private:
+    Mode mode;
+    kj::Own<CompressionContext> context;
+  };
+
+  uint32_t crc32(kj::Array<kj::byte> data, uint32_t value);
+
+  // Runs `data` through a fresh codec in one go, ending with `finishFlush` (normally Z_FINISH or
+  // BROTLI_OPERATION_FINISH). Fails with a RangeError once the output would exceed
+  // `maxOutputLength` bytes.
+  kj::Array<kj::byte> processSync(kj::Array<kj::byte> data, int mode,
+                                  jsg::Optional<Options> options, int finishFlush,
+                                  jsg::Optional<double> maxOutputLength);
+
+  JSG_RESOURCE_TYPE(ZlibUtil) {
+    JSG_METHOD(crc32);
+    JSG_METHOD(processSync);
+    JSG_NESTED_TYPE(ZlibStream);
+  }
+};
+
+#define EW_NODE_ZLIB_ISOLATE_TYPES         \
+    api::node::ZlibUtil,                   \
+    api::node::ZlibUtil::ZlibStream,       \
+    api::node::ZlibUtil::Options
+
+}  // namespace workerd::api::node
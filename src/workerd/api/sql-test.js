@@ -752,6 +752,57 @@ async function test(storage) {
     assert.equal(Array.from(execIterator.raw())[0].length, 6)
   }
 
+  // Rows of the same statement share a shape, and still come out right when names can't be
+  // used for that
+  {
+    sql.exec(`CREATE TABLE shapes (a INT, b TEXT, "0" INT, __proto__ INT);`)
+    sql.exec(`INSERT INTO shapes VALUES (1,'x',2,3),(4,'y',5,6);`)
+
+    const stmt = sql.prepare(`SELECT a, b FROM shapes`)
+    assert.deepEqual(Array.from(stmt()), [
+      { a: 1, b: 'x' },
+      { a: 4, b: 'y' },
+    ])
+    assert.deepEqual(Array.from(stmt()), [
+      { a: 1, b: 'x' },
+      { a: 4, b: 'y' },
+    ])
+
+    const rows = Array.from(sql.exec(`SELECT "0", b FROM shapes`))
+    assert.deepEqual(rows, [{ 0: 2, b: 'x' }, { 0: 5, b: 'y' }])
+    assert.deepEqual(Object.keys(rows[0]), ['0', 'b'])
+
+    // As always, a `__proto__` column sets the prototype, which a number can't be
+    const protoRows = Array.from(sql.exec(`SELECT a, __proto__ FROM shapes`))
+    assert.deepEqual(Object.keys(protoRows[0]), ['a'])
+  }
+
+  // Columnar results
+  {
+    sql.exec(`CREATE TABLE columnar (i INT, r REAL, t TEXT, mixed);`)
+    sql.exec(`INSERT INTO columnar VALUES (1, 0.5, 'a', 1), (2, 1.5, 'b', 'x'), (3, 2.5, 'c', NULL);`)
+
+    const columns = sql.exec(`SELECT * FROM columnar`).rawColumns()
+    assert.equal(columns.length, 4)
+    assert.ok(columns[0] instanceof Float64Array)
+    assert.deepEqual(Array.from(columns[0]), [1, 2, 3])
+    assert.ok(columns[1] instanceof Float64Array)
+    assert.deepEqual(Array.from(columns[1]), [0.5, 1.5, 2.5])
+    assert.deepEqual(columns[2], ['a', 'b', 'c'])
+    assert.deepEqual(columns[3], [1, 'x', null])
+
+    // Picks up where iteration left off
+    const cursor = sql.exec(`SELECT i FROM columnar ORDER BY i`)
+    assert.deepEqual(cursor[Symbol.iterator]().next().value, { i: 1 })
+    assert.deepEqual(Array.from(cursor.rawColumns()[0]), [2, 3])
+    assert.equal(cursor.rowsRead, 3)
+    assert.deepEqual(Array.from(cursor.rawColumns()), [])
+
+    const empty = sql.exec(`SELECT i FROM columnar WHERE i > 100`).rawColumns()
+    assert.equal(empty.length, 1)
+    assert.equal(empty[0].length, 0)
+  }
+
   await scheduler.wait(1)
 
   // Test for bug where a cursor constructed from a prepared statement didn't have a strong ref
@@ -1090,6 +1141,55 @@ async function testStreamingIngestion(request, storage) {
   )
 }
 
+async function testColumnarExport(storage) {
+  const { sql } = storage
+
+  sql.exec(`CREATE TABLE snapshot_src(id INTEGER PRIMARY KEY, name TEXT, score, data BLOB)`)
+  sql.exec(`CREATE TABLE snapshot_dst(id INTEGER PRIMARY KEY, name TEXT, score, data BLOB)`)
+  for (let i = 0; i < 3000; i++) {
+    // `score` mixes types, so some batches encode it as a mixed column.
+    const score = i % 100 == 7 ? 'seven' : i % 3 ? i * 1.5 : null
+    sql.exec(
+      `INSERT INTO snapshot_src VALUES (?, ?, ?, ?)`,
+      i,
+      `name ${i}`,
+      score,
+      new Uint8Array([i & 0xff, i >> 8])
+    )
+  }
+
+  const stream = sql.exportColumns(`SELECT * FROM snapshot_src WHERE id >= ?`, 1000)
+  const result = await sql.importColumns('snapshot_dst', stream)
+  assert.equal(result.rowsWritten, 2000)
+  assert.deepEqual(
+    Array.from(sql.exec(`SELECT * FROM snapshot_dst ORDER BY id`).raw()),
+    Array.from(sql.exec(`SELECT * FROM snapshot_src WHERE id >= 1000 ORDER BY id`).raw())
+  )
+
+  // A failing row leaves no others behind.
+  await assert.rejects(
+    sql.importColumns('snapshot_dst', sql.exportColumns(`SELECT * FROM snapshot_src`)),
+    /UNIQUE constraint failed/
+  )
+  assert.deepEqual(Array.from(sql.exec(`SELECT count(*) AS n FROM snapshot_dst`)), [{ n: 2000 }])
+
+  // The same names are off-limits as for exec().
+  assert.throws(
+    () => sql.exportColumns(`SELECT * FROM _cf_KV`),
+    /not authorized/
+  )
+  await assert.rejects(
+    sql.importColumns('_cf_KV', sql.exportColumns(`SELECT 'a' AS key, 'b' AS value`)),
+    /not authorized/
+  )
+
+  // Anything else is rejected.
+  await assert.rejects(
+    sql.importColumns('snapshot_dst', new Blob(['not columnar']).stream()),
+    /not in columnar format/
+  )
+}
+
 export class DurableObjectExample {
   constructor(state, env) {
     this.state = state
@@ -1122,6 +1222,23 @@ export class DurableObjectExample {
     } else if (req.url.endsWith('/streaming-ingestion')) {
       await testStreamingIngestion(req, this.state.storage)
       return Response.json({ ok: true })
+    } else if (req.url.endsWith('/columnar-export')) {
+      await testColumnarExport(this.state.storage)
+      return Response.json({ ok: true })
+    } else if (req.url.endsWith('/columnar-export-response')) {
+      // The stream is read only after this handler returns.
+      return new Response(
+        this.state.storage.sql.exportColumns(`SELECT * FROM snapshot_src`)
+      )
+    } else if (req.url.endsWith('/columnar-import')) {
+      const { sql } = this.state.storage
+      sql.exec(`CREATE TABLE snapshot_copy(id INTEGER PRIMARY KEY, name TEXT, score, data BLOB)`)
+      const result = await sql.importColumns('snapshot_copy', req.body)
+      assert.deepEqual(
+        Array.from(sql.exec(`SELECT * FROM snapshot_copy ORDER BY id`).raw()),
+        Array.from(sql.exec(`SELECT * FROM snapshot_src ORDER BY id`).raw())
+      )
+      return Response.json({ rowsWritten: result.rowsWritten })
     }
 
     throw new Error('unknown url: ' + req.url)
@@ -1174,6 +1291,16 @@ export default {
       { ok: true }
     )
 
+    // Test columnar export and import
+    assert.deepEqual(await doReq('columnar-export'), { ok: true })
+
+    // An export can be returned as a Response body, and read back in another request.
+    let exported = await obj.fetch('http://foo/columnar-export-response')
+    assert.deepEqual(
+      await doReq('columnar-import', { method: 'POST', body: exported.body }),
+      { rowsWritten: 3000 }
+    )
+
     // Test defer_foreign_keys (explodes the DO)
     await assert.rejects(async () => {
       await doReq('sql-test-foreign-keys')
@@ -4,10 +4,49 @@
 
 #include "sql.h"
 #include "actor-state.h"
+#include "streams.h"
+#include "streams/standard.h"
 #include "workerd/io/io-context.h"
+#include <workerd/util/sqlite-columnar.h>
 
 namespace workerd::api {
 
+namespace {
+
+// Whether a column can be a property of row objects made from a v8::DictionaryTemplate. Names
+// that look like integers are array indices rather than named properties, and assigning
+// `__proto__` sets the prototype, so rows with such columns are built property by property to
+// keep behaving as they always have.
+bool isTemplatePropertyName(kj::StringPtr name) {
+  if (name.size() == 0 || name == "__proto__") return false;
+  for (char c: name) {
+    if (c < '0' || c > '9') return true;
+  }
+  return false;
+}
+
+// Converts a value the same way JSG converts a Cursor::Value.
+v8::Local<v8::Value> wrapValue(jsg::Lock& js, SqlStorage::Cursor::Value&& value) {
+  KJ_IF_SOME(v, value) {
+    KJ_SWITCH_ONEOF(v) {
+      KJ_CASE_ONEOF(data, kj::Array<byte>) {
+        return js.arrayBuffer(kj::mv(data)).getHandle(js);
+      }
+      KJ_CASE_ONEOF(text, kj::StringPtr) {
+        return js.str(text);
+      }
+      KJ_CASE_ONEOF(d, double) {
+        return js.num(d);
+      }
+    }
+    KJ_UNREACHABLE;
+  } else {
+    return js.null();
+  }
+}
+
+}  // namespace
+
 SqlStorage::SqlStorage(SqliteDatabase& sqlite, jsg::Ref<DurableObjectStorage> storage)
     : sqlite(IoContext::current().addObject(sqlite)), storage(kj::mv(storage)) {}
 
@@ -25,6 +64,72 @@ SqlStorage::IngestResult SqlStorage::ingest(jsg::Lock& js, kj::String querySql)
   return IngestResult(kj::str(result.remainder), result.rowsRead, result.rowsWritten, result.statementCount);
 }
 
+// The running query behind a stream returned by exportColumns().
+struct SqlStorage::ExportState {
+  ExportState(SqlStorage& sqlStorage, kj::StringPtr sqlCode,
+              kj::Array<BindingValue> bindingsParam)
+      : bindings(kj::mv(bindingsParam)),
+        query(sqlStorage.sqlite->run(static_cast<SqliteDatabase::Regulator&>(sqlStorage),
+            sqlCode, Cursor::mapBindings(bindings).asPtr())),
+        writer(query) {}
+
+  // The query may point into these until it is done.
+  kj::Array<BindingValue> bindings;
+
+  SqliteDatabase::Query query;
+  SqliteColumnar::Writer writer;
+};
+
+jsg::Ref<ReadableStream> SqlStorage::exportColumns(jsg::Lock& js, kj::String querySql,
+                                                   jsg::Arguments<BindingValue> bindings) {
+  // The stream is pulled from JavaScript, so each batch of rows is read from the database under
+  // the isolate lock, in this request's IoContext, even when the stream is a Response body that
+  // is consumed after the handler returns. The query is dropped along with the IoContext.
+  auto state = IoContext::current().addObject(
+      kj::heap<ExportState>(*this, querySql, kj::mv(bindings)));
+
+  return ReadableStream::constructor(js, UnderlyingSource {
+    .pull = JSG_VISITABLE_LAMBDA((self = JSG_THIS, state = kj::mv(state)), (self),
+                                 (jsg::Lock& js, auto controller) mutable {
+      auto& c = controller.template get<jsg::Ref<ReadableStreamDefaultController>>();
+      KJ_IF_SOME(chunk, state->writer.next()) {
+        c->enqueue(js, jsg::BufferSource(js,
+            jsg::BackingStore::from<v8::Uint8Array>(kj::mv(chunk))).getHandle(js));
+      } else {
+        c->close(js);
+      }
+      return js.resolvedPromise();
+    }),
+  }, StreamQueuingStrategy { .highWaterMark = 0, });
+}
+
+jsg::Promise<SqlStorage::ImportResult> SqlStorage::importColumns(
+    jsg::Lock& js, kj::String table, jsg::Ref<ReadableStream> stream) {
+  auto& context = IoContext::current();
+  return stream->getController().readAllBytes(js, context.getLimitEnforcer().getBufferingLimit())
+      .then(js, [self = JSG_THIS, table = kj::mv(table)](
+          jsg::Lock& js, kj::Array<byte> data) -> ImportResult {
+    auto& db = *self->sqlite;
+    SqliteDatabase::Regulator& regulator = *self;
+
+    // Insert everything under a savepoint, which the rows' implicit transaction commits along with
+    // them, so that a bad row leaves none of the others behind. SAVEPOINT is a readonly
+    // statement, but we need to trigger an outer TRANSACTION.
+    db.notifyWrite();
+    db.run(SqliteDatabase::TRUSTED, "SAVEPOINT _cf_import_savepoint");
+    uint64_t rowsWritten;
+    try {
+      rowsWritten = SqliteColumnar::ingest(db, regulator, table, data);
+    } catch (...) {
+      db.run(SqliteDatabase::TRUSTED, "ROLLBACK TO _cf_import_savepoint");
+      db.run(SqliteDatabase::TRUSTED, "RELEASE _cf_import_savepoint");
+      throw;
+    }
+    db.run(SqliteDatabase::TRUSTED, "RELEASE _cf_import_savepoint");
+    return { .rowsWritten = static_cast<double>(rowsWritten) };
+  });
+}
+
 jsg::Ref<SqlStorage::Statement> SqlStorage::prepare(jsg::Lock& js, kj::String query) {
   return jsg::alloc<Statement>(sqlite->prepare(*this, query));
 }
@@ -89,14 +194,49 @@ void SqlStorage::Cursor::CachedColumnNames::ensureInitialized(
   if (names == kj::none) {
     js.withinHandleScope([&] {
       auto builder = kj::heapArrayBuilder<jsg::JsRef<jsg::JsString>>(source.columnCount());
+      auto templateNames = kj::heapArrayBuilder<std::string_view>(builder.capacity());
+      kj::HashSet<kj::StringPtr> seen;
+      bool canUseTemplate = true;
       for (auto i: kj::zeroTo(builder.capacity())) {
-        builder.add(js, js.str(source.getColumnName(i)));
+        kj::StringPtr name = source.getColumnName(i);
+        builder.add(js, js.str(name));
+
+        // Duplicate names (e.g. from a join) also rule out a template, since the last column of a
+        // given name has to win.
+        if (!isTemplatePropertyName(name) || seen.contains(name)) {
+          canUseTemplate = false;
+        } else {
+          seen.insert(name);
+        }
+        templateNames.add(name.begin(), name.size());
       }
       names = builder.finish();
+
+      if (canUseTemplate) {
+        auto span = v8::MemorySpan<const std::string_view>(
+            templateNames.begin(), templateNames.size());
+        rowTemplate = jsg::V8Ref<v8::DictionaryTemplate>(
+            js.v8Isolate, v8::DictionaryTemplate::New(js.v8Isolate, span));
+      }
     });
   }
 }
 
+jsg::JsObject SqlStorage::Cursor::CachedColumnNames::makeRow(
+    jsg::Lock& js, kj::ArrayPtr<v8::MaybeLocal<v8::Value>> values) {
+  KJ_IF_SOME(t, rowTemplate) {
+    auto span = v8::MemorySpan<v8::MaybeLocal<v8::Value>>(values.begin(), values.size());
+    return jsg::JsObject(t.getHandle(js)->NewInstance(js.v8Context(), span));
+  }
+
+  auto row = js.obj();
+  auto names = get();
+  for (auto i: kj::indices(values)) {
+    row.set(js, names[i].getHandle(js), jsg::JsValue(values[i].ToLocalChecked()));
+  }
+  return row;
+}
+
 double SqlStorage::Cursor::getRowsRead() {
   KJ_IF_SOME(st, state) {
     return static_cast<double>(st->query.getRowsRead());
@@ -120,20 +260,16 @@ jsg::Ref<SqlStorage::Cursor::RowIterator> SqlStorage::Cursor::rows(jsg::Lock& js
   return jsg::alloc<RowIterator>(JSG_THIS);
 }
 
-kj::Maybe<SqlStorage::Cursor::RowDict> SqlStorage::Cursor::rowIteratorNext(
+kj::Maybe<jsg::JsObject> SqlStorage::Cursor::rowIteratorNext(
     jsg::Lock& js, jsg::Ref<Cursor>& obj) {
-  auto names = obj->cachedColumnNames.get();
+  // A little trick here: We know there are no HandleScopes on the stack between JSG and here,
+  // so we can hold the values as local handles, which avoids constructing new V8Refs here which
+  // would be relatively slower.
   return iteratorImpl(js, obj,
-      [&](State& state, uint i, Value&& value) {
-    return RowDict::Field{
-      // A little trick here: We know there are no HandleScopes on the stack between JSG and here,
-      // so we can return a dict keyed by local handles, which avoids constructing new V8Refs here
-      // which would be relatively slower.
-      .name = names[i].getHandle(js),
-      .value = kj::mv(value)
-    };
-  }).map([&](kj::Array<RowDict::Field>&& fields) {
-    return RowDict { .fields = kj::mv(fields) };
+      [&](State& state, uint i, Value&& value) -> v8::MaybeLocal<v8::Value> {
+    return wrapValue(js, kj::mv(value));
+  }).map([&](kj::Array<v8::MaybeLocal<v8::Value>>&& values) {
+    return obj->cachedColumnNames.makeRow(js, values);
   });
 }
 
@@ -155,6 +291,63 @@ kj::Array<jsg::JsRef<jsg::JsString>> SqlStorage::Cursor::getColumnNames(jsg::Loc
   }
 }
 
+jsg::JsArray SqlStorage::Cursor::rawColumns(jsg::Lock& js) {
+  // A column collects plain numbers until it sees a value that isn't one, at which point it
+  // switches to holding JavaScript values. There are no HandleScopes on the stack between JSG
+  // and here, so the values can be local handles.
+  struct Column {
+    kj::Vector<double> numbers;
+    kj::Maybe<kj::Vector<v8::Local<v8::Value>>> values;
+  };
+
+  size_t columnCount = 0;
+  KJ_IF_SOME(s, state) {
+    columnCount = s->query.columnCount();
+  }
+  auto columns = kj::heapArray<Column>(columnCount);
+
+  while (true) {
+    auto& query = KJ_UNWRAP_OR(nextRow(*this), break).query;
+    for (auto i: kj::indices(columns)) {
+      auto& column = columns[i];
+      auto value = getValue(query, i);
+
+      KJ_IF_SOME(values, column.values) {
+        values.add(wrapValue(js, kj::mv(value)));
+        continue;
+      }
+      KJ_IF_SOME(v, value) {
+        KJ_IF_SOME(d, v.tryGet<double>()) {
+          column.numbers.add(d);
+          continue;
+        }
+      }
+
+      auto& values = column.values.emplace();
+      values.reserve(column.numbers.size() + 1);
+      for (double d: column.numbers) {
+        values.add(js.num(d));
+      }
+      column.numbers.clear();
+      values.add(wrapValue(js, kj::mv(value)));
+    }
+  }
+
+  auto result = kj::heapArrayBuilder<v8::Local<v8::Value>>(columns.size());
+  for (auto& column: columns) {
+    KJ_IF_SOME(values, column.values) {
+      result.add(v8::Array::New(js.v8Isolate, values.begin(), values.size()));
+    } else {
+      // Hand the numbers to V8 without copying them.
+      auto numbers = column.numbers.releaseAsArray();
+      auto bytes = numbers.asBytes().attach(kj::mv(numbers));
+      result.add(jsg::BufferSource(js,
+          jsg::BackingStore::from<v8::Float64Array>(kj::mv(bytes))).getHandle(js));
+    }
+  }
+  return jsg::JsArray(v8::Array::New(js.v8Isolate, result.begin(), result.size()));
+}
+
 kj::Maybe<kj::Array<SqlStorage::Cursor::Value>> SqlStorage::Cursor::rawIteratorNext(
     jsg::Lock& js, jsg::Ref<Cursor>& obj) {
   return iteratorImpl(js, obj,
@@ -163,14 +356,9 @@ kj::Maybe<kj::Array<SqlStorage::Cursor::Value>> SqlStorage::Cursor::rawIteratorN
   });
 }
 
-template <typename Func>
-auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func&& func)
-    -> kj::Maybe<kj::Array<
-        decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()))>> {
-  using Element = decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()));
-
-  auto& state = *KJ_UNWRAP_OR(obj->state, {
-    if (obj->canceled) {
+kj::Maybe<SqlStorage::Cursor::State&> SqlStorage::Cursor::nextRow(Cursor& obj) {
+  auto& state = *KJ_UNWRAP_OR(obj.state, {
+    if (obj.canceled) {
       JSG_FAIL_REQUIRE(Error,
           "SQL cursor was closed because the same statement was executed again. If you need to "
           "run multiple copies of the same statement concurrently, you must create multiple "
@@ -182,8 +370,9 @@ auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func
   });
 
   if (state.isFirst) {
-    // Little hack: We don't want to call query.nextRow() at the end of this method because it
-    // may invalidate the backing buffers of StringPtrs that we haven't returned to JS yet.
+    // Little hack: We don't want to call query.nextRow() as soon as we're done reading a row
+    // because it may invalidate the backing buffers of StringPtrs that we haven't returned to JS
+    // yet.
     state.isFirst = false;
   } else {
     state.query.nextRow();
@@ -193,37 +382,53 @@ auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func
 
   if (query.isDone()) {
     // Save off row counts before the query goes away.
-    obj->rowsRead = query.getRowsRead();
-    obj->rowsWritten = query.getRowsWritten();
+    obj.rowsRead = query.getRowsRead();
+    obj.rowsWritten = query.getRowsWritten();
     // Clean up the query proactively.
-    obj->state = kj::none;
+    obj.state = kj::none;
     return kj::none;
   }
 
+  return state;
+}
+
+SqlStorage::Cursor::Value SqlStorage::Cursor::getValue(SqliteDatabase::Query& query, uint i) {
+  Value value;
+  KJ_SWITCH_ONEOF(query.getValue(i)) {
+    KJ_CASE_ONEOF(data, kj::ArrayPtr<const byte>) {
+      value.emplace(kj::heapArray(data));
+    }
+    KJ_CASE_ONEOF(text, kj::StringPtr) {
+      value.emplace(text);
+    }
+    KJ_CASE_ONEOF(i, int64_t) {
+      // int64 will become BigInt, but most applications won't want all their integers to be
+      // BigInt. We will coerce to a double here.
+      // TODO(someday): Allow applications to request that certain columns use BigInt.
+      value.emplace(static_cast<double>(i));
+    }
+    KJ_CASE_ONEOF(d, double) {
+      value.emplace(d);
+    }
+    KJ_CASE_ONEOF(_, decltype(nullptr)) {
+      // leave value null
+    }
+  }
+  return value;
+}
+
+template <typename Func>
+auto SqlStorage::Cursor::iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func&& func)
+    -> kj::Maybe<kj::Array<
+        decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()))>> {
+  using Element = decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()));
+
+  auto& state = KJ_UNWRAP_OR_RETURN(nextRow(*obj), kj::none);
+  auto& query = state.query;
+
   auto results = kj::heapArrayBuilder<Element>(query.columnCount());
   for (auto i: kj::zeroTo(results.capacity())) {
-    Value value;
-    KJ_SWITCH_ONEOF(query.getValue(i)) {
-      KJ_CASE_ONEOF(data, kj::ArrayPtr<const byte>) {
-        value.emplace(kj::heapArray(data));
-      }
-      KJ_CASE_ONEOF(text, kj::StringPtr) {
-        value.emplace(text);
-      }
-      KJ_CASE_ONEOF(i, int64_t) {
-        // int64 will become BigInt, but most applications won't want all their integers to be
-        // BigInt. We will coerce to a double here.
-        // TODO(someday): Allow applications to request that certain columns use BigInt.
-        value.emplace(static_cast<double>(i));
-      }
-      KJ_CASE_ONEOF(d, double) {
-        value.emplace(d);
-      }
-      KJ_CASE_ONEOF(_, decltype(nullptr)) {
-        // leave value null
-      }
-    }
-    results.add(func(state, i, kj::mv(value)));
+    results.add(func(state, i, getValue(query, i)));
   }
   return results.finish();
 }
@@ -12,6 +12,7 @@
 namespace workerd::api {
 
 class DurableObjectStorage;
+class ReadableStream;
 
 class SqlStorage final: public jsg::Object, private SqliteDatabase::Regulator {
 public:
@@ -23,10 +24,22 @@ public:
   class Cursor;
   class Statement;
   struct IngestResult;
+  struct ImportResult;
 
   jsg::Ref<Cursor> exec(jsg::Lock& js, kj::String query, jsg::Arguments<BindingValue> bindings);
   IngestResult ingest(jsg::Lock& js, kj::String query);
 
+  // Runs a query and returns its results as a stream in the columnar format of SqliteColumnar,
+  // which is much cheaper to produce than the same rows read through a Cursor. Rows are read from
+  // the database as the stream is consumed.
+  jsg::Ref<ReadableStream> exportColumns(
+      jsg::Lock& js, kj::String query, jsg::Arguments<BindingValue> bindings);
+
+  // Inserts every row of a stream produced by exportColumns() into `table`, whose columns must
+  // include those of the exported query. Either every row is inserted or, if any fails, none is.
+  jsg::Promise<ImportResult> importColumns(
+      jsg::Lock& js, kj::String table, jsg::Ref<ReadableStream> stream);
+
   jsg::Ref<Statement> prepare(jsg::Lock& js, kj::String query);
 
   double getDatabaseSize();
@@ -39,6 +52,8 @@ public:
     // the SQL API becomes publicly available.
     if (flags.getWorkerdExperimental()) {
       JSG_METHOD(ingest);
+      JSG_METHOD(exportColumns);
+      JSG_METHOD(importColumns);
     }
 
     JSG_READONLY_PROTOTYPE_PROPERTY(databaseSize, getDatabaseSize);
@@ -50,6 +65,8 @@ public:
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const;
 
 private:
+  struct ExportState;
+
   void visitForGc(jsg::GcVisitor& visitor) {
     visitor.visit(storage);
   }
@@ -111,12 +128,27 @@ public:
   double getRowsWritten();
 
   kj::Array<jsg::JsRef<jsg::JsString>> getColumnNames(jsg::Lock& js);
-  JSG_RESOURCE_TYPE(Cursor) {
+
+  // Reads all remaining rows at once, returning them by column rather than by row: an array with
+  // an element per column, which is a Float64Array if every value in the column is a number, or
+  // else an array of the values.
+  jsg::JsArray rawColumns(jsg::Lock& js);
+
+  JSG_RESOURCE_TYPE(Cursor, CompatibilityFlags::Reader flags) {
     JSG_ITERABLE(rows);
     JSG_METHOD(raw);
+    if (flags.getWorkerdExperimental()) {
+      JSG_METHOD(rawColumns);
+    }
     JSG_READONLY_PROTOTYPE_PROPERTY(columnNames, getColumnNames);
     JSG_READONLY_PROTOTYPE_PROPERTY(rowsRead, getRowsRead);
     JSG_READONLY_PROTOTYPE_PROPERTY(rowsWritten, getRowsWritten);
+
+    // Rows are built as plain objects (see rowIteratorNext()), which JSG would otherwise declare
+    // as `object`.
+    JSG_TS_OVERRIDE({
+      [Symbol.iterator](): IterableIterator<Record<string, ArrayBuffer | string | number | null>>;
+    });
   }
 
   // One value returned from SQL. Note that we intentionally return StringPtr instead of String
@@ -125,8 +157,7 @@ public:
   // JSG, which does not need to make a copy.
   using Value = kj::Maybe<kj::OneOf<kj::Array<byte>, kj::StringPtr, double>>;
 
-  using RowDict = jsg::Dict<Value, jsg::JsString>;
-  JSG_ITERATOR(RowIterator, rows, RowDict, jsg::Ref<Cursor>, rowIteratorNext);
+  JSG_ITERATOR(RowIterator, rows, jsg::JsObject, jsg::Ref<Cursor>, rowIteratorNext);
   JSG_ITERATOR(RawIterator, raw, kj::Array<Value>, jsg::Ref<Cursor>, rawIteratorNext);
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
@@ -139,15 +170,18 @@ public:
 
 private:
   // Helper class to cache column names for a query so that we don't have to recreate the V8
-  // strings for every row.
+  // strings for every row, nor work out the layout of every row object from scratch.
   class CachedColumnNames {
-    // TODO(perf): Can we further cache the V8 object layout information for a row?
   public:
     // Get the cached names. ensureInitialized() must have been called previously.
     kj::ArrayPtr<jsg::JsRef<jsg::JsString>> get() { return KJ_REQUIRE_NONNULL(names); }
 
     void ensureInitialized(jsg::Lock& js, SqliteDatabase::Query& source);
 
+    // Creates the object for a row, given a value for each column. ensureInitialized() must have
+    // been called previously.
+    jsg::JsObject makeRow(jsg::Lock& js, kj::ArrayPtr<v8::MaybeLocal<v8::Value>> values);
+
     JSG_MEMORY_INFO(cachedColumnNames) {
       KJ_IF_SOME(list, names) {
         for (const auto& name : list) {
@@ -158,6 +192,13 @@ private:
 
   private:
     kj::Maybe<kj::Array<jsg::JsRef<jsg::JsString>>> names;
+
+    // Creates row objects with all of their properties at once. Every object made from the same
+    // template shares its layout (V8 "map"), so V8 doesn't have to go through a chain of layout
+    // transitions for each row, and code reading the rows sees one shape. kj::none if some
+    // column names can't be used in a template, in which case rows are built property by
+    // property.
+    kj::Maybe<jsg::V8Ref<v8::DictionaryTemplate>> rowTemplate;
   };
 
   struct State {
@@ -210,14 +251,20 @@ private:
   static kj::Array<const SqliteDatabase::Query::ValuePtr> mapBindings(
       kj::ArrayPtr<BindingValue> values);
 
-  static kj::Maybe<RowDict> rowIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
+  static kj::Maybe<jsg::JsObject> rowIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
   static kj::Maybe<kj::Array<Value>> rawIteratorNext(jsg::Lock& js, jsg::Ref<Cursor>& obj);
+  // Moves to the next row, returning kj::none if there are no more.
+  static kj::Maybe<State&> nextRow(Cursor& obj);
+
+  static Value getValue(SqliteDatabase::Query& query, uint i);
+
   template <typename Func>
   static auto iteratorImpl(jsg::Lock& js, jsg::Ref<Cursor>& obj, Func&& func)
       -> kj::Maybe<kj::Array<
           decltype(func(kj::instance<State&>(), uint(), kj::instance<Value&&>()))>>;
 
   friend class Statement;
+  friend class SqlStorage;
 };
 
 class SqlStorage::Statement final: public jsg::Object {
@@ -263,12 +310,19 @@ struct SqlStorage::IngestResult {
   JSG_STRUCT(remainder, rowsRead, rowsWritten, statementCount);
 };
 
+struct SqlStorage::ImportResult {
+  double rowsWritten;
+
+  JSG_STRUCT(rowsWritten);
+};
+
 
 #define EW_SQL_ISOLATE_TYPES                    \
   api::SqlStorage,                              \
   api::SqlStorage::Statement,                   \
   api::SqlStorage::Cursor,                      \
   api::SqlStorage::IngestResult,                \
+  api::SqlStorage::ImportResult,                \
   api::SqlStorage::Cursor::RowIterator,         \
   api::SqlStorage::Cursor::RowIterator::Next,   \
   api::SqlStorage::Cursor::RawIterator,         \
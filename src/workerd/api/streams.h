@@ -43,6 +43,7 @@ namespace workerd::api {
   api::ReadableStream::ReadableStreamAsyncIterator,                   \
   api::ReadableStream::ReadableStreamAsyncIterator::Next,             \
   api::CompressionStream,                                             \
+  api::CompressionStream::Options,                                    \
   api::DecompressionStream,                                           \
   api::TextEncoderStream,                                             \
   api::TextDecoderStream,                                             \
@@ -0,0 +1,361 @@
+// Copyright (c) 2017-2022 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "compression-context.h"
+#include <workerd/jsg/jsg.h>
+#include <workerd/util/zstd.h>
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#include <zlib.h>
+#include <zstd.h>
+
+namespace workerd::api {
+
+namespace {
+
+class ZlibContext final: public CompressionContext {
+public:
+  explicit ZlibContext(Mode mode, ZlibFormat format, ContextFlags flags, ZlibParams params) :
+      mode(mode), strictCompression(flags) {
+    int result = Z_OK;
+    switch (mode) {
+      case Mode::COMPRESS:
+        KJ_REQUIRE(format != ZlibFormat::AUTO);
+        result = deflateInit2(
+            &ctx,
+            params.level,
+            Z_DEFLATED,
+            getWindowBits(format, params.windowBits),
+            params.memLevel,
+            params.strategy);
+        break;
+      case Mode::DECOMPRESS:
+        result = inflateInit2(&ctx, getWindowBits(format, params.windowBits));
+        break;
+      default:
+        KJ_UNREACHABLE;
+    }
+    JSG_REQUIRE(result == Z_OK, Error, "Failed to initialize compression context.");
+  }
+
+  ~ZlibContext() noexcept(false) {
+    switch (mode) {
+      case Mode::COMPRESS:
+        deflateEnd(&ctx);
+        break;
+      case Mode::DECOMPRESS:
+        inflateEnd(&ctx);
+        break;
+    }
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(ZlibContext);
+
+  void setInput(const void* in, size_t size) override {
+    ctx.next_in = const_cast<kj::byte*>(reinterpret_cast<const kj::byte*>(in));
+    ctx.avail_in = size;
+  }
+
+  Result pumpOnce(Flush flush) override {
+    ctx.next_out = buffer;
+    ctx.avail_out = sizeof(buffer);
+
+    int zflush = Z_NO_FLUSH;
+    switch (flush) {
+      case Flush::NONE: zflush = Z_NO_FLUSH; break;
+      case Flush::SYNC: zflush = Z_SYNC_FLUSH; break;
+      case Flush::FULL: zflush = Z_FULL_FLUSH; break;
+      case Flush::FINISH: zflush = Z_FINISH; break;
+    }
+    int result = Z_OK;
+
+    switch (mode) {
+      case Mode::COMPRESS:
+        result = deflate(&ctx, zflush);
+        JSG_REQUIRE(result == Z_OK || result == Z_BUF_ERROR || result == Z_STREAM_END,
+                     Error,
+                     "Compression failed.");
+        break;
+      case Mode::DECOMPRESS:
+        result = inflate(&ctx, zflush);
+        JSG_REQUIRE(result == Z_OK || result == Z_BUF_ERROR || result == Z_STREAM_END,
+                     Error,
+                     "Decompression failed.");
+
+        if (strictCompression == ContextFlags::STRICT) {
+          // The spec requires that a TypeError is produced if there is trailing data after the end
+          // of the compression stream.
+          JSG_REQUIRE(!(result == Z_STREAM_END && ctx.avail_in > 0), TypeError,
+              "Trailing bytes after end of compressed data");
+          // Same applies to closing a stream before the complete decompressed data is available.
+          JSG_REQUIRE(!(zflush == Z_FINISH && result == Z_BUF_ERROR &&
+              ctx.avail_out == sizeof(buffer)), TypeError,
+              "Called close() on a decompression stream with incomplete data");
+        }
+        break;
+      default:
+        KJ_UNREACHABLE;
+    }
+
+    return Result {
+      .success = result == Z_OK,
+      .buffer = kj::arrayPtr(buffer, sizeof(buffer) - ctx.avail_out),
+    };
+  }
+
+private:
+  static int getWindowBits(ZlibFormat format, int windowBits) {
+    // The windowBits value (15 unless overridden) is combined with the magic value for the
+    // compression format type. For gzip, the magic value is 16, so the value returned is
+    // 15 + 16. For deflate, there is no magic value. For raw deflate (i.e. deflate without a zlib
+    // header) the negative windowBits value is used, so -15. Automatic header detection adds 32.
+    // See the comments for deflateInit2() and inflateInit2() in zlib.h for details.
+    static constexpr auto GZIP = 16;
+    static constexpr auto AUTO = 32;
+    switch (format) {
+      case ZlibFormat::DEFLATE: return windowBits;
+      case ZlibFormat::DEFLATE_RAW: return -windowBits;
+      case ZlibFormat::GZIP: return windowBits + GZIP;
+      case ZlibFormat::AUTO: return windowBits + AUTO;
+    }
+    KJ_UNREACHABLE;
+  }
+
+  Mode mode;
+  z_stream ctx = {};
+  kj::byte buffer[BUFFER_SIZE];
+
+  // For the eponymous compatibility flag
+  ContextFlags strictCompression;
+};
+
+class BrotliContext final: public CompressionContext {
+public:
+  explicit BrotliContext(Mode mode, ContextFlags flags, kj::ArrayPtr<const BrotliParam> params)
+      : mode(mode), strictCompression(flags) {
+    switch (mode) {
+      case Mode::COMPRESS: {
+        encoder = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        JSG_REQUIRE(encoder != nullptr, Error, "Failed to initialize compression context.");
+        for (auto& param: params) {
+          JSG_REQUIRE(BrotliEncoderSetParameter(encoder,
+              static_cast<BrotliEncoderParameter>(param.key), param.value), RangeError,
+              "Invalid brotli parameter ", param.key, " = ", param.value, ".");
+        }
+        break;
+      }
+      case Mode::DECOMPRESS: {
+        decoder = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+        JSG_REQUIRE(decoder != nullptr, Error, "Failed to initialize compression context.");
+        for (auto& param: params) {
+          JSG_REQUIRE(BrotliDecoderSetParameter(decoder,
+              static_cast<BrotliDecoderParameter>(param.key), param.value), RangeError,
+              "Invalid brotli parameter ", param.key, " = ", param.value, ".");
+        }
+        break;
+      }
+    }
+  }
+
+  ~BrotliContext() noexcept(false) {
+    if (encoder != nullptr) BrotliEncoderDestroyInstance(encoder);
+    if (decoder != nullptr) BrotliDecoderDestroyInstance(decoder);
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(BrotliContext);
+
+  void setInput(const void* in, size_t size) override {
+    nextIn = reinterpret_cast<const kj::byte*>(in);
+    availIn = size;
+  }
+
+  Result pumpOnce(Flush flush) override {
+    kj::byte* nextOut = buffer;
+    size_t availOut = sizeof(buffer);
+    bool more = false;
+
+    switch (mode) {
+      case Mode::COMPRESS: {
+        auto op = BROTLI_OPERATION_PROCESS;
+        switch (flush) {
+          case Flush::NONE: op = BROTLI_OPERATION_PROCESS; break;
+          case Flush::SYNC: op = BROTLI_OPERATION_FLUSH; break;
+          case Flush::FULL: op = BROTLI_OPERATION_FLUSH; break;
+          case Flush::FINISH: op = BROTLI_OPERATION_FINISH; break;
+        }
+        JSG_REQUIRE(BrotliEncoderCompressStream(encoder, op, &availIn, &nextIn, &availOut,
+            &nextOut, nullptr), Error, "Compression failed.");
+        more = availIn > 0 || BrotliEncoderHasMoreOutput(encoder) ||
+            (flush == Flush::FINISH && !BrotliEncoderIsFinished(encoder));
+        break;
+      }
+      case Mode::DECOMPRESS: {
+        if (finished) {
+          // Brotli has no notion of concatenated streams, so anything after the final
+          // meta-block is garbage.
+          JSG_REQUIRE(!(strictCompression == ContextFlags::STRICT && availIn > 0), TypeError,
+              "Trailing bytes after end of compressed data");
+          availIn = 0;
+          break;
+        }
+        auto result = BrotliDecoderDecompressStream(decoder, &availIn, &nextIn, &availOut,
+            &nextOut, nullptr);
+        JSG_REQUIRE(result != BROTLI_DECODER_RESULT_ERROR, Error, "Decompression failed.");
+        finished = result == BROTLI_DECODER_RESULT_SUCCESS;
+        more = result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+
+        if (strictCompression == ContextFlags::STRICT) {
+          JSG_REQUIRE(!(finished && availIn > 0), TypeError,
+              "Trailing bytes after end of compressed data");
+          JSG_REQUIRE(!(flush == Flush::FINISH &&
+              result == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT), TypeError,
+              "Called close() on a decompression stream with incomplete data");
+        }
+        break;
+      }
+    }
+
+    return Result {
+      .success = more,
+      .buffer = kj::arrayPtr(buffer, sizeof(buffer) - availOut),
+    };
+  }
+
+private:
+  Mode mode;
+  BrotliEncoderState* encoder = nullptr;
+  BrotliDecoderState* decoder = nullptr;
+  const kj::byte* nextIn = nullptr;
+  size_t availIn = 0;
+  bool finished = false;
+  kj::byte buffer[BUFFER_SIZE];
+
+  ContextFlags strictCompression;
+};
+
+class ZstdContext final: public CompressionContext {
+public:
+  explicit ZstdContext(Mode mode, ContextFlags flags, ZstdParams params)
+      : mode(mode), strictCompression(flags) {
+    switch (mode) {
+      case Mode::COMPRESS: {
+        cctx = ZSTD_createCCtx();
+        JSG_REQUIRE(cctx != nullptr, Error, "Failed to initialize compression context.");
+        KJ_IF_SOME(level, params.level) {
+          ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        }
+        KJ_IF_SOME(windowBits, params.windowBits) {
+          ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, windowBits);
+        } else if (params.level.orDefault(ZSTD_CLEVEL_DEFAULT) > 19) {
+          // The "ultra" levels default to windows our own DecompressionStream would reject.
+          ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG);
+        }
+        break;
+      }
+      case Mode::DECOMPRESS: {
+        dctx = ZSTD_createDCtx();
+        JSG_REQUIRE(dctx != nullptr, Error, "Failed to initialize compression context.");
+        // Bound the memory a hostile stream can make us allocate. This is also the largest window
+        // a CompressionStream will produce.
+        ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG);
+        break;
+      }
+    }
+  }
+
+  ~ZstdContext() noexcept(false) {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+  }
+
+  KJ_DISALLOW_COPY_AND_MOVE(ZstdContext);
+
+  void setInput(const void* in, size_t size) override {
+    input = { .src = in, .size = size, .pos = 0 };
+  }
+
+  Result pumpOnce(Flush flush) override {
+    ZSTD_outBuffer output = { .dst = buffer, .size = sizeof(buffer), .pos = 0 };
+    bool more = false;
+
+    switch (mode) {
+      case Mode::COMPRESS: {
+        // Once the frame has been ended, compressing again would start a new (empty) frame.
+        if (finished) break;
+        auto directive = ZSTD_e_continue;
+        switch (flush) {
+          case Flush::NONE: directive = ZSTD_e_continue; break;
+          case Flush::SYNC: directive = ZSTD_e_flush; break;
+          case Flush::FULL: directive = ZSTD_e_flush; break;
+          case Flush::FINISH: directive = ZSTD_e_end; break;
+        }
+        auto remaining = ZSTD_compressStream2(cctx, &output, &input, directive);
+        JSG_REQUIRE(!ZSTD_isError(remaining), Error, "Compression failed.");
+        if (directive == ZSTD_e_continue) {
+          more = input.pos < input.size || output.pos == output.size;
+        } else {
+          finished = directive == ZSTD_e_end && remaining == 0;
+          more = remaining != 0;
+        }
+        break;
+      }
+      case Mode::DECOMPRESS: {
+        auto consumedBefore = input.pos;
+        auto result = ZSTD_decompressStream(dctx, &output, &input);
+        JSG_REQUIRE(!ZSTD_isError(result), Error, "Decompression failed.");
+        more = input.pos < input.size || output.pos == output.size;
+
+        // A zero result means a frame has been fully decoded and flushed. Calls that make no
+        // progress only return a size hint, so they don't tell us anything.
+        if (input.pos != consumedBefore || output.pos > 0) {
+          finished = result == 0;
+        }
+
+        // Concatenated frames are a valid zstd stream, so there is no notion of trailing data
+        // here; garbage after a frame fails to decode as the next one.
+        if (strictCompression == ContextFlags::STRICT) {
+          JSG_REQUIRE(!(flush == Flush::FINISH && !more && !finished), TypeError,
+              "Called close() on a decompression stream with incomplete data");
+        }
+        break;
+      }
+    }
+
+    return Result {
+      .success = more,
+      .buffer = kj::arrayPtr(buffer, output.pos),
+    };
+  }
+
+private:
+  Mode mode;
+  ZSTD_CCtx* cctx = nullptr;
+  ZSTD_DCtx* dctx = nullptr;
+  ZSTD_inBuffer input = {};
+  // When compressing, whether the frame has been ended. When decompressing, whether the input so
+  // far ends on a frame boundary.
+  bool finished = false;
+  kj::byte buffer[BUFFER_SIZE];
+
+  ContextFlags strictCompression;
+};
+
+}  // namespace
+
+kj::Own<CompressionContext> newZlibContext(CompressionContext::Mode mode, ZlibFormat format,
+    CompressionContext::ContextFlags flags, ZlibParams params) {
+  return kj::heap<ZlibContext>(mode, format, flags, params);
+}
+
+kj::Own<CompressionContext> newBrotliContext(CompressionContext::Mode mode,
+    CompressionContext::ContextFlags flags, kj::ArrayPtr<const BrotliParam> params) {
+  return kj::heap<BrotliContext>(mode, flags, params);
+}
+
+kj::Own<CompressionContext> newZstdContext(CompressionContext::Mode mode,
+    CompressionContext::ContextFlags flags, ZstdParams params) {
+  return kj::heap<ZstdContext>(mode, flags, kj::mv(params));
+}
+
+}  // namespace workerd::api
@@ -0,0 +1,94 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// The zlib, brotli and zstd codecs behind CompressionStream / DecompressionStream, shared with
+// node:zlib.
+
+#include <kj/common.h>
+#include <kj/memory.h>
+
+namespace workerd::api {
+
+// Each implementation works on a single fixed output buffer. Callers set the input and then call
+// pumpOnce() until it reports that there is nothing more to produce.
+class CompressionContext {
+public:
+  enum class Mode {
+    COMPRESS,
+    DECOMPRESS,
+  };
+
+  enum class ContextFlags {
+    NONE,
+    // Report truncated input and trailing data as errors. Without this they are silently ignored.
+    STRICT,
+  };
+
+  enum class Flush {
+    // More input may follow.
+    NONE,
+    // Emit everything buffered so far, so that the output can be decoded up to this point.
+    SYNC,
+    // Like SYNC, but also reset the compression state (zlib Z_FULL_FLUSH). Same as SYNC for the
+    // other codecs.
+    FULL,
+    // The input set last is the end of the stream.
+    FINISH,
+  };
+
+  struct Result {
+    bool success = false;
+    kj::ArrayPtr<const kj::byte> buffer;
+  };
+
+  virtual ~CompressionContext() noexcept(false) = default;
+
+  virtual void setInput(const void* in, size_t size) = 0;
+
+  // Runs the codec once. `buffer` is the output produced by this call and is only valid until the
+  // next call. `success` is true if calling again may produce more output without more input.
+  virtual Result pumpOnce(Flush flush) = 0;
+
+protected:
+  static constexpr size_t BUFFER_SIZE = 4096;
+};
+
+enum class ZlibFormat {
+  DEFLATE,
+  DEFLATE_RAW,
+  GZIP,
+  // Decompression only: accept either a zlib or a gzip header.
+  AUTO,
+};
+
+struct ZlibParams {
+  int level = -1;  // Z_DEFAULT_COMPRESSION
+  int windowBits = 15;
+  int memLevel = 8;
+  int strategy = 0;  // Z_DEFAULT_STRATEGY
+};
+
+kj::Own<CompressionContext> newZlibContext(CompressionContext::Mode mode, ZlibFormat format,
+    CompressionContext::ContextFlags flags, ZlibParams params = {});
+
+// A BrotliEncoderParameter or BrotliDecoderParameter, depending on the mode, and its value.
+struct BrotliParam {
+  uint32_t key;
+  uint32_t value;
+};
+
+// Parameters the library rejects produce a RangeError.
+kj::Own<CompressionContext> newBrotliContext(CompressionContext::Mode mode,
+    CompressionContext::ContextFlags flags, kj::ArrayPtr<const BrotliParam> params = nullptr);
+
+struct ZstdParams {
+  kj::Maybe<int> level;
+  kj::Maybe<int> windowBits;
+};
+
+kj::Own<CompressionContext> newZstdContext(CompressionContext::Mode mode,
+    CompressionContext::ContextFlags flags, ZstdParams params = {});
+
+}  // namespace workerd::api
@@ -3,8 +3,12 @@
 //     https://opensource.org/licenses/Apache-2.0
 
 #include "compression.h"
+#include "compression-context.h"
 #include <workerd/io/features.h>
+#include <workerd/util/zstd.h>
+#include <brotli/encode.h>
 #include <zlib.h>
+#include <zstd.h>
 #include <deque>
 #include <vector>
 #include <iterator>
@@ -13,127 +17,79 @@ namespace workerd::api {
 
 namespace {
 
-class Context {
-public:
-  enum class Mode {
-    COMPRESS,
-    DECOMPRESS,
-  };
-
-  enum class ContextFlags {
-    NONE,
-    STRICT,
-  };
-
-  struct Result {
-    bool success = false;
-    kj::ArrayPtr<const byte> buffer;
-  };
+using Context = CompressionContext;
 
-  explicit Context(Mode mode, kj::StringPtr format, ContextFlags flags) :
-      mode(mode), strictCompression(flags) {
-    int result = Z_OK;
-    switch (mode) {
-      case Mode::COMPRESS:
-        result = deflateInit2(
-            &ctx,
-            Z_DEFAULT_COMPRESSION,
-            Z_DEFLATED,
-            getWindowBits(format),
-            8,  // memLevel = 8 is the default
-            Z_DEFAULT_STRATEGY);
-        break;
-      case Mode::DECOMPRESS:
-        result = inflateInit2(&ctx, getWindowBits(format));
-        break;
-      default:
-        KJ_UNREACHABLE;
-    }
-    JSG_REQUIRE(result == Z_OK, Error, "Failed to initialize compression context.");
-  }
+// Quality 11, brotli's own default, is tuned for compressing static assets ahead of time and is
+// far too slow for streaming. 4 compresses better than gzip's default at comparable speed.
+constexpr int DEFAULT_BROTLI_QUALITY = 4;
 
-  ~Context() noexcept(false) {
-    switch (mode) {
-      case Mode::COMPRESS:
-        deflateEnd(&ctx);
-        break;
-      case Mode::DECOMPRESS:
-        inflateEnd(&ctx);
-        break;
+kj::Own<Context> newContext(Context::Mode mode, kj::StringPtr format, Context::ContextFlags flags,
+                            CompressionStream::Options options = {}) {
+  if (format == "br") {
+    if (mode == Context::Mode::DECOMPRESS) {
+      return newBrotliContext(mode, flags);
     }
+    BrotliParam params[] = {
+      { BROTLI_PARAM_QUALITY, uint32_t(options.level.orDefault(DEFAULT_BROTLI_QUALITY)) },
+      { BROTLI_PARAM_LGWIN, uint32_t(options.windowBits.orDefault(BROTLI_DEFAULT_WINDOW)) },
+    };
+    return newBrotliContext(mode, flags, params);
+  } else if (format == "zstd") {
+    return newZstdContext(mode, flags, {
+      .level = options.level,
+      .windowBits = options.windowBits,
+    });
+  } else {
+    ZlibFormat zlibFormat = ZlibFormat::DEFLATE;
+    if (format == "gzip") zlibFormat = ZlibFormat::GZIP;
+    else if (format == "deflate-raw") zlibFormat = ZlibFormat::DEFLATE_RAW;
+    ZlibParams params;
+    KJ_IF_SOME(level, options.level) params.level = level;
+    KJ_IF_SOME(windowBits, options.windowBits) params.windowBits = windowBits;
+    return newZlibContext(mode, zlibFormat, flags, params);
   }
+}
 
-  KJ_DISALLOW_COPY_AND_MOVE(Context);
+bool isValidFormat(kj::StringPtr format) {
+  return format == "deflate" || format == "gzip" || format == "deflate-raw" ||
+      format == "br" || format == "zstd";
+}
 
-  void setInput(const void* in, size_t size) {
-    ctx.next_in = const_cast<byte*>(reinterpret_cast<const byte*>(in));
-    ctx.avail_in = size;
+// Checks the options against the ranges the format supports, so that the codecs never see a
+// value they would reject (or, worse, silently clamp).
+void validateOptions(kj::StringPtr format, const CompressionStream::Options& options) {
+  int minLevel, maxLevel, minWindowBits, maxWindowBits;
+  if (format == "br") {
+    minLevel = BROTLI_MIN_QUALITY;
+    maxLevel = BROTLI_MAX_QUALITY;
+    minWindowBits = BROTLI_MIN_WINDOW_BITS;
+    maxWindowBits = BROTLI_MAX_WINDOW_BITS;
+  } else if (format == "zstd") {
+    auto levelBounds = ZSTD_cParam_getBounds(ZSTD_c_compressionLevel);
+    auto windowBounds = ZSTD_cParam_getBounds(ZSTD_c_windowLog);
+    minLevel = levelBounds.lowerBound;
+    maxLevel = levelBounds.upperBound;
+    minWindowBits = windowBounds.lowerBound;
+    // Larger windows are valid zstd, but a DecompressionStream would refuse them.
+    maxWindowBits = ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG;
+  } else {
+    minLevel = Z_DEFAULT_COMPRESSION;
+    maxLevel = Z_BEST_COMPRESSION;
+    minWindowBits = 9;
+    maxWindowBits = MAX_WBITS;
   }
 
-  Result pumpOnce(int flush) {
-    ctx.next_out = buffer;
-    ctx.avail_out = sizeof(buffer);
-
-    int result = Z_OK;
-
-    switch (mode) {
-      case Mode::COMPRESS:
-        result = deflate(&ctx, flush);
-        JSG_REQUIRE(result == Z_OK || result == Z_BUF_ERROR || result == Z_STREAM_END,
-                     Error,
-                     "Compression failed.");
-        break;
-      case Mode::DECOMPRESS:
-        result = inflate(&ctx, flush);
-        JSG_REQUIRE(result == Z_OK || result == Z_BUF_ERROR || result == Z_STREAM_END,
-                     Error,
-                     "Decompression failed.");
-
-        if (strictCompression == ContextFlags::STRICT) {
-          // The spec requires that a TypeError is produced if there is trailing data after the end
-          // of the compression stream.
-          JSG_REQUIRE(!(result == Z_STREAM_END && ctx.avail_in > 0), TypeError,
-              "Trailing bytes after end of compressed data");
-          // Same applies to closing a stream before the complete decompressed data is available.
-          JSG_REQUIRE(!(flush == Z_FINISH && result == Z_BUF_ERROR &&
-              ctx.avail_out == sizeof(buffer)), TypeError,
-              "Called close() on a decompression stream with incomplete data");
-        }
-        break;
-      default:
-        KJ_UNREACHABLE;
-    }
-
-    return Result {
-      .success = result == Z_OK,
-      .buffer = kj::arrayPtr(buffer, sizeof(buffer) - ctx.avail_out),
-    };
+  KJ_IF_SOME(level, options.level) {
+    JSG_REQUIRE(level >= minLevel && level <= maxLevel, RangeError,
+        "The compression level for '", format, "' must be between ", minLevel, " and ", maxLevel,
+        ".");
   }
-
-private:
-  static int getWindowBits(kj::StringPtr format) {
-    // We use a windowBits value of 15 combined with the magic value
-    // for the compression format type. For gzip, the magic value is
-    // 16, so the value returned is 15 + 16. For deflate, the magic
-    // value is 15. For raw deflate (i.e. deflate without a zlib header)
-    // the negative windowBits value is used, so -15. See the comments for
-    // deflateInit2() in zlib.h for details.
-    static constexpr auto GZIP = 16;
-    static constexpr auto DEFLATE = 15;
-    static constexpr auto DEFLATE_RAW = -15;
-    if (format == "gzip") return DEFLATE + GZIP;
-    else if (format == "deflate") return DEFLATE;
-    else if (format == "deflate-raw") return DEFLATE_RAW;
-    KJ_UNREACHABLE;
+  KJ_IF_SOME(windowBits, options.windowBits) {
+    JSG_REQUIRE(windowBits >= minWindowBits && windowBits <= maxWindowBits, RangeError,
+        "The windowBits for '", format, "' must be between ", minWindowBits, " and ",
+        maxWindowBits, ".");
   }
-
-  Mode mode;
-  z_stream ctx = {};
-  kj::byte buffer[4096];
-
-  // For the eponymous compatibility flag
-  ContextFlags strictCompression;
-};
+}
 
 // Uncompressed data goes in. Compressed data comes out.
 template <Context::Mode mode>
@@ -141,8 +97,8 @@ class CompressionStreamImpl: public kj::Refcounted,
                              public ReadableStreamSource,
                              public WritableStreamSink {
 public:
-  explicit CompressionStreamImpl(kj::String format, Context::ContextFlags flags)
-      : context(mode, format, flags) {}
+  explicit CompressionStreamImpl(kj::Own<Context> context)
+      : context(kj::mv(context)) {}
 
   // WritableStreamSink implementation ---------------------------------------------------
 
@@ -155,8 +111,8 @@ public:
         return kj::cp(exception);
       }
       KJ_CASE_ONEOF(open, Open) {
-        context.setInput(buffer.begin(), buffer.size());
-        return writeInternal(Z_NO_FLUSH);
+        context->setInput(buffer.begin(), buffer.size());
+        return writeInternal(Context::Flush::NONE);
       }
     }
     KJ_UNREACHABLE;
@@ -185,7 +141,7 @@ public:
 
   kj::Promise<void> end() override {
     state = Ended();
-    return writeInternal(Z_FINISH);
+    return writeInternal(Context::Flush::FINISH);
   }
 
   void abort(kj::Exception reason) override {
@@ -280,13 +236,13 @@ private:
     return canceler.wrap(kj::mv(promise.promise));
   }
 
-  kj::Promise<void> writeInternal(int flush) {
+  kj::Promise<void> writeInternal(Context::Flush flush) {
     // TODO(later): This does not yet implement any backpressure. A caller can keep calling
     // write without reading, which will continue to fill the internal buffer.
-    KJ_ASSERT(flush == Z_FINISH || state.template is<Open>());
+    KJ_ASSERT(flush == Context::Flush::FINISH || state.template is<Open>());
     Context::Result result;
     KJ_IF_SOME(exception, kj::runCatchingExceptions([this, flush, &result]() {
-      result = context.pumpOnce(flush);
+      result = context->pumpOnce(flush);
     })) {
       cancelInternal(kj::cp(exception));
       return kj::mv(exception);
@@ -379,7 +335,7 @@ private:
   struct Open {};
 
   kj::OneOf<Open, Ended, kj::Exception> state = Open();
-  Context context;
+  kj::Own<Context> context;
 
   kj::Canceler canceler;
   std::vector<kj::byte> output;
@@ -387,13 +343,19 @@ private:
 };
 }  // namespace
 
-jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::String format) {
-  JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-               "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
+jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::String format,
+                                                          jsg::Optional<Options> maybeOptions) {
+  JSG_REQUIRE(isValidFormat(format), TypeError,
+               "The compression format must be either 'deflate', 'deflate-raw', 'gzip', 'br' or "
+               "'zstd'.");
+
+  auto options = kj::mv(maybeOptions).orDefault(Options {});
+  validateOptions(format, options);
 
   auto readableSide =
-      kj::refcounted<CompressionStreamImpl<Context::Mode::COMPRESS>>(kj::mv(format),
-                                                                     Context::ContextFlags::NONE);
+      kj::refcounted<CompressionStreamImpl<Context::Mode::COMPRESS>>(
+          newContext(Context::Mode::COMPRESS, format, Context::ContextFlags::NONE,
+                     kj::mv(options)));
   auto writableSide = kj::addRef(*readableSide);
 
   auto& ioContext = IoContext::current();
@@ -404,15 +366,16 @@ jsg::Ref<CompressionStream> CompressionStream::constructor(jsg::Lock& js, kj::St
 }
 
 jsg::Ref<DecompressionStream> DecompressionStream::constructor(jsg::Lock& js, kj::String format) {
-  JSG_REQUIRE(format == "deflate" || format == "gzip" || format == "deflate-raw", TypeError,
-               "The compression format must be either 'deflate', 'deflate-raw' or 'gzip'.");
+  JSG_REQUIRE(isValidFormat(format), TypeError,
+               "The compression format must be either 'deflate', 'deflate-raw', 'gzip', 'br' or "
+               "'zstd'.");
 
   auto readableSide =
       kj::refcounted<CompressionStreamImpl<Context::Mode::DECOMPRESS>>(
-          kj::mv(format),
-          FeatureFlags::get(js).getStrictCompression() ?
-              Context::ContextFlags::STRICT :
-              Context::ContextFlags::NONE);
+          newContext(Context::Mode::DECOMPRESS, format,
+              FeatureFlags::get(js).getStrictCompression() ?
+                  Context::ContextFlags::STRICT :
+                  Context::ContextFlags::NONE));
   auto writableSide = kj::addRef(*readableSide);
 
   auto& ioContext = IoContext::current();
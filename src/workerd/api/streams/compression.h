@@ -13,13 +13,25 @@ class CompressionStream: public TransformStream {
 public:
   using TransformStream::TransformStream;
 
-  static jsg::Ref<CompressionStream> constructor(jsg::Lock& js, kj::String format);
+  // Non-standard tuning knobs. The valid ranges depend on the format, see compression.c++.
+  struct Options {
+    // Compression level (the brotli "quality" for "br").
+    jsg::Optional<int> level;
+    // Base-2 logarithm of the window size.
+    jsg::Optional<int> windowBits;
+
+    JSG_STRUCT(level, windowBits);
+  };
+
+  static jsg::Ref<CompressionStream> constructor(jsg::Lock& js, kj::String format,
+                                                 jsg::Optional<Options> options);
 
   JSG_RESOURCE_TYPE(CompressionStream) {
     JSG_INHERIT(TransformStream);
 
     JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array> {
-      constructor(format: "gzip" | "deflate" | "deflate-raw");
+      constructor(format: "gzip" | "deflate" | "deflate-raw" | "br" | "zstd",
+                  options?: CompressionStreamOptions);
     });
   }
 };
@@ -34,7 +46,7 @@ public:
     JSG_INHERIT(TransformStream);
 
     JSG_TS_OVERRIDE(extends TransformStream<ArrayBuffer | ArrayBufferView, Uint8Array> {
-      constructor(format: "gzip" | "deflate" | "deflate-raw");
+      constructor(format: "gzip" | "deflate" | "deflate-raw" | "br" | "zstd");
     });
   }
 };
@@ -4,6 +4,7 @@
 
 #include "internal.h"
 #include "readable.h"
+#include "transform.h"
 #include "writable.h"
 #include <workerd/jsg/jsg.h>
 #include <workerd/jsg/jsg-test.h>
@@ -186,6 +187,97 @@ KJ_TEST("honest small stream") {
   KJ_ASSERT(stream.maxMaxBytesSeen(), 100);
 }
 
+// Records what is written to it, as it was written.
+class RecordingSink final: public WritableStreamSink {
+public:
+  kj::Vector<kj::byte> data;
+  uint writeCount = 0;
+  bool ended = false;
+
+  kj::Promise<void> write(kj::ArrayPtr<const byte> buffer) override {
+    data.addAll(buffer);
+    ++writeCount;
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const byte>> pieces) override {
+    for (auto piece: pieces) data.addAll(piece);
+    ++writeCount;
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> end() override {
+    ended = true;
+    return kj::READY_NOW;
+  }
+  void abort(kj::Exception reason) override {}
+};
+
+KJ_TEST("IdentityTransformStream pump forwards writes whole") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto pipe = newIdentityPipe();
+  RecordingSink sink;
+
+  // A write made before the pump starts is picked up by it.
+  auto first = pipe.out->write("foo"_kj.asBytes());
+  auto pump = pipe.in->pumpTo(sink, true);
+  first.wait(waitScope);
+
+  // Writes aren't broken up into reads, however big they are.
+  auto big = kj::heapArray<kj::byte>(100000);
+  memset(big.begin(), 'x', big.size());
+  pipe.out->write(big).wait(waitScope);
+  pipe.out->write("bar"_kj.asBytes()).wait(waitScope);
+  KJ_EXPECT(sink.writeCount == 3);
+  KJ_EXPECT(sink.data.size() == 100006);
+  KJ_EXPECT(!sink.ended);
+
+  // The output is ended after the pump hands over to deferred proxying.
+  pipe.out->end().wait(waitScope);
+  auto proxy = pump.wait(waitScope);
+  proxy.proxyTask.wait(waitScope);
+  KJ_EXPECT(sink.ended);
+}
+
+KJ_TEST("IdentityTransformStream pump enforces FixedLengthStream lengths") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  {
+    auto pipe = newIdentityPipe(uint64_t(5));
+    RecordingSink sink;
+    auto pump = pipe.in->pumpTo(sink, true);
+    pipe.out->write("abc"_kj.asBytes()).wait(waitScope);
+    KJ_EXPECT_THROW_MESSAGE("too many bytes", pipe.out->write("def"_kj.asBytes()).wait(waitScope));
+    KJ_EXPECT_THROW_MESSAGE("too many bytes", pump.wait(waitScope));
+    KJ_EXPECT(sink.data.size() == 3);
+  }
+
+  {
+    auto pipe = newIdentityPipe(uint64_t(5));
+    RecordingSink sink;
+    auto pump = pipe.in->pumpTo(sink, true);
+    pipe.out->write("abc"_kj.asBytes()).wait(waitScope);
+    pipe.out->end().wait(waitScope);
+    KJ_EXPECT_THROW_MESSAGE("did not see all expected bytes", pump.wait(waitScope));
+    KJ_EXPECT(!sink.ended);
+  }
+}
+
+KJ_TEST("IdentityTransformStream pump cancellation fails writes") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto pipe = newIdentityPipe();
+  RecordingSink sink;
+  {
+    auto pump = pipe.in->pumpTo(sink, true);
+    pipe.out->write("abc"_kj.asBytes()).wait(waitScope);
+  }
+  KJ_EXPECT_THROW_MESSAGE("reader canceled", pipe.out->write("def"_kj.asBytes()).wait(waitScope));
+  KJ_EXPECT(sink.data.size() == 3);
+}
+
 KJ_TEST("WritableStreamInternalController queue size assertion") {
 
   capnp::MallocMessageBuilder message;
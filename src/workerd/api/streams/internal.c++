@@ -775,7 +775,7 @@ ReadableStreamController::Tee ReadableStreamInternalController::tee(jsg::Lock& j
         return makeTee(kj::mv(tee.branches[0]), kj::mv(tee.branches[1]));
       }
 
-      auto tee = kj::newTee(kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
+      auto tee = newSpillableTee(kj::heap<TeeAdapter>(kj::mv(readable)), bufferLimit);
 
       return makeTee(
           kj::heap<TeeBranch>(newTeeErrorAdapter(kj::mv(tee.branches[0]))),
@@ -2232,20 +2232,12 @@ kj::Promise<size_t> IdentityTransformStreamImpl::tryRead(
 kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, size_t maxBytes) {
   auto promise = readHelper(kj::arrayPtr(static_cast<kj::byte*>(buffer), maxBytes));
 
-  KJ_IF_SOME(l, limit) {
-    promise = promise.then([this, &l = l](size_t amount) -> kj::Promise<size_t> {
-      if (amount > l) {
-        auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
-            "Attempt to write too many bytes through a FixedLengthStream.");
-        cancel(exception);
-        return kj::mv(exception);
-      } else if (amount == 0 && l != 0) {
-        auto exception = JSG_KJ_EXCEPTION(FAILED, TypeError,
-            "FixedLengthStream did not see all expected bytes before close().");
-        cancel(exception);
+  if (limit != kj::none) {
+    promise = promise.then([this](size_t amount) -> kj::Promise<size_t> {
+      KJ_IF_SOME(exception, checkLimit(amount)) {
+        cancel(kj::cp(exception));
         return kj::mv(exception);
       }
-      l -= amount;
       return amount;
     });
   }
@@ -2253,6 +2245,20 @@ kj::Promise<size_t> IdentityTransformStreamImpl::tryReadInternal(void* buffer, s
   return promise;
 }
 
+kj::Maybe<kj::Exception> IdentityTransformStreamImpl::checkLimit(size_t amount) {
+  KJ_IF_SOME(l, limit) {
+    if (amount > l) {
+      return JSG_KJ_EXCEPTION(FAILED, TypeError,
+          "Attempt to write too many bytes through a FixedLengthStream.");
+    } else if (amount == 0 && l != 0) {
+      return JSG_KJ_EXCEPTION(FAILED, TypeError,
+          "FixedLengthStream did not see all expected bytes before close().");
+    }
+    l -= amount;
+  }
+  return kj::none;
+}
+
 kj::Promise<DeferredProxy<void>> IdentityTransformStreamImpl::pumpTo(
     WritableStreamSink& output,
     bool end) {
@@ -2266,7 +2272,77 @@ kj::Promise<DeferredProxy<void>> IdentityTransformStreamImpl::pumpTo(
   JSG_REQUIRE(kj::dynamicDowncastIfAvailable<IdentityTransformStreamImpl>(output) == kj::none,
       TypeError, "Inter-TransformStream ReadableStream.pipeTo() is not implemented.");
 
-  return ReadableStreamSource::pumpTo(output, end);
+  auto paf = kj::newPromiseAndFulfiller<void>();
+  kj::Maybe<WriteRequest> pendingWrite;
+  KJ_SWITCH_ONEOF(state) {
+    KJ_CASE_ONEOF(idle, Idle) {}
+    KJ_CASE_ONEOF(request, ReadRequest) {
+      KJ_FAIL_ASSERT("read operation already in flight");
+    }
+    KJ_CASE_ONEOF(request, WriteRequest) {
+      pendingWrite = kj::mv(request);
+    }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      KJ_FAIL_ASSERT("pump operation already in flight");
+    }
+    KJ_CASE_ONEOF(exception, kj::Exception) {
+      kj::throwFatalException(kj::cp(exception));
+    }
+    KJ_CASE_ONEOF(closed, StreamStates::Closed) {
+      paf.fulfiller->fulfill();
+    }
+  }
+  if (!state.is<StreamStates::Closed>()) {
+    state = PumpRequest { output, kj::mv(paf.fulfiller) };
+  }
+
+  {
+    // If the pump is canceled while the writable side is still open, writes can't go anywhere
+    // anymore, so they fail the same way as when a read is canceled.
+    KJ_DEFER({
+      if (state.is<PumpRequest>()) {
+        cancel(KJ_EXCEPTION(DISCONNECTED, "reader canceled"));
+      }
+    });
+
+    KJ_IF_SOME(request, pendingWrite) {
+      // A write was already waiting for a reader. If it fails, so does the pump, below.
+      try {
+        co_await forward(output, request.bytes);
+        request.fulfiller->fulfill();
+      } catch (...) {
+        request.fulfiller->reject(kj::getCaughtExceptionAsKj());
+      }
+    }
+
+    // From here on, writeHelper() forwards writes as they come, until the writable side closes.
+    co_await paf.promise;
+  }
+
+  // Writes come from the application, so the pump needs the IoContext until the writable side
+  // closes. Only ending the output can happen after the IoContext is gone.
+  KJ_CO_MAGIC BEGIN_DEFERRED_PROXYING;
+
+  if (end) {
+    co_await output.end();
+  }
+}
+
+kj::Promise<void> IdentityTransformStreamImpl::forward(
+    WritableStreamSink& output, kj::ArrayPtr<const kj::byte> bytes) {
+  KJ_IF_SOME(exception, checkLimit(bytes.size())) {
+    cancel(kj::cp(exception));
+    return kj::mv(exception);
+  }
+
+  return pumpCanceler.wrap(output.write(bytes).catch_([this](kj::Exception&& exception) {
+    // The output failed, so the pump does too. Subsequent writes will see the same error.
+    KJ_IF_SOME(request, state.tryGet<PumpRequest>()) {
+      request.fulfiller->reject(kj::cp(exception));
+      state = kj::cp(exception);
+    }
+    return kj::mv(exception);
+  }));
 }
 
 kj::Maybe<uint64_t> IdentityTransformStreamImpl::tryGetLength(StreamEncoding encoding) {
@@ -2288,6 +2364,10 @@ void IdentityTransformStreamImpl::cancel(kj::Exception reason) {
     KJ_CASE_ONEOF(request, WriteRequest) {
       request.fulfiller->reject(kj::cp(reason));
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      request.fulfiller->reject(kj::cp(reason));
+      pumpCanceler.cancel(reason);
+    }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       // Already errored.
       return;
@@ -2335,6 +2415,9 @@ void IdentityTransformStreamImpl::abort(kj::Exception reason) {
     KJ_CASE_ONEOF(request, WriteRequest) {
       KJ_FAIL_ASSERT("abort() is supposed to wait for any pending write() to finish");
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      request.fulfiller->reject(kj::cp(reason));
+    }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       // Already errored.
       return;
@@ -2361,6 +2444,9 @@ kj::Promise<size_t> IdentityTransformStreamImpl::readHelper(kj::ArrayPtr<kj::byt
     KJ_CASE_ONEOF(request, ReadRequest) {
       KJ_FAIL_ASSERT("read operation already in flight");
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      KJ_FAIL_ASSERT("pump operation already in flight");
+    }
     KJ_CASE_ONEOF(request, WriteRequest) {
       if (bytes.size() >= request.bytes.size()) {
         // The write buffer will entirely fit into our read buffer; fulfill both requests.
@@ -2447,6 +2533,21 @@ kj::Promise<void> IdentityTransformStreamImpl::writeHelper(kj::ArrayPtr<const kj
     KJ_CASE_ONEOF(request, WriteRequest) {
       KJ_FAIL_ASSERT("write operation already in flight");
     }
+    KJ_CASE_ONEOF(request, PumpRequest) {
+      if (bytes.size() == 0) {
+        // This is a close operation. The pump ends the output, unless the stream came up short.
+        KJ_IF_SOME(exception, checkLimit(0)) {
+          request.fulfiller->reject(kj::cp(exception));
+          state = kj::mv(exception);
+        } else {
+          request.fulfiller->fulfill();
+          state = StreamStates::Closed();
+        }
+        return kj::READY_NOW;
+      }
+
+      return forward(request.output, bytes);
+    }
     KJ_CASE_ONEOF(exception, kj::Exception) {
       return kj::cp(exception);
     }
@@ -364,13 +364,14 @@ private:
 // An implementation of ReadableStreamSource and WritableStreamSink which communicates read and
 // write requests via a OneOf.
 //
+// Like kj::OneWayPipe, once the readable side is pumped somewhere, writes go straight to the
+// pump's output rather than being copied into read buffers one read at a time.
+//
 // This class is also used as the implementation of FixedLengthStream, in which case `limit` is
 // non-nullptr.
 class IdentityTransformStreamImpl: public kj::Refcounted,
                                    public ReadableStreamSource,
                                    public WritableStreamSink {
-  // TODO(soon): Reimplement this in terms of kj::OneWayPipe, so we can optimize pumpTo().
-
 public:
   explicit IdentityTransformStreamImpl(kj::Maybe<uint64_t> limit = kj::none)
       : limit(limit) {}
@@ -412,8 +413,18 @@ private:
 
   kj::Promise<void> writeHelper(kj::ArrayPtr<const kj::byte> bytes);
 
+  // Counts `amount` bytes against `limit`, or if `amount` is zero (meaning the writable side
+  // closed), checks that the limit was reached. Returns the error to report, if any.
+  kj::Maybe<kj::Exception> checkLimit(size_t amount);
+
+  // Writes `bytes` to the output of a pump in progress.
+  kj::Promise<void> forward(WritableStreamSink& output, kj::ArrayPtr<const kj::byte> bytes);
+
   kj::Maybe<uint64_t> limit;
 
+  // Cancels writes in flight to a pump's output, if the pump goes away before they finish.
+  kj::Canceler pumpCanceler;
+
   struct ReadRequest {
     kj::ArrayPtr<kj::byte> bytes;
     // WARNING: `bytes` may be invalid if fulfiller->isWaiting() returns false! (This indicates the
@@ -427,9 +438,17 @@ private:
     kj::Own<kj::PromiseFulfiller<void>> fulfiller;
   };
 
+  struct PumpRequest {
+    WritableStreamSink& output;
+
+    // Fulfilled when the writable side closes.
+    kj::Own<kj::PromiseFulfiller<void>> fulfiller;
+  };
+
   struct Idle {};
 
-  kj::OneOf<Idle, ReadRequest, WriteRequest, kj::Exception, StreamStates::Closed> state = Idle();
+  kj::OneOf<Idle, ReadRequest, WriteRequest, PumpRequest, kj::Exception, StreamStates::Closed>
+      state = Idle();
 };
 
 }  // namespace workerd::api
@@ -7,6 +7,7 @@
 #include <kj/one-of.h>
 #include <kj/compat/gzip.h>
 #include <kj/compat/brotli.h>
+#include <workerd/util/zstd.h>
 
 namespace workerd::api {
 
@@ -39,8 +40,8 @@ public:
   // data.
   //
   // This implementation of `tryTee()` is not technically required for correctness, but prevents
-  // re-encoding (and converting Content-Length responses to chunk-encoded responses) gzip and
-  // brotli streams.
+  // re-encoding (and converting Content-Length responses to chunk-encoded responses) gzip,
+  // brotli and zstd streams.
   kj::Maybe<Tee> tryTee(uint64_t limit) override;
 
 private:
@@ -85,6 +86,14 @@ kj::Promise<size_t> EncodedAsyncInputStream::tryRead(
         "Brotli compression failed." },
       { "brotli compressed stream ended prematurely"_kj,
         "Brotli compressed stream ended prematurely." },
+      { "zstd state allocation failed"_kj,
+        "Zstd state allocation failed." },
+      { "zstd decompression failed"_kj,
+        "Zstd decompression failed." },
+      { "zstd compression failed"_kj,
+        "Zstd compression failed." },
+      { "zstd compressed stream ended prematurely"_kj,
+        "Zstd compressed stream ended prematurely." },
     })) {
       return kj::mv(e);
     }
@@ -110,7 +119,7 @@ kj::Maybe<ReadableStreamSource::Tee> EncodedAsyncInputStream::tryTee(uint64_t li
   // Additionally, we should propagate the fact that this stream is a native stream to the branches
   // of the tee, so that branches which fall behind their siblings (and thus are reading from the
   // tee buffer) still register pending events correctly.
-  auto tee = kj::newTee(kj::mv(inner), limit);
+  auto tee = newSpillableTee(kj::mv(inner), limit);
 
   Tee result;
   result.branches[0] = newSystemStream(newTeeErrorAdapter(kj::mv(tee.branches[0])), encoding);
@@ -126,8 +135,11 @@ void EncodedAsyncInputStream::ensureIdentityEncoding() {
   } else if (encoding == StreamEncoding::BROTLI) {
     inner = kj::heap<kj::BrotliAsyncInputStream>(*inner).attach(kj::mv(inner));
     encoding = StreamEncoding::IDENTITY;
+  } else if (encoding == StreamEncoding::ZSTD) {
+    inner = kj::heap<ZstdAsyncInputStream>(*inner).attach(kj::mv(inner));
+    encoding = StreamEncoding::IDENTITY;
   } else {
-    // We currently support gzip and brotli as non-identity content encodings.
+    // We currently support gzip, brotli and zstd as non-identity content encodings.
     KJ_ASSERT(encoding == StreamEncoding::IDENTITY);
   }
 }
@@ -177,7 +189,7 @@ private:
   // correctness rather than for optimization. I "know" this code will never be compiled w/o RTTI,
   // but I'm paranoid.
   kj::OneOf<kj::Own<kj::AsyncOutputStream>, kj::Own<kj::GzipAsyncOutputStream>,
-            kj::Own<kj::BrotliAsyncOutputStream>, Ended> inner;
+            kj::Own<kj::BrotliAsyncOutputStream>, kj::Own<ZstdAsyncOutputStream>, Ended> inner;
 
   StreamEncoding encoding;
 
@@ -251,6 +263,9 @@ kj::Maybe<kj::Promise<DeferredProxy<void>>> EncodedAsyncOutputStream::tryPumpFro
         KJ_CASE_ONEOF(br, kj::Own<kj::BrotliAsyncOutputStream>) {
           promise = promise.then([&br = br]() { return br->end(); });
         }
+        KJ_CASE_ONEOF(zstd, kj::Own<ZstdAsyncOutputStream>) {
+          promise = promise.then([&zstd = zstd]() { return zstd->end(); });
+        }
         KJ_CASE_ONEOF(e, Ended) {}
       }
     }
@@ -291,6 +306,9 @@ kj::Promise<void> EncodedAsyncOutputStream::end() {
     KJ_CASE_ONEOF(br, kj::Own<kj::BrotliAsyncOutputStream>) {
       promise = br->end().attach(kj::mv(br));
     }
+    KJ_CASE_ONEOF(zstd, kj::Own<ZstdAsyncOutputStream>) {
+      promise = zstd->end().attach(kj::mv(zstd));
+    }
     KJ_CASE_ONEOF(e, Ended) {}
   }
 
@@ -317,8 +335,13 @@ void EncodedAsyncOutputStream::ensureIdentityEncoding() {
 
     inner = kj::heap<kj::BrotliAsyncOutputStream>(*stream).attach(kj::mv(stream));
     encoding = StreamEncoding::IDENTITY;
+  } else if (encoding == StreamEncoding::ZSTD) {
+    auto& stream = inner.get<kj::Own<kj::AsyncOutputStream>>();
+
+    inner = kj::heap<ZstdAsyncOutputStream>(*stream).attach(kj::mv(stream));
+    encoding = StreamEncoding::IDENTITY;
   } else {
-    // We currently support gzip and brotli as non-identity content encodings.
+    // We currently support gzip, brotli and zstd as non-identity content encodings.
     KJ_ASSERT(encoding == StreamEncoding::IDENTITY);
   }
 }
@@ -334,6 +357,9 @@ kj::AsyncOutputStream& EncodedAsyncOutputStream::getInner() {
     KJ_CASE_ONEOF(br, kj::Own<kj::BrotliAsyncOutputStream>) {
       return *br;
     }
+    KJ_CASE_ONEOF(zstd, kj::Own<ZstdAsyncOutputStream>) {
+      return *zstd;
+    }
     KJ_CASE_ONEOF(ended, Ended) {
       KJ_FAIL_ASSERT("the EncodedAsyncOutputStream has been ended or aborted.");
     }
@@ -366,7 +392,8 @@ SystemMultiStream newSystemMultiStream(
 }
 
 ContentEncodingOptions::ContentEncodingOptions(CompatibilityFlags::Reader flags)
-    : brotliEnabled(flags.getBrotliContentEncoding()) {}
+    : brotliEnabled(flags.getBrotliContentEncoding()),
+      zstdEnabled(flags.getZstdContentEncoding()) {}
 
 StreamEncoding getContentEncoding(IoContext& context, const kj::HttpHeaders& headers,
                                   Response::BodyEncoding bodyEncoding,
@@ -379,6 +406,8 @@ StreamEncoding getContentEncoding(IoContext& context, const kj::HttpHeaders& hea
       return StreamEncoding::GZIP;
     } else if (options.brotliEnabled && encodingStr == "br") {
       return StreamEncoding::BROTLI;
+    } else if (options.zstdEnabled && encodingStr == "zstd") {
+      return StreamEncoding::ZSTD;
     }
   }
   return StreamEncoding::IDENTITY;
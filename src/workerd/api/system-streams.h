@@ -43,6 +43,7 @@ SystemMultiStream newSystemMultiStream(
 
 struct ContentEncodingOptions {
   bool brotliEnabled = false;
+  bool zstdEnabled = false;
   ContentEncodingOptions() = default;
   ContentEncodingOptions(CompatibilityFlags::Reader flags);
 };
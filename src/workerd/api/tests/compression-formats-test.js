@@ -0,0 +1,152 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+import * as assert from 'node:assert';
+
+const input = new TextEncoder().encode(
+  'The quick brown fox jumps over the lazy dog. '.repeat(2000));
+
+async function compress(format, data, options) {
+  const cs = new CompressionStream(format, options);
+  const writer = cs.writable.getWriter();
+  writer.write(data);
+  writer.close();
+  return new Uint8Array(await new Response(cs.readable).arrayBuffer());
+}
+
+async function decompress(format, data) {
+  const ds = new DecompressionStream(format);
+  const writer = ds.writable.getWriter();
+  writer.write(data).catch(() => {});
+  writer.close().catch(() => {});
+  return new Uint8Array(await new Response(ds.readable).arrayBuffer());
+}
+
+export const roundTrip = {
+  async test() {
+    for (const format of ['gzip', 'deflate', 'deflate-raw', 'br', 'zstd']) {
+      const compressed = await compress(format, input);
+      assert.ok(compressed.byteLength < input.byteLength / 10, format);
+      assert.deepStrictEqual(await decompress(format, compressed), input, format);
+    }
+  }
+};
+
+export const chunkedInput = {
+  async test() {
+    for (const format of ['br', 'zstd']) {
+      const cs = new CompressionStream(format);
+      const writer = cs.writable.getWriter();
+      for (let i = 0; i < input.byteLength; i += 1000) {
+        writer.write(input.subarray(i, i + 1000));
+      }
+      writer.close();
+      const compressed = new Uint8Array(await new Response(cs.readable).arrayBuffer());
+
+      // Feed the compressed data back one byte at a time.
+      const ds = new DecompressionStream(format);
+      const dsWriter = ds.writable.getWriter();
+      for (let i = 0; i < compressed.byteLength; i++) {
+        dsWriter.write(compressed.subarray(i, i + 1));
+      }
+      dsWriter.close();
+      const output = new Uint8Array(await new Response(ds.readable).arrayBuffer());
+      assert.deepStrictEqual(output, input, format);
+    }
+  }
+};
+
+export const options = {
+  async test() {
+    for (const format of ['gzip', 'br', 'zstd']) {
+      const fast = await compress(format, input, { level: 1 });
+      const small = await compress(format, input, { level: 9, windowBits: 15 });
+      assert.deepStrictEqual(await decompress(format, fast), input, format);
+      assert.deepStrictEqual(await decompress(format, small), input, format);
+    }
+
+    assert.throws(() => new CompressionStream('gzip', { level: 10 }), {
+      name: 'RangeError',
+      message: "The compression level for 'gzip' must be between -1 and 9.",
+    });
+    assert.throws(() => new CompressionStream('br', { level: 12 }), {
+      name: 'RangeError',
+      message: "The compression level for 'br' must be between 0 and 11.",
+    });
+    assert.throws(() => new CompressionStream('br', { windowBits: 25 }), {
+      name: 'RangeError',
+      message: "The windowBits for 'br' must be between 10 and 24.",
+    });
+    assert.throws(() => new CompressionStream('zstd', { windowBits: 24 }), {
+      name: 'RangeError',
+      message: "The windowBits for 'zstd' must be between 10 and 23.",
+    });
+    assert.throws(() => new CompressionStream('lz4'), {
+      name: 'TypeError',
+    });
+  }
+};
+
+export const strictErrors = {
+  async test() {
+    for (const format of ['br', 'zstd']) {
+      const compressed = await compress(format, input);
+
+      await assert.rejects(decompress(format, compressed.subarray(0, compressed.byteLength - 4)), {
+        name: 'TypeError',
+        message: 'Called close() on a decompression stream with incomplete data',
+      });
+    }
+
+    // Unlike brotli, zstd frames start with a magic number, so garbage is rejected right away.
+    await assert.rejects(decompress('zstd', new TextEncoder().encode('not compressed data')), {
+      name: 'Error',
+      message: 'Decompression failed.',
+    });
+
+    // Brotli streams end with their final meta-block, so anything after it is an error.
+    const br = await compress('br', input);
+    const trailing = new Uint8Array(br.byteLength + 1);
+    trailing.set(br);
+    await assert.rejects(decompress('br', trailing), {
+      name: 'TypeError',
+      message: 'Trailing bytes after end of compressed data',
+    });
+
+    // Concatenated zstd frames decode as the concatenation of their contents.
+    const zstd = await compress('zstd', input);
+    const twice = new Uint8Array(zstd.byteLength * 2);
+    twice.set(zstd);
+    twice.set(zstd, zstd.byteLength);
+    assert.strictEqual((await decompress('zstd', twice)).byteLength, input.byteLength * 2);
+  }
+};
+
+export default {
+  async fetch(request) {
+    if (request.url.endsWith('/manual')) {
+      // Already compressed, so the runtime must pass the body through untouched.
+      return new Response(await compress('zstd', input), {
+        headers: { 'Content-Encoding': 'zstd' },
+        encodeBody: 'manual',
+      });
+    }
+    return new Response(input, {
+      headers: { 'Content-Encoding': 'zstd' },
+    });
+  }
+};
+
+export const zstdContentEncoding = {
+  async test(ctrl, env) {
+    const response = await env.self.fetch('http://example.org/zstd');
+    assert.strictEqual(response.headers.get('Content-Encoding'), 'zstd');
+    assert.deepStrictEqual(new Uint8Array(await response.arrayBuffer()), input);
+
+    // A body compressed by CompressionStream decodes the same way.
+    const manual = await env.self.fetch('http://example.org/manual');
+    assert.strictEqual(manual.headers.get('Content-Encoding'), 'zstd');
+    assert.deepStrictEqual(new Uint8Array(await manual.arrayBuffer()), input);
+  }
+};
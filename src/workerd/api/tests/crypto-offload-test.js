@@ -0,0 +1,94 @@
+import {
+  deepStrictEqual,
+  strictEqual,
+  rejects,
+} from 'node:assert';
+import {
+  pbkdf2,
+  pbkdf2Sync,
+  scrypt,
+  scryptSync,
+} from 'node:crypto';
+
+// These run with the crypto-offload autogate enabled, so the expensive operations below run on
+// the crypto thread pool. The results must be identical to the synchronous paths.
+
+const enc = new TextEncoder();
+
+export const deriveBitsPbkdf2 = {
+  async test() {
+    const key = await crypto.subtle.importKey(
+        'raw', enc.encode('password'), 'PBKDF2', false, ['deriveBits', 'deriveKey']);
+    const salt = enc.encode('salt');
+
+    // Many at once, to make sure results are routed back to the right promise.
+    const results = await Promise.all([1, 2, 3, 4, 5, 6, 7, 8].map((i) =>
+        crypto.subtle.deriveBits(
+            { name: 'PBKDF2', hash: 'SHA-256', salt, iterations: 1000 * i }, key, 256)));
+    results.forEach((bits, n) => {
+      const expected = pbkdf2Sync('password', 'salt', 1000 * (n + 1), 32, 'sha256');
+      deepStrictEqual(Buffer.from(bits), expected);
+    });
+
+    // Validation still happens up front.
+    await rejects(crypto.subtle.deriveBits(
+        { name: 'PBKDF2', hash: 'SHA-256', salt, iterations: 0 }, key, 256), {
+      name: 'OperationError',
+    });
+    await rejects(crypto.subtle.deriveBits(
+        { name: 'PBKDF2', hash: 'SHA-256', salt, iterations: 1000 }, key, 7), {
+      name: 'OperationError',
+    });
+  }
+};
+
+export const deriveKeyPbkdf2 = {
+  async test() {
+    const baseKey = await crypto.subtle.importKey(
+        'raw', enc.encode('password'), 'PBKDF2', false, ['deriveKey']);
+    const key = await crypto.subtle.deriveKey(
+        { name: 'PBKDF2', hash: 'SHA-256', salt: enc.encode('salt'), iterations: 1000 },
+        baseKey, { name: 'HMAC', hash: 'SHA-256', length: 256 }, true, ['sign']);
+    const raw = await crypto.subtle.exportKey('raw', key);
+    deepStrictEqual(Buffer.from(raw), pbkdf2Sync('password', 'salt', 1000, 32, 'sha256'));
+  }
+};
+
+export const generateRsa = {
+  async test() {
+    const { publicKey, privateKey } = await crypto.subtle.generateKey({
+      name: 'RSASSA-PKCS1-v1_5',
+      modulusLength: 2048,
+      publicExponent: new Uint8Array([1, 0, 1]),
+      hash: 'SHA-256',
+    }, false, ['sign', 'verify']);
+    strictEqual(publicKey.algorithm.modulusLength, 2048);
+    strictEqual(privateKey.extractable, false);
+    const data = enc.encode('hello');
+    const signature = await crypto.subtle.sign('RSASSA-PKCS1-v1_5', privateKey, data);
+    strictEqual(await crypto.subtle.verify('RSASSA-PKCS1-v1_5', publicKey, signature, data), true);
+
+    await rejects(crypto.subtle.generateKey({
+      name: 'RSA-OAEP',
+      modulusLength: 2048,
+      publicExponent: new Uint8Array([1, 0, 1]),
+      hash: 'SHA-256',
+    }, false, []), {
+      name: 'SyntaxError',
+    });
+  }
+};
+
+export const nodeKdfs = {
+  async test() {
+    const pbkdf2Result = await new Promise((resolve, reject) => {
+      pbkdf2('password', 'salt', 1000, 64, 'sha512', (err, key) => err ? reject(err) : resolve(key));
+    });
+    deepStrictEqual(pbkdf2Result, pbkdf2Sync('password', 'salt', 1000, 64, 'sha512'));
+
+    const scryptResult = await new Promise((resolve, reject) => {
+      scrypt('password', 'salt', 64, { N: 1024 }, (err, key) => err ? reject(err) : resolve(key));
+    });
+    deepStrictEqual(scryptResult, scryptSync('password', 'salt', 64, { N: 1024 }));
+  }
+};
@@ -381,6 +381,40 @@ export const eventSourceFromWithBOMTest = {
   }
 };
 
+export const eventSourceFromSplitLinesTest = {
+  async test() {
+    const enc = new TextEncoder();
+    // Lines split across chunks, including a CRLF pair split between two chunks, which must not
+    // be treated as two line terminators (that would dispatch an extra, empty message).
+    const chunks = [
+      'data: fi',
+      'rst\r',
+      '\ndata: line\r\n\r',
+      '\nevent: custom\rdata: sec',
+      'ond\n\n',
+    ];
+    const rs = new ReadableStream({
+      async pull(c) {
+        c.enqueue(enc.encode(chunks.shift()));
+        if (chunks.length === 0) {
+          c.close();
+        }
+      }
+    });
+    const { promise, resolve } = Promise.withResolvers();
+    const eventsource = EventSource.from(rs);
+    eventsource.onmessage = (event) => {
+      strictEqual(event.data, 'first\nline');
+    };
+    eventsource.addEventListener('custom', (event) => {
+      strictEqual(event.data, 'second');
+      eventsource.close();
+      resolve();
+    });
+    await promise;
+  }
+};
+
 export const prototypePropertyTest = {
   test() {
     strictEqual(EventSource.prototype.constructor, EventSource);
@@ -777,3 +777,82 @@ export const svgNamespace = {
     strictEqual(namespace, "http://www.w3.org/2000/svg");
   }
 };
+
+export const reusedSelectors = {
+  async test() {
+    // Selectors are parsed once and shared between rewriters; make sure reuse doesn't leak state
+    // between them and that invalid selectors keep throwing on every attempt.
+    for (let i = 0; i < 3; i++) {
+      const seen = [];
+      const text = await new HTMLRewriter()
+        .on("p.a", {
+          element(e) {
+            seen.push(e.tagName);
+            e.setAttribute("data-i", `${i}`);
+          }
+        })
+        .transform(new Response('<p class="a">x</p><p class="b">y</p>'))
+        .text();
+
+      deepStrictEqual(seen, ["p"]);
+      strictEqual(text, `<p class="a" data-i="${i}">x</p><p class="b">y</p>`);
+      throws(() => new HTMLRewriter().on("p:::nope", {}), TypeError);
+    }
+  }
+};
+
+export const streamContent = {
+  async test() {
+    const encoder = new TextEncoder();
+    function streamOf(...chunks) {
+      return new ReadableStream({
+        pull(controller) {
+          if (chunks.length === 0) {
+            controller.close();
+          } else {
+            controller.enqueue(encoder.encode(chunks.shift()));
+          }
+        }
+      });
+    }
+
+    const text = await new HTMLRewriter()
+      .on("esi", {
+        element(e) {
+          e.replace(new Response("<b>included</b>"), { html: true });
+        }
+      })
+      .on("p", {
+        element(e) {
+          e.before(streamOf("<a>", " & ", "</a>"));
+          e.append(streamOf("<i>", "x", "</i>"), { html: true });
+        }
+      })
+      .onDocument({
+        end(end) {
+          end.append(streamOf("<!-- done -->"), { html: true });
+        }
+      })
+      .transform(new Response('<esi></esi><p>y</p>'))
+      .text();
+
+    strictEqual(text,
+        '<b>included</b>&lt;a&gt; &amp; &lt;/a&gt;<p>y<i>x</i></p><!-- done -->');
+  }
+};
+
+export const streamContentOnRemovedElement = {
+  async test() {
+    const text = await new HTMLRewriter()
+      .on("p", {
+        element(e) {
+          e.append(new Response("never"));
+          e.remove();
+        }
+      })
+      .transform(new Response('<div><p>y</p></div>'))
+      .text();
+
+    strictEqual(text, '<div></div>');
+  }
+};
@@ -2,6 +2,8 @@
 // Licensed under the Apache 2.0 license found in the LICENSE file or at:
 //     https://opensource.org/licenses/Apache-2.0
 
+import * as assert from 'node:assert';
+
 // A simple test to confirm we can close() a websocket from the close handler.
 export class DurableObjectExample {
   constructor(state) {
@@ -10,6 +12,13 @@ export class DurableObjectExample {
   }
 
   async fetch(request) {
+    let url = new URL(request.url);
+    if (url.pathname === "/broadcast") {
+      let tag = url.searchParams.get("tag") ?? undefined;
+      let count = this.state.broadcast(`broadcast to ${tag ?? "all"}`, { tag });
+      return new Response(`${count}`);
+    }
+
     // Confirm this is a websocket request.
     const upgradeHeader = request.headers.get('Upgrade');
     if (!upgradeHeader || upgradeHeader !== 'websocket') {
@@ -18,8 +27,8 @@ export class DurableObjectExample {
 
     let pair = new WebSocketPair();
     let server = pair[0];
-    if (request.url.endsWith("/hibernation")) {
-      this.state.acceptWebSocket(server);
+    if (url.pathname === "/hibernation") {
+      this.state.acceptWebSocket(server, url.searchParams.getAll("tag"));
     } else {
       server.accept();
       server.addEventListener("message", () => {
@@ -82,5 +91,44 @@ export default {
     await webSocketTest(obj, "http://example.com/", "regular close from DO");
     // Hibernatable Websocket.
     await webSocketTest(obj, "http://example.com/hibernation", "Hibernatable close from DO");
+
+    // Test that broadcast() reaches the hibernatable websockets matching the tag.
+    let connect = async (tags) => {
+      let query = tags.map(tag => `tag=${tag}`).join("&");
+      let req = await obj.fetch(`http://example.com/hibernation?${query}`, {
+        headers: {
+          Upgrade: 'websocket',
+        },
+      });
+      let ws = req.webSocket;
+      let received = [];
+      ws.accept();
+      ws.addEventListener("message", (msg) => received.push(msg.data));
+      return { ws, received };
+    };
+    let broadcast = async (tag) => {
+      let url = "http://example.com/broadcast" + (tag ? `?tag=${tag}` : "");
+      return parseInt(await (await obj.fetch(url)).text());
+    };
+
+    let red = await connect(["red"]);
+    let blue = await connect(["blue"]);
+    let both = await connect(["red", "blue"]);
+
+    assert.strictEqual(await broadcast("red"), 2);
+    assert.strictEqual(await broadcast("green"), 0);
+    assert.strictEqual(await broadcast(), 3);
+    await scheduler.wait(100);
+
+    assert.deepStrictEqual(red.received, ["broadcast to red", "broadcast to all"]);
+    assert.deepStrictEqual(blue.received, ["broadcast to all"]);
+    assert.deepStrictEqual(both.received, ["broadcast to red", "broadcast to all"]);
+
+    // Closed websockets are skipped.
+    for (let { ws } of [red, blue, both]) {
+      ws.close(1000, "bye from Worker!");
+    }
+    await scheduler.wait(100);
+    assert.strictEqual(await broadcast(), 0);
   }
 }
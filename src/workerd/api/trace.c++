@@ -20,7 +20,7 @@ namespace workerd::api {
 TailEvent::TailEvent(jsg::Lock& js, kj::StringPtr type, kj::ArrayPtr<kj::Own<Trace>> events)
     : ExtendableEvent(kj::str(type)),
       events(KJ_MAP(e, events) -> jsg::Ref<TraceItem> {
-        return jsg::alloc<TraceItem>(js, *e);
+        return jsg::alloc<TraceItem>(kj::addRef(*e));
       }) {}
 
 kj::Array<jsg::Ref<TraceItem>> TailEvent::getEvents() {
@@ -54,13 +54,13 @@ double getTraceDiagnosticChannelEventTimestamp(const Trace::DiagnosticChannelEve
   }
 }
 
-kj::String getTraceLogLevel(const Trace::Log& log) {
+kj::StringPtr getTraceLogLevel(const Trace::Log& log) {
     switch (log.logLevel) {
-    case LogLevel::DEBUG_: return kj::str("debug");
-    case LogLevel::INFO: return kj::str("info");
-    case LogLevel::LOG: return kj::str("log");
-    case LogLevel::WARN: return kj::str("warn");
-    case LogLevel::ERROR: return kj::str("error");
+    case LogLevel::DEBUG_: return "debug"_kj;
+    case LogLevel::INFO: return "info"_kj;
+    case LogLevel::LOG: return "log"_kj;
+    case LogLevel::WARN: return "warn"_kj;
+    case LogLevel::ERROR: return "error"_kj;
   }
   KJ_UNREACHABLE;
 }
@@ -69,16 +69,15 @@ jsg::V8Ref<v8::Object> getTraceLogMessage(jsg::Lock& js, const Trace::Log& log)
   return js.parseJson(log.message).cast<v8::Object>(js);
 }
 
-kj::Array<jsg::Ref<TraceLog>> getTraceLogs(jsg::Lock& js, const Trace& trace) {
+kj::Array<jsg::Ref<TraceLog>> getTraceLogs(Trace& trace) {
   return KJ_MAP(x, trace.logs) -> jsg::Ref<TraceLog> {
-    return jsg::alloc<TraceLog>(js, trace, x);
+    return jsg::alloc<TraceLog>(kj::addRef(trace), x);
   };
 }
 
-kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> getTraceDiagnosticChannelEvents(
-    jsg::Lock& js, const Trace& trace) {
+kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> getTraceDiagnosticChannelEvents(Trace& trace) {
   return KJ_MAP(x, trace.diagnosticChannelEvents) -> jsg::Ref<TraceDiagnosticChannelEvent> {
-    return jsg::alloc<TraceDiagnosticChannelEvent>(trace, x);
+    return jsg::alloc<TraceDiagnosticChannelEvent>(kj::addRef(trace), x);
   };
 }
 
@@ -94,20 +93,12 @@ double getTraceExceptionTimestamp(const Trace::Exception& ex) {
   }
 }
 
-kj::Array<jsg::Ref<TraceException>> getTraceExceptions(const Trace& trace) {
+kj::Array<jsg::Ref<TraceException>> getTraceExceptions(Trace& trace) {
   return KJ_MAP(x, trace.exceptions) -> jsg::Ref<TraceException> {
-    return jsg::alloc<TraceException>(trace, x);
+    return jsg::alloc<TraceException>(kj::addRef(trace), x);
   };
 }
 
-jsg::Optional<kj::Array<kj::String>> getTraceScriptTags(const Trace& trace) {
-  if (trace.scriptTags.size() > 0) {
-    return KJ_MAP(t, trace.scriptTags) -> kj::String { return kj::str(t); };
-  } else {
-    return kj::none;
-  }
-}
-
 kj::String getTraceOutcome(const Trace& trace) {
   // TODO(cleanup): Add to enumToStr() to capnp?
   auto enums = capnp::Schema::from<EventOutcome>().getEnumerants();
@@ -116,36 +107,12 @@ kj::String getTraceOutcome(const Trace& trace) {
   return kj::str(enums[i].getProto().getName());
 }
 
-kj::Own<TraceItem::FetchEventInfo::Request::Detail> getFetchRequestDetail(
-    jsg::Lock& js,
-    const Trace& trace,
-    const Trace::FetchEventInfo& eventInfo) {
-  const auto getCf = [&]() -> jsg::Optional<jsg::V8Ref<v8::Object>> {
-    const auto& cfJson = eventInfo.cfJson;
-    if (cfJson.size() > 0) {
-      return js.parseJson(cfJson).cast<v8::Object>(js);
-    }
-    return kj::none;
-  };
-
-  const auto getHeaders = [&]() -> kj::Array<Trace::FetchEventInfo::Header> {
-    return KJ_MAP(header, eventInfo.headers) {
-      return Trace::FetchEventInfo::Header(kj::str(header.name), kj::str(header.value));
-    };
-  };
-
-  return kj::refcounted<TraceItem::FetchEventInfo::Request::Detail>(
-    getCf(),
-    getHeaders(),
-    kj::str(eventInfo.method),
-    kj::str(eventInfo.url));
-}
-
-kj::Maybe<TraceItem::EventInfo> getTraceEvent(jsg::Lock& js, const Trace& trace) {
+kj::Maybe<TraceItem::EventInfo> getTraceEvent(Trace& trace) {
   KJ_IF_SOME(e, trace.eventInfo) {
     KJ_SWITCH_ONEOF(e) {
       KJ_CASE_ONEOF(fetch, Trace::FetchEventInfo) {
-        return kj::Maybe(jsg::alloc<TraceItem::FetchEventInfo>(js, trace, fetch, trace.fetchResponseInfo));
+        return kj::Maybe(
+            jsg::alloc<TraceItem::FetchEventInfo>(trace, fetch, trace.fetchResponseInfo));
       }
       KJ_CASE_ONEOF(jsRpc, Trace::JsRpcEventInfo) {
         return kj::Maybe(jsg::alloc<TraceItem::JsRpcEventInfo>(trace, jsRpc));
@@ -188,101 +155,71 @@ kj::Maybe<TraceItem::EventInfo> getTraceEvent(jsg::Lock& js, const Trace& trace)
 }
 }  // namespace
 
-TraceItem::TraceItem(jsg::Lock& js, const Trace& trace)
-    : eventInfo(getTraceEvent(js, trace)),
-      eventTimestamp(getTraceTimestamp(trace)),
-      logs(getTraceLogs(js, trace)),
-      exceptions(getTraceExceptions(trace)),
-      diagnosticChannelEvents(getTraceDiagnosticChannelEvents(js, trace)),
-      scriptName(trace.scriptName.map([](auto& name) { return kj::str(name); })),
-      entrypoint(trace.entrypoint.map([](auto& name) { return kj::str(name); })),
-      scriptVersion(getTraceScriptVersion(trace)),
-      dispatchNamespace(trace.dispatchNamespace.map([](auto& ns) { return kj::str(ns); })),
-      scriptTags(getTraceScriptTags(trace)),
-      outcome(getTraceOutcome(trace)),
-      cpuTime(trace.cpuTime / kj::MILLISECONDS),
-      wallTime(trace.wallTime / kj::MILLISECONDS),
-      truncated(trace.truncated) {}
+TraceItem::TraceItem(kj::Own<Trace> trace): trace(kj::mv(trace)) {}
 
 kj::Maybe<TraceItem::EventInfo> TraceItem::getEvent(jsg::Lock& js) {
-  return eventInfo.map([](auto& info) -> TraceItem::EventInfo {
-    KJ_SWITCH_ONEOF(info) {
-      KJ_CASE_ONEOF(info, jsg::Ref<FetchEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<JsRpcEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<ScheduledEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<AlarmEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<QueueEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<EmailEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<TailEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<HibernatableWebSocketEventInfo>) { return info.addRef(); }
-      KJ_CASE_ONEOF(info, jsg::Ref<CustomEventInfo>) { return info.addRef(); }
-    }
-    KJ_UNREACHABLE;
-  });
+  return getTraceEvent(*trace);
 }
 
 kj::Maybe<double> TraceItem::getEventTimestamp() {
-  return eventTimestamp;
+  return getTraceTimestamp(*trace);
 }
 
-kj::ArrayPtr<jsg::Ref<TraceLog>> TraceItem::getLogs() {
-  return logs;
+kj::Array<jsg::Ref<TraceLog>> TraceItem::getLogs() {
+  return getTraceLogs(*trace);
 }
 
-kj::ArrayPtr<jsg::Ref<TraceException>> TraceItem::getExceptions() {
-  return exceptions;
+kj::Array<jsg::Ref<TraceException>> TraceItem::getExceptions() {
+  return getTraceExceptions(*trace);
 }
 
-kj::ArrayPtr<jsg::Ref<TraceDiagnosticChannelEvent>> TraceItem::getDiagnosticChannelEvents() {
-  return diagnosticChannelEvents;
+kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> TraceItem::getDiagnosticChannelEvents() {
+  return getTraceDiagnosticChannelEvents(*trace);
 }
 
 kj::Maybe<kj::StringPtr> TraceItem::getScriptName() {
-  return scriptName.map([](auto& name) -> kj::StringPtr { return name; });
+  return trace->scriptName.map([](auto& name) -> kj::StringPtr { return name; });
 }
 
 jsg::Optional<kj::StringPtr> TraceItem::getEntrypoint() {
-  return entrypoint;
+  return trace->entrypoint.map([](auto& name) -> kj::StringPtr { return name; });
 }
 
 jsg::Optional<ScriptVersion> TraceItem::getScriptVersion() {
-  return scriptVersion;
+  return getTraceScriptVersion(*trace);
 }
 
 jsg::Optional<kj::StringPtr> TraceItem::getDispatchNamespace() {
-  return dispatchNamespace.map([](auto& ns) -> kj::StringPtr { return ns; });
+  return trace->dispatchNamespace.map([](auto& ns) -> kj::StringPtr { return ns; });
 }
 
 jsg::Optional<kj::Array<kj::StringPtr>> TraceItem::getScriptTags() {
-  return scriptTags.map([](kj::Array<kj::String>& tags) {
-    return KJ_MAP(t, tags) -> kj::StringPtr { return t; };
-  });
+  if (trace->scriptTags.size() > 0) {
+    return KJ_MAP(t, trace->scriptTags) -> kj::StringPtr { return t; };
+  } else {
+    return kj::none;
+  }
 }
 
-kj::StringPtr TraceItem::getOutcome() { return outcome; }
+kj::String TraceItem::getOutcome() { return getTraceOutcome(*trace); }
 
-bool TraceItem::getTruncated() { return truncated; }
+bool TraceItem::getTruncated() { return trace->truncated; }
 
-uint TraceItem::getCpuTime() { return cpuTime; }
+uint TraceItem::getCpuTime() { return trace->cpuTime / kj::MILLISECONDS; }
 
-uint TraceItem::getWallTime() { return wallTime; }
+uint TraceItem::getWallTime() { return trace->wallTime / kj::MILLISECONDS; }
 
-TraceItem::FetchEventInfo::FetchEventInfo(jsg::Lock& js,
-                                          const Trace& trace,
+TraceItem::FetchEventInfo::FetchEventInfo(Trace& trace,
                                           const Trace::FetchEventInfo& eventInfo,
                                           kj::Maybe<const Trace::FetchResponseInfo&> responseInfo)
-    : request(jsg::alloc<Request>(js, trace, eventInfo)),
+    : request(jsg::alloc<Request>(trace, eventInfo)),
       response(responseInfo.map([&](auto& info) { return jsg::alloc<Response>(trace, info); })) {}
 
 TraceItem::FetchEventInfo::Request::Detail::Detail(
-    jsg::Optional<jsg::V8Ref<v8::Object>> cf,
-    kj::Array<Trace::FetchEventInfo::Header> headers,
-    kj::String method,
-    kj::String url)
-    : cf(kj::mv(cf)),
-      headers(kj::mv(headers)),
-      method(kj::mv(method)),
-      url(kj::mv(url)) {}
+    kj::Own<Trace> trace,
+    const Trace::FetchEventInfo& eventInfo)
+    : trace(kj::mv(trace)),
+      eventInfo(eventInfo) {}
 
 jsg::Ref<TraceItem::FetchEventInfo::Request> TraceItem::FetchEventInfo::getRequest() {
   return request.addRef();
@@ -294,15 +231,22 @@ jsg::Optional<jsg::Ref<TraceItem::FetchEventInfo::Response>> TraceItem::FetchEve
   });
 }
 
-TraceItem::FetchEventInfo::Request::Request(jsg::Lock& js,
-                                            const Trace& trace,
+TraceItem::FetchEventInfo::Request::Request(Trace& trace,
                                             const Trace::FetchEventInfo& eventInfo)
-    : detail(getFetchRequestDetail(js, trace, eventInfo)) {}
+    : detail(kj::refcounted<Detail>(kj::addRef(trace), eventInfo)) {}
 
 TraceItem::FetchEventInfo::Request::Request(Detail& detail, bool redacted)
     : redacted(redacted), detail(kj::addRef(detail)) {}
 
 jsg::Optional<jsg::V8Ref<v8::Object>> TraceItem::FetchEventInfo::Request::getCf(jsg::Lock& js) {
+  // Parsed at most once, and shared with the unredacted view of the same request.
+  if (!detail->cfParsed) {
+    const auto& cfJson = detail->eventInfo.cfJson;
+    if (cfJson.size() > 0) {
+      detail->cf = js.parseJson(cfJson).cast<v8::Object>(js);
+    }
+    detail->cfParsed = true;
+  }
   return detail->cf.map([&](jsg::V8Ref<v8::Object>& obj) {
     return obj.addRef(js);
   });
@@ -323,8 +267,9 @@ jsg::Dict<jsg::ByteString, jsg::ByteString> TraceItem::FetchEventInfo::Request::
   };
 
   using HeaderDict = jsg::Dict<jsg::ByteString, jsg::ByteString>;
-  auto builder = kj::heapArrayBuilder<HeaderDict::Field>(detail->headers.size());
-  for (const auto& header: detail->headers) {
+  const auto& headers = detail->eventInfo.headers;
+  auto builder = kj::heapArrayBuilder<HeaderDict::Field>(headers.size());
+  for (const auto& header: headers) {
     auto v = (redacted && shouldRedact(header.name)) ? "REDACTED"_kj : header.value;
     builder.add(HeaderDict::Field {
         jsg::ByteString(kj::str(header.name)),
@@ -335,12 +280,13 @@ jsg::Dict<jsg::ByteString, jsg::ByteString> TraceItem::FetchEventInfo::Request::
   return HeaderDict{ builder.finish() };
 }
 
-kj::StringPtr TraceItem::FetchEventInfo::Request::getMethod() {
-  return detail->method;
+kj::String TraceItem::FetchEventInfo::Request::getMethod() {
+  return kj::str(detail->eventInfo.method);
 }
 
 kj::String TraceItem::FetchEventInfo::Request::getUrl() {
-  return (redacted ? redactUrl(detail->url) : kj::str(detail->url));
+  const auto& url = detail->eventInfo.url;
+  return (redacted ? redactUrl(url) : kj::str(url));
 }
 
 jsg::Ref<TraceItem::FetchEventInfo::Request> TraceItem::FetchEventInfo::Request::getUnredacted() {
@@ -439,23 +385,24 @@ kj::Maybe<kj::StringPtr> TraceItem::TailEventInfo::TailItem::getScriptName() {
 }
 
 TraceDiagnosticChannelEvent::TraceDiagnosticChannelEvent(
-    const Trace& trace,
+    kj::Own<Trace> trace,
     const Trace::DiagnosticChannelEvent& eventInfo)
-    : timestamp(getTraceDiagnosticChannelEventTimestamp(eventInfo)),
-      channel(kj::heapString(eventInfo.channel)),
-      message(kj::heapArray<kj::byte>(eventInfo.message)) {}
+    : trace(kj::mv(trace)),
+      eventInfo(eventInfo) {}
 
 kj::StringPtr TraceDiagnosticChannelEvent::getChannel() {
-  return channel;
+  return eventInfo.channel;
 }
 
 jsg::JsValue TraceDiagnosticChannelEvent::getMessage(jsg::Lock& js) {
-  if (message.size() == 0) return js.undefined();
-  jsg::Deserializer des(js, message.asPtr());
+  if (eventInfo.message.size() == 0) return js.undefined();
+  jsg::Deserializer des(js, eventInfo.message.asPtr());
   return des.readValue(js);
 }
 
-double TraceDiagnosticChannelEvent::getTimestamp() { return timestamp; }
+double TraceDiagnosticChannelEvent::getTimestamp() {
+  return getTraceDiagnosticChannelEventTimestamp(eventInfo);
+}
 
 ScriptVersion::ScriptVersion(workerd::ScriptVersion::Reader version)
     : id{[&]() -> kj::Maybe<kj::String> {
@@ -526,43 +473,40 @@ bool TraceItem::HibernatableWebSocketEventInfo::Close::getWasClean() {
   return eventInfo.wasClean;
 }
 
-TraceLog::TraceLog(jsg::Lock& js, const Trace& trace, const Trace::Log& log)
-    : timestamp(getTraceLogTimestamp(log)),
-      level(getTraceLogLevel(log)),
-      message(getTraceLogMessage(js, log)) {}
+TraceLog::TraceLog(kj::Own<Trace> trace, const Trace::Log& log)
+    : trace(kj::mv(trace)),
+      log(log) {}
 
 double TraceLog::getTimestamp() {
-  return timestamp;
+  return getTraceLogTimestamp(log);
 }
 
 kj::StringPtr TraceLog::getLevel() {
-  return level;
+  return getTraceLogLevel(log);
 }
 
 jsg::V8Ref<v8::Object> TraceLog::getMessage(jsg::Lock& js) {
-  return message.addRef(js);
+  return getTraceLogMessage(js, log);
 }
 
-TraceException::TraceException(const Trace& trace, const Trace::Exception& exception)
-    : timestamp(getTraceExceptionTimestamp(exception)),
-      name(kj::str(exception.name)),
-      message(kj::str(exception.message)),
-      stack(exception.stack.map([](kj::StringPtr s) { return kj::str(s); })) {}
+TraceException::TraceException(kj::Own<Trace> trace, const Trace::Exception& exception)
+    : trace(kj::mv(trace)),
+      exception(exception) {}
 
 double TraceException::getTimestamp() {
-  return timestamp;
+  return getTraceExceptionTimestamp(exception);
 }
 
 kj::StringPtr TraceException::getMessage() {
-  return message;
+  return exception.message;
 }
 
 kj::StringPtr TraceException::getName() {
-  return name;
+  return exception.name;
 }
 
 jsg::Optional<kj::StringPtr> TraceException::getStack(jsg::Lock& js) {
-  return stack;
+  return exception.stack.map([](const kj::String& s) -> kj::StringPtr { return s; });
 }
 
 TraceMetrics::TraceMetrics(uint cpuTime, uint wallTime) : cpuTime(cpuTime), wallTime(wallTime) {}
@@ -656,55 +600,9 @@ void TailEvent::visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
 }
 
 void TraceItem::visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-  KJ_IF_SOME(event, eventInfo) {
-    KJ_SWITCH_ONEOF(event) {
-      KJ_CASE_ONEOF(info, jsg::Ref<FetchEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<JsRpcEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<ScheduledEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<AlarmEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<QueueEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<EmailEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<TailEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<CustomEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-      KJ_CASE_ONEOF(info, jsg::Ref<HibernatableWebSocketEventInfo>) {
-        tracker.trackField("eventInfo", info);
-      }
-    }
-  }
-  for (const auto& log : logs) {
-    tracker.trackField("log", log);
-  }
-  for (const auto& exception: exceptions) {
-    tracker.trackField("exception", exception);
-  }
-  for (const auto& event: diagnosticChannelEvents) {
-    tracker.trackField("diagnosticChannelEvent", event);
-  }
-  tracker.trackField("scriptName", scriptName);
-  tracker.trackField("scriptVersion", scriptVersion);
-  tracker.trackField("dispatchNamespace", dispatchNamespace);
-  KJ_IF_SOME(tags, scriptTags) {
-    for (const auto& tag: tags) {
-      tracker.trackField("scriptTag", tag);
-    }
-  }
-  tracker.trackField("outcome", outcome);
+  // The JS objects for the event, logs, etc. are created lazily and owned by the JS wrapper once
+  // materialized; what we hold directly is the underlying trace data.
+  tracker.trackFieldWithSize("trace", trace->bytesUsed);
 }
 
 void TraceItem::FetchEventInfo::visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
@@ -76,7 +76,10 @@ public:
   class HibernatableWebSocketEventInfo;
   class CustomEventInfo;
 
-  explicit TraceItem(jsg::Lock& js, const Trace& trace);
+  // The TraceItem keeps a reference to the (immutable, completed) Trace rather than copying it.
+  // All properties are lazy, so logs, exceptions, and event details are only converted to JS
+  // when the tail worker actually reads them; V8 then caches the result on the instance.
+  explicit TraceItem(kj::Own<Trace> trace);
 
   typedef kj::OneOf<jsg::Ref<FetchEventInfo>,
                     jsg::Ref<JsRpcEventInfo>,
@@ -90,15 +93,15 @@ public:
   kj::Maybe<EventInfo> getEvent(jsg::Lock& js);
   kj::Maybe<double> getEventTimestamp();
 
-  kj::ArrayPtr<jsg::Ref<TraceLog>> getLogs();
-  kj::ArrayPtr<jsg::Ref<TraceException>> getExceptions();
-  kj::ArrayPtr<jsg::Ref<TraceDiagnosticChannelEvent>> getDiagnosticChannelEvents();
+  kj::Array<jsg::Ref<TraceLog>> getLogs();
+  kj::Array<jsg::Ref<TraceException>> getExceptions();
+  kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> getDiagnosticChannelEvents();
   kj::Maybe<kj::StringPtr> getScriptName();
   jsg::Optional<kj::StringPtr> getEntrypoint();
   jsg::Optional<ScriptVersion> getScriptVersion();
   jsg::Optional<kj::StringPtr> getDispatchNamespace();
   jsg::Optional<kj::Array<kj::StringPtr>> getScriptTags();
-  kj::StringPtr getOutcome();
+  kj::String getOutcome();
 
   uint getCpuTime();
   uint getWallTime();
@@ -122,30 +125,15 @@ public:
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const;
 
 private:
-  kj::Maybe<EventInfo> eventInfo;
-  kj::Maybe<double> eventTimestamp;
-  kj::Array<jsg::Ref<TraceLog>> logs;
-  kj::Array<jsg::Ref<TraceException>> exceptions;
-  kj::Array<jsg::Ref<TraceDiagnosticChannelEvent>> diagnosticChannelEvents;
-  kj::Maybe<kj::String> scriptName;
-  kj::Maybe<kj::String> entrypoint;
-  kj::Maybe<ScriptVersion> scriptVersion;
-  kj::Maybe<kj::String> dispatchNamespace;
-  jsg::Optional<kj::Array<kj::String>> scriptTags;
-  kj::String outcome;
-  uint cpuTime;
-  uint wallTime;
-  bool truncated;
+  kj::Own<Trace> trace;
 };
 
-// When adding a new TraceItem eventInfo type, it is important not to
-// try keeping a reference to the Trace and Trace::*EventInfo inputs.
-// They are kj heap objects that have a lifespan that is managed independently
-// of the TraceItem object. Each of the implementations here extract the
-// necessary detail on creation and use LAZY instance properties to minimize
-// copying and allocation necessary when accessing these values.
-// TODO(cleanup): Later we can further optimize by creating the JS objects
-// immediately on creation.
+// When adding a new TraceItem eventInfo type, note that the Trace and Trace::*EventInfo inputs
+// are only guaranteed to outlive the constructor call. Implementations that want to defer work
+// until a property is read (as FetchEventInfo::Request does for its cf object and headers) must
+// hold a kj::Own<Trace> alongside any reference into it. The rest extract the (small) necessary
+// detail on creation and use LAZY instance properties to minimize copying and allocation
+// necessary when accessing these values.
 
 // While this class is named FetchEventInfo, it encapsulates both the actual
 // FetchEventInfo as well as the FetchResponseInfo, which is an (optional)
@@ -160,8 +148,7 @@ public:
   class Request;
   class Response;
 
-  explicit FetchEventInfo(jsg::Lock& js,
-                          const Trace& trace,
+  explicit FetchEventInfo(Trace& trace,
                           const Trace::FetchEventInfo& eventInfo,
                           kj::Maybe<const Trace::FetchResponseInfo&> responseInfo);
 
@@ -183,35 +170,33 @@ private:
 
 class TraceItem::FetchEventInfo::Request final: public jsg::Object {
 public:
+  // Shared between the redacted and unredacted views of the request. Holds the Trace so that
+  // the cf object is only parsed, and the headers only copied, if the tail worker asks for them.
   struct Detail : public kj::Refcounted {
+    kj::Own<Trace> trace;
+    const Trace::FetchEventInfo& eventInfo;
     jsg::Optional<jsg::V8Ref<v8::Object>> cf;
-    kj::Array<Trace::FetchEventInfo::Header> headers;
-    kj::String method;
-    kj::String url;
+    bool cfParsed = false;
 
-    Detail(jsg::Optional<jsg::V8Ref<v8::Object>> cf,
-           kj::Array<Trace::FetchEventInfo::Header> headers,
-           kj::String method,
-           kj::String url);
+    Detail(kj::Own<Trace> trace, const Trace::FetchEventInfo& eventInfo);
 
     JSG_MEMORY_INFO(Detail) {
       tracker.trackField("cf", cf);
-      for (const auto& header : headers) {
+      for (const auto& header : eventInfo.headers) {
         tracker.trackField(nullptr, header);
       }
-      tracker.trackField("method", method);
-      tracker.trackField("url", url);
+      tracker.trackField("url", eventInfo.url);
     }
   };
 
-  explicit Request(jsg::Lock& js, const Trace& trace, const Trace::FetchEventInfo& eventInfo);
+  explicit Request(Trace& trace, const Trace::FetchEventInfo& eventInfo);
 
   // Creates a possibly unredacted instance that shared a ref of the Detail
   explicit Request(Detail& detail, bool redacted = true);
 
   jsg::Optional<jsg::V8Ref<v8::Object>> getCf(jsg::Lock& js);
   jsg::Dict<jsg::ByteString, jsg::ByteString> getHeaders();
-  kj::StringPtr getMethod();
+  kj::String getMethod();
   kj::String getUrl();
 
   jsg::Ref<Request> getUnredacted();
@@ -479,10 +464,12 @@ private:
   const Trace::CustomEventInfo& eventInfo;
 };
 
+// TraceDiagnosticChannelEvent, TraceLog and TraceException hold a reference to their Trace and
+// read from it on demand, so that creating them for a TraceItem's arrays is cheap.
 class TraceDiagnosticChannelEvent final: public jsg::Object {
 public:
   explicit TraceDiagnosticChannelEvent(
-      const Trace& trace,
+      kj::Own<Trace> trace,
       const Trace::DiagnosticChannelEvent& eventInfo);
 
   double getTimestamp();
@@ -496,19 +483,18 @@ public:
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("channel", channel);
-    tracker.trackFieldWithSize("message", message.size());
+    tracker.trackField("channel", eventInfo.channel);
+    tracker.trackFieldWithSize("message", eventInfo.message.size());
   }
 
 private:
-  double timestamp;
-  kj::String channel;
-  kj::Array<kj::byte> message;
+  kj::Own<Trace> trace;
+  const Trace::DiagnosticChannelEvent& eventInfo;
 };
 
 class TraceLog final: public jsg::Object {
 public:
-  TraceLog(jsg::Lock& js, const Trace& trace, const Trace::Log& log);
+  TraceLog(kj::Own<Trace> trace, const Trace::Log& log);
 
   double getTimestamp();
   kj::StringPtr getLevel();
@@ -521,19 +507,17 @@ public:
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("level", level);
-    tracker.trackField("message", message);
+    tracker.trackField("message", log.message);
   }
 
 private:
-  double timestamp;
-  kj::String level;
-  jsg::V8Ref<v8::Object> message;
+  kj::Own<Trace> trace;
+  const Trace::Log& log;
 };
 
 class TraceException final: public jsg::Object {
 public:
-  TraceException(const Trace& trace, const Trace::Exception& exception);
+  TraceException(kj::Own<Trace> trace, const Trace::Exception& exception);
 
   double getTimestamp();
   kj::StringPtr getName();
@@ -548,15 +532,13 @@ public:
   }
 
   void visitForMemoryInfo(jsg::MemoryTracker& tracker) const {
-    tracker.trackField("name", name);
-    tracker.trackField("message", message);
+    tracker.trackField("name", exception.name);
+    tracker.trackField("message", exception.message);
   }
 
 private:
-  double timestamp;
-  kj::String name;
-  kj::String message;
-  kj::Maybe<kj::String> stack;
+  kj::Own<Trace> trace;
+  const Trace::Exception& exception;
 };
 
 class TraceMetrics final : public jsg::Object {
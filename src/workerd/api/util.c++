@@ -7,6 +7,7 @@
 #include <workerd/io/io-context.h>
 #include <workerd/util/thread-scopes.h>
 #include <workerd/util/mimetype.h>
+#include <workerd/util/spilling-tee.h>
 
 namespace workerd::api {
 
@@ -149,6 +150,19 @@ kj::Own<kj::AsyncInputStream> newTeeErrorAdapter(kj::Own<kj::AsyncInputStream> i
   }
 }
 
+kj::Tee newSpillableTee(kj::Own<kj::AsyncInputStream> input, uint64_t limit) {
+  if (IoContext::hasCurrent()) {
+    KJ_IF_SOME(spill, IoContext::current().getLimitEnforcer().getTeeSpillOptions()) {
+      return newSpillingTee(kj::mv(input), {
+        .memoryLimit = spill.memoryLimit,
+        .bufferLimit = limit,
+        .newSpillFile = [&directory = spill.directory]() { return directory.createTemporary(); },
+      });
+    }
+  }
+  return kj::newTee(kj::mv(input), limit);
+}
+
 kj::String redactUrl(kj::StringPtr url) {
   kj::Vector<char> redacted(url.size() + 1);
   const char* spanStart = url.begin();
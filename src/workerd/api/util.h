@@ -87,6 +87,10 @@ kj::Maybe<kj::Exception> translateKjException(
 // JS-visible exceptions.
 kj::Own<kj::AsyncInputStream> newTeeErrorAdapter(kj::Own<kj::AsyncInputStream> inner);
 
+// Like kj::newTee(), but if the current request's LimitEnforcer provides TeeSpillOptions, the
+// data buffered for a lagging branch is spilled to disk rather than held in memory.
+kj::Tee newSpillableTee(kj::Own<kj::AsyncInputStream> input, uint64_t limit);
+
 // Redacts potential secret keys from a given URL using a couple heuristics:
 //   - Any run of hex characters of 32 or more digits, ignoring potential "+-_" separators
 //   - Any run of base64 characters of 21 or more digits, including at least
@@ -732,7 +732,10 @@ void WebSocket::serializeAttachment(jsg::Lock& js, jsg::JsValue attachment) {
 void WebSocket::setAutoResponseStatus(kj::Maybe<kj::Date> time,
     kj::Promise<void> autoResponsePromise) {
   autoResponseTimestamp = time;
-  autoResponseStatus.ongoingAutoResponse = kj::mv(autoResponsePromise);
+  // Sends started while we were hibernating may still be in flight, so we wait for those as well
+  // as the new promise rather than replacing them.
+  autoResponseStatus.ongoingAutoResponse = kj::joinPromises(kj::arr(
+      kj::mv(autoResponseStatus.ongoingAutoResponse), kj::mv(autoResponsePromise)));
 }
 
 
@@ -810,7 +813,13 @@ kj::Promise<void> WebSocket::sendAutoResponse(kj::String message, kj::WebSocket&
   if (autoResponseStatus.isPumping) {
     autoResponseStatus.pendingAutoResponseDeque.push_back(kj::mv(message));
   } else if (!autoResponseStatus.isClosed){
-    auto p = ws.send(message).fork();
+    // A broadcast queued while we were hibernating may still be sending, and kj::WebSocket only
+    // allows one send at a time.
+    auto p = kj::mv(autoResponseStatus.ongoingAutoResponse)
+        .then([&ws, message = kj::mv(message)]() mutable {
+      auto promise = ws.send(message);
+      return promise.attach(kj::mv(message));
+    }).fork();
     autoResponseStatus.ongoingAutoResponse = p.addBranch();
     co_await p;
     autoResponseStatus.ongoingAutoResponse = kj::READY_NOW;
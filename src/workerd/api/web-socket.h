@@ -322,6 +322,9 @@ public:
 
   HibernationPackage buildPackageForHibernation();
 
+  // True once `close()` has been called, after which `send()` throws.
+  bool hasClosedOutgoing() { return closedOutgoingForHib; }
+
   // ---------------------------------------------------------------------------
   // JS API.
 
@@ -939,6 +939,7 @@ private:
   bool evictIfNeeded(Lock& lock) const KJ_WARN_UNUSED_RESULT;
 
   friend class ActorCache;
+  friend class ActorSqlite;
 };
 
 // A transaction represents a set of writes that haven't been committed. The transaction can be
@@ -0,0 +1,267 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "actor-sqlite.h"
+#include "io-gate.h"
+#include <kj/test.h>
+#include <kj/filesystem.h>
+
+namespace workerd {
+namespace {
+
+struct ActorSqliteTest {
+  kj::EventLoop loop;
+  kj::WaitScope ws;
+
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs;
+  OutputGate gate;
+  ActorCache::SharedLru lru;
+  ActorSqlite actor;
+
+  // Writes to the same table as `actor`, behind its back, so that tests can tell whether a read
+  // was served from the cache.
+  SqliteKv backdoor;
+
+  ActorSqliteTest(size_t softLimit = 1024 * 1024)
+      : ws(loop), vfs(*dir),
+        lru({softLimit, 2 * softLimit, 1 * kj::SECONDS, 64 * 1024, 128}),
+        actor(kj::heap<SqliteDatabase>(vfs, kj::Path({"foo"}),
+                  kj::WriteMode::CREATE | kj::WriteMode::MODIFY),
+              gate, []() -> kj::Promise<void> { return kj::READY_NOW; },
+              ActorSqlite::Hooks::DEFAULT, lru),
+        backdoor(KJ_ASSERT_NONNULL(actor.getSqliteDatabase())) {}
+
+  kj::Maybe<kj::String> get(kj::StringPtr key, ActorCacheOps::ReadOptions options = {}) {
+    auto result = actor.get(kj::str(key), options);
+    auto& value = result.get<kj::Maybe<ActorCacheOps::Value>>();
+    return value.map([](ActorCacheOps::Value& value) { return kj::str(value.asChars()); });
+  }
+
+  void put(kj::StringPtr key, kj::StringPtr value, ActorCacheOps::WriteOptions options = {}) {
+    actor.put(kj::str(key), kj::heapArray(value.asBytes()), options);
+  }
+
+  void putBehindBack(kj::StringPtr key, kj::StringPtr value) {
+    backdoor.put(key, value.asBytes());
+  }
+
+  // Let the implicit transaction commit.
+  void settle() {
+    gate.wait().wait(ws);
+  }
+};
+
+KJ_TEST("ActorSqlite read cache serves repeated gets") {
+  ActorSqliteTest test;
+
+  test.putBehindBack("foo", "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+  KJ_EXPECT(test.lru.currentSize() > 0);
+
+  // The second read comes from memory, so it doesn't see the change made behind its back.
+  test.putBehindBack("foo", "def");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+
+  // Absence is cached too.
+  KJ_EXPECT(test.get("bar") == kj::none);
+  test.putBehindBack("bar", "123");
+  KJ_EXPECT(test.get("bar") == kj::none);
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache skips noCache reads") {
+  ActorSqliteTest test;
+
+  test.putBehindBack("foo", "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo", {.noCache = true})) == "abc");
+  KJ_EXPECT(test.lru.currentSize() == 0);
+
+  test.putBehindBack("foo", "def");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "def");
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache follows writes") {
+  ActorSqliteTest test;
+
+  test.put("foo", "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+
+  test.put("foo", "def");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "def");
+
+  KJ_EXPECT(test.actor.delete_(kj::str("foo"), {}).get<bool>());
+  KJ_EXPECT(test.get("foo") == kj::none);
+
+  test.put("foo", "ghi");
+  test.put("bar", "123");
+  KJ_EXPECT(test.actor.deleteAll({}).count.wait(test.ws) == 2);
+  KJ_EXPECT(test.get("foo") == kj::none);
+  KJ_EXPECT(test.get("bar") == kj::none);
+
+  // A noCache write drops the entry instead of replacing it.
+  test.put("foo", "jkl", {.noCache = true});
+  test.putBehindBack("foo", "mno");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "mno");
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache forgets rolled back writes") {
+  ActorSqliteTest test;
+
+  test.put("foo", "abc");
+  test.settle();
+
+  {
+    auto txn = test.actor.startTransaction();
+    txn->put(kj::str("foo"), kj::heapArray("def"_kj.asBytes()), {});
+    KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "def");
+    txn->rollback().wait(test.ws);
+  }
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+
+  // Same for savepoints that don't belong to ActorSqlite, like those of transactionSync().
+  auto& db = KJ_ASSERT_NONNULL(test.actor.getSqliteDatabase());
+  db.notifyWrite();
+  db.run("SAVEPOINT _cf_sync_savepoint_0");
+  test.put("foo", "ghi");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "ghi");
+  db.run("ROLLBACK TO _cf_sync_savepoint_0");
+  db.run("RELEASE _cf_sync_savepoint_0");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache stays under the soft limit") {
+  ActorSqliteTest test(4096);
+
+  auto value = kj::str(kj::repeat('x', 1000));
+  for (auto i: kj::zeroTo(20)) {
+    test.putBehindBack(kj::str("key", i), value);
+    KJ_EXPECT(KJ_ASSERT_NONNULL(test.get(kj::str("key", i))) == value);
+    KJ_EXPECT(test.lru.currentSize() <= 4096);
+  }
+
+  // The most recent read is still cached, the oldest is not.
+  test.putBehindBack("key0", "abc");
+  test.putBehindBack("key19", "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("key0")) == "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("key19")) == value);
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache evicts stale entries") {
+  ActorSqliteTest test;
+
+  test.putBehindBack("foo", "abc");
+  test.putBehindBack("bar", "123");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("bar")) == "123");
+
+  // The first pass only marks entries, and reading `foo` unmarks it.
+  test.actor.evictStale(kj::UNIX_EPOCH + 1 * kj::SECONDS);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+  test.actor.evictStale(kj::UNIX_EPOCH + 3 * kj::SECONDS);
+
+  test.putBehindBack("foo", "def");
+  test.putBehindBack("bar", "456");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("foo")) == "abc");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.get("bar")) == "456");
+
+  test.settle();
+}
+
+KJ_TEST("ActorSqlite read cache returns its memory to the LRU") {
+  ActorSqliteTest test;
+
+  test.putBehindBack("foo", "abc");
+  KJ_EXPECT(test.get("foo") != kj::none);
+  KJ_EXPECT(test.lru.currentSize() > 0);
+
+  test.actor.shutdown(kj::none);
+  KJ_EXPECT(test.lru.currentSize() == 0);
+}
+
+struct CountingPoolObserver final: public ActorSqlite::HandlePool::Observer {
+  uint hits = 0;
+  uint misses = 0;
+  uint evictions = 0;
+
+  void gotHandle(bool reused) override { ++(reused ? hits : misses); }
+  void evicted() override { ++evictions; }
+};
+
+KJ_TEST("ActorSqlite handle pool reuses databases") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  OutputGate gate;
+  CountingPoolObserver observer;
+  ActorSqlite::HandlePool pool(1,
+      kj::Own<CountingPoolObserver>(&observer, kj::NullDisposer::instance));
+
+  uint opened = 0;
+  auto get = [&](kj::StringPtr name) {
+    return pool.get(name, [&]() {
+      ++opened;
+      return kj::heap<SqliteDatabase>(vfs, kj::Path({name}),
+          kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    });
+  };
+  auto makeActor = [&](kj::Own<ActorSqlite::Handle> handle) {
+    return kj::heap<ActorSqlite>(kj::mv(handle), gate,
+        []() -> kj::Promise<void> { return kj::READY_NOW; });
+  };
+
+  {
+    auto actor = makeActor(get("foo"));
+    actor->put(kj::str("key"), kj::heapArray("abc"_kj.asBytes()), {});
+    gate.wait().wait(ws);
+  }
+  KJ_EXPECT(pool.idleCount() == 1);
+
+  // Coming back gets the same database, which still works.
+  {
+    auto actor = makeActor(get("foo"));
+    KJ_EXPECT(opened == 1);
+    auto result = actor->get(kj::str("key"), {});
+    auto& value = KJ_ASSERT_NONNULL(result.get<kj::Maybe<ActorCacheOps::Value>>());
+    KJ_EXPECT(value.asChars() == "abc"_kj);
+
+    // While it's in use, another actor for the same name gets a database of its own.
+    auto other = get("foo");
+    KJ_EXPECT(opened == 2);
+  }
+  KJ_EXPECT(observer.hits == 1);
+  KJ_EXPECT(observer.misses == 2);
+
+  // Only one database stays open.
+  get("bar");
+  KJ_EXPECT(opened == 3);
+  KJ_EXPECT(observer.evictions == 1);
+  KJ_EXPECT(pool.idleCount() == 1);
+  get("foo");
+  KJ_EXPECT(opened == 4);
+
+  // A database left mid-transaction is closed rather than pooled, so that its writes roll back.
+  {
+    auto actor = makeActor(get("baz"));
+    actor->put(kj::str("key"), kj::heapArray("abc"_kj.asBytes()), {});
+    actor->shutdown(kj::none);
+  }
+  auto actor = makeActor(get("baz"));
+  KJ_EXPECT(opened == 6);
+  auto result = actor->get(kj::str("key"), {});
+  KJ_EXPECT(result.get<kj::Maybe<ActorCacheOps::Value>>() == kj::none);
+}
+
+}  // namespace
+}  // namespace workerd
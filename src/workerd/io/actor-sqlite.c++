@@ -9,18 +9,95 @@
 
 namespace workerd {
 
+ActorSqlite::Handle::Handle(kj::Own<SqliteDatabase> dbParam)
+    : db(kj::mv(dbParam)), kv(*db) {}
+
+ActorSqlite::HandlePool::~HandlePool() noexcept(false) {
+  for (auto& entry: idleOrder) {
+    idleOrder.remove(entry);
+  }
+}
+
+kj::Own<ActorSqlite::Handle> ActorSqlite::HandlePool::get(
+    kj::StringPtr key, kj::FunctionParam<kj::Own<SqliteDatabase>()> open) {
+  KJ_IF_SOME(entry, entries.find(key)) {
+    if (entry->link.isLinked()) {
+      idleOrder.remove(*entry);
+      inUse.insert(entry->handle.get(), entry.get());
+      observer->gotHandle(true);
+      return kj::Own<Handle>(entry->handle.get(), *this);
+    }
+
+    // An ActorSqlite still has the pooled Handle, e.g. one that was broken and hasn't been
+    // destroyed yet. Give this one a Handle of its own, which won't be pooled.
+    observer->gotHandle(false);
+    return kj::heap<Handle>(open());
+  }
+
+  observer->gotHandle(false);
+  auto entry = kj::heap<Entry>();
+  entry->key = kj::str(key);
+  entry->handle = kj::heap<Handle>(open());
+  auto& handle = *entry->handle;
+  inUse.insert(&handle, entry.get());
+  entries.insert(entry->key, kj::mv(entry));
+  return kj::Own<Handle>(&handle, *this);
+}
+
+void ActorSqlite::HandlePool::disposeImpl(void* pointer) const {
+  auto& handle = *static_cast<Handle*>(pointer);
+  auto& entry = *KJ_ASSERT_NONNULL(inUse.find(&handle));
+  inUse.erase(&handle);
+
+  if (handle.db->isInTransaction()) {
+    // Closing the database is what rolls the transaction back.
+    entries.erase(KJ_ASSERT_NONNULL(entries.findEntry(entry.key)));
+    return;
+  }
+
+  idleOrder.add(entry);
+  while (idleOrder.size() > limit) {
+    auto& oldest = idleOrder.front();
+    idleOrder.remove(oldest);
+    observer->evicted();
+    entries.erase(KJ_ASSERT_NONNULL(entries.findEntry(oldest.key)));
+  }
+}
+
 ActorSqlite::ActorSqlite(kj::Own<SqliteDatabase> dbParam, OutputGate& outputGate,
                          kj::Function<kj::Promise<void>()> commitCallback,
-                         Hooks& hooks)
-    : db(kj::mv(dbParam)), outputGate(outputGate), commitCallback(kj::mv(commitCallback)),
-      hooks(hooks), kv(*db), commitTasks(*this) {
-  db->onWrite(KJ_BIND_METHOD(*this, onWrite));
+                         Hooks& hooks, kj::Maybe<const ActorCache::SharedLru&> readCacheLru)
+    : ActorSqlite(kj::heap<Handle>(kj::mv(dbParam)), outputGate, kj::mv(commitCallback),
+                  hooks, readCacheLru) {}
+
+ActorSqlite::ActorSqlite(kj::Own<Handle> handleParam, OutputGate& outputGate,
+                         kj::Function<kj::Promise<void>()> commitCallback,
+                         Hooks& hooks, kj::Maybe<const ActorCache::SharedLru&> readCacheLru)
+    : handle(kj::mv(handleParam)), outputGate(outputGate),
+      commitCallback(kj::mv(commitCallback)), hooks(hooks), readCacheLru(readCacheLru),
+      commitTasks(*this) {
+  db.onWrite(KJ_BIND_METHOD(*this, onWrite));
+
+  if (readCacheLru != kj::none) {
+    // Rolling back a transaction or savepoint -- whether ours, an implicit transaction failing to
+    // commit, or transactionSync() -- can undo writes the cache has already absorbed. Rollbacks
+    // are rare, so just start over.
+    db.onRollback(KJ_BIND_METHOD(*this, clearReadCache));
+  }
+}
+
+ActorSqlite::~ActorSqlite() noexcept(false) {
+  // Give the cached bytes back to the shared LRU.
+  clearReadCache();
+
+  // The Handle may go on to serve another ActorSqlite.
+  db.clearCallbacks();
 }
 
 ActorSqlite::ImplicitTxn::ImplicitTxn(ActorSqlite& parent)
     : parent(parent) {
   KJ_REQUIRE(parent.currentTxn.is<NoTxn>());
-  parent.beginTxn.run();
+  parent.handle->beginTxn.run();
   parent.currentTxn = this;
 }
 ActorSqlite::ImplicitTxn::~ImplicitTxn() noexcept(false) {
@@ -34,14 +111,14 @@ ActorSqlite::ImplicitTxn::~ImplicitTxn() noexcept(false) {
     //
     // This should only happen in cases of catastrophic error. Since this is rarely actually
     // executed, we don't prepare a statement for it.
-    parent.db->run("ROLLBACK TRANSACTION");
+    parent.db.run("ROLLBACK TRANSACTION");
   }
 }
 
 void ActorSqlite::ImplicitTxn::commit() {
   // Ignore redundant commit()s.
   if (!committed) {
-    parent.commitTxn.run();
+    parent.handle->commitTxn.run();
     committed = true;
   }
 }
@@ -71,7 +148,7 @@ ActorSqlite::ExplicitTxn::ExplicitTxn(ActorSqlite& actorSqlite)
   // Unfortunately this means we cannot prepare the statement, unless we prepare a series of
   // statements for each depth. (Actually, it could be reasonable to prepare statements for
   // depth 0 specifically, but I'm not going to try it for now.)
-  actorSqlite.db->run(SqliteDatabase::TRUSTED,
+  actorSqlite.db.run(SqliteDatabase::TRUSTED,
       kj::str("SAVEPOINT _cf_savepoint_", depth));
 }
 ActorSqlite::ExplicitTxn::~ExplicitTxn() noexcept(false) {
@@ -99,7 +176,7 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::ExplicitTxn::commit() {
   KJ_REQUIRE(!hasChild, "critical sections should have prevented committing transaction while "
       "nested txn is outstanding");
 
-  actorSqlite.db->run(SqliteDatabase::TRUSTED,
+  actorSqlite.db.run(SqliteDatabase::TRUSTED,
       kj::str("RELEASE _cf_savepoint_", depth));
   committed = true;
 
@@ -125,9 +202,9 @@ kj::Promise<void> ActorSqlite::ExplicitTxn::rollback() {
 }
 
 void ActorSqlite::ExplicitTxn::rollbackImpl() noexcept(false) {
-  actorSqlite.db->run(SqliteDatabase::TRUSTED,
+  actorSqlite.db.run(SqliteDatabase::TRUSTED,
       kj::str("ROLLBACK TO _cf_savepoint_", depth));
-  actorSqlite.db->run(SqliteDatabase::TRUSTED,
+  actorSqlite.db.run(SqliteDatabase::TRUSTED,
       kj::str("RELEASE _cf_savepoint_", depth));
 }
 
@@ -177,6 +254,80 @@ void ActorSqlite::requireNotBroken() {
   }
 }
 
+// =======================================================================================
+// read cache
+
+kj::Maybe<const ActorCache::SharedLru&> ActorSqlite::getReadCacheLru(bool noCache) {
+  KJ_IF_SOME(lru, readCacheLru) {
+    if (!noCache && !lru.options.noCache) {
+      return lru;
+    }
+  }
+  return kj::none;
+}
+
+kj::Maybe<ActorSqlite::CachedValue&> ActorSqlite::findCached(KeyPtr key) {
+  KJ_IF_SOME(entry, readCache.find(key)) {
+    readCacheOrder.remove(*entry);
+    readCacheOrder.add(*entry);
+    entry->isStale = false;
+    return *entry;
+  }
+  return kj::none;
+}
+
+void ActorSqlite::addCached(const ActorCache::SharedLru& lru, kj::Own<CachedValue> entry) {
+  removeCached(entry->key);
+
+  lru.size.fetch_add(entry->size(), std::memory_order_relaxed);
+  readCacheOrder.add(*entry);
+  KeyPtr key = entry->key;
+  readCache.insert(key, kj::mv(entry));
+
+  // Unlike ActorCache we can only evict our own entries, but those are also the only ones that
+  // grew the LRU. This may evict the entry just added, if it alone is over the limit.
+  while (lru.size.load(std::memory_order_relaxed) > lru.options.softLimit &&
+         !readCacheOrder.empty()) {
+    auto& victim = readCacheOrder.front();
+    releaseCached(victim);
+    readCache.erase(victim.key);
+  }
+}
+
+void ActorSqlite::removeCached(KeyPtr key) {
+  KJ_IF_SOME(entry, readCache.find(key)) {
+    releaseCached(*entry);
+    readCache.erase(key);
+  }
+}
+
+void ActorSqlite::clearReadCache() {
+  for (auto& entry: readCache) {
+    releaseCached(*entry.value);
+  }
+  readCache.clear();
+}
+
+void ActorSqlite::releaseCached(CachedValue& entry) {
+  readCacheOrder.remove(entry);
+
+  // Values handed out by get() may outlive the entry by a little, until the caller has
+  // deserialized them, but they're no longer ours to account for.
+  auto& lru = KJ_ASSERT_NONNULL(readCacheLru);
+  size_t size = entry.size();
+  size_t before = lru.size.fetch_sub(size, std::memory_order_relaxed);
+  if (KJ_UNLIKELY(before < size)) {
+    KJ_LOG(ERROR, "SharedLru size tracking inconsistency detected", before, size);
+    lru.size.store(0, std::memory_order_relaxed);
+  }
+}
+
+kj::Maybe<ActorCacheOps::Value> ActorSqlite::shareCached(CachedValue& entry) {
+  return entry.value.map([&](Value& value) -> Value {
+    return value.asPtr().attach(kj::addRef(entry));
+  });
+}
+
 // =======================================================================================
 // ActorCacheInterface implementation
 
@@ -185,10 +336,20 @@ kj::OneOf<kj::Maybe<ActorCacheOps::Value>,
     ActorSqlite::get(Key key, ReadOptions options) {
   requireNotBroken();
 
+  KJ_IF_SOME(entry, findCached(key)) {
+    return shareCached(entry);
+  }
+
   kj::Maybe<ActorCacheOps::Value> result;
   kv.get(key, [&](ValuePtr value) {
     result = kj::heapArray(value);
   });
+
+  KJ_IF_SOME(lru, getReadCacheLru(options.noCache)) {
+    auto entry = kj::refcounted<CachedValue>(kj::mv(key), kj::mv(result));
+    result = shareCached(*entry);
+    addCached(lru, kj::mv(entry));
+  }
   return result;
 }
 
@@ -196,11 +357,29 @@ kj::OneOf<ActorCacheOps::GetResultList, kj::Promise<ActorCacheOps::GetResultList
     ActorSqlite::get(kj::Array<Key> keys, ReadOptions options) {
   requireNotBroken();
 
+  auto maybeLru = getReadCacheLru(options.noCache);
   kj::Vector<KeyValuePair> results;
   for (auto& key: keys) {
+    KJ_IF_SOME(entry, findCached(key)) {
+      KJ_IF_SOME(value, shareCached(entry)) {
+        results.add(KeyValuePair { kj::mv(key), kj::mv(value) });
+      }
+      continue;
+    }
+
+    kj::Maybe<Value> result;
     kv.get(key, [&](ValuePtr value) {
-      results.add(KeyValuePair { kj::mv(key), kj::heapArray(value) });
+      result = kj::heapArray(value);
     });
+
+    KJ_IF_SOME(lru, maybeLru) {
+      auto entry = kj::refcounted<CachedValue>(kj::str(key), kj::mv(result));
+      result = shareCached(*entry);
+      addCached(lru, kj::mv(entry));
+    }
+    KJ_IF_SOME(value, result) {
+      results.add(KeyValuePair { kj::mv(key), kj::mv(value) });
+    }
   }
   std::sort(results.begin(), results.end(),
       [](auto& a, auto& b) { return a.key < b.key; });
@@ -245,6 +424,13 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::put(Key key, Value value, WriteOptions
   requireNotBroken();
 
   kv.put(key, value);
+
+  // The write is now what a read would return, so cache it rather than just dropping what we had.
+  KJ_IF_SOME(lru, getReadCacheLru(options.noCache)) {
+    addCached(lru, kj::refcounted<CachedValue>(kj::mv(key), kj::mv(value)));
+  } else if (readCacheLru != kj::none) {
+    removeCached(key);
+  }
   return kj::none;
 }
 
@@ -252,8 +438,15 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::put(
     kj::Array<KeyValuePair> pairs, WriteOptions options) {
   requireNotBroken();
 
+  auto maybeLru = getReadCacheLru(options.noCache);
   for (auto& pair: pairs) {
     kv.put(pair.key, pair.value);
+
+    KJ_IF_SOME(lru, maybeLru) {
+      addCached(lru, kj::refcounted<CachedValue>(kj::mv(pair.key), kj::mv(pair.value)));
+    } else if (readCacheLru != kj::none) {
+      removeCached(pair.key);
+    }
   }
   return kj::none;
 }
@@ -261,16 +454,29 @@ kj::Maybe<kj::Promise<void>> ActorSqlite::put(
 kj::OneOf<bool, kj::Promise<bool>> ActorSqlite::delete_(Key key, WriteOptions options) {
   requireNotBroken();
 
-  return kv.delete_(key);
+  bool deleted = kv.delete_(key);
+  KJ_IF_SOME(lru, getReadCacheLru(options.noCache)) {
+    addCached(lru, kj::refcounted<CachedValue>(kj::mv(key), kj::none));
+  } else if (readCacheLru != kj::none) {
+    removeCached(key);
+  }
+  return deleted;
 }
 
 kj::OneOf<uint, kj::Promise<uint>> ActorSqlite::delete_(
     kj::Array<Key> keys, WriteOptions options) {
   requireNotBroken();
 
+  auto maybeLru = getReadCacheLru(options.noCache);
   uint count = 0;
   for (auto& key: keys) {
     count += kv.delete_(key);
+
+    KJ_IF_SOME(lru, maybeLru) {
+      addCached(lru, kj::refcounted<CachedValue>(kj::mv(key), kj::none));
+    } else if (readCacheLru != kj::none) {
+      removeCached(key);
+    }
   }
   return count;
 }
@@ -292,6 +498,7 @@ ActorCacheInterface::DeleteAllResults ActorSqlite::deleteAll(WriteOptions option
   requireNotBroken();
 
   uint count = kv.deleteAll();
+  clearReadCache();
   return {
     .backpressure = kj::none,
     .count = count,
@@ -299,6 +506,21 @@ ActorCacheInterface::DeleteAllResults ActorSqlite::deleteAll(WriteOptions option
 }
 
 kj::Maybe<kj::Promise<void>> ActorSqlite::evictStale(kj::Date now) {
+  // Same two-pass scheme as ActorCache::evictStale(), but over our own entries only: anything not
+  // read since the previous pass goes.
+  KJ_IF_SOME(lru, readCacheLru) {
+    if (now >= nextStaleCheck) {
+      nextStaleCheck = now + lru.options.staleTimeout;
+      for (auto& entry: readCacheOrder) {
+        if (entry.isStale) {
+          removeCached(entry.key);
+        } else {
+          entry.isStale = true;
+        }
+      }
+    }
+  }
+
   // This implementation never needs to apply backpressure.
   return kj::none;
 }
@@ -329,6 +551,9 @@ void ActorSqlite::shutdown(kj::Maybe<const kj::Exception&> maybeException) {
     // but they still hold the output lock as long as `allowUnconfirmed` wasn't used.
     broken.emplace(kj::mv(exception));
 
+    // Nothing can read the cache anymore.
+    clearReadCache();
+
     // We explicitly do not schedule a flush to break the output gate. This means that if a request
     // is ongoing after the actor cache is shutting down, the output gate is only broken if they
     // had to send a flush after shutdown, either from a scheduled flush or a retry after failure.
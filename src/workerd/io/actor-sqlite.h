@@ -30,6 +30,83 @@ public:
     static Hooks DEFAULT;
   };
 
+  // The database an ActorSqlite works on, along with the KV table set up in it and the statements
+  // prepared against it. Setting these up costs more than opening the file, so they can outlive
+  // the ActorSqlite and be handed to the next one for the same database; see HandlePool.
+  struct Handle {
+    explicit Handle(kj::Own<SqliteDatabase> db);
+
+    kj::Own<SqliteDatabase> db;
+    SqliteKv kv;
+
+    SqliteDatabase::Statement beginTxn = db->prepare("BEGIN TRANSACTION");
+    SqliteDatabase::Statement commitTxn = db->prepare("COMMIT TRANSACTION");
+  };
+
+  // Keeps the Handles of destroyed ActorSqlites open for a while, so that an actor which was
+  // evicted for inactivity and then comes right back gets its old Handle rather than a new one.
+  // Handles are keyed by a name of the caller's choosing, normally the database's path, and once
+  // more than `limit` are idle the least-recently-released ones are closed.
+  //
+  // The pool must outlive every Handle it hands out, and be destroyed before the Vfs of the
+  // databases it holds. Keys only need to be unique among those databases, so a pool should only
+  // hold databases of one Vfs.
+  class HandlePool final: private kj::Disposer {
+  public:
+    // Told about the pool's activity, e.g. to record metrics.
+    class Observer {
+    public:
+      virtual ~Observer() noexcept(false) = default;
+
+      // get() returned a Handle. `reused` is true if it was an idle one, false if it had to open
+      // the database.
+      virtual void gotHandle(bool reused) {}
+
+      // An idle Handle was closed to stay within the limit.
+      virtual void evicted() {}
+    };
+
+    explicit HandlePool(uint limit, kj::Own<Observer> observer = kj::heap<Observer>())
+        : limit(limit), observer(kj::mv(observer)) {}
+    ~HandlePool() noexcept(false);
+    KJ_DISALLOW_COPY_AND_MOVE(HandlePool);
+
+    // Returns the idle Handle for `key`, or else a new one for the database returned by `open`.
+    // Dropping the Handle returns it to the pool, unless it's dropped with a transaction still
+    // open, e.g. because the actor was shut down with uncommitted writes: those must be rolled
+    // back, and closing the database is how that happens normally.
+    kj::Own<Handle> get(kj::StringPtr key, kj::FunctionParam<kj::Own<SqliteDatabase>()> open);
+
+    // Number of Handles open and waiting to be reused.
+    size_t idleCount() const { return idleOrder.size(); }
+
+  private:
+    struct Entry {
+      kj::String key;
+      kj::Own<Handle> handle;
+
+      // Links the entry into `idleOrder` while no ActorSqlite is using it.
+      kj::ListLink<Entry> link;
+    };
+
+    uint limit;
+
+    // Disposing of a Handle updates these, from a const method.
+    mutable kj::Own<Observer> observer;
+
+    // Every entry, idle or in use.
+    mutable kj::HashMap<kj::StringPtr, kj::Own<Entry>> entries;
+
+    // Entries whose Handles are out, by Handle.
+    mutable kj::HashMap<const Handle*, Entry*> inUse;
+
+    // Idle entries, least-recently-released first.
+    mutable kj::List<Entry, &Entry::link> idleOrder;
+
+    // Takes back a Handle returned by get().
+    void disposeImpl(void* pointer) const override;
+  };
+
   // Constructs ActorSqlite, arranging to honor the output gate, that is, any writes to the
   // database which occur without any `await`s in between will automatically be combined into a
   // single atomic write. This is accomplished using transactions. In addition to ensuring
@@ -39,13 +116,25 @@ public:
   // `commitCallback` will be invoked after committing a transaction. The output gate will block on
   // the returned promise. This can be used e.g. when the database needs to be replicated to other
   // machines before being considered durable.
+  //
+  // If `readCacheLru` is given, values read by get() are kept in memory so that reading the same
+  // keys again skips SQLite. The cached bytes count against the LRU's limits just like ActorCache
+  // entries do, and the cache is kept consistent with writes made through this object.
   explicit ActorSqlite(kj::Own<SqliteDatabase> dbParam, OutputGate& outputGate,
                        kj::Function<kj::Promise<void>()> commitCallback,
-                       Hooks& hooks = Hooks::DEFAULT);
+                       Hooks& hooks = Hooks::DEFAULT,
+                       kj::Maybe<const ActorCache::SharedLru&> readCacheLru = kj::none);
+
+  // Like above, but works on a Handle, which may have been used by an earlier ActorSqlite.
+  explicit ActorSqlite(kj::Own<Handle> handle, OutputGate& outputGate,
+                       kj::Function<kj::Promise<void>()> commitCallback,
+                       Hooks& hooks = Hooks::DEFAULT,
+                       kj::Maybe<const ActorCache::SharedLru&> readCacheLru = kj::none);
+  ~ActorSqlite() noexcept(false);
 
   bool isCommitScheduled() { return !currentTxn.is<NoTxn>(); }
 
-  kj::Maybe<SqliteDatabase&> getSqliteDatabase() override { return *db; }
+  kj::Maybe<SqliteDatabase&> getSqliteDatabase() override { return db; }
 
   kj::OneOf<kj::Maybe<Value>, kj::Promise<kj::Maybe<Value>>> get(
       Key key, ReadOptions options) override;
@@ -74,17 +163,46 @@ public:
   // See ActorCacheInterface
 
 private:
-  kj::Own<SqliteDatabase> db;
+  kj::Own<Handle> handle;
+  SqliteDatabase& db = *handle->db;
   OutputGate& outputGate;
   kj::Function<kj::Promise<void>()> commitCallback;
   Hooks& hooks;
-  SqliteKv kv;
-
-  SqliteDatabase::Statement beginTxn = db->prepare("BEGIN TRANSACTION");
-  SqliteDatabase::Statement commitTxn = db->prepare("COMMIT TRANSACTION");
+  SqliteKv& kv = handle->kv;
 
   kj::Maybe<kj::Exception> broken;
 
+  // A value read from (or written to) the database, or the knowledge that the key is absent.
+  // Refcounted so that get() can return the bytes without copying them.
+  struct CachedValue: public kj::Refcounted {
+    CachedValue(Key key, kj::Maybe<Value> value): key(kj::mv(key)), value(kj::mv(value)) {}
+
+    Key key;
+    kj::Maybe<Value> value;
+
+    // Set by each evictStale() pass and cleared by reads; see ActorCache::Entry::isStale.
+    bool isStale = false;
+
+    kj::ListLink<CachedValue> link;
+
+    size_t size() const {
+      size_t result = sizeof(*this) + key.size();
+      KJ_IF_SOME(v, value) {
+        result += v.size();
+      }
+      return result;
+    }
+  };
+
+  kj::Maybe<const ActorCache::SharedLru&> readCacheLru;
+  kj::HashMap<KeyPtr, kj::Own<CachedValue>> readCache;
+
+  // All of `readCache`, ordered from least-recently-used to most-recently-used.
+  kj::List<CachedValue, &CachedValue::link> readCacheOrder;
+
+  // When evictStale() should next look for entries that haven't been read since the last pass.
+  kj::Date nextStaleCheck = kj::UNIX_EPOCH;
+
   struct NoTxn {};
 
   class ImplicitTxn {
@@ -156,6 +274,24 @@ private:
   void taskFailed(kj::Exception&& exception) override;
 
   void requireNotBroken();
+
+  // Returns the LRU whose limits the read cache obeys, or kj::none if `noCache` means the cache
+  // shouldn't be used.
+  kj::Maybe<const ActorCache::SharedLru&> getReadCacheLru(bool noCache);
+
+  // Looks up `key` in the read cache, marking it as most-recently-used.
+  kj::Maybe<CachedValue&> findCached(KeyPtr key);
+
+  // Adds `entry` to the read cache, replacing any entry for the same key, then evicts the
+  // least-recently-used entries until the LRU is back under its soft limit.
+  void addCached(const ActorCache::SharedLru& lru, kj::Own<CachedValue> entry);
+
+  void removeCached(KeyPtr key);
+  void clearReadCache();
+  void releaseCached(CachedValue& entry);
+
+  // Returns the cached value without copying it.
+  static kj::Maybe<Value> shareCached(CachedValue& entry);
 };
 
 }  // namespace workerd
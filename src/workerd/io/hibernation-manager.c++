@@ -74,6 +74,22 @@ jsg::Ref<api::WebSocket> HibernationManagerImpl::HibernatableWebSocket::getActiv
   return activeOrPackage.get<jsg::Ref<api::WebSocket>>().addRef();
 }
 
+kj::Promise<void> HibernationManagerImpl::HibernatableWebSocket::queueSend(
+    kj::Maybe<kj::Promise<void>> outputLock,
+    kj::Function<kj::Promise<void>(kj::WebSocket&)> send) {
+  auto& socket = *KJ_REQUIRE_NONNULL(ws);
+  auto promise = kj::mv(autoResponsePromise);
+  KJ_IF_SOME(lock, outputLock) {
+    promise = kj::joinPromises(kj::arr(kj::mv(promise), kj::mv(lock)));
+  }
+  // kj::WebSocket only allows one send at a time, so each send is chained onto the last one.
+  auto fork = promise.then([&socket, send = kj::mv(send)]() mutable {
+    return send(socket);
+  }).fork();
+  autoResponsePromise = fork.addBranch();
+  return fork.addBranch();
+}
+
 HibernationManagerImpl::HibernationManagerImpl(
     kj::Own<Worker::Actor::Loopback> loopback,
     uint16_t hibernationEventType)
@@ -181,6 +197,88 @@ kj::Vector<jsg::Ref<api::WebSocket>> HibernationManagerImpl::getWebSockets(
   return kj::mv(matches);
 }
 
+namespace {
+
+// The one copy of a broadcast message shared by every hibernating websocket it's sent to.
+struct BroadcastMessage: public kj::Refcounted {
+  kj::OneOf<kj::Array<byte>, kj::String> content;
+
+  explicit BroadcastMessage(kj::OneOf<kj::Array<byte>, kj::String> content)
+      : content(kj::mv(content)) {}
+
+  kj::Promise<void> sendTo(kj::WebSocket& ws) {
+    KJ_SWITCH_ONEOF(content) {
+      KJ_CASE_ONEOF(data, kj::Array<byte>) {
+        return ws.send(data).attach(kj::addRef(*this));
+      }
+      KJ_CASE_ONEOF(text, kj::String) {
+        return ws.send(text).attach(kj::addRef(*this));
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+
+  kj::OneOf<kj::Array<byte>, kj::String> clone() {
+    KJ_SWITCH_ONEOF(content) {
+      KJ_CASE_ONEOF(data, kj::Array<byte>) {
+        return kj::heapArray<byte>(data);
+      }
+      KJ_CASE_ONEOF(text, kj::String) {
+        return kj::str(text);
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+};
+
+}  // namespace
+
+uint HibernationManagerImpl::broadcast(
+    jsg::Lock& js,
+    kj::OneOf<kj::Array<byte>, kj::String> message,
+    kj::Maybe<kj::StringPtr> maybeTag) {
+  auto shared = kj::refcounted<BroadcastMessage>(kj::mv(message));
+  auto& context = IoContext::current();
+  uint count = 0;
+
+  auto sendTo = [&](HibernatableWebSocket& hib) {
+    KJ_SWITCH_ONEOF(hib.activeOrPackage) {
+      KJ_CASE_ONEOF(apiWs, jsg::Ref<api::WebSocket>) {
+        // The api::WebSocket has its own queue of outgoing messages, which we must not bypass.
+        if (apiWs->hasClosedOutgoing()) {
+          return;
+        }
+        apiWs->send(js, shared->clone());
+      }
+      KJ_CASE_ONEOF(package, api::WebSocket::HibernationPackage) {
+        if (package.closedOutgoingConnection || hib.ws == kj::none) {
+          return;
+        }
+        // We don't wait for the send, which stays queued on `hib`. If it fails, the readLoop will
+        // notice and handle the socket's termination.
+        auto sent KJ_UNUSED = hib.queueSend(context.waitForOutputLocksIfNecessary(),
+            [message = kj::addRef(*shared)](kj::WebSocket& ws) mutable {
+          return message->sendTo(ws);
+        });
+      }
+    }
+    ++count;
+  };
+
+  KJ_IF_SOME(tag, maybeTag) {
+    KJ_IF_SOME(item, tagToWs.find(tag)) {
+      for (auto& entry: *item->list) {
+        sendTo(KJ_REQUIRE_NONNULL(entry.hibWS));
+      }
+    }
+  } else {
+    for (auto& hibWS: allWs) {
+      sendTo(*hibWS);
+    }
+  }
+  return count;
+}
+
 void HibernationManagerImpl::setWebSocketAutoResponse(
     kj::Maybe<kj::StringPtr> request, kj::Maybe<kj::StringPtr> response) {
   KJ_IF_SOME(req, request) {
@@ -320,11 +418,12 @@ kj::Promise<void> HibernationManagerImpl::readLoop(HibernatableWebSocket& hib) {
                   // If we do that, we have to provide it with the promise to avoid races. This can
                   // happen if we have a websocket hibernating, that unhibernates and sends a
                   // message while ws.send() for auto-response is also sending.
-                  auto p = ws.send(
-                      KJ_REQUIRE_NONNULL(autoResponsePair->response).asArray()).fork();
-                  hib.autoResponsePromise = p.addBranch();
-                  co_await p;
-                  hib.autoResponsePromise = kj::READY_NOW;
+                  co_await hib.queueSend(kj::none,
+                      [response = kj::str(KJ_REQUIRE_NONNULL(autoResponsePair->response))]
+                      (kj::WebSocket& ws) mutable {
+                    auto promise = ws.send(response.asArray());
+                    return promise.attach(kj::mv(response));
+                  });
                 }
               }
             }
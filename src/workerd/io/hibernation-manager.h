@@ -31,6 +31,15 @@ public:
       jsg::Lock& js,
       kj::Maybe<kj::StringPtr> tag) override;
 
+  // Sends `message` to every websocket associated with the given tag, or to all accepted
+  // websockets if no tag is provided, and returns how many it was sent to. Unlike
+  // `getWebSockets()`, this does not wake hibernating websockets: their copy of the message is
+  // written straight to the kj::WebSocket, behind the actor's output gate, and all of them share
+  // one buffer. Websockets that have been closed are skipped.
+  uint broadcast(jsg::Lock& js,
+      kj::OneOf<kj::Array<byte>, kj::String> message,
+      kj::Maybe<kj::StringPtr> tag) override;
+
   // Hibernates all the websockets held by the HibernationManager.
   // This converts our activeOrPackage from an api::WebSocket to a HibernationPackage.
   void hibernateWebSockets(Worker::Lock& lock) override;
@@ -98,6 +107,12 @@ private:
     // to the api::WebSocket.
     jsg::Ref<api::WebSocket> getActiveOrUnhibernate(jsg::Lock& js);
 
+    // Sends a message on `ws` while we're hibernating, once every send queued before it has
+    // completed and `outputLock` (if any) has resolved. The returned promise resolves once this
+    // message is sent, but the send goes ahead even if it is dropped.
+    kj::Promise<void> queueSend(kj::Maybe<kj::Promise<void>> outputLock,
+        kj::Function<kj::Promise<void>(kj::WebSocket&)> send);
+
     kj::ListLink<HibernatableWebSocket> link;
 
     // An array of all the items/nodes that refer to this HibernatableWebSocket.
@@ -132,8 +147,9 @@ private:
     // Stores the last received autoResponseRequest timestamp.
     kj::Maybe<kj::Date> autoResponseTimestamp;
 
-    // Keeps track of the currently ongoing websocket auto-response send promise. This promise may
-    // be moved to api::websocket if an hibernating websocket unhibernates.
+    // Keeps track of the sends (auto-responses and broadcasts) queued by `queueSend()` while we're
+    // hibernating. This promise may be moved to api::websocket if an hibernating websocket
+    // unhibernates.
     kj::Promise<void> autoResponsePromise = kj::READY_NOW;
 
     friend HibernationManagerImpl;
@@ -1038,6 +1038,7 @@ void IoContext::runImpl(Runnable& runnable, bool takePendingEvent,
     }
 
     auto limiterScope = limitEnforcer->enterJs(workerLock, *this);
+    auto profilerScope = workerLock.enterSampledRequest(this);
 
     bool gotTermination = false;
 
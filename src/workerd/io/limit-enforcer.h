@@ -6,6 +6,7 @@
 
 #include <workerd/jsg/jsg.h>
 #include <workerd/io/observer.h>
+#include <kj/filesystem.h>
 
 namespace workerd {
 
@@ -136,6 +137,19 @@ public:
   // data in C++ memory, such as reading an entire HTTP response into an `ArrayBuffer`.
   virtual size_t getBufferingLimit() = 0;
 
+  struct TeeSpillOptions {
+    // Bytes a tee may buffer in memory for a lagging branch before spilling to disk.
+    size_t memoryLimit;
+
+    // Directory in which to create the temporary files to spill to. Must outlive the request.
+    const kj::Directory& directory;
+  };
+
+  // If this returns non-null, then when a stream is tee'd, e.g. by `Response.clone()`, and one
+  // branch is read more slowly than the other, the data buffered for the slower branch may be
+  // spilled to disk, rather than held in memory up to getBufferingLimit().
+  virtual kj::Maybe<TeeSpillOptions> getTeeSpillOptions() { return kj::none; }
+
   // If a limit has been exceeded which prevents further JavaScript execution, such as the CPU or
   // memory limit, returns a request status code indicating which one. Returns null if no limits
   // are exceeded.
@@ -151,6 +165,11 @@ public:
 
   // Report resource usage metrics to the given request metrics object.
   virtual void reportMetrics(RequestObserver& requestMetrics) = 0;
+
+  // Called when work done on behalf of this request ran on another thread, outside of any
+  // `enterJs()` scope (e.g. crypto kernels offloaded to a thread pool), so that its CPU time can
+  // still be accounted against the request.
+  virtual void reportOffloadedCpuTime(kj::Duration time) {}
 };
 
 }  // namespace workerd
@@ -0,0 +1,61 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/io/sampling-profiler.h>
+
+#if defined(WORKERD_USE_PERFETTO)
+
+#include <workerd/jsg/jsg-test.h>
+#include <unistd.h>
+
+namespace workerd {
+namespace {
+
+jsg::V8System v8System;
+
+struct ProfilerContext: public jsg::Object, public jsg::ContextGlobal {
+  JSG_RESOURCE_TYPE(ProfilerContext) {}
+};
+JSG_DECLARE_ISOLATE_TYPE(ProfilerIsolate, ProfilerContext);
+
+template <typename Func>
+void withContext(Func&& func) {
+  ProfilerIsolate isolate(v8System, kj::heap<jsg::IsolateObserver>());
+  isolate.runInLockScope([&](ProfilerIsolate::Lock& lock) {
+    JSG_WITHIN_CONTEXT_SCOPE(lock,
+        lock.newContext<ProfilerContext>().getHandle(lock.v8Isolate),
+        [&](jsg::Lock& js) { func(js); });
+  });
+}
+
+void spin(jsg::Lock& js, uint milliseconds) {
+  auto code = kj::str("const end = Date.now() + ", milliseconds, "; while (Date.now() < end) {}");
+  auto script = jsg::check(v8::Script::Compile(js.v8Context(), jsg::v8Str(js.v8Isolate, code)));
+  jsg::check(script->Run(js.v8Context()));
+}
+
+KJ_TEST("SamplingProfiler keeps at most maxCpuSamples samples between flushes") {
+  withContext([](jsg::Lock& js) {
+    SamplingProfiler profiler(js.v8Isolate, 10);
+    spin(js, 200);
+    KJ_EXPECT(profiler.flush() == 10);
+  });
+}
+
+KJ_TEST("SamplingProfiler drops samples taken while idle when a request enters") {
+  withContext([](jsg::Lock& js) {
+    SamplingProfiler profiler(js.v8Isolate);
+    usleep(300 * 1000);
+
+    // Entering restarts the profile, since it's older than FLUSH_INTERVAL, and leaving right
+    // away doesn't flush again.
+    profiler.enter(&profiler);
+    KJ_EXPECT(profiler.flush() < 50);
+  });
+}
+
+}  // namespace
+}  // namespace workerd
+
+#endif  // defined(WORKERD_USE_PERFETTO)
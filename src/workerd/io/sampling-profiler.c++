@@ -0,0 +1,169 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "sampling-profiler.h"
+
+#if defined(WORKERD_USE_PERFETTO)
+
+#include <workerd/jsg/util.h>
+#include <workerd/util/use-perfetto-categories.h>
+#include <kj/map.h>
+#include <algorithm>
+
+namespace workerd {
+
+namespace {
+
+kj::TimePoint now() {
+  return kj::systemPreciseMonotonicClock().now();
+}
+
+perfetto::TraceTimestamp toTraceTimestamp(kj::TimePoint time) {
+  // kj's precise monotonic clock is CLOCK_MONOTONIC.
+  return perfetto::TraceTimestamp {
+    perfetto::protos::pbzero::BUILTIN_CLOCK_MONOTONIC,
+    static_cast<uint64_t>((time - kj::origin<kj::TimePoint>()) / kj::NANOSECONDS),
+  };
+}
+
+}  // namespace
+
+SamplingProfiler::SamplingProfiler(v8::Isolate* isolate, uint maxCpuSamples)
+    : isolate(isolate),
+      // Eager logging, because we restart the profile on every flush and lazy logging would
+      // re-log all code each time.
+      cpuProfiler(v8::CpuProfiler::New(isolate, v8::kDebugNaming, v8::kEagerLogging)),
+      maxCpuSamples(maxCpuSamples) {
+  cpuProfiler->SetSamplingInterval(CPU_SAMPLING_INTERVAL / kj::MICROSECONDS);
+  start();
+}
+
+SamplingProfiler::~SamplingProfiler() noexcept(false) {
+  v8::HandleScope scope(isolate);
+  auto profile = cpuProfiler->StopProfiling(name());
+  if (profile != nullptr) profile->Delete();
+  isolate->GetHeapProfiler()->StopSamplingHeapProfiler();
+  cpuProfiler->Dispose();
+}
+
+kj::Own<void> SamplingProfiler::enter(const void* tag) {
+  // Drop whatever was sampled while the isolate sat idle, so that it doesn't use up the sample
+  // limit before this request has run.
+  if (now() - profileStart >= FLUSH_INTERVAL) {
+    flush();
+  }
+
+  current = Interval { .tag = tag, .start = now(), .end = kj::origin<kj::TimePoint>() };
+  return kj::heap(kj::defer([this]() {
+    KJ_IF_SOME(c, current) {
+      c.end = now();
+      intervals.add(c);
+      current = kj::none;
+    }
+    if (now() - profileStart >= FLUSH_INTERVAL) {
+      flush();
+    }
+  }));
+}
+
+uint SamplingProfiler::flush() {
+  v8::HandleScope scope(isolate);
+  auto samples = emitCpuSamples();
+  emitHeapSamples();
+  intervals.clear();
+  start();
+  return samples;
+}
+
+v8::Local<v8::String> SamplingProfiler::name() {
+  return jsg::v8StrIntern(isolate, "workerd sampling profile"_kj);
+}
+
+void SamplingProfiler::start() {
+  v8::HandleScope scope(isolate);
+  cpuProfiler->StartProfiling(name(), v8::CpuProfilingOptions(
+      v8::kLeafNodeLineNumbers, maxCpuSamples));
+  isolate->GetHeapProfiler()->StartSamplingHeapProfiler(HEAP_SAMPLING_INTERVAL,
+      HEAP_SAMPLING_STACK_DEPTH,
+      static_cast<v8::HeapProfiler::SamplingFlags>(
+          v8::HeapProfiler::kSamplingIncludeObjectsCollectedByMajorGC |
+          v8::HeapProfiler::kSamplingIncludeObjectsCollectedByMinorGC));
+  profileStart = now();
+}
+
+uint SamplingProfiler::emitCpuSamples() {
+  auto profile = cpuProfiler->StopProfiling(name());
+  if (profile == nullptr) return 0;
+  KJ_DEFER(profile->Delete());
+
+  // V8 timestamps samples in microseconds on its own clock; anchor them to ours using the time
+  // we started the profile.
+  auto v8Start = profile->GetStartTime();
+  size_t next = 0;
+  for (int i = 0; i < profile->GetSamplesCount() && next < intervals.size(); i++) {
+    auto when = profileStart + (profile->GetSampleTimestamp(i) - v8Start) * kj::MICROSECONDS;
+    while (next < intervals.size() && intervals[next].end < when) ++next;
+    if (next == intervals.size() || when < intervals[next].start) {
+      // Not running JS for any request (idle, or running JS outside of an IoContext).
+      continue;
+    }
+
+    auto node = profile->GetSample(i);
+    TRACE_EVENT_INSTANT("workerd.profile", "JS sample",
+        PERFETTO_TRACK_FROM_POINTER(intervals[next].tag), toTraceTimestamp(when),
+        "function", node->GetFunctionNameStr(),
+        "url", node->GetScriptResourceNameStr(),
+        "line", node->GetLineNumber());
+  }
+  return profile->GetSamplesCount();
+}
+
+void SamplingProfiler::emitHeapSamples() {
+  auto heapProfiler = isolate->GetHeapProfiler();
+  std::unique_ptr<v8::AllocationProfile> profile(heapProfiler->GetAllocationProfile());
+  heapProfiler->StopSamplingHeapProfiler();
+  if (profile == nullptr) return;
+
+  kj::HashMap<uint32_t, size_t> bytesByNode;
+  size_t totalBytes = 0;
+  for (auto& sample: profile->GetSamples()) {
+    auto bytes = sample.size * sample.count;
+    bytesByNode.upsert(sample.node_id, bytes, [](size_t& existing, size_t&& added) {
+      existing += added;
+    });
+    totalBytes += bytes;
+  }
+
+  auto isolateTrack = PERFETTO_TRACK_FROM_POINTER(this);
+  TRACE_COUNTER("workerd.profile",
+      perfetto::CounterTrack("JS sampled allocation bytes", isolateTrack), totalBytes);
+  if (bytesByNode.size() == 0) return;
+
+  auto track = isolateTrack;
+  if (intervals.size() > 0 && std::all_of(intervals.begin(), intervals.end(),
+      [&](const Interval& i) { return i.tag == intervals[0].tag; })) {
+    track = PERFETTO_TRACK_FROM_POINTER(intervals[0].tag);
+  }
+
+  kj::Vector<v8::AllocationProfile::Node*> unvisited;
+  unvisited.add(profile->GetRootNode());
+  while (!unvisited.empty()) {
+    auto node = unvisited.back();
+    unvisited.removeLast();
+    for (auto child: node->children) {
+      unvisited.add(child);
+    }
+
+    KJ_IF_SOME(bytes, bytesByNode.find(node->node_id)) {
+      v8::String::Utf8Value function(isolate, node->name);
+      v8::String::Utf8Value url(isolate, node->script_name);
+      TRACE_EVENT_INSTANT("workerd.profile", "JS allocations", track,
+          "function", *function, "url", *url, "line", node->line_number, "bytes", bytes);
+    }
+  }
+}
+
+}  // namespace workerd
+
+#endif  // defined(WORKERD_USE_PERFETTO)
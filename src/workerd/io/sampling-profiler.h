@@ -0,0 +1,80 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/util/perfetto-tracing.h>
+
+#if defined(WORKERD_USE_PERFETTO)
+
+#include <kj/time.h>
+#include <kj/vector.h>
+#include <v8-profiler.h>
+
+namespace workerd {
+
+// Optional per-isolate sampling profiler which writes V8 CPU samples and heap allocation samples
+// into the Perfetto trace. It is turned on for isolates created while the "workerd.profile"
+// category is enabled, e.g.:
+//
+//     workerd serve config.capnp --perfetto-trace=out.pftrace=workerd,workerd.profile
+//
+// CPU samples are attributed to the IoContext that was running JS when the sample was taken, and
+// are emitted on that IoContext's track -- the same track WorkerEntrypoint uses for its request
+// events -- so they line up with the request in the Perfetto UI. V8 does not timestamp heap
+// samples, so allocations are attributed to a request only if it was the only one to run JS
+// since the previous flush; otherwise they go to the isolate's own track.
+//
+// Samples are flushed on the way out of a request once the profile is FLUSH_INTERVAL old. V8
+// keeps taking CPU samples while the isolate is idle, so a profile that has been open since
+// before the isolate went idle is also restarted on the way in, and V8 is told to keep at most
+// `maxCpuSamples` samples, which bounds what an isolate that never sees another request holds.
+//
+// All methods must be called with the isolate lock held.
+class SamplingProfiler {
+public:
+  static constexpr kj::Duration CPU_SAMPLING_INTERVAL = 1 * kj::MILLISECONDS;
+  static constexpr kj::Duration FLUSH_INTERVAL = 100 * kj::MILLISECONDS;
+
+  // Enough for 10 seconds of samples, e.g. for a request that runs JS that long without a break.
+  static constexpr uint DEFAULT_MAX_CPU_SAMPLES = 10000;
+
+  explicit SamplingProfiler(v8::Isolate* isolate, uint maxCpuSamples = DEFAULT_MAX_CPU_SAMPLES);
+  ~SamplingProfiler() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(SamplingProfiler);
+
+  // Marks the start of a period during which JS runs on behalf of `tag` (an IoContext). The
+  // period ends when the returned object is destroyed, which must happen under the same lock.
+  kj::Own<void> enter(const void* tag);
+
+  // Writes the samples taken since the last flush to the trace and restarts profiling. Returns
+  // the number of CPU samples the profile held, including those not attributed to any request.
+  uint flush();
+
+private:
+  static constexpr uint64_t HEAP_SAMPLING_INTERVAL = 64 * 1024;
+  static constexpr int HEAP_SAMPLING_STACK_DEPTH = 16;
+
+  struct Interval {
+    const void* tag;
+    kj::TimePoint start;
+    kj::TimePoint end;
+  };
+
+  v8::Isolate* isolate;
+  v8::CpuProfiler* cpuProfiler;
+  uint maxCpuSamples;
+  kj::TimePoint profileStart = kj::origin<kj::TimePoint>();
+  kj::Maybe<Interval> current;
+  kj::Vector<Interval> intervals;
+
+  v8::Local<v8::String> name();
+  void start();
+  uint emitCpuSamples();
+  void emitHeapSamples();
+};
+
+}  // namespace workerd
+
+#endif  // defined(WORKERD_USE_PERFETTO)
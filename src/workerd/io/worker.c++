@@ -5,13 +5,16 @@
 #include <cstdint>
 #include <workerd/io/worker.h>
 #include <workerd/io/promise-wrapper.h>
+#include <workerd/io/sampling-profiler.h>
 #include "actor-cache.h"
 #include <workerd/util/batch-queue.h>
 #include <workerd/util/color-util.h>
 #include <workerd/util/mimetype.h>
 #include <workerd/util/stream-utils.h>
 #include <workerd/util/thread-scopes.h>
+#include <workerd/util/use-perfetto-categories.h>
 #include <workerd/util/xthreadnotifier.h>
+#include <workerd/util/zstd.h>
 #include <workerd/api/actor-state.h>
 #include <workerd/api/global-scope.h>
 #include <workerd/api/sockets.h>
@@ -33,6 +36,7 @@
 #include <kj/map.h>
 #include <v8-inspector.h>
 #include <v8-profiler.h>
+#include <algorithm>
 #include <map>
 #include <time.h>
 #include <numeric>
@@ -491,6 +495,9 @@ struct Worker::Isolate::Impl {
   kj::Maybe<std::unique_ptr<v8_inspector::V8Inspector>> inspector;
   InspectorPolicy inspectorPolicy;
   kj::Maybe<kj::Own<v8::CpuProfiler>> profiler;
+#if defined(WORKERD_USE_PERFETTO)
+  kj::Maybe<kj::Own<SamplingProfiler>> samplingProfiler;
+#endif
   ActorCache::SharedLru actorCacheLru;
 
   // Notification messages to deliver to the next inspector client when it connects.
@@ -1060,6 +1067,12 @@ Worker::Isolate::Isolate(kj::Own<Api> apiParam,
     // as well just throw the switch to "moderate" right away.
     lock->v8Isolate->MemoryPressureNotification(v8::MemoryPressureLevel::kModerate);
 
+#if defined(WORKERD_USE_PERFETTO)
+    if (TRACE_EVENT_CATEGORY_ENABLED("workerd.profile")) {
+      impl->samplingProfiler = kj::heap<SamplingProfiler>(lock->v8Isolate);
+    }
+#endif
+
     // Register GC prologue and epilogue callbacks so that we can report GC CPU time via the
     // "request_context" Jaeger span.
     lock->v8Isolate->AddGCPrologueCallback(
@@ -1304,6 +1317,9 @@ Worker::Isolate::~Isolate() noexcept(false) {
     metrics->teardownLockAcquired();
     auto inspector = kj::mv(impl->inspector);
     auto dropTraceAsyncContextKey = kj::mv(traceAsyncContextKey);
+#if defined(WORKERD_USE_PERFETTO)
+    auto dropSamplingProfiler = kj::mv(impl->samplingProfiler);
+#endif
   });
 }
 
@@ -1867,6 +1883,15 @@ bool Worker::Lock::isInspectorEnabled() {
   return worker.script->isolate->impl->inspector != kj::none;
 }
 
+kj::Own<void> Worker::Lock::enterSampledRequest(const void* tag) {
+#if defined(WORKERD_USE_PERFETTO)
+  KJ_IF_SOME(profiler, worker.script->isolate->impl->samplingProfiler) {
+    return profiler->enter(tag);
+  }
+#endif
+  return nullptr;
+}
+
 void Worker::Lock::logWarning(kj::StringPtr description) {
   // const_cast OK because we are a lock on this isolate.
   const_cast<Isolate&>(worker.getIsolate()).logWarning(description, *this);
@@ -3632,6 +3657,8 @@ public:
     } else if (encoding == api::StreamEncoding::BROTLI) {
       compStream.emplace().init<kj::BrotliOutputStream>(decodedBuf,
           kj::BrotliOutputStream::DECOMPRESS);
+    } else if (encoding == api::StreamEncoding::ZSTD) {
+      compStream.emplace().init<ZstdOutputStream>(decodedBuf, ZstdOutputStream::DECOMPRESS);
     }
   }
 
@@ -3694,6 +3721,12 @@ public:
           brotli.write(buffer);
           brotli.flush();
         }
+        KJ_CASE_ONEOF(zstd, ZstdOutputStream) {
+          KJ_ON_SCOPE_FAILURE(decodedBuf.reset());
+
+          zstd.write(buffer);
+          zstd.flush();
+        }
       }
     } else {
       decodedBuf.write(buffer);
@@ -3735,7 +3768,7 @@ private:
   kj::Own<kj::AsyncOutputStream> inner;
   size_t rawSize = 0;
   LimitedBodyWrapper decodedBuf;
-  kj::Maybe<kj::OneOf<kj::GzipOutputStream, kj::BrotliOutputStream>> compStream;
+  kj::Maybe<kj::OneOf<kj::GzipOutputStream, kj::BrotliOutputStream, ZstdOutputStream>> compStream;
   RequestObserver& requestMetrics;
 };
 
@@ -3889,6 +3922,8 @@ kj::Promise<void> Worker::Isolate::SubrequestClient::request(
         encoding = api::StreamEncoding::GZIP;
       } else if (encodingStr == "br") {
         encoding = api::StreamEncoding::BROTLI;
+      } else if (encodingStr == "zstd") {
+        encoding = api::StreamEncoding::ZSTD;
       }
     }
 
@@ -526,6 +526,12 @@ public:
   v8::Local<v8::Context> getContext();
 
   bool isInspectorEnabled();
+
+  // If the isolate's sampling profiler is running (see the "workerd.profile" Perfetto category),
+  // attributes JS samples taken until the returned object is dropped to the request identified
+  // by `tag`. Returns null if the profiler isn't running. Must be dropped under this lock.
+  kj::Own<void> enterSampledRequest(const void* tag);
+
   void logWarning(kj::StringPtr description);
   void logWarningOnce(kj::StringPtr description);
 
@@ -664,6 +670,9 @@ public:
     virtual kj::Vector<jsg::Ref<api::WebSocket>> getWebSockets(
         jsg::Lock& js,
         kj::Maybe<kj::StringPtr> tag) = 0;
+    virtual uint broadcast(jsg::Lock& js,
+        kj::OneOf<kj::Array<byte>, kj::String> message,
+        kj::Maybe<kj::StringPtr> tag) = 0;
     virtual void hibernateWebSockets(Worker::Lock& lock) = 0;
     virtual void setWebSocketAutoResponse(kj::Maybe<kj::StringPtr> request,
         kj::Maybe<kj::StringPtr> response) = 0;
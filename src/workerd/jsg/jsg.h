@@ -190,6 +190,26 @@ namespace workerd::jsg {
     registry.template registerMethod<NAME, decltype(&Self::name), &Self::name>(); \
   } while (false)
 
+// Like JSG_METHOD, but additionally gives V8 a "fast API call" path for the method, which
+// optimized code can call directly without going through the usual argument unwrapping. Use this
+// for hot, trivial methods such as `performance.now()`.
+//
+// The fast path is only generated when the method's signature allows it: parameters must be
+// `bool`, `int32_t`, `uint32_t`, `float`, `double` or `kj::Array<kj::byte>` (which only matches
+// Uint8Arrays), and the return type must be `void` or one of the primitive types. The method
+// can't take `Lock&` and can't be on a context global. Otherwise this behaves exactly like
+// JSG_METHOD.
+//
+// IMPORTANT: A method declared with JSG_FAST_METHOD must not throw, call into JavaScript, or
+// allocate on the JS heap, since the fast path runs with none of those allowed. (V8 still uses
+// the regular path for unoptimized code and for arguments of other types, so the method must also
+// behave identically either way.)
+#define JSG_FAST_METHOD(name) \
+  do { \
+    static const char NAME[] = #name; \
+    registry.template registerFastMethod<NAME, decltype(&Self::name), &Self::name>(); \
+  } while (false)
+
 // Like JSG_METHOD but allows you to specify a different name to use in JavaScript. This is
 // particularly useful when a JavaScript API wants to use a name that is a keyword in C++. For
 // example:
@@ -633,6 +633,66 @@ KJ_TEST("Methods can take Lock& as first parameter") {
 
 // ========================================================================================
 
+struct FastMethodContext: public ContextGlobalObject {
+  struct Counter: public Object {
+    static Ref<Counter> constructor() { return alloc<Counter>(); }
+
+    int32_t add(int32_t a, int32_t b) { return a + b; }
+    double scale(double value) { return value * factor; }
+    void setFactor(double value) { factor = value; }
+    uint32_t sum(kj::Array<kj::byte> bytes) {
+      uint32_t result = 0;
+      for (auto b: bytes) result += b;
+      return result;
+    }
+    // Not eligible for a fast path; registered like a regular method.
+    kj::String describe() { return kj::str("factor=", factor); }
+
+    double factor = 1;
+
+    JSG_RESOURCE_TYPE(Counter) {
+      JSG_FAST_METHOD(add);
+      JSG_FAST_METHOD(scale);
+      JSG_FAST_METHOD(setFactor);
+      JSG_FAST_METHOD(sum);
+      JSG_FAST_METHOD(describe);
+    }
+  };
+
+  JSG_RESOURCE_TYPE(FastMethodContext) {
+    JSG_NESTED_TYPE(Counter);
+  }
+};
+JSG_DECLARE_ISOLATE_TYPE(FastMethodIsolate, FastMethodContext, FastMethodContext::Counter);
+
+using Counter = FastMethodContext::Counter;
+static_assert(FastMethodCallback<false, Counter, decltype(&Counter::add), &Counter::add>::supported);
+static_assert(FastMethodCallback<false, Counter, decltype(&Counter::sum), &Counter::sum>::supported);
+static_assert(!FastMethodCallback<false, Counter,
+    decltype(&Counter::describe), &Counter::describe>::supported);
+static_assert(!FastMethodCallback<true, Counter, decltype(&Counter::add), &Counter::add>::supported);
+
+KJ_TEST("JSG_FAST_METHODs behave like regular methods") {
+  Evaluator<FastMethodContext, FastMethodIsolate> e(v8System);
+  // Run enough iterations for the call sites to get optimized, so both paths are exercised.
+  e.expectEval(
+      "var c = new Counter();\n"
+      "var total = 0;\n"
+      "for (var i = 0; i < 100000; i++) total += c.add(i & 7, 1);\n"
+      "total", "number", "450000");
+  e.expectEval(
+      "var c = new Counter();\n"
+      "c.setFactor(2);\n"
+      "var bytes = new Uint8Array([1, 2, 3]);\n"
+      "var total = 0;\n"
+      "for (var i = 0; i < 100000; i++) total += c.scale(c.sum(bytes));\n"
+      "total + ' ' + c.describe() + ' ' + c.sum(bytes.buffer)", "string", "1200000 factor=2 6");
+  e.expectEval(
+      "new Counter().add.call({}, 1, 2)", "throws", kIllegalInvocation);
+}
+
+// ========================================================================================
+
 struct JsBundleContext: public ContextGlobalObject {
   JSG_RESOURCE_TYPE(JsBundleContext) {
     JSG_CONTEXT_JS_BUNDLE(BUILTIN_BUNDLE);
@@ -14,6 +14,7 @@
 #include <kj/debug.h>
 #include <type_traits>
 #include <kj/map.h>
+#include <v8-fast-api-calls.h>
 #include "util.h"
 #include "wrappable.h"
 #include <typeindex>
@@ -270,6 +271,83 @@ struct MethodCallback<TypeWrapper, methodName, isContext,
   }
 };
 
+// Support for V8 "fast API calls", used by JSG_FAST_METHOD.
+//
+// When TurboFan optimizes a call site to a function that has a fast path, and it can prove that
+// the receiver matches the function's signature and that the arguments have the expected
+// primitive / typed array types, it calls a plain C function directly instead of going through
+// the FunctionCallbackInfo machinery. The fast path can't allocate on the JS heap, can't throw,
+// and can't re-enter JavaScript, so only methods with a narrow set of parameter and return types
+// qualify.
+
+// Maps a parameter type of a C++ method to the type V8 passes to a fast callback for it. The
+// primary template marks the type as unsupported; `Type` only exists so that signatures can still
+// be spelled out.
+template <typename T>
+struct FastApiArg {
+  static constexpr bool supported = false;
+  using Type = v8::Local<v8::Value>;
+};
+
+template <typename T>
+struct FastApiPrimitiveArg {
+  static constexpr bool supported = true;
+  using Type = T;
+  static T unwrap(T value) { return value; }
+};
+
+template <> struct FastApiArg<bool>: public FastApiPrimitiveArg<bool> {};
+template <> struct FastApiArg<int32_t>: public FastApiPrimitiveArg<int32_t> {};
+template <> struct FastApiArg<uint32_t>: public FastApiPrimitiveArg<uint32_t> {};
+template <> struct FastApiArg<float>: public FastApiPrimitiveArg<float> {};
+template <> struct FastApiArg<double>: public FastApiPrimitiveArg<double> {};
+
+// Byte arrays are passed as a borrowed view of the Uint8Array's storage. That's safe because
+// nothing can run GC or detach the buffer during a fast call. Other kinds of buffer (ArrayBuffer,
+// DataView, other typed arrays) don't match the fast signature and take the regular path.
+template <>
+struct FastApiArg<kj::Array<kj::byte>> {
+  static constexpr bool supported = true;
+  using Type = const v8::FastApiTypedArray<uint8_t>&;
+  static kj::Array<kj::byte> unwrap(Type array) {
+    uint8_t* data = nullptr;
+    // Byte-sized elements are always aligned.
+    KJ_ASSERT(array.getStorageIfAligned(&data));
+    return kj::Array<kj::byte>(data, array.length(), kj::NullArrayDisposer::instance);
+  }
+};
+
+template <typename T>
+constexpr bool isFastApiReturn() {
+  return isVoid<T>() || kj::isSameType<T, bool>() || kj::isSameType<T, int32_t>() ||
+         kj::isSameType<T, uint32_t>() || kj::isSameType<T, float>() ||
+         kj::isSameType<T, double>();
+}
+
+// Implements the fast callback for a method of the C++ class, when the method's signature allows
+// one. `supported` is false otherwise, in which case `callback` must not be used.
+template <bool isContext, typename T, typename Method, Method method>
+struct FastMethodCallback {
+  static constexpr bool supported = false;
+};
+
+template <bool isContext, typename T, typename U, typename Ret, typename... Args,
+          Ret (U::*method)(Args...)>
+struct FastMethodCallback<isContext, T, Ret (U::*)(Args...), method> {
+  // Context globals keep their C++ pointer in the context rather than the object, and there is no
+  // context at hand in a fast call.
+  static constexpr bool supported =
+      !isContext && isFastApiReturn<Ret>() && (FastApiArg<kj::Decay<Args>>::supported && ...);
+
+  static Ret callback(v8::Local<v8::Object> receiver,
+                      typename FastApiArg<kj::Decay<Args>>::Type... args) {
+    // V8 only takes the fast path once it has checked the receiver against the signature of the
+    // FunctionTemplate, so this is the same object the slow path would see.
+    auto& self = extractInternalPointer<T, false>(v8::Local<v8::Context>(), receiver);
+    return (self.*method)(FastApiArg<kj::Decay<Args>>::unwrap(args)...);
+  }
+};
+
 // Implements the V8 callback function for calling a static method of the C++ class.
 //
 // This is separate from MethodCallback<> because we need to know the interface type, T, and it
@@ -846,6 +924,21 @@ struct ResourceTypeBuilder {
         v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow));
   }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    using Fast = FastMethodCallback<isContext, Self, Method, method>;
+    if constexpr (Fast::supported) {
+      static const v8::CFunction cFunction = v8::CFunction::Make(&Fast::callback);
+      prototype->Set(isolate, name, v8::FunctionTemplate::New(isolate,
+          &MethodCallback<TypeWrapper, name, isContext, Self, Method, method,
+                          ArgumentIndexes<Method>>::callback,
+          v8::Local<v8::Value>(), signature, 0, v8::ConstructorBehavior::kThrow,
+          v8::SideEffectType::kHasSideEffect, &cFunction));
+    } else {
+      registerMethod<name, Method, method>();
+    }
+  }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() {
     // Notably, we specify an empty signature because a static method invocation will have no holder
@@ -1123,6 +1216,9 @@ struct JsSetup {
   template<const char* name, typename Method, Method method>
   inline void registerMethod() { }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() { }
+
   template<const char* name, typename Method, Method method>
   inline void registerStaticMethod() { }
 
@@ -553,6 +553,9 @@ struct MemberCounter {
   template<const char* name, typename Method, Method method>
   inline void registerMethod() { ++members; }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() { ++members; }
+
   template<typename Method, Method method>
   inline void registerCallable() { /* not a member */ }
 
@@ -753,6 +756,11 @@ struct MembersBuilder {
     TupleRttiBuilder<Configuration, Args>::build(method.initArgs(std::tuple_size_v<Args>), rtti);
   }
 
+  template<const char* name, typename Method, Method method>
+  inline void registerFastMethod() {
+    registerMethod<name, Method, method>();
+  }
+
   template<typename Method, Method method>
   inline void registerCallable() {
     auto func = structure.initCallable();
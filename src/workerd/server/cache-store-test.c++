@@ -0,0 +1,310 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cache-store.h"
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+class MockClock final: public kj::Clock {
+public:
+  kj::Date now() const override { return time; }
+
+  kj::Date time = kj::UNIX_EPOCH + 1'700'000'000 * kj::SECONDS;
+};
+
+struct Result {
+  uint status;
+  kj::String cacheStatus;  // Empty if there's no CF-Cache-Status header.
+  kj::String body;
+};
+
+struct CacheStoreTest {
+  kj::EventLoop loop;
+  kj::WaitScope ws { loop };
+  kj::HttpHeaderTable::Builder builder;
+  CacheStore::HeaderIds ids { builder };
+  kj::HttpHeaderId acceptEncoding = builder.add("Accept-Encoding");
+  kj::Own<kj::HttpHeaderTable> table = builder.build();
+  MockClock clock;
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(clock);
+
+  kj::Own<CacheStore> newStore(uint64_t maxSize = 1 << 20, uint64_t maxEntrySize = 1 << 20) {
+    return kj::heap<CacheStore>(ids, *dir, clock, CacheStore::Options {
+      .maxSize = maxSize,
+      .maxEntrySize = maxEntrySize,
+    });
+  }
+
+  Result send(CacheStore& store, kj::HttpMethod method, kj::StringPtr url,
+              const kj::HttpHeaders& headers, kj::StringPtr body = nullptr) {
+    auto client = kj::newHttpClient(store);
+    auto request = client->request(method, url, headers, uint64_t(body.size()));
+    if (body.size() > 0) {
+      request.body->write(body.asBytes()).wait(ws);
+    }
+    request.body = nullptr;
+    auto response = request.response.wait(ws);
+    return {
+      .status = response.statusCode,
+      .cacheStatus = kj::str(response.headers->get(ids.cfCacheStatus).orDefault(""_kj)),
+      .body = response.body->readAllText().wait(ws),
+    };
+  }
+
+  uint put(CacheStore& store, kj::StringPtr url, kj::StringPtr payload) {
+    return send(store, kj::HttpMethod::PUT, url, kj::HttpHeaders(*table), payload).status;
+  }
+
+  Result match(CacheStore& store, kj::StringPtr url) {
+    return send(store, kj::HttpMethod::GET, url, kj::HttpHeaders(*table));
+  }
+
+  bool isHit(CacheStore& store, kj::StringPtr url) {
+    auto result = match(store, url);
+    return result.status == 200 && result.cacheStatus == "HIT";
+  }
+};
+
+constexpr auto HELLO =
+    "HTTP/1.1 200 OK\r\n"
+    "Cache-Control: max-age=60\r\n"
+    "Content-Length: 5\r\n"
+    "\r\n"
+    "hello"_kj;
+
+KJ_TEST("CacheStore put, match and purge") {
+  CacheStoreTest test;
+  auto store = test.newStore();
+
+  auto miss = test.match(*store, "https://example.com/");
+  KJ_EXPECT(miss.status == 504);
+  KJ_EXPECT(miss.cacheStatus == "MISS");
+
+  KJ_EXPECT(test.put(*store, "https://example.com/", HELLO) == 204);
+  KJ_EXPECT(store->size() == 1);
+
+  auto hit = test.match(*store, "https://example.com/");
+  KJ_EXPECT(hit.status == 200);
+  KJ_EXPECT(hit.cacheStatus == "HIT");
+  KJ_EXPECT(hit.body == "hello");
+
+  // Other caches don't see the response.
+  kj::HttpHeaders otherCache(*test.table);
+  otherCache.set(test.ids.cfCacheNamespace, "other");
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", otherCache).status
+      == 504);
+
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::PURGE, "https://example.com/",
+                      kj::HttpHeaders(*test.table)).status == 200);
+  KJ_EXPECT(test.match(*store, "https://example.com/").status == 504);
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::PURGE, "https://example.com/",
+                      kj::HttpHeaders(*test.table)).status == 404);
+  KJ_EXPECT(store->size() == 0);
+  KJ_EXPECT(test.dir->listNames().size() == 0);
+}
+
+KJ_TEST("CacheStore honors Cache-Control and Expires") {
+  CacheStoreTest test;
+  auto store = test.newStore();
+
+  test.put(*store, "https://example.com/a", HELLO);
+  test.clock.time += 59 * kj::SECONDS;
+  KJ_EXPECT(test.isHit(*store, "https://example.com/a"));
+  test.clock.time += 1 * kj::SECONDS;
+  KJ_EXPECT(!test.isHit(*store, "https://example.com/a"));
+  KJ_EXPECT(store->size() == 0);
+
+  // s-maxage wins over max-age.
+  test.put(*store, "https://example.com/b",
+      "HTTP/1.1 200 OK\r\nCache-Control: max-age=10, s-maxage=100\r\n\r\n");
+  test.clock.time += 50 * kj::SECONDS;
+  KJ_EXPECT(test.isHit(*store, "https://example.com/b"));
+
+  // Expires counts from the origin's Date.
+  test.put(*store, "https://example.com/c",
+      "HTTP/1.1 200 OK\r\n"
+      "Date: Wed, 01 Jan 2020 00:00:00 GMT\r\n"
+      "Expires: Wed, 01 Jan 2020 00:00:30 GMT\r\n"
+      "\r\n");
+  test.clock.time += 29 * kj::SECONDS;
+  KJ_EXPECT(test.isHit(*store, "https://example.com/c"));
+  test.clock.time += 1 * kj::SECONDS;
+  KJ_EXPECT(!test.isHit(*store, "https://example.com/c"));
+
+  // Without any lifetime, responses are kept.
+  test.put(*store, "https://example.com/d", "HTTP/1.1 200 OK\r\n\r\n");
+  test.clock.time += 365 * kj::DAYS;
+  KJ_EXPECT(test.isHit(*store, "https://example.com/d"));
+
+  // These aren't stored at all.
+  for (auto payload: {
+    "HTTP/1.1 200 OK\r\nCache-Control: no-store\r\n\r\n"_kj,
+    "HTTP/1.1 200 OK\r\nCache-Control: private, max-age=60\r\n\r\n"_kj,
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=0\r\n\r\n"_kj,
+    "HTTP/1.1 200 OK\r\nCache-Control: max-age=60\r\nSet-Cookie: a=b\r\n\r\n"_kj,
+    "HTTP/1.1 200 OK\r\nExpires: 0\r\n\r\n"_kj,
+    "HTTP/1.1 200 OK\r\nExpires: Wed, 01 Jan 2099 24:00:00 GMT\r\n\r\n"_kj,
+  }) {
+    KJ_EXPECT(test.put(*store, "https://example.com/e", payload) == 204);
+    KJ_EXPECT(!test.isHit(*store, "https://example.com/e"), payload);
+  }
+}
+
+KJ_TEST("CacheStore matches Vary headers") {
+  CacheStoreTest test;
+  auto store = test.newStore();
+
+  kj::HttpHeaders gzip(*test.table);
+  gzip.set(test.acceptEncoding, "gzip");
+  kj::HttpHeaders br(*test.table);
+  br.set(test.acceptEncoding, "br");
+  kj::HttpHeaders none(*test.table);
+
+  auto payload =
+      "HTTP/1.1 200 OK\r\n"
+      "Vary: Accept-Encoding\r\n"
+      "Content-Length: 4\r\n"
+      "\r\n"
+      "gzip"_kj;
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::PUT, "https://example.com/", gzip, payload).status
+      == 204);
+
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", gzip).body == "gzip");
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", br).status == 504);
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", none).status == 504);
+
+  // `Vary: *` never matches, so such responses aren't stored.
+  auto star =
+      "HTTP/1.1 200 OK\r\n"
+      "Vary: Accept-Encoding, *\r\n"
+      "\r\n"_kj;
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::PUT, "https://example.com/star", gzip, star).status
+      == 204);
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/star", gzip).status
+      == 504);
+}
+
+KJ_TEST("CacheStore answers conditional and range requests") {
+  CacheStoreTest test;
+  auto store = test.newStore();
+
+  test.put(*store, "https://example.com/",
+      "HTTP/1.1 200 OK\r\n"
+      "ETag: \"v1\"\r\n"
+      "Last-Modified: Wed, 01 Jan 2020 00:00:00 GMT\r\n"
+      "Content-Length: 11\r\n"
+      "\r\n"
+      "hello world");
+
+  auto conditional = [&](kj::HttpHeaderId id, kj::StringPtr value) {
+    kj::HttpHeaders headers(*test.table);
+    headers.set(id, value);
+    return test.send(*store, kj::HttpMethod::GET, "https://example.com/", headers).status;
+  };
+  KJ_EXPECT(conditional(test.ids.ifNoneMatch, "\"v1\"") == 304);
+  KJ_EXPECT(conditional(test.ids.ifNoneMatch, "\"v0\", W/\"v1\"") == 304);
+  KJ_EXPECT(conditional(test.ids.ifNoneMatch, "*") == 304);
+  KJ_EXPECT(conditional(test.ids.ifNoneMatch, "\"v2\"") == 200);
+  KJ_EXPECT(conditional(test.ids.ifModifiedSince, "Wed, 01 Jan 2020 00:00:00 GMT") == 304);
+  KJ_EXPECT(conditional(test.ids.ifModifiedSince, "Tue, 31 Dec 2019 23:59:59 GMT") == 200);
+
+  kj::HttpHeaders range(*test.table);
+  range.set(kj::HttpHeaderId::RANGE, "bytes=6-");
+  auto partial = test.send(*store, kj::HttpMethod::GET, "https://example.com/", range);
+  KJ_EXPECT(partial.status == 206);
+  KJ_EXPECT(partial.body == "world");
+
+  range.set(kj::HttpHeaderId::RANGE, "bytes=20-30");
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", range).status == 416);
+}
+
+KJ_TEST("CacheStore evicts the least recently used responses") {
+  CacheStoreTest test;
+  auto store = test.newStore();
+  test.put(*store, "https://example.com/size", HELLO);
+  auto entrySize = store->totalSize();
+  test.put(*store, "https://example.com/size", HELLO);
+  KJ_EXPECT(store->totalSize() == entrySize);
+  store = nullptr;
+  test.dir->remove(kj::Path({test.dir->listNames()[0]}));
+
+  // Room for three responses like HELLO with URLs of the same length.
+  store = test.newStore(entrySize * 3 + entrySize / 2);
+  test.put(*store, "https://example.com/aaaa", HELLO);
+  test.put(*store, "https://example.com/bbbb", HELLO);
+  test.put(*store, "https://example.com/cccc", HELLO);
+  KJ_EXPECT(test.isHit(*store, "https://example.com/aaaa"));
+
+  test.put(*store, "https://example.com/dddd", HELLO);
+  KJ_EXPECT(store->size() == 3);
+  KJ_EXPECT(!test.isHit(*store, "https://example.com/bbbb"));
+  KJ_EXPECT(test.isHit(*store, "https://example.com/aaaa"));
+  KJ_EXPECT(test.isHit(*store, "https://example.com/cccc"));
+  KJ_EXPECT(test.isHit(*store, "https://example.com/dddd"));
+  KJ_EXPECT(test.dir->listNames().size() == 3);
+}
+
+KJ_TEST("CacheStore rejects responses that are too large") {
+  CacheStoreTest test;
+  auto store = test.newStore(1 << 20, 1024);
+
+  auto body = kj::str(kj::repeat('x', 2000));
+  KJ_EXPECT(test.put(*store, "https://example.com/",
+      kj::str("HTTP/1.1 200 OK\r\nContent-Length: 2000\r\n\r\n", body)) == 413);
+  // Without a Content-Length, the body is only found to be too large while it's being stored.
+  KJ_EXPECT(test.put(*store, "https://example.com/",
+      kj::str("HTTP/1.1 200 OK\r\n\r\n", body)) == 413);
+  KJ_EXPECT(store->size() == 0);
+  KJ_EXPECT(test.dir->listNames().size() == 0);
+
+  // A truncated body isn't stored either.
+  KJ_EXPECT(test.put(*store, "https://example.com/",
+      "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nhello") == 400);
+  KJ_EXPECT(store->size() == 0);
+}
+
+KJ_TEST("CacheStore reloads responses from its directory") {
+  CacheStoreTest test;
+  test.dir->openFile(kj::Path({"unrelated.txt"}), kj::WriteMode::CREATE)
+      ->writeAll("not a cache entry");
+
+  uint64_t totalSize;
+  {
+    auto store = test.newStore();
+    kj::HttpHeaders headers(*test.table);
+    headers.set(test.ids.cfCacheNamespace, "named");
+    test.send(*store, kj::HttpMethod::PUT, "https://example.com/", headers, HELLO);
+    test.put(*store, "https://example.com/", HELLO);
+    test.put(*store, "https://example.com/short",
+        "HTTP/1.1 200 OK\r\nCache-Control: max-age=1\r\n\r\n");
+    totalSize = store->totalSize();
+  }
+
+  test.clock.time += 2 * kj::SECONDS;
+  auto store = test.newStore();
+  KJ_EXPECT(store->size() == 2);
+  KJ_EXPECT(store->totalSize() < totalSize);
+  auto hit = test.match(*store, "https://example.com/");
+  KJ_EXPECT(hit.cacheStatus == "HIT");
+  KJ_EXPECT(hit.body == "hello");
+
+  kj::HttpHeaders headers(*test.table);
+  headers.set(test.ids.cfCacheNamespace, "named");
+  KJ_EXPECT(test.send(*store, kj::HttpMethod::GET, "https://example.com/", headers).body
+      == "hello");
+
+  // The expired response's file was deleted, and the unrelated file left alone.
+  KJ_EXPECT(test.dir->listNames().size() == 3);
+  KJ_EXPECT(test.dir->exists(kj::Path({"unrelated.txt"})));
+
+  // New files don't reuse the names of the old ones.
+  test.put(*store, "https://example.com/new", HELLO);
+  KJ_EXPECT(store->size() == 3);
+  KJ_EXPECT(test.dir->listNames().size() == 4);
+}
+
+}  // namespace
+}  // namespace workerd::server
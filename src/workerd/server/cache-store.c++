@@ -0,0 +1,559 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "cache-store.h"
+#include <workerd/util/http-util.h>
+#include <kj/debug.h>
+#include <algorithm>
+#include <stdlib.h>
+
+namespace workerd::server {
+
+namespace {
+
+// Limit on the size of a stored response's headers, including the request it was stored for.
+constexpr size_t MAX_HEAD_SIZE = 128 * 1024;
+
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+constexpr auto FILE_SUFFIX = ".entry"_kj;
+
+// Cache-Control lifetimes beyond this are treated as this, to stay clear of overflows.
+constexpr uint64_t MAX_LIFETIME_SECONDS = uint64_t(1) << 32;
+
+// Returns the offset just past the first blank line in `text` at or after `start`.
+kj::Maybe<size_t> findHeadEnd(kj::ArrayPtr<const char> text, size_t start = 0) {
+  for (size_t i = start; i + 4 <= text.size(); i++) {
+    if (text[i] == '\r' && text[i + 1] == '\n' && text[i + 2] == '\r' && text[i + 3] == '\n') {
+      return i + 4;
+    }
+  }
+  return kj::none;
+}
+
+bool varyIncludesStar(kj::StringPtr vary) {
+  bool result = false;
+  forEachListElement(vary, [&](kj::String name) {
+    if (name == "*") result = true;
+  });
+  return result;
+}
+
+struct CacheControl {
+  bool noStore = false;
+  bool noCache = false;
+  bool isPrivate = false;
+  kj::Maybe<uint64_t> maxAge;
+  kj::Maybe<uint64_t> sMaxAge;
+};
+
+CacheControl parseCacheControl(kj::StringPtr value) {
+  CacheControl result;
+  forEachListElement(value, [&](kj::String directive) {
+    kj::StringPtr name = directive;
+    kj::Maybe<uint64_t> seconds;
+    KJ_IF_SOME(i, directive.findFirst('=')) {
+      directive[i] = '\0';
+      name = kj::StringPtr(directive.begin(), i);
+      seconds = kj::StringPtr(directive.begin() + i + 1).tryParseAs<uint64_t>();
+    }
+
+    if (equalsIgnoreCase(name, "no-store")) {
+      result.noStore = true;
+    } else if (equalsIgnoreCase(name, "no-cache")) {
+      result.noCache = true;
+    } else if (equalsIgnoreCase(name, "private")) {
+      result.isPrivate = true;
+    } else if (equalsIgnoreCase(name, "max-age")) {
+      result.maxAge = seconds.map([](uint64_t s) { return kj::min(s, MAX_LIFETIME_SECONDS); });
+    } else if (equalsIgnoreCase(name, "s-maxage")) {
+      result.sMaxAge = seconds.map([](uint64_t s) { return kj::min(s, MAX_LIFETIME_SECONDS); });
+    }
+  });
+  return result;
+}
+
+// Strong or weak comparison of entity tags, as If-None-Match calls for.
+bool etagListMatches(kj::StringPtr list, kj::StringPtr etag) {
+  auto stripWeak = [](kj::StringPtr tag) {
+    return tag.startsWith("W/") ? tag.slice(2) : tag;
+  };
+  bool matched = false;
+  forEachListElement(list, [&](kj::String element) {
+    if (element == "*" || stripWeak(element) == stripWeak(etag)) matched = true;
+  });
+  return matched;
+}
+
+kj::Promise<void> drain(kj::AsyncInputStream& in) {
+  auto buffer = kj::heapArray<kj::byte>(BUFFER_SIZE);
+  while (co_await in.tryRead(buffer.begin(), 1, buffer.size()) > 0) {}
+}
+
+}  // namespace
+
+// The headers of a stored file: the request the response was stored for, which records the
+// cache namespace, the time it was stored (as its Date header) and the values of any headers the
+// response varies on; followed by the response's status line and headers.
+struct CacheStore::StoredHead {
+  StoredHead(const kj::HttpHeaderTable& table): request(table), response(table) {}
+
+  kj::Array<char> text;  // Both heads, which `request` and `response` point into.
+  kj::HttpHeaders request;
+  kj::StringPtr url;
+  uint statusCode;
+  kj::StringPtr statusText;
+  kj::HttpHeaders response;
+
+  kj::Date stored = kj::UNIX_EPOCH;
+  kj::Maybe<kj::Date> expires;
+};
+
+CacheStore::HeaderIds::HeaderIds(kj::HttpHeaderTable::Builder& builder)
+    : table(builder.getFutureTable()),
+      age(builder.add("Age")),
+      cacheControl(builder.add("Cache-Control")),
+      cfCacheNamespace(builder.add("CF-Cache-Namespace")),
+      cfCacheStatus(builder.add("CF-Cache-Status")),
+      date(builder.add("Date")),
+      etag(builder.add("ETag")),
+      expires(builder.add("Expires")),
+      ifModifiedSince(builder.add("If-Modified-Since")),
+      ifNoneMatch(builder.add("If-None-Match")),
+      lastModified(builder.add("Last-Modified")),
+      setCookie(builder.add("Set-Cookie")),
+      vary(builder.add("Vary")) {}
+
+CacheStore::CacheStore(const HeaderIds& ids, const kj::Directory& dir, const kj::Clock& clock,
+                       Options options)
+    : ids(ids), dir(dir), clock(clock), options(options) {
+  kj::Vector<Entry> loaded;
+  for (auto& name: dir.listNames()) {
+    if (name.endsWith(FILE_SUFFIX)) {
+      load(name, loaded);
+    }
+  }
+
+  // Files stored earlier count as less recently used.
+  std::sort(loaded.begin(), loaded.end(), [](const Entry& a, const Entry& b) {
+    return a.head->stored < b.head->stored;
+  });
+  for (auto& entry: loaded) {
+    entry.liveliness = nextLiveliness++;
+    insert(kj::mv(entry));
+  }
+}
+
+CacheStore::~CacheStore() noexcept(false) {}
+
+void CacheStore::load(kj::StringPtr fileName, kj::Vector<Entry>& loaded) {
+  auto idText = kj::heapString(fileName.begin(), fileName.size() - FILE_SUFFIX.size());
+  char* idEnd;
+  uint64_t id = strtoull(idText.cStr(), &idEnd, 16);
+  if (idText.size() == 0 || idEnd != idText.end()) {
+    // Not one of ours.
+    return;
+  }
+  nextFileId = kj::max(nextFileId, id + 1);
+
+  auto path = kj::Path({fileName});
+  auto file = dir.openFile(path);
+  auto fileSize = file->stat().size;
+  auto buffer = kj::heapArray<char>(kj::min(fileSize, MAX_HEAD_SIZE));
+  file->read(0, buffer.asBytes());
+
+  kj::Maybe<kj::Own<StoredHead>> head;
+  KJ_IF_SOME(requestEnd, findHeadEnd(buffer)) {
+    KJ_IF_SOME(responseEnd, findHeadEnd(buffer, requestEnd)) {
+      head = parseHead(kj::heapArray<char>(buffer.first(responseEnd)));
+    }
+  }
+
+  KJ_IF_SOME(h, head) {
+    bool expired = false;
+    KJ_IF_SOME(expires, h->expires) {
+      expired = expires <= clock.now();
+    }
+    if (!expired) {
+      auto key = kj::str(h->request.get(ids.cfCacheNamespace).orDefault(""_kj), ' ', h->url);
+      loaded.add(Entry {
+        .key = kj::mv(key),
+        .liveliness = 0,
+        .fileName = kj::heapString(fileName),
+        .fileSize = fileSize,
+        .head = kj::mv(h),
+      });
+      return;
+    }
+  } else {
+    KJ_LOG(WARNING, "deleting unreadable Cache API entry", fileName);
+  }
+  dir.tryRemove(path);
+}
+
+kj::Maybe<kj::Own<CacheStore::StoredHead>> CacheStore::parseHead(kj::Array<char> text) {
+  auto head = kj::heap<StoredHead>(ids.table);
+  head->text = kj::mv(text);
+  size_t requestEnd = KJ_UNWRAP_OR_RETURN(findHeadEnd(head->text), kj::none);
+
+  auto request = head->request.tryParseRequest(head->text.first(requestEnd));
+  auto& parsedRequest = KJ_UNWRAP_OR_RETURN(
+      request.tryGet<kj::HttpHeaders::Request>(), kj::none);
+  head->url = parsedRequest.url;
+
+  auto response = head->response.tryParseResponse(head->text.slice(requestEnd));
+  auto& parsedResponse = KJ_UNWRAP_OR_RETURN(
+      response.tryGet<kj::HttpHeaders::Response>(), kj::none);
+  head->statusCode = parsedResponse.statusCode;
+  head->statusText = parsedResponse.statusText;
+
+  head->stored = KJ_UNWRAP_OR_RETURN(
+      parseHttpTime(KJ_UNWRAP_OR_RETURN(head->request.get(ids.date), kj::none)), kj::none);
+  head->expires = expiration(*head);
+  return kj::mv(head);
+}
+
+kj::Maybe<kj::Date> CacheStore::expiration(const StoredHead& head) {
+  auto cacheControl = parseCacheControl(head.response.get(ids.cacheControl).orDefault(""_kj));
+  KJ_IF_SOME(seconds, cacheControl.sMaxAge) {
+    return head.stored + int64_t(seconds) * kj::SECONDS;
+  }
+  KJ_IF_SOME(seconds, cacheControl.maxAge) {
+    return head.stored + int64_t(seconds) * kj::SECONDS;
+  }
+  KJ_IF_SOME(expires, head.response.get(ids.expires)) {
+    // An invalid Expires header means the response is already expired.
+    auto expiresDate = KJ_UNWRAP_OR(parseHttpTime(expires), return head.stored);
+    // Expires is in terms of the origin's clock, given by its Date header.
+    kj::Date originDate = head.stored;
+    KJ_IF_SOME(date, head.response.get(ids.date)) {
+      KJ_IF_SOME(parsed, parseHttpTime(date)) {
+        originDate = parsed;
+      }
+    }
+    return head.stored + (expiresDate - originDate);
+  }
+
+  // Without any lifetime, the response is kept until evicted.
+  return kj::none;
+}
+
+bool CacheStore::isCacheable(const StoredHead& head) {
+  auto cacheControl = parseCacheControl(head.response.get(ids.cacheControl).orDefault(""_kj));
+  if (cacheControl.noStore || cacheControl.noCache || cacheControl.isPrivate) {
+    return false;
+  }
+  if (head.response.get(ids.setCookie) != kj::none) {
+    // The cookie is presumably meant for one client only.
+    return false;
+  }
+  if (varyIncludesStar(head.response.get(ids.vary).orDefault(""_kj))) {
+    // The response depends on more than the request's headers, so no request can match it.
+    return false;
+  }
+  KJ_IF_SOME(expires, head.expires) {
+    return expires > clock.now();
+  }
+  return true;
+}
+
+bool CacheStore::varyMatches(const StoredHead& head, const kj::HttpHeaders& headers) {
+  bool matches = true;
+  forEachListElement(head.response.get(ids.vary).orDefault(""_kj), [&](kj::String name) {
+    if (name == "*") {
+      // Never matches (RFC 9111 section 4.1). Such responses aren't stored any more, but older
+      // entries may still be in the directory.
+      matches = false;
+      return;
+    }
+    auto stored = findHeader(head.request, name);
+    auto requested = findHeader(headers, name);
+    KJ_IF_SOME(s, stored) {
+      KJ_IF_SOME(r, requested) {
+        if (s != r) matches = false;
+      } else {
+        matches = false;
+      }
+    } else if (requested != kj::none) {
+      matches = false;
+    }
+  });
+  return matches;
+}
+
+bool CacheStore::isNotModified(const StoredHead& head, const kj::HttpHeaders& headers) {
+  KJ_IF_SOME(ifNoneMatch, headers.get(ids.ifNoneMatch)) {
+    KJ_IF_SOME(etag, head.response.get(ids.etag)) {
+      return etagListMatches(ifNoneMatch, etag);
+    }
+    return false;
+  }
+  KJ_IF_SOME(ifModifiedSince, headers.get(ids.ifModifiedSince)) {
+    KJ_IF_SOME(lastModified, head.response.get(ids.lastModified)) {
+      KJ_IF_SOME(since, parseHttpTime(ifModifiedSince)) {
+        KJ_IF_SOME(modified, parseHttpTime(lastModified)) {
+          return modified <= since;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+void CacheStore::insert(Entry entry) {
+  KJ_IF_SOME(existing, entries.find(entry.key)) {
+    remove(existing);
+  }
+  usedSize += entry.fileSize;
+  entries.insert(kj::mv(entry));
+  evictIfNeeded();
+}
+
+void CacheStore::remove(Entry& entry) {
+  dir.tryRemove(kj::Path({entry.fileName}));
+  usedSize -= entry.fileSize;
+  entries.erase(entry);
+}
+
+void CacheStore::evictIfNeeded() {
+  while (usedSize > options.maxSize && entries.size() > 0) {
+    remove(*entries.ordered<1>().begin());
+  }
+}
+
+kj::Promise<void> CacheStore::request(
+    kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+    kj::AsyncInputStream& requestBody, Response& response) {
+  auto key = kj::str(headers.get(ids.cfCacheNamespace).orDefault(""_kj), ' ', url);
+  switch (method) {
+    case kj::HttpMethod::GET:
+      return match(kj::mv(key), headers, response);
+    case kj::HttpMethod::PUT:
+      return put(kj::mv(key), url, headers, requestBody, response);
+    case kj::HttpMethod::PURGE:
+      return purge(kj::mv(key), response);
+    default:
+      return response.sendError(405, "Method Not Allowed", ids.table);
+  }
+}
+
+kj::Promise<void> CacheStore::match(
+    kj::String key, const kj::HttpHeaders& headers, Response& response) {
+  auto miss = [&]() {
+    kj::HttpHeaders responseHeaders(ids.table);
+    responseHeaders.set(ids.cfCacheStatus, "MISS");
+    response.send(504, "Gateway Timeout", responseHeaders, uint64_t(0));
+  };
+
+  auto& found = KJ_UNWRAP_OR(entries.find(key), {
+    miss();
+    co_return;
+  });
+  auto now = clock.now();
+  KJ_IF_SOME(expires, found.head->expires) {
+    if (expires <= now) {
+      remove(found);
+      miss();
+      co_return;
+    }
+  }
+  if (!varyMatches(*found.head, headers)) {
+    miss();
+    co_return;
+  }
+
+  // Mark the entry as most recently used.
+  Entry released = entries.release(found);
+  released.liveliness = nextLiveliness++;
+  auto& entry = entries.insert(kj::mv(released));
+  auto& head = *entry.head;
+
+  auto responseHeaders = head.response.clone();
+  responseHeaders.set(ids.cfCacheStatus, "HIT");
+  auto age = now > head.stored ? (now - head.stored) / kj::SECONDS : 0;
+  responseHeaders.set(ids.age, kj::str(age));
+
+  if (isNotModified(head, headers)) {
+    response.send(304, "Not Modified", responseHeaders, uint64_t(0));
+    co_return;
+  }
+
+  // Everything we need from the entry is copied or mapped before the first co_await, since the
+  // entry may be evicted while the body is being written.
+  uint64_t bodyOffset = head.text.size();
+  uint64_t bodySize = entry.fileSize - bodyOffset;
+  uint statusCode = head.statusCode;
+  auto statusText = kj::str(head.statusText);
+
+  kj::Array<const kj::byte> body;
+  if (bodySize > 0) {
+    auto file = KJ_UNWRAP_OR(dir.tryOpenFile(kj::Path({entry.fileName})), {
+      // Someone deleted the file from under us.
+      remove(entry);
+      miss();
+      co_return;
+    });
+    auto mapping = file->mmap(bodyOffset, bodySize);
+    body = mapping.asPtr().attach(kj::mv(mapping), kj::mv(file));
+  }
+
+  if (statusCode == 200) {
+    KJ_IF_SOME(rangeHeader, headers.get(kj::HttpHeaderId::RANGE)) {
+      KJ_SWITCH_ONEOF(kj::tryParseHttpRangeHeader(rangeHeader.asArray(), bodySize)) {
+        KJ_CASE_ONEOF(ranges, kj::Array<kj::HttpByteRange>) {
+          if (ranges.size() == 1) {
+            auto range = ranges[0];
+            auto rangeSize = range.end - range.start + 1;
+            responseHeaders.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(rangeSize));
+            responseHeaders.set(kj::HttpHeaderId::CONTENT_RANGE,
+                kj::str("bytes ", range.start, "-", range.end, "/", bodySize));
+            auto out = response.send(206, "Partial Content", responseHeaders, rangeSize);
+            co_return co_await out->write(body.slice(range.start, range.end + 1));
+          }
+        }
+        KJ_CASE_ONEOF(_, kj::HttpEverythingRange) {}
+        KJ_CASE_ONEOF(_, kj::HttpUnsatisfiableRange) {
+          responseHeaders.set(kj::HttpHeaderId::CONTENT_RANGE, kj::str("bytes */", bodySize));
+          response.send(416, "Range Not Satisfiable", responseHeaders, uint64_t(0));
+          co_return;
+        }
+      }
+    }
+  }
+
+  responseHeaders.set(kj::HttpHeaderId::CONTENT_LENGTH, kj::str(bodySize));
+  auto out = response.send(statusCode, statusText, responseHeaders, bodySize);
+  if (bodySize > 0) {
+    co_await out->write(body);
+  }
+}
+
+kj::Promise<void> CacheStore::put(kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers,
+                                  kj::AsyncInputStream& requestBody, Response& response) {
+  // The request body is the response to store, serialized as an HTTP response. Start by reading
+  // its head.
+  kj::Vector<char> buffer;
+  size_t payloadHeadEnd;
+  for (;;) {
+    size_t searchFrom = buffer.size() < 3 ? 0 : buffer.size() - 3;
+    size_t readSize = kj::min(BUFFER_SIZE, MAX_HEAD_SIZE - buffer.size());
+    if (readSize == 0) {
+      co_await drain(requestBody);
+      co_return co_await response.sendError(413, "Payload Too Large", ids.table);
+    }
+    buffer.resize(buffer.size() + readSize);
+    auto n = co_await requestBody.tryRead(buffer.end() - readSize, 1, readSize);
+    buffer.resize(buffer.size() - readSize + n);
+    if (n == 0) {
+      co_return co_await response.sendError(400, "Bad Request", ids.table);
+    }
+    KJ_IF_SOME(end, findHeadEnd(buffer.asPtr(), searchFrom)) {
+      payloadHeadEnd = end;
+      break;
+    }
+  }
+
+  auto payloadHeadText = kj::heapArray<char>(buffer.first(payloadHeadEnd));
+  kj::HttpHeaders payloadHeaders(ids.table);
+  auto parsed = payloadHeaders.tryParseResponse(payloadHeadText);
+  auto& status = KJ_UNWRAP_OR(parsed.tryGet<kj::HttpHeaders::Response>(), {
+    co_await drain(requestBody);
+    co_return co_await response.sendError(400, "Bad Request", ids.table);
+  });
+
+  kj::Maybe<uint64_t> expectedBodySize;
+  KJ_IF_SOME(length, payloadHeaders.get(kj::HttpHeaderId::CONTENT_LENGTH)) {
+    expectedBodySize = length.tryParseAs<uint64_t>();
+  }
+  // The body is stored as-is. Any framing is up to whoever serves it.
+  payloadHeaders.unset(kj::HttpHeaderId::CONNECTION);
+  payloadHeaders.unset(kj::HttpHeaderId::KEEP_ALIVE);
+  payloadHeaders.unset(kj::HttpHeaderId::TRANSFER_ENCODING);
+  payloadHeaders.unset(kj::HttpHeaderId::CONTENT_LENGTH);
+
+  // Record what we need to match the response later in the head of a request.
+  kj::HttpHeaders requestHead(ids.table);
+  KJ_IF_SOME(ns, headers.get(ids.cfCacheNamespace)) {
+    requestHead.set(ids.cfCacheNamespace, ns);
+  }
+  requestHead.set(ids.date, httpTime(clock.now()));
+  forEachListElement(payloadHeaders.get(ids.vary).orDefault(""_kj), [&](kj::String name) {
+    KJ_IF_SOME(value, findHeader(headers, name)) {
+      requestHead.add(kj::mv(name), kj::mv(value));
+    }
+  });
+
+  auto headText = kj::str(requestHead.serializeRequest(kj::HttpMethod::GET, url),
+                          payloadHeaders.serializeResponse(status.statusCode, status.statusText));
+  auto head = KJ_UNWRAP_OR(parseHead(kj::heapArray<char>(headText.asArray())), {
+    co_await drain(requestBody);
+    co_return co_await response.sendError(400, "Bad Request", ids.table);
+  });
+
+  if (!isCacheable(*head)) {
+    co_await drain(requestBody);
+    response.send(204, "No Content", kj::HttpHeaders(ids.table));
+    co_return;
+  }
+
+  auto maxBodySize = options.maxEntrySize - kj::min(options.maxEntrySize, headText.size());
+  if (expectedBodySize.orDefault(0) > maxBodySize || headText.size() > MAX_HEAD_SIZE) {
+    co_await drain(requestBody);
+    co_return co_await response.sendError(413, "Payload Too Large", ids.table);
+  }
+
+  auto fileName = kj::str(kj::hex(nextFileId++), FILE_SUFFIX);
+  auto replacer = dir.replaceFile(kj::Path({fileName}), kj::WriteMode::CREATE);
+  auto& file = replacer->get();
+  file.write(0, headText.asBytes());
+  uint64_t offset = headText.size();
+
+  // Whatever followed the head in the buffer is the start of the body.
+  auto bodyStart = buffer.asPtr().slice(payloadHeadEnd).asBytes();
+  file.write(offset, bodyStart);
+  uint64_t bodySize = bodyStart.size();
+  offset += bodyStart.size();
+
+  auto chunk = kj::heapArray<kj::byte>(BUFFER_SIZE);
+  for (;;) {
+    if (bodySize > maxBodySize) {
+      co_await drain(requestBody);
+      co_return co_await response.sendError(413, "Payload Too Large", ids.table);
+    }
+    auto n = co_await requestBody.tryRead(chunk.begin(), 1, chunk.size());
+    if (n == 0) break;
+    file.write(offset, chunk.first(n));
+    bodySize += n;
+    offset += n;
+  }
+
+  KJ_IF_SOME(expected, expectedBodySize) {
+    if (bodySize != expected) {
+      co_return co_await response.sendError(400, "Bad Request", ids.table);
+    }
+  }
+
+  replacer->commit();
+  insert(Entry {
+    .key = kj::mv(key),
+    .liveliness = nextLiveliness++,
+    .fileName = kj::mv(fileName),
+    .fileSize = offset,
+    .head = kj::mv(head),
+  });
+  response.send(204, "No Content", kj::HttpHeaders(ids.table));
+}
+
+kj::Promise<void> CacheStore::purge(kj::String key, Response& response) {
+  kj::HttpHeaders responseHeaders(ids.table);
+  KJ_IF_SOME(entry, entries.find(key)) {
+    remove(entry);
+    response.send(200, "OK", responseHeaders, uint64_t(0));
+  } else {
+    response.send(404, "Not Found", responseHeaders, uint64_t(0));
+  }
+  return kj::READY_NOW;
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,132 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/compat/http.h>
+#include <kj/filesystem.h>
+#include <kj/table.h>
+
+namespace workerd::server {
+
+// Stores responses for the Cache API. Speaks the HTTP protocol that api::Cache uses to talk to the
+// cache service configured as a Worker's `cacheApiOutbound` (see api/cache.c++):
+//
+// - GET looks up the response stored for the URL. It answers with the response and
+//   `CF-Cache-Status: HIT`, or with a 504 and `CF-Cache-Status: MISS`.
+// - PUT stores the response serialized in the request body for the URL. It answers 204, or 413 if
+//   the response is too large to cache.
+// - PURGE deletes the response stored for the URL. It answers 200, or 404 if there was none.
+//
+// Requests with a `CF-Cache-Namespace` header, which is how `caches.open()` passes the cache name,
+// operate on that cache; other requests on the default cache.
+//
+// Responses are only stored if their Cache-Control header allows shared caches to store them,
+// and expire as it (or the Expires header) says. Responses with a Vary header only match requests
+// that have the same values for the listed headers as the request they were stored for. Only one
+// response is kept per URL: storing a response with different Vary values replaces the previous
+// one. Conditional GETs with If-None-Match or If-Modified-Since get a 304 if the stored response
+// matches, and GETs with a single byte range get a 206.
+//
+// Each response is stored in its own file, which holds the request it was stored for, the
+// response's headers, and then its body, so that a hit can serve the body straight from a
+// mapping of the file. The index of stored responses is kept in memory; it is rebuilt from the
+// files found in the directory when the store is created. Once the files exceed the configured
+// total size, the least recently used are deleted.
+class CacheStore final: public kj::HttpService {
+public:
+  // IDs of the headers the store needs, which must be registered in the same header table as the
+  // requests it will receive.
+  struct HeaderIds {
+    explicit HeaderIds(kj::HttpHeaderTable::Builder& builder);
+
+    kj::HttpHeaderTable& table;
+    kj::HttpHeaderId age;
+    kj::HttpHeaderId cacheControl;
+    kj::HttpHeaderId cfCacheNamespace;
+    kj::HttpHeaderId cfCacheStatus;
+    kj::HttpHeaderId date;
+    kj::HttpHeaderId etag;
+    kj::HttpHeaderId expires;
+    kj::HttpHeaderId ifModifiedSince;
+    kj::HttpHeaderId ifNoneMatch;
+    kj::HttpHeaderId lastModified;
+    kj::HttpHeaderId setCookie;
+    kj::HttpHeaderId vary;
+  };
+
+  struct Options {
+    // Total size of the stored files, beyond which the least recently used are deleted.
+    uint64_t maxSize;
+
+    // Size of the largest response to store, headers included.
+    uint64_t maxEntrySize;
+  };
+
+  // `dir` must outlive the store, and shouldn't be used for anything else. `clock` is used to
+  // decide when responses expire.
+  CacheStore(const HeaderIds& ids, const kj::Directory& dir, const kj::Clock& clock,
+             Options options);
+  ~CacheStore() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(CacheStore);
+
+  // Number of stored responses, and total size of their files.
+  size_t size() const { return entries.size(); }
+  uint64_t totalSize() const { return usedSize; }
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override;
+
+private:
+  struct StoredHead;
+
+  struct Entry {
+    kj::String key;
+    uint64_t liveliness;  // Set from `nextLiveliness` whenever the entry is stored or matched.
+
+    kj::String fileName;
+    uint64_t fileSize;
+    kj::Own<StoredHead> head;
+  };
+
+  struct KeyCallbacks {
+    inline kj::StringPtr keyForRow(const Entry& entry) const { return entry.key; }
+    inline bool matches(const Entry& entry, kj::StringPtr key) const { return entry.key == key; }
+    inline auto hashCode(kj::StringPtr key) const { return kj::hashCode(key); }
+  };
+
+  struct LivelinessCallbacks {
+    inline uint64_t keyForRow(const Entry& entry) const { return entry.liveliness; }
+    inline bool matches(const Entry& entry, uint64_t key) const { return entry.liveliness == key; }
+    inline bool isBefore(const Entry& entry, uint64_t key) const { return entry.liveliness < key; }
+  };
+
+  const HeaderIds& ids;
+  const kj::Directory& dir;
+  const kj::Clock& clock;
+  Options options;
+
+  kj::Table<Entry, kj::HashIndex<KeyCallbacks>, kj::TreeIndex<LivelinessCallbacks>> entries;
+  uint64_t usedSize = 0;
+  uint64_t nextLiveliness = 0;
+  uint64_t nextFileId = 0;
+
+  kj::Promise<void> match(kj::String key, const kj::HttpHeaders& headers, Response& response);
+  kj::Promise<void> put(kj::String key, kj::StringPtr url, const kj::HttpHeaders& headers,
+                        kj::AsyncInputStream& requestBody, Response& response);
+  kj::Promise<void> purge(kj::String key, Response& response);
+
+  kj::Maybe<kj::Own<StoredHead>> parseHead(kj::Array<char> text);
+  void load(kj::StringPtr fileName, kj::Vector<Entry>& loaded);
+  void insert(Entry entry);
+  void remove(Entry& entry);
+  void evictIfNeeded();
+  kj::Maybe<kj::Date> expiration(const StoredHead& head);
+  bool isCacheable(const StoredHead& head);
+  bool varyMatches(const StoredHead& head, const kj::HttpHeaders& headers);
+  bool isNotModified(const StoredHead& head, const kj::HttpHeaders& headers);
+};
+
+}  // namespace workerd::server
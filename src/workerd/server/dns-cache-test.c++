@@ -0,0 +1,196 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "dns-cache.h"
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+struct Counts {
+  uint resolved = 0;
+  uint restricted = 0;
+  bool refuse = false;
+};
+
+class FakeAddress final: public kj::NetworkAddress {
+public:
+  FakeAddress(Counts& counts, kj::String name): counts(counts), name(kj::mv(name)) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    if (counts.refuse) {
+      return KJ_EXCEPTION(DISCONNECTED, "connection refused");
+    }
+    return kj::Own<kj::AsyncIoStream>(kj::mv(kj::newTwoWayPipe().ends[0]));
+  }
+  kj::Own<kj::ConnectionReceiver> listen() override { KJ_UNIMPLEMENTED("not needed"); }
+  kj::Own<kj::NetworkAddress> clone() override {
+    return kj::heap<FakeAddress>(counts, kj::str(name));
+  }
+  kj::String toString() override { return kj::str(name); }
+
+private:
+  Counts& counts;
+  kj::String name;
+};
+
+// Resolves any hostname but "nx" to `<generation>.<hostname>`, where the generation counts the
+// lookups, so that tests can tell whether an address came from the cache.
+class FakeNetwork final: public kj::Network {
+public:
+  explicit FakeNetwork(Counts& counts): counts(counts) {}
+
+  kj::Promise<kj::Own<kj::NetworkAddress>> parseAddress(
+      kj::StringPtr addr, uint portHint) override {
+    auto name = kj::str(++counts.resolved, '.', addr);
+    co_await kj::yield();
+    if (name.endsWith(".nx")) {
+      KJ_FAIL_REQUIRE("DNS lookup failed", name);
+    }
+    co_return kj::heap<FakeAddress>(counts, kj::mv(name));
+  }
+  kj::Own<kj::NetworkAddress> getSockaddr(const void* sockaddr, uint len) override {
+    KJ_UNIMPLEMENTED("not needed");
+  }
+  kj::Own<kj::Network> restrictPeers(
+      kj::ArrayPtr<const kj::StringPtr> allow,
+      kj::ArrayPtr<const kj::StringPtr> deny) override {
+    ++counts.restricted;
+    return kj::heap<FakeNetwork>(counts);
+  }
+
+private:
+  Counts& counts;
+};
+
+struct CountingObserver final: public DnsCache::Observer {
+  uint hits = 0;
+  uint misses = 0;
+  uint connections = 0;
+
+  void lookedUp(bool cached) override { ++(cached ? hits : misses); }
+  void connected() override { ++connections; }
+};
+
+struct DnsCacheTest {
+  kj::EventLoop loop;
+  kj::WaitScope ws { loop };
+  kj::TimerImpl timer { kj::origin<kj::TimePoint>() };
+  Counts counts;
+  FakeNetwork root { counts };
+  CountingObserver observer;
+  const kj::StringPtr publicPeers[1] = { "public"_kj };
+
+  kj::Own<kj::Network> network(kj::Duration ttl = 30 * kj::SECONDS, size_t maxEntries = 4096) {
+    KJ_IF_SOME(c, cache) {
+      return c->restrictPeers(publicPeers, nullptr, ttl, observer);
+    }
+    return cache.emplace(kj::heap<DnsCache>(root, timer, maxEntries))
+        ->restrictPeers(publicPeers, nullptr, ttl, observer);
+  }
+
+  kj::String lookup(kj::Network& net, kj::StringPtr host) {
+    return net.parseAddress(host, 80).wait(ws)->toString();
+  }
+
+  kj::Maybe<kj::Own<DnsCache>> cache;
+};
+
+KJ_TEST("DnsCache caches lookups until their TTL expires") {
+  DnsCacheTest test;
+  auto net = test.network();
+
+  KJ_EXPECT(test.lookup(*net, "example.com") == "1.example.com");
+  KJ_EXPECT(test.lookup(*net, "example.com") == "1.example.com");
+  KJ_EXPECT(test.lookup(*net, "example.org") == "2.example.org");
+  KJ_EXPECT(test.observer.misses == 2);
+  KJ_EXPECT(test.observer.hits == 1);
+
+  test.timer.advanceTo(test.timer.now() + 30 * kj::SECONDS);
+  KJ_EXPECT(test.lookup(*net, "example.com") == "3.example.com");
+  KJ_EXPECT(test.observer.misses == 3);
+}
+
+KJ_TEST("DnsCache looks up a hostname once for concurrent lookups") {
+  DnsCacheTest test;
+  auto net = test.network();
+
+  auto a = net->parseAddress("example.com", 80);
+  auto b = net->parseAddress("example.com", 80);
+  KJ_EXPECT(a.wait(test.ws)->toString() == "1.example.com");
+  KJ_EXPECT(b.wait(test.ws)->toString() == "1.example.com");
+  KJ_EXPECT(test.counts.resolved == 1);
+  KJ_EXPECT(test.observer.hits == 1);
+}
+
+KJ_TEST("DnsCache doesn't cache failed lookups") {
+  DnsCacheTest test;
+  auto net = test.network();
+
+  KJ_EXPECT_THROW_MESSAGE("DNS lookup failed", net->parseAddress("nx", 80).wait(test.ws));
+  KJ_EXPECT_THROW_MESSAGE("DNS lookup failed", net->parseAddress("nx", 80).wait(test.ws));
+  KJ_EXPECT(test.counts.resolved == 2);
+}
+
+KJ_TEST("DnsCache looks up addresses that failed to connect again") {
+  DnsCacheTest test;
+  auto net = test.network();
+
+  auto address = net->parseAddress("example.com", 80).wait(test.ws);
+  address->connect().wait(test.ws);
+  KJ_EXPECT(test.observer.connections == 1);
+  KJ_EXPECT(test.lookup(*net, "example.com") == "1.example.com");
+
+  test.counts.refuse = true;
+  KJ_EXPECT_THROW_MESSAGE("connection refused", address->connect().wait(test.ws));
+  KJ_EXPECT(test.observer.connections == 1);
+  KJ_EXPECT(test.lookup(*net, "example.com") == "2.example.com");
+}
+
+KJ_TEST("DnsCache shares entries only between networks with the same restrictions") {
+  DnsCacheTest test;
+  auto net = test.network();
+  auto same = test.network();
+  const kj::StringPtr privatePeers[1] = { "private"_kj };
+  auto other = KJ_ASSERT_NONNULL(test.cache)
+      ->restrictPeers(privatePeers, nullptr, 30 * kj::SECONDS, test.observer);
+  KJ_EXPECT(test.counts.restricted == 2);
+
+  KJ_EXPECT(test.lookup(*net, "example.com") == "1.example.com");
+  KJ_EXPECT(test.lookup(*same, "example.com") == "1.example.com");
+  KJ_EXPECT(test.lookup(*other, "example.com") == "2.example.com");
+}
+
+KJ_TEST("DnsCache doesn't cache with a zero TTL") {
+  DnsCacheTest test;
+  auto net = test.network(0 * kj::SECONDS);
+
+  KJ_EXPECT(test.lookup(*net, "example.com") == "1.example.com");
+  KJ_EXPECT(test.lookup(*net, "example.com") == "2.example.com");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.cache)->size() == 0);
+}
+
+KJ_TEST("DnsCache makes room by dropping expired entries") {
+  DnsCacheTest test;
+  auto net = test.network(30 * kj::SECONDS, 2);
+
+  test.lookup(*net, "a.com");
+  test.timer.advanceTo(test.timer.now() + 20 * kj::SECONDS);
+  test.lookup(*net, "b.com");
+
+  // Full, and nothing has expired, so c.com isn't cached.
+  KJ_EXPECT(test.lookup(*net, "c.com") == "3.c.com");
+  KJ_EXPECT(test.lookup(*net, "c.com") == "4.c.com");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.cache)->size() == 2);
+
+  // Once a.com has expired, c.com takes its place.
+  test.timer.advanceTo(test.timer.now() + 10 * kj::SECONDS);
+  KJ_EXPECT(test.lookup(*net, "c.com") == "5.c.com");
+  KJ_EXPECT(test.lookup(*net, "c.com") == "5.c.com");
+  KJ_EXPECT(test.lookup(*net, "b.com") == "2.b.com");
+  KJ_EXPECT(KJ_ASSERT_NONNULL(test.cache)->size() == 2);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,192 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "dns-cache.h"
+#include <kj/debug.h>
+
+namespace workerd::server {
+
+struct DnsCache::Entry final: public kj::Refcounted {
+  // Set once the lookup has succeeded.
+  kj::Maybe<kj::Own<kj::NetworkAddress>> address;
+  kj::TimePoint expires = kj::origin<kj::TimePoint>();
+
+  // Set if the lookup failed, or the address failed to connect. The next lookup replaces the
+  // entry.
+  bool stale = false;
+
+  // Declared last so that the lookup is canceled before the rest is destroyed.
+  kj::ForkedPromise<void> resolved = nullptr;
+};
+
+struct DnsCache::Peers {
+  Peers(kj::Own<kj::Network> network, kj::Duration ttl): network(kj::mv(network)), ttl(ttl) {}
+
+  kj::Own<kj::Network> network;
+  kj::Duration ttl;
+
+  // Keyed by `<portHint> <addr>`.
+  kj::HashMap<kj::String, kj::Own<Entry>> entries;
+};
+
+class DnsCache::CachedAddress final: public kj::NetworkAddress {
+public:
+  CachedAddress(kj::Own<kj::NetworkAddress> inner, kj::Maybe<kj::Own<Entry>> entry,
+                Observer& observer)
+      : inner(kj::mv(inner)), entry(kj::mv(entry)), observer(observer) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> connect() override {
+    return observe(inner->connect(), observer, addRefEntry());
+  }
+  kj::Promise<kj::AuthenticatedStream> connectAuthenticated() override {
+    return observe(inner->connectAuthenticated(), observer, addRefEntry());
+  }
+  kj::Own<kj::ConnectionReceiver> listen() override {
+    return inner->listen();
+  }
+  kj::Own<kj::DatagramPort> bindDatagramPort() override {
+    return inner->bindDatagramPort();
+  }
+  kj::Own<kj::NetworkAddress> clone() override {
+    return kj::heap<CachedAddress>(inner->clone(), addRefEntry(), observer);
+  }
+  kj::String toString() override {
+    return inner->toString();
+  }
+
+private:
+  kj::Own<kj::NetworkAddress> inner;
+  kj::Maybe<kj::Own<Entry>> entry;
+  Observer& observer;
+
+  kj::Maybe<kj::Own<Entry>> addRefEntry() {
+    return entry.map([](kj::Own<Entry>& e) { return kj::addRef(*e); });
+  }
+
+  // Static, because the connection may outlive the address.
+  template <typename T>
+  static kj::Promise<T> observe(kj::Promise<T> promise, Observer& observer,
+                                kj::Maybe<kj::Own<Entry>> entry) {
+    try {
+      T result = co_await promise;
+      observer.connected();
+      co_return kj::mv(result);
+    } catch (...) {
+      KJ_IF_SOME(e, entry) {
+        e->stale = true;
+      }
+      throw;
+    }
+  }
+};
+
+class DnsCache::CachedNetwork final: public kj::Network {
+public:
+  CachedNetwork(DnsCache& cache, Peers& peers, Observer& observer)
+      : cache(cache), peers(peers), observer(observer) {}
+
+  kj::Promise<kj::Own<kj::NetworkAddress>> parseAddress(
+      kj::StringPtr addr, uint portHint) override {
+    return cache.lookup(peers, addr, portHint, observer);
+  }
+
+  kj::Own<kj::NetworkAddress> getSockaddr(const void* sockaddr, uint len) override {
+    auto address = peers.network->getSockaddr(sockaddr, len);
+    return kj::heap<CachedAddress>(kj::mv(address), kj::none, observer);
+  }
+
+  kj::Own<kj::Network> restrictPeers(
+      kj::ArrayPtr<const kj::StringPtr> allow,
+      kj::ArrayPtr<const kj::StringPtr> deny) override {
+    return peers.network->restrictPeers(allow, deny);
+  }
+
+private:
+  DnsCache& cache;
+  Peers& peers;
+  Observer& observer;
+};
+
+DnsCache::~DnsCache() noexcept(false) {}
+
+kj::Own<kj::Network> DnsCache::restrictPeers(
+    kj::ArrayPtr<const kj::StringPtr> allow, kj::ArrayPtr<const kj::StringPtr> deny,
+    kj::Duration ttl, Observer& observer) {
+  auto key = kj::str(kj::strArray(allow, ","), ';', kj::strArray(deny, ","), ';',
+                     ttl / kj::NANOSECONDS);
+  kj::StringPtr keyPtr = key;
+  auto& p = *allPeers.findOrCreate(keyPtr, [&]() -> decltype(allPeers)::Entry {
+    return { kj::mv(key), kj::heap<Peers>(network.restrictPeers(allow, deny), ttl) };
+  });
+  return kj::heap<CachedNetwork>(*this, p, observer);
+}
+
+kj::Promise<kj::Own<kj::NetworkAddress>> DnsCache::lookup(
+    Peers& peers, kj::StringPtr addr, uint portHint, Observer& observer) {
+  // Note that `addr` is only valid until the first co_await.
+
+  if (peers.ttl == 0 * kj::SECONDS) {
+    observer.lookedUp(false);
+    auto address = co_await peers.network->parseAddress(addr, portHint);
+    co_return kj::heap<CachedAddress>(kj::mv(address), kj::none, observer);
+  }
+
+  auto key = kj::str(portHint, ' ', addr);
+  auto now = timer.now();
+  kj::Maybe<kj::Own<Entry>> found;
+  KJ_IF_SOME(entry, peers.entries.find(key)) {
+    if (!entry->stale && (entry->address == kj::none || entry->expires > now)) {
+      found = kj::addRef(*entry);
+    }
+  }
+
+  kj::Own<Entry> entry;
+  KJ_IF_SOME(e, found) {
+    observer.lookedUp(true);
+    entry = kj::mv(e);
+  } else {
+    observer.lookedUp(false);
+
+    // Drop the entry this one replaces, if it's stale or expired.
+    if (peers.entries.erase(key)) {
+      --entryCount;
+    }
+
+    if (entryCount >= maxEntries && !makeRoom()) {
+      auto address = co_await peers.network->parseAddress(addr, portHint);
+      co_return kj::heap<CachedAddress>(kj::mv(address), kj::none, observer);
+    }
+
+    entry = kj::refcounted<Entry>();
+    entry->resolved = resolve(peers, *entry, kj::str(addr), portHint).fork();
+    peers.entries.insert(kj::mv(key), kj::addRef(*entry));
+    ++entryCount;
+  }
+
+  co_await entry->resolved.addBranch();
+  auto address = KJ_ASSERT_NONNULL(entry->address)->clone();
+  co_return kj::heap<CachedAddress>(kj::mv(address), kj::mv(entry), observer);
+}
+
+kj::Promise<void> DnsCache::resolve(Peers& peers, Entry& entry, kj::String addr, uint portHint) {
+  try {
+    entry.address = co_await peers.network->parseAddress(addr, portHint);
+  } catch (...) {
+    entry.stale = true;
+    throw;
+  }
+  entry.expires = timer.now() + peers.ttl;
+}
+
+bool DnsCache::makeRoom() {
+  auto now = timer.now();
+  for (auto& p: allPeers) {
+    entryCount -= p.value->entries.eraseAll([&](kj::String&, kj::Own<Entry>& entry) {
+      return entry->stale || (entry->address != kj::none && entry->expires <= now);
+    });
+  }
+  return entryCount < maxEntries;
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,82 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+#include <kj/map.h>
+#include <kj/timer.h>
+
+namespace workerd::server {
+
+// Caches the addresses hostnames resolve to, for the Network services of a server. Without it,
+// every time an HTTP client has no pooled connection to a host left it resolves the host again,
+// which under bursty load adds a lookup to the setup of most new connections.
+//
+// Peer restrictions are applied by kj when a resolved address is connected to, by whichever
+// network resolved it, so resolved addresses are only shared between networks created with the
+// same allow and deny lists (and TTL). Those networks share one restricted network too.
+//
+// getaddrinfo() doesn't report the TTLs of the records it returns, so results are kept for the
+// TTL the network was created with, which is thus an upper bound rather than the records' own.
+// Failed lookups aren't cached at all, and an address that fails to connect is looked up again
+// by the next connection, in case the host has moved.
+class DnsCache {
+public:
+  // Told about the lookups and connections made through a network returned by restrictPeers(),
+  // e.g. to record metrics.
+  class Observer {
+  public:
+    virtual ~Observer() noexcept(false) = default;
+
+    // A hostname was looked up. `cached` is true if the lookup was answered from the cache, or
+    // joined an identical one in progress.
+    virtual void lookedUp(bool cached) {}
+
+    // A new connection was established.
+    virtual void connected() {}
+  };
+
+  // `maxEntries` bounds the number of resolved addresses kept across all networks. Once it's
+  // reached, expired entries are dropped, and if that doesn't make room, lookups aren't cached.
+  DnsCache(kj::Network& network, kj::Timer& timer, size_t maxEntries = 4096)
+      : network(network), timer(timer), maxEntries(maxEntries) {}
+  ~DnsCache() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(DnsCache);
+
+  // Like `network.restrictPeers(allow, deny)`, but the returned network keeps the addresses it
+  // resolves for `ttl`. A zero `ttl` disables caching. `observer` must outlive the returned
+  // network, which must not outlive the DnsCache.
+  //
+  // Calling restrictPeers() on the returned network returns a network that's neither cached nor
+  // observed.
+  kj::Own<kj::Network> restrictPeers(
+      kj::ArrayPtr<const kj::StringPtr> allow, kj::ArrayPtr<const kj::StringPtr> deny,
+      kj::Duration ttl, Observer& observer);
+
+  // Number of cached addresses, including lookups in progress.
+  size_t size() const { return entryCount; }
+
+private:
+  struct Entry;
+  struct Peers;
+  class CachedNetwork;
+  class CachedAddress;
+
+  kj::Network& network;
+  kj::Timer& timer;
+  size_t maxEntries;
+  size_t entryCount = 0;
+
+  // Keyed by the allow and deny lists and TTL. Values are boxed so that references survive
+  // rehashing.
+  kj::HashMap<kj::String, kj::Own<Peers>> allPeers;
+
+  kj::Promise<kj::Own<kj::NetworkAddress>> lookup(
+      Peers& peers, kj::StringPtr addr, uint portHint, Observer& observer);
+  kj::Promise<void> resolve(Peers& peers, Entry& entry, kj::String addr, uint portHint);
+  bool makeRoom();
+};
+
+}  // namespace workerd::server
@@ -0,0 +1,95 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <workerd/util/sqlite-pcache.h>
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+bool hasLine(kj::StringPtr text, kj::StringPtr line) {
+  return text.startsWith(kj::str(line, '\n')) || text.contains(kj::str('\n', line, '\n'));
+}
+
+KJ_TEST("Metrics::Histogram") {
+  Metrics::Histogram histogram;
+  histogram.record(50 * kj::MICROSECONDS);
+  histogram.record(1 * kj::MILLISECONDS);
+  histogram.record(3 * kj::MILLISECONDS);
+  histogram.record(1 * kj::MINUTES);
+
+  auto snapshot = histogram.snapshot();
+  KJ_EXPECT(snapshot.count == 4);
+  KJ_EXPECT(snapshot.buckets[0] == 1);  // <= 100us
+  KJ_EXPECT(snapshot.buckets[3] == 1);  // <= 1ms, inclusive
+  KJ_EXPECT(snapshot.buckets[5] == 1);  // <= 5ms
+  KJ_EXPECT(snapshot.buckets[Metrics::Histogram::BUCKETS - 1] == 1);  // +Inf
+  KJ_EXPECT(snapshot.sumSeconds > 60.004 && snapshot.sumSeconds < 60.0041, snapshot.sumSeconds);
+}
+
+KJ_TEST("Metrics render") {
+  Metrics metrics;
+
+  // Nothing has been observed yet.
+  KJ_EXPECT(metrics.render() == "# EOF\n", metrics.render());
+
+  auto& requests = metrics.getRequestMetrics("hello", kj::none);
+  KJ_EXPECT(&metrics.getRequestMetrics("hello", kj::none) == &requests);
+  requests.requests.add(3);
+  requests.failures.add();
+  requests.duration.record(2 * kj::MILLISECONDS);
+  metrics.getRequestMetrics("hello", "api"_kj).requests.add();
+  metrics.getActorMetrics("a\"b\\c", "Counter").storageWriteUnits.add(7);
+  metrics.getNetworkMetrics("internet").connectionsOpened.add(2);
+  Metrics::makeWarmDatabaseObserver(metrics.getWarmDatabaseMetrics("hello"))->gotHandle(true);
+
+  auto text = metrics.render();
+  KJ_EXPECT(text.endsWith("\n# EOF\n"), text);
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_requests counter"), text);
+  KJ_EXPECT(hasLine(text, "workerd_requests_total{service=\"hello\",entrypoint=\"default\"} 3"),
+      text);
+  KJ_EXPECT(hasLine(text, "workerd_requests_total{service=\"hello\",entrypoint=\"api\"} 1"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_request_failures_total{service=\"hello\",entrypoint=\"default\"} 1"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_request_duration_seconds_bucket{service=\"hello\",entrypoint=\"default\","
+      "le=\"0.001\"} 0"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_request_duration_seconds_bucket{service=\"hello\",entrypoint=\"default\","
+      "le=\"0.0025\"} 1"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_request_duration_seconds_bucket{service=\"hello\",entrypoint=\"default\","
+      "le=\"+Inf\"} 1"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_request_duration_seconds_count{service=\"hello\",entrypoint=\"default\"} 1"), text);
+
+  KJ_EXPECT(hasLine(text,
+      "workerd_network_connections_opened_total{service=\"internet\"} 2"), text);
+  KJ_EXPECT(hasLine(text,
+      "workerd_sqlite_warm_database_hits_total{service=\"hello\"} 1"), text);
+
+  // Label values are escaped.
+  KJ_EXPECT(hasLine(text,
+      "workerd_actor_storage_write_units_total{service=\"a\\\"b\\\\c\",class=\"Counter\"} 7"), text);
+
+  // Families without any series are left out.
+  KJ_EXPECT(!text.contains("workerd_isolate_lock_wait_seconds"), text);
+}
+
+// Installs the page cache for the rest of the process, so this must stay the last test.
+KJ_TEST("Metrics render the shared SQLite page cache's stats") {
+  Metrics metrics;
+  KJ_EXPECT(!metrics.render().contains("workerd_sqlite"));
+
+  SqlitePageCache::install(1024 * 1024);
+  auto text = metrics.render();
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_sqlite_page_cache_hits counter"), text);
+  KJ_EXPECT(hasLine(text, "workerd_sqlite_page_cache_hits_total 0"), text);
+  KJ_EXPECT(hasLine(text, "# TYPE workerd_sqlite_page_cache_bytes gauge"), text);
+  KJ_EXPECT(hasLine(text, "workerd_sqlite_page_cache_max_bytes 1048576"), text);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,454 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "metrics.h"
+#include <workerd/util/sqlite-pcache.h>
+#include <kj/vector.h>
+#include <algorithm>
+
+namespace workerd::server {
+
+namespace {
+
+uint stripeIndex() {
+  static std::atomic<uint> nextStripe {0};
+  thread_local uint index = nextStripe.fetch_add(1, std::memory_order_relaxed) % Metrics::STRIPES;
+  return index;
+}
+
+kj::TimePoint now() {
+  return kj::systemPreciseMonotonicClock().now();
+}
+
+kj::String escapeLabelValue(kj::StringPtr value) {
+  kj::Vector<char> result(value.size() + 1);
+  for (char c: value) {
+    switch (c) {
+      case '\\': result.addAll("\\\\"_kj); break;
+      case '"': result.addAll("\\\""_kj); break;
+      case '\n': result.addAll("\\n"_kj); break;
+      default: result.add(c); break;
+    }
+  }
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+class WebSocketObserverImpl final: public WebSocketObserver {
+public:
+  explicit WebSocketObserverImpl(Metrics::RequestMetrics& metrics): metrics(metrics) {}
+
+  void sentMessage(size_t bytes) override {
+    metrics.webSocketMessagesSent.add();
+    metrics.webSocketBytesSent.add(bytes);
+  }
+  void receivedMessage(size_t bytes) override {
+    metrics.webSocketMessagesReceived.add();
+    metrics.webSocketBytesReceived.add(bytes);
+  }
+
+private:
+  Metrics::RequestMetrics& metrics;
+};
+
+class RequestObserverImpl final: public RequestObserver {
+public:
+  explicit RequestObserverImpl(Metrics::RequestMetrics& metrics): metrics(metrics) {}
+
+  kj::Maybe<kj::Own<WebSocketObserver>> tryCreateWebSocketObserver() override {
+    return kj::Own<WebSocketObserver>(kj::refcounted<WebSocketObserverImpl>(metrics));
+  }
+
+  void delivered() override {
+    metrics.requests.add();
+    deliveredTime = now();
+  }
+
+  void jsDone() override {
+    KJ_IF_SOME(time, deliveredTime) {
+      metrics.duration.record(now() - time);
+      deliveredTime = kj::none;
+    }
+  }
+
+  void setIsPrewarm() override {
+    metrics.prewarms.add();
+  }
+
+  void reportFailure(const kj::Exception& e) override {
+    metrics.failures.add();
+  }
+
+private:
+  Metrics::RequestMetrics& metrics;
+  kj::Maybe<kj::TimePoint> deliveredTime;
+};
+
+class LockTimingImpl final: public IsolateObserver::LockTiming {
+public:
+  explicit LockTimingImpl(Metrics::IsolateMetrics& metrics): metrics(metrics) {}
+
+  void start() override {
+    startTime = now();
+  }
+  void locked() override {
+    auto time = now();
+    KJ_IF_SOME(start, startTime) {
+      metrics.lockWait.record(time - start);
+    }
+    lockedTime = time;
+  }
+  void stop() override {
+    KJ_IF_SOME(time, lockedTime) {
+      metrics.lockHeld.record(now() - time);
+      lockedTime = kj::none;
+    }
+  }
+
+  void gcPrologue() override {
+    gcStartTime = now();
+  }
+  void gcEpilogue() override {
+    KJ_IF_SOME(time, gcStartTime) {
+      metrics.gcPause.record(now() - time);
+      gcStartTime = kj::none;
+    }
+  }
+
+private:
+  Metrics::IsolateMetrics& metrics;
+  kj::Maybe<kj::TimePoint> startTime;
+  kj::Maybe<kj::TimePoint> lockedTime;
+  kj::Maybe<kj::TimePoint> gcStartTime;
+};
+
+class IsolateObserverImpl final: public IsolateObserver {
+public:
+  explicit IsolateObserverImpl(Metrics::IsolateMetrics& metrics): metrics(metrics) {}
+
+  kj::Maybe<kj::Own<LockTiming>> tryCreateLockTiming(
+      kj::OneOf<SpanParent, kj::Maybe<RequestObserver&>> parentOrRequest) const override {
+    return kj::Own<LockTiming>(kj::heap<LockTimingImpl>(metrics));
+  }
+
+private:
+  Metrics::IsolateMetrics& metrics;
+};
+
+class NetworkObserverImpl final: public DnsCache::Observer {
+public:
+  explicit NetworkObserverImpl(Metrics::NetworkMetrics& metrics): metrics(metrics) {}
+
+  void lookedUp(bool cached) override {
+    if (cached) {
+      metrics.dnsCacheHits.add();
+    } else {
+      metrics.dnsLookups.add();
+    }
+  }
+
+  void connected() override {
+    metrics.connectionsOpened.add();
+  }
+
+private:
+  Metrics::NetworkMetrics& metrics;
+};
+
+class WarmDatabaseObserverImpl final: public ActorSqlite::HandlePool::Observer {
+public:
+  explicit WarmDatabaseObserverImpl(Metrics::WarmDatabaseMetrics& metrics): metrics(metrics) {}
+
+  void gotHandle(bool reused) override {
+    (reused ? metrics.hits : metrics.misses).add();
+  }
+  void evicted() override { metrics.evictions.add(); }
+
+private:
+  Metrics::WarmDatabaseMetrics& metrics;
+};
+
+class ActorObserverImpl final: public ActorObserver {
+public:
+  explicit ActorObserverImpl(Metrics::ActorMetrics& metrics): metrics(metrics) {}
+
+  void webSocketAccepted() override { metrics.webSocketsAccepted.add(); }
+  void webSocketClosed() override { metrics.webSocketsClosed.add(); }
+
+  void addCachedStorageReadUnits(uint32_t units) override {
+    metrics.cachedStorageReadUnits.add(units);
+  }
+  void addUncachedStorageReadUnits(uint32_t units) override {
+    metrics.uncachedStorageReadUnits.add(units);
+  }
+  void addStorageWriteUnits(uint32_t units) override {
+    metrics.storageWriteUnits.add(units);
+  }
+  void addStorageDeletes(uint32_t count) override {
+    metrics.storageDeletes.add(count);
+  }
+
+  void storageReadCompleted(kj::Duration latency) override {
+    metrics.storageReadLatency.record(latency);
+  }
+  void storageWriteCompleted(kj::Duration latency) override {
+    metrics.storageWriteLatency.record(latency);
+  }
+
+private:
+  Metrics::ActorMetrics& metrics;
+};
+
+// Writes one metric family for every series in `map`.
+template <typename T>
+class FamilyRenderer {
+public:
+  FamilyRenderer(kj::Vector<kj::String>& out, const kj::HashMap<kj::String, kj::Own<T>>& map)
+      : out(out), map(map) {}
+
+  void counter(kj::StringPtr name, kj::StringPtr help, Metrics::Counter T::*member) {
+    if (map.size() == 0) return;
+    out.add(kj::str("# TYPE ", name, " counter\n# HELP ", name, ' ', help, '\n'));
+    for (auto& entry: map) {
+      out.add(kj::str(name, "_total{", entry.key, "} ", ((*entry.value).*member).get(), '\n'));
+    }
+  }
+
+  void histogram(kj::StringPtr name, kj::StringPtr help, Metrics::Histogram T::*member) {
+    if (map.size() == 0) return;
+    out.add(kj::str("# TYPE ", name, " histogram\n# HELP ", name, ' ', help, '\n'));
+    for (auto& entry: map) {
+      auto snapshot = ((*entry.value).*member).snapshot();
+      uint64_t cumulative = 0;
+      for (auto i: kj::zeroTo(kj::size(Metrics::Histogram::BOUNDS))) {
+        cumulative += snapshot.buckets[i];
+        out.add(kj::str(name, "_bucket{", entry.key, ",le=\"", Metrics::Histogram::BOUNDS[i],
+                        "\"} ", cumulative, '\n'));
+      }
+      out.add(kj::str(name, "_bucket{", entry.key, ",le=\"+Inf\"} ", snapshot.count, '\n'));
+      out.add(kj::str(name, "_sum{", entry.key, "} ", snapshot.sumSeconds, '\n'));
+      out.add(kj::str(name, "_count{", entry.key, "} ", snapshot.count, '\n'));
+    }
+  }
+
+private:
+  kj::Vector<kj::String>& out;
+  const kj::HashMap<kj::String, kj::Own<T>>& map;
+};
+
+// Write metric families with a single, unlabeled series, for process-wide values that are read
+// when rendering.
+void singleCounter(kj::Vector<kj::String>& out, kj::StringPtr name, kj::StringPtr help,
+                   uint64_t value) {
+  out.add(kj::str("# TYPE ", name, " counter\n# HELP ", name, ' ', help, '\n',
+                  name, "_total ", value, '\n'));
+}
+
+void singleGauge(kj::Vector<kj::String>& out, kj::StringPtr name, kj::StringPtr help,
+                 uint64_t value) {
+  out.add(kj::str("# TYPE ", name, " gauge\n# HELP ", name, ' ', help, '\n',
+                  name, ' ', value, '\n'));
+}
+
+}  // namespace
+
+void Metrics::Counter::add(uint64_t n) {
+  stripes[stripeIndex()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::get() const {
+  uint64_t total = 0;
+  for (auto& stripe: stripes) {
+    total += stripe.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void Metrics::Histogram::record(kj::Duration duration) {
+  int64_t nanos = kj::max(duration / kj::NANOSECONDS, int64_t(0));
+  double seconds = nanos / 1e9;
+  size_t bucket = std::lower_bound(BOUNDS, BOUNDS + kj::size(BOUNDS), seconds) - BOUNDS;
+
+  auto& stripe = stripes[stripeIndex()];
+  stripe.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  stripe.sumNanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::snapshot() const {
+  Snapshot result;
+  uint64_t sumNanos = 0;
+  for (auto& stripe: stripes) {
+    for (auto i: kj::zeroTo(BUCKETS)) {
+      result.buckets[i] += stripe.buckets[i].load(std::memory_order_relaxed);
+    }
+    sumNanos += stripe.sumNanos.load(std::memory_order_relaxed);
+  }
+  for (auto count: result.buckets) {
+    result.count += count;
+  }
+  result.sumSeconds = sumNanos / 1e9;
+  return result;
+}
+
+template <typename T>
+T& Metrics::getOrCreate(kj::HashMap<kj::String, kj::Own<T>>& map, kj::String labels) {
+  kj::StringPtr key = labels;
+  return *map.findOrCreate(key, [&]() -> typename kj::HashMap<kj::String, kj::Own<T>>::Entry {
+    return { kj::mv(labels), kj::heap<T>() };
+  });
+}
+
+Metrics::RequestMetrics& Metrics::getRequestMetrics(
+    kj::StringPtr service, kj::Maybe<kj::StringPtr> entrypoint) {
+  auto labels = kj::str("service=\"", escapeLabelValue(service), "\",entrypoint=\"",
+                        escapeLabelValue(entrypoint.orDefault("default"_kj)), '"');
+  return getOrCreate(state.lockExclusive()->requests, kj::mv(labels));
+}
+
+Metrics::IsolateMetrics& Metrics::getIsolateMetrics(kj::StringPtr service) {
+  auto labels = kj::str("service=\"", escapeLabelValue(service), '"');
+  return getOrCreate(state.lockExclusive()->isolates, kj::mv(labels));
+}
+
+Metrics::ActorMetrics& Metrics::getActorMetrics(kj::StringPtr service, kj::StringPtr className) {
+  auto labels = kj::str("service=\"", escapeLabelValue(service), "\",class=\"",
+                        escapeLabelValue(className), '"');
+  return getOrCreate(state.lockExclusive()->actors, kj::mv(labels));
+}
+
+Metrics::NetworkMetrics& Metrics::getNetworkMetrics(kj::StringPtr service) {
+  auto labels = kj::str("service=\"", escapeLabelValue(service), '"');
+  return getOrCreate(state.lockExclusive()->networks, kj::mv(labels));
+}
+
+Metrics::WarmDatabaseMetrics& Metrics::getWarmDatabaseMetrics(kj::StringPtr service) {
+  auto labels = kj::str("service=\"", escapeLabelValue(service), '"');
+  return getOrCreate(state.lockExclusive()->warmDatabases, kj::mv(labels));
+}
+
+kj::Own<RequestObserver> Metrics::makeRequestObserver(RequestMetrics& metrics) {
+  return kj::refcounted<RequestObserverImpl>(metrics);
+}
+
+kj::Own<IsolateObserver> Metrics::makeIsolateObserver(IsolateMetrics& metrics) {
+  return kj::atomicRefcounted<IsolateObserverImpl>(metrics);
+}
+
+kj::Own<ActorObserver> Metrics::makeActorObserver(ActorMetrics& metrics) {
+  return kj::refcounted<ActorObserverImpl>(metrics);
+}
+
+kj::Own<DnsCache::Observer> Metrics::makeNetworkObserver(NetworkMetrics& metrics) {
+  return kj::heap<NetworkObserverImpl>(metrics);
+}
+
+kj::Own<ActorSqlite::HandlePool::Observer> Metrics::makeWarmDatabaseObserver(
+    WarmDatabaseMetrics& metrics) {
+  return kj::heap<WarmDatabaseObserverImpl>(metrics);
+}
+
+kj::String Metrics::render() const {
+  auto lock = state.lockShared();
+  kj::Vector<kj::String> out;
+
+  FamilyRenderer<RequestMetrics> requests(out, lock->requests);
+  requests.counter("workerd_requests", "Requests delivered to a Worker.",
+      &RequestMetrics::requests);
+  requests.counter("workerd_request_failures", "Requests that failed with an exception.",
+      &RequestMetrics::failures);
+  requests.counter("workerd_prewarms", "Prewarm requests.",
+      &RequestMetrics::prewarms);
+  requests.histogram("workerd_request_duration_seconds",
+      "Time from delivering a request until no more JavaScript runs on its behalf.",
+      &RequestMetrics::duration);
+  requests.counter("workerd_websocket_messages_sent", "WebSocket messages sent by a Worker.",
+      &RequestMetrics::webSocketMessagesSent);
+  requests.counter("workerd_websocket_bytes_sent", "WebSocket message bytes sent by a Worker.",
+      &RequestMetrics::webSocketBytesSent);
+  requests.counter("workerd_websocket_messages_received",
+      "WebSocket messages received by a Worker.",
+      &RequestMetrics::webSocketMessagesReceived);
+  requests.counter("workerd_websocket_bytes_received",
+      "WebSocket message bytes received by a Worker.",
+      &RequestMetrics::webSocketBytesReceived);
+
+  FamilyRenderer<IsolateMetrics> isolates(out, lock->isolates);
+  isolates.histogram("workerd_isolate_lock_wait_seconds",
+      "Time spent waiting to lock a Worker's isolate.",
+      &IsolateMetrics::lockWait);
+  isolates.histogram("workerd_isolate_lock_held_seconds",
+      "Time spent holding a Worker's isolate lock, i.e. running JavaScript.",
+      &IsolateMetrics::lockHeld);
+  isolates.histogram("workerd_isolate_gc_pause_seconds",
+      "Garbage collection pauses while holding a Worker's isolate lock.",
+      &IsolateMetrics::gcPause);
+
+  FamilyRenderer<ActorMetrics> actors(out, lock->actors);
+  actors.counter("workerd_actor_storage_cached_read_units",
+      "Durable Object storage read units served from cache.",
+      &ActorMetrics::cachedStorageReadUnits);
+  actors.counter("workerd_actor_storage_uncached_read_units",
+      "Durable Object storage read units served from storage.",
+      &ActorMetrics::uncachedStorageReadUnits);
+  actors.counter("workerd_actor_storage_write_units", "Durable Object storage write units.",
+      &ActorMetrics::storageWriteUnits);
+  actors.counter("workerd_actor_storage_deletes", "Durable Object storage deletes.",
+      &ActorMetrics::storageDeletes);
+  actors.histogram("workerd_actor_storage_read_latency_seconds",
+      "Latency of Durable Object storage reads.",
+      &ActorMetrics::storageReadLatency);
+  actors.histogram("workerd_actor_storage_write_latency_seconds",
+      "Latency of Durable Object storage writes.",
+      &ActorMetrics::storageWriteLatency);
+  actors.counter("workerd_actor_websockets_accepted", "WebSockets accepted by Durable Objects.",
+      &ActorMetrics::webSocketsAccepted);
+  actors.counter("workerd_actor_websockets_closed", "WebSockets of Durable Objects that closed.",
+      &ActorMetrics::webSocketsClosed);
+
+  FamilyRenderer<NetworkMetrics> networks(out, lock->networks);
+  networks.counter("workerd_network_requests",
+      "Requests and connect() calls sent out by a Network service.",
+      &NetworkMetrics::requests);
+  networks.counter("workerd_network_connections_opened",
+      "New connections opened by a Network service. Its other requests reused pooled ones.",
+      &NetworkMetrics::connectionsOpened);
+  networks.counter("workerd_network_dns_lookups",
+      "Hostname lookups by a Network service that went to the resolver.",
+      &NetworkMetrics::dnsLookups);
+  networks.counter("workerd_network_dns_cache_hits",
+      "Hostname lookups by a Network service answered from the DNS cache.",
+      &NetworkMetrics::dnsCacheHits);
+
+  FamilyRenderer<WarmDatabaseMetrics> warmDatabases(out, lock->warmDatabases);
+  warmDatabases.counter("workerd_sqlite_warm_database_hits",
+      "Durable Object databases reopened from those kept open after eviction.",
+      &WarmDatabaseMetrics::hits);
+  warmDatabases.counter("workerd_sqlite_warm_database_misses",
+      "Durable Object databases that had to be opened from disk.",
+      &WarmDatabaseMetrics::misses);
+  warmDatabases.counter("workerd_sqlite_warm_database_evictions",
+      "Databases of evicted Durable Objects closed to stay within the warm database limit.",
+      &WarmDatabaseMetrics::evictions);
+
+  if (SqlitePageCache::isInstalled()) {
+    auto stats = SqlitePageCache::getStats();
+    singleCounter(out, "workerd_sqlite_page_cache_hits",
+        "Page lookups answered by the shared SQLite page cache.", stats.hits);
+    singleCounter(out, "workerd_sqlite_page_cache_misses",
+        "Page lookups that missed the shared SQLite page cache.", stats.misses);
+    singleCounter(out, "workerd_sqlite_page_cache_evictions",
+        "Pages evicted from the shared SQLite page cache to make room.", stats.evictions);
+    singleGauge(out, "workerd_sqlite_page_cache_pages",
+        "Pages held by the shared SQLite page cache.", stats.pageCount);
+    singleGauge(out, "workerd_sqlite_page_cache_bytes",
+        "Bytes held by the shared SQLite page cache.", stats.bytes);
+    singleGauge(out, "workerd_sqlite_page_cache_max_bytes",
+        "Byte budget of the shared SQLite page cache.", stats.maxBytes);
+  }
+
+  out.add(kj::str("# EOF\n"));
+  return kj::strArray(out, "");
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,166 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/actor-sqlite.h>
+#include <workerd/io/observer.h>
+#include <workerd/server/dns-cache.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <atomic>
+
+namespace workerd::server {
+
+// Collects runtime metrics about the Workers in this process, through the hooks in
+// io/observer.h, and renders them in the Prometheus/OpenMetrics text exposition format.
+//
+// A Metrics object exists only if the config defines a `metrics` service; otherwise workerd
+// installs the default observers, which observe nothing.
+//
+// Recording never takes a lock: every counter and histogram is split into stripes, and each thread
+// only ever increments the stripe assigned to it, with relaxed atomics. Rendering sums the
+// stripes without stopping writers, so a scrape may see half of a concurrent update (e.g. a
+// histogram's bucket but not its sum), which is fine for monitoring.
+class Metrics {
+public:
+  Metrics() = default;
+  KJ_DISALLOW_COPY_AND_MOVE(Metrics);
+
+  // Number of stripes per metric. Threads are assigned stripes round-robin.
+  static constexpr uint STRIPES = 8;
+
+  class Counter {
+  public:
+    void add(uint64_t n = 1);
+    uint64_t get() const;
+
+  private:
+    struct alignas(64) Stripe {
+      std::atomic<uint64_t> value {0};
+    };
+    Stripe stripes[STRIPES];
+  };
+
+  // A histogram of durations. Bucket bounds are fixed, from 100us to 10s, which covers anything
+  // from a cached fetch to a CPU-heavy request.
+  class Histogram {
+  public:
+    static constexpr double BOUNDS[] = {
+      0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+      0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+    };
+    static constexpr size_t BUCKETS = kj::size(BOUNDS) + 1;  // The last bucket is +Inf.
+
+    void record(kj::Duration duration);
+
+    struct Snapshot {
+      // Not cumulative; bucket i counts the durations in (BOUNDS[i - 1], BOUNDS[i]].
+      uint64_t buckets[BUCKETS] = {};
+      uint64_t count = 0;
+      double sumSeconds = 0;
+    };
+    Snapshot snapshot() const;
+
+  private:
+    struct alignas(64) Stripe {
+      std::atomic<uint64_t> buckets[BUCKETS] {};
+      std::atomic<uint64_t> sumNanos {0};
+    };
+    Stripe stripes[STRIPES];
+  };
+
+  // Metrics of requests to one entrypoint of a service.
+  struct RequestMetrics {
+    Counter requests;
+    Counter failures;
+    Counter prewarms;
+    Counter webSocketMessagesSent;
+    Counter webSocketBytesSent;
+    Counter webSocketMessagesReceived;
+    Counter webSocketBytesReceived;
+
+    // From delivery until no more JavaScript runs on behalf of the request.
+    Histogram duration;
+  };
+
+  // Metrics of the isolate of a service.
+  struct IsolateMetrics {
+    // Time spent waiting for the isolate lock, and holding it. Workers only run while holding the
+    // lock, so the latter is a good measure of their CPU time.
+    Histogram lockWait;
+    Histogram lockHeld;
+    Histogram gcPause;
+  };
+
+  // Metrics of the Durable Objects of one class.
+  struct ActorMetrics {
+    Counter cachedStorageReadUnits;
+    Counter uncachedStorageReadUnits;
+    Counter storageWriteUnits;
+    Counter storageDeletes;
+    Counter webSocketsAccepted;
+    Counter webSocketsClosed;
+    Histogram storageReadLatency;
+    Histogram storageWriteLatency;
+  };
+
+  // Metrics of a Network service's outbound connections. Requests that didn't need a new
+  // connection reused one from the pool.
+  struct NetworkMetrics {
+    Counter requests;
+    Counter connectionsOpened;
+    Counter dnsLookups;
+    Counter dnsCacheHits;
+  };
+
+  // Metrics of the databases a Worker keeps open for Durable Objects it evicted; see
+  // `sqlite.warmDatabaseLimit`.
+  struct WarmDatabaseMetrics {
+    Counter hits;
+    Counter misses;
+    Counter evictions;
+  };
+
+  // Return the metrics for the given labels, creating them the first time they're asked for. The
+  // results stay valid for the lifetime of the Metrics object. `entrypoint` is kj::none for a
+  // service's default entrypoint.
+  RequestMetrics& getRequestMetrics(kj::StringPtr service, kj::Maybe<kj::StringPtr> entrypoint);
+  IsolateMetrics& getIsolateMetrics(kj::StringPtr service);
+  ActorMetrics& getActorMetrics(kj::StringPtr service, kj::StringPtr className);
+  NetworkMetrics& getNetworkMetrics(kj::StringPtr service);
+  WarmDatabaseMetrics& getWarmDatabaseMetrics(kj::StringPtr service);
+
+  // Make observers that record into the given metrics, which must outlive them.
+  static kj::Own<RequestObserver> makeRequestObserver(RequestMetrics& metrics);
+  static kj::Own<IsolateObserver> makeIsolateObserver(IsolateMetrics& metrics);
+  static kj::Own<ActorObserver> makeActorObserver(ActorMetrics& metrics);
+  static kj::Own<DnsCache::Observer> makeNetworkObserver(NetworkMetrics& metrics);
+  static kj::Own<ActorSqlite::HandlePool::Observer> makeWarmDatabaseObserver(
+      WarmDatabaseMetrics& metrics);
+
+  // Renders all metrics in the OpenMetrics text format, terminated by `# EOF`.
+  kj::String render() const;
+
+  // Content-Type to serve render()'s output with.
+  static constexpr kj::StringPtr CONTENT_TYPE =
+      "application/openmetrics-text; version=1.0.0; charset=utf-8"_kj;
+
+private:
+  // Each map is keyed by the label set, formatted for output, e.g.
+  // `service="foo",entrypoint="bar"`. Values are boxed so that references survive rehashing.
+  struct State {
+    kj::HashMap<kj::String, kj::Own<RequestMetrics>> requests;
+    kj::HashMap<kj::String, kj::Own<IsolateMetrics>> isolates;
+    kj::HashMap<kj::String, kj::Own<ActorMetrics>> actors;
+    kj::HashMap<kj::String, kj::Own<NetworkMetrics>> networks;
+    kj::HashMap<kj::String, kj::Own<WarmDatabaseMetrics>> warmDatabases;
+  };
+  kj::MutexGuarded<State> state;
+
+  template <typename T>
+  static T& getOrCreate(kj::HashMap<kj::String, kj::Own<T>>& map, kj::String labels);
+};
+
+}  // namespace workerd::server
@@ -0,0 +1,251 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "request-coalescer.h"
+#include <kj/test.h>
+
+namespace workerd::server {
+namespace {
+
+struct CoalescerTest;
+
+// Sends requests through the coalescer to the test's upstream service.
+class FrontService final: public kj::HttpService {
+public:
+  explicit FrontService(CoalescerTest& test): test(test) {}
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override;
+
+private:
+  CoalescerTest& test;
+};
+
+// Also the upstream service, which answers requests once `release()` is called with their URL
+// and User-Agent header, repeated `bodyRepeat` times.
+struct CoalescerTest final: public kj::HttpService {
+  kj::EventLoop loop;
+  kj::WaitScope ws { loop };
+  kj::HttpHeaderTable::Builder builder;
+  RequestCoalescer::HeaderIds ids { builder };
+  kj::HttpHeaderId acceptEncoding = builder.add("Accept-Encoding");
+  kj::HttpHeaderId setCookie = builder.add("Set-Cookie");
+  kj::HttpHeaderId vary = builder.add("Vary");
+  kj::HttpHeaderId userAgent = builder.add("User-Agent");
+  kj::HttpHeaderId xApiKey = builder.add("X-Api-Key");
+  kj::Own<kj::HttpHeaderTable> table = builder.build();
+
+  RequestCoalescer coalescer { ids, 1024 };
+  FrontService front { *this };
+  kj::Own<kj::HttpClient> client = kj::newHttpClient(front);
+
+  kj::Maybe<kj::StringPtr> responseVary;
+  bool responseSetsCookie = false;
+  kj::Maybe<kj::Exception> failure;
+  size_t bodyRepeat = 1;
+  uint upstreamRequests = 0;
+
+  kj::Own<kj::PromiseFulfiller<void>> releaseFulfiller;
+  kj::ForkedPromise<void> released = nullptr;
+
+  CoalescerTest() {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    releaseFulfiller = kj::mv(paf.fulfiller);
+    released = paf.promise.fork();
+  }
+
+  void release() { releaseFulfiller->fulfill(); }
+
+  kj::Promise<kj::String> fetch(kj::StringPtr url,
+                                kj::Maybe<kj::StringPtr> agent = kj::none,
+                                kj::Maybe<kj::StringPtr> encoding = kj::none,
+                                kj::HttpMethod method = kj::HttpMethod::GET,
+                                kj::Maybe<kj::StringPtr> apiKey = kj::none) {
+    kj::HttpHeaders headers(*table);
+    KJ_IF_SOME(a, agent) {
+      headers.set(userAgent, a);
+    }
+    KJ_IF_SOME(e, encoding) {
+      headers.set(acceptEncoding, e);
+    }
+    KJ_IF_SOME(k, apiKey) {
+      headers.set(xApiKey, k);
+    }
+    auto request = client->request(method, url, headers, uint64_t(0));
+    return request.response.then([](kj::HttpClient::Response&& response) {
+      return response.body->readAllText().attach(kj::mv(response.body));
+    }).eagerlyEvaluate(nullptr);
+  }
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, Response& response) override {
+    ++upstreamRequests;
+    auto body = kj::str(url, ' ', headers.get(userAgent).orDefault("-"_kj));
+    co_await released.addBranch();
+    KJ_IF_SOME(e, failure) {
+      kj::throwFatalException(kj::cp(e));
+    }
+
+    kj::HttpHeaders responseHeaders(*table);
+    KJ_IF_SOME(v, responseVary) {
+      responseHeaders.set(vary, v);
+    }
+    if (responseSetsCookie) {
+      responseHeaders.set(setCookie, "session=1");
+    }
+    auto out = response.send(200, "OK", responseHeaders, uint64_t(body.size() * bodyRepeat));
+    for (auto i KJ_UNUSED: kj::zeroTo(bodyRepeat)) {
+      co_await out->write(body.asBytes());
+    }
+  }
+};
+
+kj::Promise<void> FrontService::request(
+    kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+    kj::AsyncInputStream& requestBody, Response& response) {
+  return test.coalescer.request(method, url, headers, requestBody, response, kj::none,
+      [this]() -> kj::Own<kj::HttpService> { return { &test, kj::NullDisposer::instance }; });
+}
+
+KJ_TEST("RequestCoalescer sends identical requests once") {
+  CoalescerTest test;
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/foo");
+  auto c = test.fetch("/foo");
+  test.ws.poll();
+  KJ_EXPECT(test.upstreamRequests == 1);
+  KJ_EXPECT(test.coalescer.inFlight() == 1);
+
+  test.release();
+  KJ_EXPECT(a.wait(test.ws) == "/foo -");
+  KJ_EXPECT(b.wait(test.ws) == "/foo -");
+  KJ_EXPECT(c.wait(test.ws) == "/foo -");
+  KJ_EXPECT(test.upstreamRequests == 1);
+  KJ_EXPECT(test.coalescer.inFlight() == 0);
+
+  // Once the response has arrived, the next request is sent again.
+  KJ_EXPECT(test.fetch("/foo").wait(test.ws) == "/foo -");
+  KJ_EXPECT(test.upstreamRequests == 2);
+}
+
+KJ_TEST("RequestCoalescer doesn't coalesce different requests") {
+  CoalescerTest test;
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/bar");
+  auto c = test.fetch("/foo", kj::none, "gzip"_kj);
+  auto d = test.fetch("/foo", kj::none, kj::none, kj::HttpMethod::POST);
+  test.ws.poll();
+  KJ_EXPECT(test.upstreamRequests == 4);
+
+  test.release();
+  KJ_EXPECT(a.wait(test.ws) == "/foo -");
+  KJ_EXPECT(b.wait(test.ws) == "/bar -");
+  KJ_EXPECT(c.wait(test.ws) == "/foo -");
+  KJ_EXPECT(d.wait(test.ws) == "/foo -");
+}
+
+KJ_TEST("RequestCoalescer doesn't coalesce requests with headers outside its key") {
+  CoalescerTest test;
+
+  // The service may well answer differently for each key, whether or not it says so in Vary.
+  auto a = test.fetch("/foo", kj::none, kj::none, kj::HttpMethod::GET, "alice"_kj);
+  auto b = test.fetch("/foo", kj::none, kj::none, kj::HttpMethod::GET, "bob"_kj);
+  test.ws.poll();
+  KJ_EXPECT(test.upstreamRequests == 2);
+  KJ_EXPECT(test.coalescer.inFlight() == 0);
+
+  test.release();
+  a.wait(test.ws);
+  b.wait(test.ws);
+}
+
+KJ_TEST("RequestCoalescer resends requests that don't match the response's Vary") {
+  CoalescerTest test;
+  test.responseVary = "User-Agent"_kj;
+
+  auto a = test.fetch("/foo", "a"_kj);
+  auto b = test.fetch("/foo", "b"_kj);
+  auto c = test.fetch("/foo", "a"_kj);
+  auto d = test.fetch("/foo");
+  test.ws.poll();
+  KJ_EXPECT(test.upstreamRequests == 1);
+
+  test.release();
+  KJ_EXPECT(a.wait(test.ws) == "/foo a");
+  KJ_EXPECT(b.wait(test.ws) == "/foo b");
+  KJ_EXPECT(c.wait(test.ws) == "/foo a");
+  KJ_EXPECT(d.wait(test.ws) == "/foo -");
+  KJ_EXPECT(test.upstreamRequests == 3);
+}
+
+KJ_TEST("RequestCoalescer doesn't share responses that set cookies") {
+  CoalescerTest test;
+  test.responseSetsCookie = true;
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/foo");
+  test.ws.poll();
+  KJ_EXPECT(test.upstreamRequests == 1);
+
+  test.release();
+  KJ_EXPECT(a.wait(test.ws) == "/foo -");
+  KJ_EXPECT(b.wait(test.ws) == "/foo -");
+  KJ_EXPECT(test.upstreamRequests == 2);
+}
+
+KJ_TEST("RequestCoalescer fails all coalesced requests if the service fails") {
+  CoalescerTest test;
+  test.failure = KJ_EXCEPTION(FAILED, "upstream failed");
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/foo");
+  test.ws.poll();
+
+  test.release();
+  KJ_EXPECT_THROW_MESSAGE("upstream failed", a.wait(test.ws));
+  KJ_EXPECT_THROW_MESSAGE("upstream failed", b.wait(test.ws));
+  KJ_EXPECT(test.upstreamRequests == 1);
+  KJ_EXPECT(test.coalescer.inFlight() == 0);
+}
+
+KJ_TEST("RequestCoalescer streams bodies larger than its buffer") {
+  CoalescerTest test;
+  test.bodyRepeat = 10000;
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/foo");
+  test.ws.poll();
+
+  test.release();
+  kj::Vector<kj::StringPtr> parts;
+  for (auto i KJ_UNUSED: kj::zeroTo(10000)) {
+    parts.add("/foo -"_kj);
+  }
+  auto expected = kj::strArray(parts, "");
+  KJ_EXPECT(a.wait(test.ws) == expected);
+  KJ_EXPECT(b.wait(test.ws) == expected);
+  KJ_EXPECT(test.upstreamRequests == 1);
+}
+
+KJ_TEST("RequestCoalescer keeps the request going while anyone waits for it") {
+  CoalescerTest test;
+
+  auto a = test.fetch("/foo");
+  auto b = test.fetch("/foo");
+  test.ws.poll();
+
+  // The request that was sent is canceled, but the other still gets the response.
+  a = nullptr;
+  test.ws.poll();
+  test.release();
+  KJ_EXPECT(b.wait(test.ws) == "/foo -");
+  KJ_EXPECT(test.upstreamRequests == 1);
+}
+
+}  // namespace
+}  // namespace workerd::server
@@ -0,0 +1,456 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "request-coalescer.h"
+#include <workerd/util/http-util.h>
+#include <kj/debug.h>
+#include <deque>
+
+namespace workerd::server {
+
+namespace {
+
+constexpr kj::StringPtr KEY_HEADERS[] = {
+  "Accept"_kj,
+  "Accept-Encoding"_kj,
+  "Accept-Language"_kj,
+  "Authorization"_kj,
+  "Cookie"_kj,
+  "If-Modified-Since"_kj,
+  "If-None-Match"_kj,
+  "Range"_kj,
+};
+
+// Headers that requests may carry and still be coalesced without them being part of the key:
+// they describe the connection or the client software rather than who is asking. A request with
+// any header not here or in KEY_HEADERS, e.g. a credential in a custom header like X-Api-Key,
+// might get a different response than another request, so is sent on by itself.
+constexpr kj::StringPtr NEUTRAL_HEADERS[] = {
+  "Cache-Control"_kj,
+  "Connection"_kj,
+  "Content-Length"_kj,
+  "Host"_kj,
+  "Keep-Alive"_kj,
+  "Pragma"_kj,
+  "TE"_kj,
+  "User-Agent"_kj,
+  "Via"_kj,
+};
+
+bool isCoalescable(kj::StringPtr headerName) {
+  for (auto name: KEY_HEADERS) {
+    if (equalsIgnoreCase(headerName, name)) return true;
+  }
+  for (auto name: NEUTRAL_HEADERS) {
+    if (equalsIgnoreCase(headerName, name)) return true;
+  }
+  return false;
+}
+
+kj::Array<kj::HttpHeaderId> addHeaders(
+    kj::HttpHeaderTable::Builder& builder, kj::ArrayPtr<const kj::StringPtr> names) {
+  auto result = kj::heapArrayBuilder<kj::HttpHeaderId>(names.size());
+  for (auto name: names) {
+    result.add(builder.add(name));
+  }
+  return result.finish();
+}
+
+// The body of a GET request.
+class EmptyInputStream final: public kj::AsyncInputStream {
+public:
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return size_t(0);
+  }
+  kj::Maybe<uint64_t> tryGetLength() override {
+    return uint64_t(0);
+  }
+};
+
+// Wakes up everyone waiting on it whenever it's raised.
+class Signal {
+public:
+  kj::Promise<void> wait() {
+    if (fulfiller == kj::none) {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      fulfiller = kj::mv(paf.fulfiller);
+      promise = paf.promise.fork();
+    }
+    return promise.addBranch();
+  }
+
+  void raise() {
+    KJ_IF_SOME(f, fulfiller) {
+      f->fulfill();
+    }
+    fulfiller = kj::none;
+  }
+
+private:
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> fulfiller;
+  kj::ForkedPromise<void> promise = nullptr;
+};
+
+// A response body, written once and read by any number of readers at their own pace. Chunks are
+// kept until every reader still attached has read them. Stream offsets are counted from the start
+// of the body.
+class BodyBroadcast {
+public:
+  explicit BodyBroadcast(size_t bufferSize): bufferSize(bufferSize) {}
+
+  // Readers can only be added before anything is written.
+  uint addReader() {
+    KJ_REQUIRE(end == 0 && !done, "can't add a reader once the body has started");
+    readers.add(Reader { .position = 0, .attached = true });
+    return readers.size() - 1;
+  }
+
+  void removeReader(uint reader) {
+    readers[reader].attached = false;
+    trim();
+  }
+
+  // Completes once the slowest reader is no more than `bufferSize` bytes behind.
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> data) {
+    if (data.size() > 0) {
+      chunks.push_back(Chunk { .offset = end, .data = kj::heapArray(data) });
+      bufferedBytes += data.size();
+      end += data.size();
+      dataAvailable.raise();
+      trim();
+    }
+    while (bufferedBytes > bufferSize) {
+      co_await spaceAvailable.wait();
+    }
+  }
+
+  void finish() {
+    done = true;
+    dataAvailable.raise();
+  }
+
+  void fail(kj::Exception exception) {
+    error = kj::mv(exception);
+    finish();
+  }
+
+  // Writes the whole body to `out`, or throws if writing it failed. Readers still get everything
+  // written before the failure first.
+  kj::Promise<void> pumpTo(uint reader, kj::AsyncOutputStream& out) {
+    for (;;) {
+      uint64_t position = readers[reader].position;
+      if (position < end) {
+        // The chunk stays alive until this reader moves past it.
+        auto piece = pieceAt(position);
+        co_await out.write(piece);
+        readers[reader].position += piece.size();
+        trim();
+      } else if (done) {
+        KJ_IF_SOME(e, error) {
+          kj::throwFatalException(kj::cp(e));
+        }
+        co_return;
+      } else {
+        co_await dataAvailable.wait();
+      }
+    }
+  }
+
+private:
+  struct Chunk {
+    uint64_t offset;
+    kj::Array<kj::byte> data;
+  };
+  struct Reader {
+    uint64_t position;
+    bool attached;
+  };
+
+  size_t bufferSize;
+  kj::Vector<Reader> readers;
+  std::deque<Chunk> chunks;
+  size_t bufferedBytes = 0;
+  uint64_t end = 0;
+  bool done = false;
+  kj::Maybe<kj::Exception> error;
+
+  Signal dataAvailable;
+  Signal spaceAvailable;
+
+  kj::ArrayPtr<const kj::byte> pieceAt(uint64_t position) {
+    for (auto& chunk: chunks) {
+      if (position < chunk.offset + chunk.data.size()) {
+        return chunk.data.slice(position - chunk.offset, chunk.data.size());
+      }
+    }
+    KJ_UNREACHABLE;
+  }
+
+  // Drops the chunks every attached reader has read.
+  void trim() {
+    uint64_t minPosition = end;
+    for (auto& reader: readers) {
+      if (reader.attached) minPosition = kj::min(minPosition, reader.position);
+    }
+    bool trimmed = false;
+    while (!chunks.empty() && chunks.front().offset + chunks.front().data.size() <= minPosition) {
+      bufferedBytes -= chunks.front().data.size();
+      chunks.pop_front();
+      trimmed = true;
+    }
+    if (trimmed && bufferedBytes <= bufferSize) {
+      spaceAvailable.raise();
+    }
+  }
+};
+
+class BodyWriter final: public kj::AsyncOutputStream {
+public:
+  explicit BodyWriter(BodyBroadcast& body): body(body) {}
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override {
+    return body.write(buffer);
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    for (auto piece: pieces) {
+      co_await body.write(piece);
+    }
+  }
+  kj::Promise<void> whenWriteDisconnected() override {
+    return kj::NEVER_DONE;
+  }
+
+private:
+  BodyBroadcast& body;
+};
+
+}  // namespace
+
+RequestCoalescer::HeaderIds::HeaderIds(kj::HttpHeaderTable::Builder& builder)
+    : key(addHeaders(builder, kj::arrayPtr(KEY_HEADERS, kj::size(KEY_HEADERS)))),
+      cacheControl(builder.add("Cache-Control")),
+      setCookie(builder.add("Set-Cookie")),
+      upgrade(builder.add("Upgrade")),
+      vary(builder.add("Vary")) {}
+
+// One request sent on, and the response the requests coalesced with it are waiting for. Each of
+// those holds a reference; when none are left, the request is canceled.
+class RequestCoalescer::Flight final: public kj::Refcounted, private kj::HttpService::Response {
+public:
+  Flight(RequestCoalescer& coalescer, kj::String key, kj::StringPtr url,
+         const kj::HttpHeaders& headers, kj::Own<kj::HttpService> upstream)
+      : coalescer(coalescer), key(kj::mv(key)), url(kj::str(url)),
+        requestHeaders(headers.clone()), upstream(kj::mv(upstream)),
+        body(coalescer.bufferSize) {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    headFulfiller = kj::mv(paf.fulfiller);
+    headReady = paf.promise.fork();
+    coalescer.flights.insert(this->key, this);
+  }
+
+  ~Flight() noexcept(false) {
+    task = nullptr;
+    closeWindow();
+  }
+
+  // Sends the request. Called once the request that started the flight has joined it, since the
+  // response may arrive right away.
+  void start() {
+    task = run().eagerlyEvaluate(nullptr);
+  }
+
+private:
+  friend class RequestCoalescer;
+
+  struct Head {
+    uint statusCode;
+    kj::String statusText;
+    kj::HttpHeaders headers;
+    kj::Maybe<uint64_t> expectedBodySize;
+    bool shareable;
+  };
+
+  RequestCoalescer& coalescer;
+  kj::String key;
+  kj::String url;
+  kj::HttpHeaders requestHeaders;
+  kj::Own<kj::HttpService> upstream;
+  BodyBroadcast body;
+
+  // Set once `headReady` resolves.
+  kj::Maybe<Head> head;
+  kj::Own<kj::PromiseFulfiller<void>> headFulfiller;
+  kj::ForkedPromise<void> headReady = nullptr;
+
+  bool accepting = true;
+  kj::Promise<void> task = nullptr;
+
+  kj::Promise<void> run() {
+    EmptyInputStream requestBody;
+    try {
+      co_await upstream->request(kj::HttpMethod::GET, url, requestHeaders, requestBody, *this);
+    } catch (...) {
+      auto exception = kj::getCaughtExceptionAsKj();
+      closeWindow();
+      if (headFulfiller->isWaiting()) {
+        headFulfiller->reject(kj::cp(exception));
+      }
+      body.fail(kj::mv(exception));
+      co_return;
+    }
+
+    closeWindow();
+    if (headFulfiller->isWaiting()) {
+      headFulfiller->reject(KJ_EXCEPTION(FAILED, "service returned without sending a response"));
+    }
+    body.finish();
+  }
+
+  // Stops identical requests from joining the flight.
+  void closeWindow() {
+    if (accepting) {
+      accepting = false;
+      coalescer.flights.erase(key);
+    }
+  }
+
+  kj::Own<kj::AsyncOutputStream> send(
+      uint statusCode, kj::StringPtr statusText, const kj::HttpHeaders& headers,
+      kj::Maybe<uint64_t> expectedBodySize) override {
+    closeWindow();
+    head = Head {
+      .statusCode = statusCode,
+      .statusText = kj::str(statusText),
+      .headers = headers.clone(),
+      .expectedBodySize = expectedBodySize,
+      .shareable = coalescer.isShareable(headers),
+    };
+    headFulfiller->fulfill();
+    return kj::heap<BodyWriter>(body);
+  }
+
+  kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
+    KJ_FAIL_REQUIRE("coalesced requests can't be upgraded to WebSockets");
+  }
+};
+
+kj::Promise<void> RequestCoalescer::request(
+    kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+    kj::AsyncInputStream& requestBody, kj::HttpService::Response& response,
+    kj::Maybe<kj::StringPtr> cfBlobJson,
+    kj::Function<kj::Own<kj::HttpService>()> startUpstream) {
+  kj::Own<Flight> flight;
+  bool leading = false;
+  KJ_IF_SOME(key, keyFor(method, url, headers, requestBody, cfBlobJson)) {
+    KJ_IF_SOME(existing, flights.find(key)) {
+      flight = kj::addRef(*existing);
+    } else {
+      flight = kj::refcounted<Flight>(*this, kj::mv(key), url, headers, startUpstream());
+      leading = true;
+    }
+  } else {
+    auto upstream = startUpstream();
+    co_await upstream->request(method, url, headers, requestBody, response);
+    co_return;
+  }
+
+  uint reader = flight->body.addReader();
+  KJ_DEFER(flight->body.removeReader(reader));
+  if (leading) {
+    flight->start();
+  }
+
+  co_await flight->headReady.addBranch();
+  auto& head = KJ_ASSERT_NONNULL(flight->head);
+
+  // The response was made for the request that started the flight, which can always use it.
+  if (!leading && !(head.shareable && varyMatches(*flight, headers))) {
+    flight->body.removeReader(reader);
+    auto upstream = startUpstream();
+    co_await upstream->request(method, url, headers, requestBody, response);
+    co_return;
+  }
+
+  auto out = response.send(head.statusCode, head.statusText, head.headers, head.expectedBodySize);
+  co_await flight->body.pumpTo(reader, *out);
+}
+
+kj::Maybe<kj::String> RequestCoalescer::keyFor(
+    kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+    kj::AsyncInputStream& requestBody, kj::Maybe<kj::StringPtr> cfBlobJson) {
+  if (method != kj::HttpMethod::GET || headers.get(ids.upgrade) != kj::none) {
+    return kj::none;
+  }
+  KJ_IF_SOME(length, requestBody.tryGetLength()) {
+    if (length > 0) return kj::none;
+  } else {
+    return kj::none;
+  }
+
+  bool coalescable = true;
+  headers.forEach([&](kj::StringPtr name, kj::StringPtr) {
+    if (!isCoalescable(name)) coalescable = false;
+  });
+  if (!coalescable) return kj::none;
+
+  // Header values can't contain newlines, so this is unambiguous.
+  kj::Vector<kj::String> parts;
+  parts.add(kj::str(url));
+  for (auto i: kj::indices(ids.key)) {
+    KJ_IF_SOME(value, headers.get(ids.key[i])) {
+      parts.add(kj::str(i, ':', value));
+    }
+  }
+
+  // Last, so that any newlines it contains can't be mistaken for the end of a header's value.
+  KJ_IF_SOME(cf, cfBlobJson) {
+    parts.add(kj::str("cf:", cf));
+  }
+  return kj::strArray(parts, "\n");
+}
+
+bool RequestCoalescer::isShareable(const kj::HttpHeaders& responseHeaders) {
+  if (responseHeaders.get(ids.setCookie) != kj::none) {
+    // The cookie is presumably meant for one client only.
+    return false;
+  }
+  bool shareable = true;
+  forEachListElement(responseHeaders.get(ids.cacheControl).orDefault(""_kj),
+                     [&](kj::String directive) {
+    kj::StringPtr name = directive;
+    KJ_IF_SOME(i, directive.findFirst('=')) {
+      directive[i] = '\0';
+      name = kj::StringPtr(directive.begin(), i);
+    }
+    if (equalsIgnoreCase(name, "private") || equalsIgnoreCase(name, "no-store")) {
+      shareable = false;
+    }
+  });
+  return shareable;
+}
+
+bool RequestCoalescer::varyMatches(const Flight& flight, const kj::HttpHeaders& headers) {
+  auto& head = KJ_ASSERT_NONNULL(flight.head);
+  bool matches = true;
+  forEachListElement(head.headers.get(ids.vary).orDefault(""_kj), [&](kj::String name) {
+    if (name == "*") {
+      matches = false;
+      return;
+    }
+    auto sent = findHeader(flight.requestHeaders, name);
+    auto requested = findHeader(headers, name);
+    KJ_IF_SOME(s, sent) {
+      KJ_IF_SOME(r, requested) {
+        if (s != r) matches = false;
+      } else {
+        matches = false;
+      }
+    } else if (requested != kj::none) {
+      matches = false;
+    }
+  });
+  return matches;
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,81 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/compat/http.h>
+#include <kj/function.h>
+#include <kj/map.h>
+
+namespace workerd::server {
+
+// Coalesces identical GET requests to a service: while one request waits for the service's
+// response, identical requests that arrive aren't sent on but wait for that response, and get a
+// copy of it. This spares the service a stampede of requests for the same resource, e.g. when a
+// popular URL has just dropped out of a cache.
+//
+// Requests are identical if they have the same URL and the same values for the headers that
+// commonly select between representations of a resource, or carry credentials (see
+// `HeaderIds::key`). A response may vary on other headers too, so a request only gets a copy if
+// it has the same values as the request that was sent for each header the response's Vary
+// header lists; otherwise it's sent on by itself once the response arrives. Neither are
+// responses that set cookies or are marked private shared. Requests carrying any header that's
+// neither part of the key nor known not to affect the response (e.g. Host or User-Agent) are
+// never coalesced, since it may be a credential the service answers differently for. Nor are
+// requests with different `cf` properties, which the service may act on or answer differently for.
+//
+// Only requests that arrive before the response's headers do are coalesced. The body is then
+// streamed to all of them, with the service made to wait while the fastest is more than
+// `bufferSize` bytes ahead of the slowest.
+class RequestCoalescer {
+public:
+  // IDs of the headers the coalescer needs, which must be registered in the same header table as
+  // the requests it will receive.
+  struct HeaderIds {
+    explicit HeaderIds(kj::HttpHeaderTable::Builder& builder);
+
+    // Headers that must have the same values for requests to be coalesced.
+    kj::Array<kj::HttpHeaderId> key;
+
+    kj::HttpHeaderId cacheControl;
+    kj::HttpHeaderId setCookie;
+    kj::HttpHeaderId upgrade;
+    kj::HttpHeaderId vary;
+  };
+
+  explicit RequestCoalescer(const HeaderIds& ids, size_t bufferSize = 1 << 20)
+      : ids(ids), bufferSize(bufferSize) {}
+  KJ_DISALLOW_COPY_AND_MOVE(RequestCoalescer);
+
+  // Number of requests sent on that identical requests can still be coalesced with.
+  size_t inFlight() const { return flights.size(); }
+
+  // Handles a request on behalf of the service. `startUpstream` is called, at most once, if the
+  // request needs to be sent on to the service; if it's coalesced with another, it isn't.
+  // `cfBlobJson` is the request's JSON-encoded `cf` properties, if any, which need only remain
+  // valid until `startUpstream` is called.
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response,
+      kj::Maybe<kj::StringPtr> cfBlobJson,
+      kj::Function<kj::Own<kj::HttpService>()> startUpstream);
+
+private:
+  class Flight;
+
+  const HeaderIds& ids;
+  size_t bufferSize;
+
+  // Requests sent on which are still waiting for their response's headers. Keyed by the key the
+  // flight owns.
+  kj::HashMap<kj::StringPtr, Flight*> flights;
+
+  kj::Maybe<kj::String> keyFor(kj::HttpMethod method, kj::StringPtr url,
+                               const kj::HttpHeaders& headers, kj::AsyncInputStream& requestBody,
+                               kj::Maybe<kj::StringPtr> cfBlobJson);
+  bool isShareable(const kj::HttpHeaders& responseHeaders);
+  bool varyMatches(const Flight& flight, const kj::HttpHeaders& headers);
+};
+
+}  // namespace workerd::server
@@ -20,7 +20,6 @@
 #include <workerd/io/compatibility-date.h>
 #include <workerd/io/io-context.h>
 #include <workerd/io/worker.h>
-#include <time.h>
 #include <openssl/bio.h>
 #include <openssl/pem.h>
 #include <workerd/io/actor-cache.h>
@@ -33,9 +32,19 @@
 #include <workerd/util/use-perfetto-categories.h>
 #include <workerd/api/worker-rpc.h>
 #include "workerd-api.h"
+#include "metrics.h"
+#include "dns-cache.h"
+#include "cache-store.h"
+#include "request-coalescer.h"
+#include "worker-limits.h"
 #include "workerd/io/hibernation-manager.h"
 #include <stdlib.h>
 
+#if __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
 namespace workerd::server {
 
 namespace {
@@ -76,22 +85,6 @@ static kj::Maybe<PemData> decodePem(kj::ArrayPtr<const char> text) {
   return PemData { kj::String(kj::mv(nameArr)), kj::mv(data) };
 }
 
-// Returns a time string in the format HTTP likes to use.
-static kj::String httpTime(kj::Date date) {
-  time_t time = (date - kj::UNIX_EPOCH) / kj::SECONDS;
-#if _WIN32
-  // `gmtime` is thread-safe on Windows: https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/gmtime-gmtime32-gmtime64?view=msvc-170#return-value
-  auto tm = *gmtime(&time);
-#else
-  struct tm tm;
-  KJ_ASSERT(gmtime_r(&time, &tm) == &tm);
-#endif
-  char buf[256]{};
-  size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
-  KJ_ASSERT(n > 0);
-  return kj::heapString(buf, n);
-}
-
 static kj::Vector<char> escapeJsonString(kj::StringPtr text) {
   static const char HEXDIGITS[] = "0123456789abcdef";
   kj::Vector<char> escaped(text.size() + 1);
@@ -134,7 +127,8 @@ Server::Server(kj::Filesystem& fs, kj::Timer& timer, kj::Network& network,
                kj::Function<void(kj::String)> reportConfigError)
     : fs(fs), timer(timer), network(network), entropySource(entropySource),
       reportConfigError(kj::mv(reportConfigError)), consoleMode(consoleMode),
-      memoryCacheProvider(kj::heap<api::MemoryCacheProvider>()), tasks(*this) {}
+      memoryCacheProvider(kj::heap<api::MemoryCacheProvider>()),
+      dnsCache(kj::heap<DnsCache>(network, timer)), tasks(*this) {}
 
 Server::~Server() noexcept(false) {}
 
@@ -144,6 +138,7 @@ struct Server::GlobalContext {
   capnp::HttpOverCapnpFactory httpOverCapnpFactory;
   ThreadContext threadContext;
   kj::HttpHeaderTable& headerTable;
+  RequestCoalescer::HeaderIds coalescerHeaderIds;
 
   GlobalContext(Server& server, jsg::V8System& v8System,
                 kj::HttpHeaderTable::Builder& headerTableBuilder)
@@ -154,7 +149,8 @@ struct Server::GlobalContext {
             headerTableBuilder, httpOverCapnpFactory,
             byteStreamFactory,
             false /* isFiddle -- TODO(beta): support */),
-        headerTable(headerTableBuilder.getFutureTable()) {}
+        headerTable(headerTableBuilder.getFutureTable()),
+        coalescerHeaderIds(headerTableBuilder) {}
 };
 
 class Server::Service {
@@ -174,6 +170,19 @@ public:
 // =======================================================================================
 
 kj::Own<kj::TlsContext> Server::makeTlsContext(config::TlsOptions::Reader conf) {
+  if (!conf.getShareSessionCache()) {
+    return newTlsContext(conf);
+  }
+
+  auto key = conf.toString().flatten();
+  kj::StringPtr keyPtr = key;
+  auto& context = *tlsContexts.findOrCreate(keyPtr, [&]() -> decltype(tlsContexts)::Entry {
+    return { kj::mv(key), newTlsContext(conf) };
+  });
+  return { context.get(), kj::NullDisposer::instance };
+}
+
+kj::Own<kj::TlsContext> Server::newTlsContext(config::TlsOptions::Reader conf) {
   kj::TlsContext::Options options;
 
   struct Attachments {
@@ -540,7 +549,8 @@ public:
                       kj::Own<HttpRewriter> rewriter, kj::HttpHeaderTable& headerTable,
                       kj::Timer& timer, kj::EntropySource& entropySource,
                       capnp::ByteStreamFactory& byteStreamFactory,
-                      capnp::HttpOverCapnpFactory& httpOverCapnpFactory)
+                      capnp::HttpOverCapnpFactory& httpOverCapnpFactory,
+                      bool multiplexHttp)
       : addr(kj::mv(addrParam)),
         inner(kj::newHttpClient(timer, headerTable, *addr, {
           .entropySource = entropySource,
@@ -551,6 +561,7 @@ public:
         headerTable(headerTable),
         byteStreamFactory(byteStreamFactory),
         httpOverCapnpFactory(httpOverCapnpFactory),
+        multiplexHttp(multiplexHttp),
         waitUntilTasks(*this) {}
 
   kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
@@ -572,6 +583,7 @@ private:
   kj::HttpHeaderTable& headerTable;
   capnp::ByteStreamFactory& byteStreamFactory;
   capnp::HttpOverCapnpFactory& httpOverCapnpFactory;
+  bool multiplexHttp;
   kj::TaskSet waitUntilTasks;
 
   void taskFailed(kj::Exception&& exception) override {
@@ -618,6 +630,20 @@ private:
     return c.rpcSystem.bootstrap().castAs<rpc::WorkerdBootstrap>();
   }
 
+  // Where HTTP requests are sent: over a connection of their own, or for `multiplexHttp`, as one
+  // of the many streams of the capnp connection.
+  kj::Own<kj::HttpService> getHttpService() {
+    if (!multiplexHttp) {
+      return { serviceAdapter.get(), kj::NullDisposer::instance };
+    }
+
+    // Pipelined, so the request is on its way without waiting for the dispatcher.
+    auto dispatcher = getOutgoingCapnp(*inner)
+        .startEventRequest(capnp::MessageSize {4, 0}).send().getDispatcher();
+    return httpOverCapnpFactory.capnpToKj(
+        dispatcher.getHttpServiceRequest(capnp::MessageSize {4, 0}).send().getHttp());
+  }
+
   class WorkerInterfaceImpl final: public WorkerInterface, private kj::HttpService::Response {
   public:
     WorkerInterfaceImpl(ExternalHttpService& parent, IoChannelFactory::SubrequestMetadata metadata)
@@ -629,12 +655,14 @@ private:
       TRACE_EVENT("workerd", "ExternalHttpServer::request()");
       KJ_REQUIRE(wrappedResponse == kj::none, "object should only receive one request");
       wrappedResponse = response;
+      auto service = parent.getHttpService();
       if (parent.rewriter->needsRewriteRequest()) {
         auto rewrite = parent.rewriter->rewriteOutgoingRequest(url, headers, metadata.cfBlobJson);
-        return parent.serviceAdapter->request(method, url, *rewrite.headers, requestBody, *this)
-            .attach(kj::mv(rewrite));
+        return service->request(method, url, *rewrite.headers, requestBody, *this)
+            .attach(kj::mv(rewrite), kj::mv(service));
       } else {
-        return parent.serviceAdapter->request(method, url, headers, requestBody, *this);
+        return service->request(method, url, headers, requestBody, *this)
+            .attach(kj::mv(service));
       }
     }
 
@@ -719,8 +747,19 @@ kj::Own<Server::Service> Server::makeExternalService(
     return makeInvalidConfigService();
   }
 
+  bool multiplexHttp = conf.getMultiplexHttp();
+  auto checkMultiplexHttp = [&](config::HttpOptions::Reader options) {
+    if (multiplexHttp && !options.hasCapnpConnectHost()) {
+      reportConfigError(kj::str(
+          "External service \"", name, "\" sets multiplexHttp, which requires its HTTP options "
+          "to set capnpConnectHost."));
+      multiplexHttp = false;
+    }
+  };
+
   switch (conf.which()) {
     case config::ExternalServer::HTTP: {
+      checkMultiplexHttp(conf.getHttp());
       // We have to construct the rewriter upfront before waiting on any promises, since the
       // HeaderTable::Builder is only available synchronously.
       auto rewriter = kj::heap<HttpRewriter>(conf.getHttp(), headerTableBuilder);
@@ -728,10 +767,11 @@ kj::Own<Server::Service> Server::makeExternalService(
       return kj::heap<ExternalHttpService>(
           kj::mv(addr), kj::mv(rewriter), headerTableBuilder.getFutureTable(),
           timer, entropySource, globalContext->byteStreamFactory,
-          globalContext->httpOverCapnpFactory);
+          globalContext->httpOverCapnpFactory, multiplexHttp);
     }
     case config::ExternalServer::HTTPS: {
       auto httpsConf = conf.getHttps();
+      checkMultiplexHttp(httpsConf.getOptions());
       kj::Maybe<kj::StringPtr> certificateHost;
       if (httpsConf.hasCertificateHost()) {
         certificateHost = httpsConf.getCertificateHost();
@@ -742,9 +782,14 @@ kj::Own<Server::Service> Server::makeExternalService(
       return kj::heap<ExternalHttpService>(
           kj::mv(addr), kj::mv(rewriter), headerTableBuilder.getFutureTable(),
           timer, entropySource, globalContext->byteStreamFactory,
-          globalContext->httpOverCapnpFactory);
+          globalContext->httpOverCapnpFactory, multiplexHttp);
     }
     case config::ExternalServer::TCP: {
+      if (multiplexHttp) {
+        reportConfigError(kj::str(
+            "External service \"", name, "\" sets multiplexHttp, which only applies to HTTP "
+            "and HTTPS servers."));
+      }
       auto tcpConf = conf.getTcp();
       auto addr = kj::heap<PromisedNetworkAddress>(network.parseAddress(addrStr, 80));
       if (tcpConf.hasTlsOptions()) {
@@ -764,6 +809,23 @@ kj::Own<Server::Service> Server::makeExternalService(
   return makeInvalidConfigService();
 }
 
+static kj::Maybe<Metrics::NetworkMetrics&> getNetworkMetrics(
+    kj::Maybe<kj::Own<Metrics>>& metrics, kj::StringPtr name) {
+  return metrics.map([&](kj::Own<Metrics>& m) -> Metrics::NetworkMetrics& {
+    return m->getNetworkMetrics(name);
+  });
+}
+
+// Returns an observer of a Network service's DNS cache, which records into its metrics if there
+// are any.
+static kj::Own<DnsCache::Observer> makeNetworkObserver(
+    kj::Maybe<Metrics::NetworkMetrics&> networkMetrics) {
+  KJ_IF_SOME(m, networkMetrics) {
+    return Metrics::makeNetworkObserver(m);
+  }
+  return kj::heap<DnsCache::Observer>();
+}
+
 // Service used when the service is configured as network service.
 class Server::NetworkService final: public Service, private WorkerInterface {
 public:
@@ -771,14 +833,18 @@ public:
                  kj::Timer& timer, kj::EntropySource& entropySource,
                  kj::Own<kj::Network> networkParam,
                  kj::Maybe<kj::Own<kj::Network>> tlsNetworkParam,
-                 kj::Maybe<kj::SecureNetworkWrapper&> tlsContext)
+                 kj::Maybe<kj::SecureNetworkWrapper&> tlsContext,
+                 kj::Duration idleTimeout,
+                 kj::Maybe<Metrics::NetworkMetrics&> metrics)
       : network(kj::mv(networkParam)), tlsNetwork(kj::mv(tlsNetworkParam)),
         inner(kj::newHttpClient(timer, headerTable, *network, tlsNetwork, {
+          .idleTimeout = idleTimeout,
           .entropySource = entropySource,
           .webSocketCompressionMode = kj::HttpClientSettings::MANUAL_COMPRESSION,
           .tlsContext = tlsContext
         })),
-        serviceAdapter(kj::newHttpService(*inner)) {}
+        serviceAdapter(kj::newHttpService(*inner)),
+        metrics(metrics) {}
 
   kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
     return { this, kj::NullDisposer::instance };
@@ -793,11 +859,15 @@ private:
   kj::Maybe<kj::Own<kj::Network>> tlsNetwork;
   kj::Own<kj::HttpClient> inner;
   kj::Own<kj::HttpService> serviceAdapter;
+  kj::Maybe<Metrics::NetworkMetrics&> metrics;
 
   kj::Promise<void> request(
       kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
       kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
     TRACE_EVENT("workerd", "NetworkService::request()");
+    KJ_IF_SOME(m, metrics) {
+      m.requests.add();
+    }
     return serviceAdapter->request(method, url, headers, requestBody, response);
   }
 
@@ -809,6 +879,9 @@ private:
     // It represents a proxy-less TCP connection, which means we can simply defer the handling of
     // the connection to the service adapter (likely NetworkHttpClient). Its behaviour will be to
     // connect directly to the host over TCP.
+    KJ_IF_SOME(m, metrics) {
+      m.requests.add();
+    }
     return serviceAdapter->connect(host, headers, connection, tunnel, kj::mv(settings));
   }
 
@@ -828,11 +901,18 @@ private:
   }
 };
 
-kj::Own<Server::Service> Server::makeNetworkService(config::Network::Reader conf) {
+kj::Own<Server::Service> Server::makeNetworkService(
+    kj::StringPtr name, config::Network::Reader conf) {
   TRACE_EVENT("workerd", "Server::makeNetworkService()");
-  auto restrictedNetwork = network.restrictPeers(
+  auto networkMetrics = getNetworkMetrics(metrics, name);
+
+  // Connections made through `restrictedNetwork` are counted by the observer, including those the
+  // TLS network below makes through it.
+  auto observer = makeNetworkObserver(networkMetrics);
+  auto restrictedNetwork = dnsCache->restrictPeers(
       KJ_MAP(a, conf.getAllow()) -> kj::StringPtr { return a; },
-      KJ_MAP(a, conf.getDeny() ) -> kj::StringPtr { return a; });
+      KJ_MAP(a, conf.getDeny() ) -> kj::StringPtr { return a; },
+      conf.getDnsCacheTtlSeconds() * kj::SECONDS, *observer).attach(kj::mv(observer));
 
   kj::Maybe<kj::Own<kj::Network>> tlsNetwork;
   kj::Maybe<kj::SecureNetworkWrapper&> tlsContext;
@@ -843,7 +923,8 @@ kj::Own<Server::Service> Server::makeNetworkService(config::Network::Reader conf
   }
 
   return kj::heap<NetworkService>(globalContext->headerTable, timer, entropySource,
-                                  kj::mv(restrictedNetwork), kj::mv(tlsNetwork), tlsContext);
+                                  kj::mv(restrictedNetwork), kj::mv(tlsNetwork), tlsContext,
+                                  conf.getIdleTimeoutSeconds() * kj::SECONDS, networkMetrics);
 }
 
 // Service used when the service is configured as disk directory service.
@@ -1126,6 +1207,249 @@ kj::Own<Server::Service> Server::makeDiskDirectoryService(
 
 // =======================================================================================
 
+// Serves the server's runtime metrics to scrapers such as Prometheus.
+class Server::MetricsService final: public Service, private WorkerInterface {
+public:
+  MetricsService(const Metrics& metrics, kj::HttpHeaderTable::Builder& headerTableBuilder)
+      : metrics(metrics), headerTable(headerTableBuilder.getFutureTable()) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  const Metrics& metrics;
+  kj::HttpHeaderTable& headerTable;
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr urlStr, const kj::HttpHeaders& requestHeaders,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    TRACE_EVENT("workerd", "MetricsService::request()");
+    if (method != kj::HttpMethod::GET) {
+      co_return co_await response.sendError(405, "Method Not Allowed", headerTable);
+    }
+
+    auto body = metrics.render();
+    kj::HttpHeaders headers(headerTable);
+    headers.set(kj::HttpHeaderId::CONTENT_TYPE, Metrics::CONTENT_TYPE);
+    auto out = response.send(200, "OK", headers, body.size());
+    co_await out->write(body.asBytes());
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Metrics services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeMetricsService(
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  // startServices() creates `metrics` before any service if the config has a metrics service.
+  return kj::heap<MetricsService>(*KJ_ASSERT_NONNULL(metrics), headerTableBuilder);
+}
+
+// =======================================================================================
+
+// Stores responses for the Cache API of Workers that name it as their `cacheApiOutbound`.
+class Server::CacheService final: public Service, private WorkerInterface {
+public:
+  // Called by link() to open the store, once the directory service it uses can be looked up.
+  using LinkCallback = kj::Function<kj::Own<CacheStore>(const CacheStore::HeaderIds& ids)>;
+
+  CacheService(kj::HttpHeaderTable::Builder& headerTableBuilder, LinkCallback linkCallback)
+      : ids(headerTableBuilder), store(kj::mv(linkCallback)) {}
+
+  void link() override {
+    LinkCallback callback = kj::mv(KJ_REQUIRE_NONNULL(
+        store.tryGet<LinkCallback>(), "already called link()"));
+    store = callback(ids);
+  }
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return { this, kj::NullDisposer::instance };
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return handlerName == "fetch"_kj;
+  }
+
+private:
+  CacheStore::HeaderIds ids;
+  kj::OneOf<LinkCallback, kj::Own<CacheStore>> store;
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    TRACE_EVENT("workerd", "CacheService::request()", "url", url.cStr());
+    auto& s = *KJ_REQUIRE_NONNULL(store.tryGet<kj::Own<CacheStore>>(),
+                                  "link() has not been called");
+    return s.request(method, url, headers, requestBody, response);
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    throwUnsupported();
+  }
+  void prewarm(kj::StringPtr url) override {}
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    throwUnsupported();
+  }
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    throwUnsupported();
+  }
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    throwUnsupported();
+  }
+
+  [[noreturn]] void throwUnsupported() {
+    JSG_FAIL_REQUIRE(Error, "Cache services don't support this event type.");
+  }
+};
+
+kj::Own<Server::Service> Server::makeCacheService(
+    kj::StringPtr name, config::Cache::Reader conf,
+    kj::HttpHeaderTable::Builder& headerTableBuilder) {
+  CacheStore::Options options {
+    .maxSize = uint64_t(conf.getMaxSizeMb()) << 20,
+    .maxEntrySize = uint64_t(kj::min(conf.getMaxEntrySizeMb(), conf.getMaxSizeMb())) << 20,
+  };
+
+  return kj::heap<CacheService>(headerTableBuilder,
+      [this, name, conf, options](const CacheStore::HeaderIds& ids) -> kj::Own<CacheStore> {
+    auto& clock = kj::systemPreciseCalendarClock();
+
+    if (conf.hasDirectory()) {
+      kj::StringPtr diskName = conf.getDirectory();
+      KJ_IF_SOME(svc, services.find(diskName)) {
+        auto diskSvc = dynamic_cast<DiskDirectoryService*>(svc.get());
+        if (diskSvc == nullptr) {
+          reportConfigError(kj::str("service ", name, ": directory refers to the service \"",
+              diskName, "\", but that service is not a local disk service."));
+        } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
+          return kj::heap<CacheStore>(ids, dir, clock, options);
+        } else {
+          reportConfigError(kj::str("service ", name, ": directory refers to the disk service \"",
+              diskName, "\", but that service is defined read-only."));
+        }
+      } else {
+        reportConfigError(kj::str("service ", name, ": directory refers to a service \"",
+            diskName, "\", but no such service is defined."));
+      }
+    }
+
+    // Either no directory was configured, or the config is invalid and we won't be serving
+    // anyway. Keep responses in memory.
+    auto dir = kj::newInMemoryDirectory(clock);
+    auto store = kj::heap<CacheStore>(ids, *dir, clock, options);
+    return store.attach(kj::mv(dir));
+  });
+}
+
+// =======================================================================================
+
+// Wraps the service a designator with `coalesceRequests` refers to, coalescing identical GET
+// requests sent to it while one is in flight.
+class Server::CoalescingService final: public Service {
+public:
+  CoalescingService(const RequestCoalescer::HeaderIds& ids, Service& inner)
+      : coalescer(ids), inner(inner) {}
+
+  kj::Own<WorkerInterface> startRequest(IoChannelFactory::SubrequestMetadata metadata) override {
+    return kj::heap<Request>(*this, kj::mv(metadata));
+  }
+
+  bool hasHandler(kj::StringPtr handlerName) override {
+    return inner.hasHandler(handlerName);
+  }
+
+private:
+  class Request;
+
+  RequestCoalescer coalescer;
+  Service& inner;
+};
+
+// Only starts a request to the inner service if it's needed, which it isn't for HTTP requests
+// that are coalesced with another.
+class Server::CoalescingService::Request final: public WorkerInterface {
+public:
+  Request(CoalescingService& service, IoChannelFactory::SubrequestMetadata metadata)
+      : service(service), metadata(kj::mv(metadata)) {}
+
+  kj::Promise<void> request(
+      kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+      kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+    TRACE_EVENT("workerd", "CoalescingService::request()", "url", url.cStr());
+    // Requests with different `cf` properties may get different responses, so they're part of the
+    // key.
+    kj::Maybe<kj::StringPtr> cfBlobJson;
+    KJ_IF_SOME(m, metadata) {
+      KJ_IF_SOME(cf, m.cfBlobJson) {
+        cfBlobJson = cf;
+      }
+    }
+    return service.coalescer.request(method, url, headers, requestBody, response, cfBlobJson,
+        [this]() -> kj::Own<kj::HttpService> { return startInner(); });
+  }
+
+  kj::Promise<void> connect(kj::StringPtr host, const kj::HttpHeaders& headers,
+      kj::AsyncIoStream& connection, kj::HttpService::ConnectResponse& response,
+      kj::HttpConnectSettings settings) override {
+    auto worker = startInner();
+    return worker->connect(host, headers, connection, response, settings).attach(kj::mv(worker));
+  }
+
+  // Only a hint, and this request may not need the inner service at all.
+  void prewarm(kj::StringPtr url) override {}
+
+  kj::Promise<ScheduledResult> runScheduled(kj::Date scheduledTime, kj::StringPtr cron) override {
+    auto worker = startInner();
+    return worker->runScheduled(scheduledTime, cron).attach(kj::mv(worker));
+  }
+
+  kj::Promise<AlarmResult> runAlarm(kj::Date scheduledTime, uint32_t retryCount) override {
+    auto worker = startInner();
+    return worker->runAlarm(scheduledTime, retryCount).attach(kj::mv(worker));
+  }
+
+  kj::Promise<CustomEvent::Result> customEvent(kj::Own<CustomEvent> event) override {
+    auto worker = startInner();
+    return worker->customEvent(kj::mv(event)).attach(kj::mv(worker));
+  }
+
+private:
+  CoalescingService& service;
+  kj::Maybe<IoChannelFactory::SubrequestMetadata> metadata;
+
+  kj::Own<WorkerInterface> startInner() {
+    auto m = kj::mv(KJ_REQUIRE_NONNULL(metadata, "request already started"));
+    metadata = kj::none;
+    return service.inner.startRequest(kj::mv(m));
+  }
+};
+
+// =======================================================================================
+
 // This class exists to update the InspectorService's table of isolates when a config
 // has multiple services. The InspectorService exists on the stack of it's own thread and
 // initializes state that is bound to the thread, e.g. a http server and an event loop.
@@ -1382,18 +1706,28 @@ public:
     kj::Maybe<Service&> cache;
     kj::Maybe<kj::Own<SqliteDatabase::Vfs>> actorStorage;
     AlarmScheduler& alarmScheduler;
+
+    // Databases in `actorStorage` of recently evicted actors. Declared after `actorStorage` so
+    // that it's destroyed first.
+    kj::Maybe<kj::Own<ActorSqlite::HandlePool>> sqliteHandlePool;
+    kj::Maybe<TeeSpillOptions> teeSpill;
   };
   using LinkCallback = kj::Function<LinkedIoChannels(WorkerService&)>;
   using AbortActorsCallback = kj::Function<void()>;
 
-  WorkerService(ThreadContext& threadContext, kj::Own<const Worker> worker,
+  WorkerService(ThreadContext& threadContext, kj::StringPtr name, kj::Own<const Worker> worker,
+                const WorkerLimitEnforcer& limits,
                 kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers,
                 kj::HashMap<kj::String, kj::HashSet<kj::String>> namedEntrypointsParam,
                 const kj::HashMap<kj::String, ActorConfig>& actorClasses,
-                LinkCallback linkCallback, AbortActorsCallback abortActorsCallback)
+                LinkCallback linkCallback, AbortActorsCallback abortActorsCallback,
+                kj::Maybe<Metrics&> metrics)
       : threadContext(threadContext),
+        name(kj::str(name)),
+        metrics(metrics),
         ioChannels(kj::mv(linkCallback)),
         worker(kj::mv(worker)),
+        limits(limits),
         defaultEntrypointHandlers(kj::mv(defaultEntrypointHandlers)),
         waitUntilTasks(*this), abortActorsCallback(kj::mv(abortActorsCallback)) {
 
@@ -1458,16 +1792,30 @@ public:
         kj::atomicAddRef(*worker),
         entrypointName,
         kj::mv(actor),
-        kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance),
+        limits.wrapRequest(kj::Own<LimitEnforcer>(this, kj::NullDisposer::instance)),
         {},                        // ioContextDependency
         kj::Own<IoChannelFactory>(this, kj::NullDisposer::instance),
-        kj::refcounted<RequestObserver>(),  // default observer makes no observations
+        makeRequestObserver(entrypointName),
         waitUntilTasks,
         true,                      // tunnelExceptions
         kj::none,                  // workerTracer
         kj::mv(metadata.cfBlobJson));
   }
 
+  kj::Own<RequestObserver> makeRequestObserver(kj::Maybe<kj::StringPtr> entrypointName) {
+    KJ_IF_SOME(m, metrics) {
+      return Metrics::makeRequestObserver(m.getRequestMetrics(name, entrypointName));
+    }
+    return kj::refcounted<RequestObserver>();  // default observer makes no observations
+  }
+
+  kj::Own<ActorObserver> makeActorObserver(kj::StringPtr className) {
+    KJ_IF_SOME(m, metrics) {
+      return Metrics::makeActorObserver(m.getActorMetrics(name, className));
+    }
+    return kj::refcounted<ActorObserver>();
+  }
+
   class ActorNamespace final {
   public:
     ActorNamespace(WorkerService& service,kj::StringPtr className, const ActorConfig& config,
@@ -1854,12 +2202,23 @@ public:
                   .uniqueKey = d.uniqueKey, .actorId = idStr
                 }).attach(kj::mv(idStr));
 
-                auto db = kj::heap<SqliteDatabase>(*as,
-                    kj::Path({d.uniqueKey, kj::str(idPtr, ".sqlite")}),
-                    kj::WriteMode::CREATE | kj::WriteMode::MODIFY | kj::WriteMode::CREATE_PARENT);
-                return kj::heap<ActorSqlite>(kj::mv(db), outputGate,
+                auto path = kj::Path({d.uniqueKey, kj::str(idPtr, ".sqlite")});
+                auto open = [&]() {
+                  return kj::heap<SqliteDatabase>(*as, path,
+                      kj::WriteMode::CREATE | kj::WriteMode::MODIFY |
+                      kj::WriteMode::CREATE_PARENT);
+                };
+                // If this actor was evicted recently, its database may still be open.
+                kj::Own<ActorSqlite::Handle> handle;
+                KJ_IF_SOME(pool, channels.sqliteHandlePool) {
+                  handle = pool->get(path.toString(), open);
+                } else {
+                  handle = kj::heap<ActorSqlite::Handle>(open());
+                }
+                // Reads are cached in memory under the same limits as the in-memory storage below.
+                return kj::heap<ActorSqlite>(kj::mv(handle), outputGate,
                     []() -> kj::Promise<void> { return kj::READY_NOW; },
-                    *sqliteHooks).attach(kj::mv(sqliteHooks));
+                    *sqliteHooks, sharedLru).attach(kj::mv(sqliteHooks));
               } else {
                 // Create an ActorCache backed by a fake, empty storage. Elsewhere, we configure
                 // ActorCache never to flush, so this effectively creates in-memory storage.
@@ -1889,7 +2248,7 @@ public:
                 kj::refcounted<Worker::Actor>(
                     *service.worker, actorContainer->getTracker(), kj::str(idPtr), true,
                     kj::mv(makeActorCache), className, kj::mv(makeStorage), lock, kj::mv(loopback),
-                    timerChannel, kj::refcounted<ActorObserver>(),
+                    timerChannel, service.makeActorObserver(className),
                     actorContainer->tryGetManagerRef(),
                     hibernationEventTypeId));
 
@@ -1967,11 +2326,14 @@ private:
   };
 
   ThreadContext& threadContext;
+  kj::String name;
+  kj::Maybe<Metrics&> metrics;
 
   // LinkedIoChannels owns the SqliteDatabase::Vfs, so make sure it is destroyed last.
   kj::OneOf<LinkCallback, LinkedIoChannels> ioChannels;
 
   kj::Own<const Worker> worker;
+  const WorkerLimitEnforcer& limits;  // Owned by `worker`'s isolate.
   kj::Maybe<kj::HashSet<kj::String>> defaultEntrypointHandlers;
   kj::HashMap<kj::String, EntrypointService> namedEntrypoints;
   kj::HashMap<kj::StringPtr, kj::Own<ActorNamespace>> actorNamespaces;
@@ -2173,7 +2535,8 @@ private:
   // ---------------------------------------------------------------------------
   // implements LimitEnforcer
   //
-  // No limits are enforced.
+  // No limits are enforced here. The CPU and memory limits of the Worker's `limits` config are
+  // layered on top by WorkerLimitEnforcer::wrapRequest().
 
   kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) override { return {}; }
   void topUpActor() override {}
@@ -2184,6 +2547,11 @@ private:
   kj::Promise<void> limitScheduled() override { return kj::NEVER_DONE; }
   kj::Duration getAlarmLimit() override { return 15 * kj::MINUTES; }
   size_t getBufferingLimit() override { return kj::maxValue; }
+  kj::Maybe<TeeSpillOptions> getTeeSpillOptions() override {
+    auto& channels = KJ_REQUIRE_NONNULL(ioChannels.tryGet<LinkedIoChannels>(),
+        "link() has not been called");
+    return channels.teeSpill;
+  }
   kj::Maybe<EventOutcome> getLimitsExceeded() override { return kj::none; }
   kj::Promise<void> onLimitsExceeded() override { return kj::NEVER_DONE; }
   void requireLimitsNotExceeded() override {}
@@ -2628,56 +2996,21 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     errorReporter.addError(kj::str("Worker must specify compatibilityDate."));
   }
 
-  // IsolateLimitEnforcer that enforces no limits.
-  class NullIsolateLimitEnforcer final: public IsolateLimitEnforcer {
-  public:
-    v8::Isolate::CreateParams getCreateParams() override { return {}; }
-    void customizeIsolate(v8::Isolate* isolate) override {}
-    ActorCacheSharedLruOptions getActorCacheLruOptions() override {
-      // TODO(someday): Make this configurable?
-      return {
-        .softLimit = 16 * (1ull << 20), // 16 MiB
-        .hardLimit = 128 * (1ull << 20), // 128 MiB
-        .staleTimeout = 30 * kj::SECONDS,
-        .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
-        .maxKeysPerRpc = 128,
-
-        // For now, we use `neverFlush` to implement in-memory-only actors.
-        // See WorkerService::getActor().
-        .neverFlush = true
-      };
-    }
-    kj::Own<void> enterStartupJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
-    }
-    kj::Own<void> enterStartupPython(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
-    }
-    kj::Own<void> enterDynamicImportJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
-    }
-    kj::Own<void> enterLoggingJs(
-        jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override {
-      return {};
-    }
-    kj::Own<void> enterInspectorJs(
-        jsg::Lock& loc, kj::Maybe<kj::Exception>& error) const override {
-      return {};
-    }
-    void completedRequest(kj::StringPtr id) const override {}
-    bool exitJs(jsg::Lock& lock) const override { return false; }
-    void reportMetrics(IsolateObserver& isolateMetrics) const override {}
-    kj::Maybe<size_t> checkPbkdfIterations(jsg::Lock& lock, size_t iterations) const override {
-      // No limit on the number of iterations in workerd
-      return kj::none;
-    }
-  };
+  kj::Own<IsolateObserver> observer = kj::atomicRefcounted<IsolateObserver>();
+  KJ_IF_SOME(m, metrics) {
+    observer = Metrics::makeIsolateObserver(m->getIsolateMetrics(name));
+  }
 
-  auto observer = kj::atomicRefcounted<IsolateObserver>();
-  auto limitEnforcer = kj::heap<NullIsolateLimitEnforcer>();
+  auto limitsConf = conf.getLimits();
+  kj::Maybe<const CpuWatchdog&> watchdog = kj::none;
+  if (limitsConf.getCpuMsPerRequest() > 0) {
+    if (cpuWatchdog == kj::none) {
+      cpuWatchdog = kj::heap<CpuWatchdog>();
+    }
+    watchdog = *KJ_ASSERT_NONNULL(cpuWatchdog);
+  }
+  auto limitEnforcer = kj::heap<WorkerLimitEnforcer>(limitsConf, watchdog);
+  const WorkerLimitEnforcer& limits = *limitEnforcer;
 
   kj::Maybe<kj::Own<jsg::modules::ModuleRegistry>> newModuleRegistry;
   if (featureFlags.getNewModuleRegistry()) {
@@ -2987,6 +3320,16 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
               "to the service \"", diskName, "\", but that service is not a local disk service."));
         } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
           result.actorStorage = kj::heap<SqliteDatabase::Vfs>(dir);
+          if (warmDatabaseLimit > 0) {
+            kj::Own<ActorSqlite::HandlePool::Observer> observer;
+            KJ_IF_SOME(m, metrics) {
+              observer = Metrics::makeWarmDatabaseObserver(m->getWarmDatabaseMetrics(name));
+            } else {
+              observer = kj::heap<ActorSqlite::HandlePool::Observer>();
+            }
+            result.sqliteHandlePool =
+                kj::heap<ActorSqlite::HandlePool>(warmDatabaseLimit, kj::mv(observer));
+          }
         } else {
           reportConfigError(kj::str("service ", name, ": durableObjectStorage config refers "
               "to the disk service \"", diskName, "\", but that service is defined read-only."));
@@ -2997,6 +3340,29 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
       }
     }
 
+    auto limitConf = conf.getLimits();
+    if (limitConf.hasTeeSpillDirectory()) {
+      kj::StringPtr diskName = limitConf.getTeeSpillDirectory();
+      KJ_IF_SOME(svc, this->services.find(diskName)) {
+        auto diskSvc = dynamic_cast<DiskDirectoryService*>(svc.get());
+        if (diskSvc == nullptr) {
+          reportConfigError(kj::str("service ", name, ": teeSpillDirectory refers to the "
+              "service \"", diskName, "\", but that service is not a local disk service."));
+        } else KJ_IF_SOME(dir, diskSvc->getWritable()) {
+          result.teeSpill = LimitEnforcer::TeeSpillOptions {
+            .memoryLimit = size_t(limitConf.getTeeMemoryLimitKb()) << 10,
+            .directory = dir,
+          };
+        } else {
+          reportConfigError(kj::str("service ", name, ": teeSpillDirectory refers to the "
+              "disk service \"", diskName, "\", but that service is defined read-only."));
+        }
+      } else {
+        reportConfigError(kj::str("service ", name, ": teeSpillDirectory refers to a "
+            "service \"", diskName, "\", but no such service is defined."));
+      }
+    }
+
     kj::HashMap<kj::StringPtr, WorkerService::ActorNamespace&> durableNamespacesByUniqueKey;
     for(auto& [className, ns] : workerService.getActorNamespaces()) {
       KJ_IF_SOME(config, ns->getConfig().tryGet<Server::Durable>()) {
@@ -3012,10 +3378,11 @@ kj::Own<Server::Service> Server::makeWorker(kj::StringPtr name, config::Worker::
     return result;
   };
 
-  return kj::heap<WorkerService>(globalContext->threadContext, kj::mv(worker),
+  return kj::heap<WorkerService>(globalContext->threadContext, name, kj::mv(worker), limits,
                                  kj::mv(errorReporter.defaultEntrypoint),
                                  kj::mv(errorReporter.namedEntrypoints), localActorConfigs,
-                                 kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors));
+                                 kj::mv(linkCallback), KJ_BIND_METHOD(*this, abortAllActors),
+                                 metrics.map([](kj::Own<Metrics>& m) -> Metrics& { return *m; }));
 }
 
 // =======================================================================================
@@ -3036,13 +3403,19 @@ kj::Own<Server::Service> Server::makeService(
       return makeExternalService(name, conf.getExternal(), headerTableBuilder);
 
     case config::Service::NETWORK:
-      return makeNetworkService(conf.getNetwork());
+      return makeNetworkService(name, conf.getNetwork());
 
     case config::Service::WORKER:
       return makeWorker(name, conf.getWorker(), extensions);
 
     case config::Service::DISK:
       return makeDiskDirectoryService(name, conf.getDisk(), headerTableBuilder);
+
+    case config::Service::METRICS:
+      return makeMetricsService(headerTableBuilder);
+
+    case config::Service::CACHE:
+      return makeCacheService(name, conf.getCache(), headerTableBuilder);
   }
 
   reportConfigError(kj::str(
@@ -3057,35 +3430,47 @@ void Server::taskFailed(kj::Exception&& exception) {
 
 Server::Service& Server::lookupService(
     config::ServiceDesignator::Reader designator, kj::String errorContext) {
-  kj::StringPtr targetName = designator.getName();
-  Service* service = KJ_UNWRAP_OR(services.find(targetName), {
-    reportConfigError(kj::str(
-        errorContext, " refers to a service \"", targetName,
-        "\", but no such service is defined."));
-    return *invalidConfigServiceSingleton;
-  });
+  Service& target = [&]() -> Service& {
+    kj::StringPtr targetName = designator.getName();
+    Service* service = KJ_UNWRAP_OR(services.find(targetName), {
+      reportConfigError(kj::str(
+          errorContext, " refers to a service \"", targetName,
+          "\", but no such service is defined."));
+      return *invalidConfigServiceSingleton;
+    });
 
-  if (designator.hasEntrypoint()) {
-    kj::StringPtr entrypointName = designator.getEntrypoint();
-    if (WorkerService* worker = dynamic_cast<WorkerService*>(service)) {
-      KJ_IF_SOME(ep, worker->getEntrypoint(entrypointName)) {
-        return ep;
+    if (designator.hasEntrypoint()) {
+      kj::StringPtr entrypointName = designator.getEntrypoint();
+      if (WorkerService* worker = dynamic_cast<WorkerService*>(service)) {
+        KJ_IF_SOME(ep, worker->getEntrypoint(entrypointName)) {
+          return ep;
+        } else {
+          reportConfigError(kj::str(
+              errorContext, " refers to service \"", targetName, "\" with a named entrypoint \"",
+              entrypointName, "\", but \"", targetName, "\" has no such named entrypoint."));
+          return *invalidConfigServiceSingleton;
+        }
       } else {
         reportConfigError(kj::str(
             errorContext, " refers to service \"", targetName, "\" with a named entrypoint \"",
-            entrypointName, "\", but \"", targetName, "\" has no such named entrypoint."));
+            entrypointName, "\", but \"", targetName, "\" is not a Worker, so does not have any "
+            "named entrypoints."));
         return *invalidConfigServiceSingleton;
       }
     } else {
-      reportConfigError(kj::str(
-          errorContext, " refers to service \"", targetName, "\" with a named entrypoint \"",
-          entrypointName, "\", but \"", targetName, "\" is not a Worker, so does not have any "
-          "named entrypoints."));
-      return *invalidConfigServiceSingleton;
+      return *service;
     }
-  } else {
-    return *service;
+  }();
+
+  if (designator.getCoalesceRequests()) {
+    // Each designator gets its own coalescer, so that only requests made through the same binding
+    // are coalesced.
+    auto coalescing = kj::heap<CoalescingService>(globalContext->coalescerHeaderIds, target);
+    auto& result = *coalescing;
+    coalescingServices.add(kj::mv(coalescing));
+    return result;
   }
+  return target;
 }
 
 // =======================================================================================
@@ -3185,6 +3570,81 @@ private:
     return s.accept(conn);
   }
 
+  class ResponseWrapper final: public kj::HttpService::Response {
+  public:
+    ResponseWrapper(kj::HttpService::Response& inner, HttpRewriter& rewriter)
+        : inner(inner), rewriter(rewriter) {}
+
+    kj::Own<kj::AsyncOutputStream> send(
+        uint statusCode, kj::StringPtr statusText, const kj::HttpHeaders& headers,
+        kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
+      TRACE_EVENT("workerd", "ResponseWrapper::send()");
+      auto rewrite = headers.cloneShallow();
+      rewriter.rewriteResponse(rewrite);
+      return inner.send(statusCode, statusText, rewrite, expectedBodySize);
+    }
+
+    kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
+      TRACE_EVENT("workerd", "ResponseWrapper::acceptWebSocket()");
+      auto rewrite = headers.cloneShallow();
+      rewriter.rewriteResponse(rewrite);
+      return inner.acceptWebSocket(rewrite);
+    }
+
+  private:
+    kj::HttpService::Response& inner;
+    HttpRewriter& rewriter;
+  };
+
+  // Delivers an HTTP request received on one of the listener's connections to the service.
+  kj::Promise<void> handleRequest(
+      kj::Maybe<kj::String> cfBlobJson, kj::HttpMethod method, kj::StringPtr url,
+      const kj::HttpHeaders& headers, kj::AsyncInputStream& requestBody,
+      kj::HttpService::Response& response) {
+    bool hasCfBlob = cfBlobJson != kj::none;
+    IoChannelFactory::SubrequestMetadata metadata;
+    metadata.cfBlobJson = kj::mv(cfBlobJson);
+
+    kj::HttpService::Response* wrappedResponse = &response;
+    kj::Own<ResponseWrapper> ownResponse;
+    if (rewriter->needsRewriteResponse()) {
+      wrappedResponse = ownResponse = kj::heap<ResponseWrapper>(response, *rewriter);
+    }
+
+    if (rewriter->needsRewriteRequest() || hasCfBlob) {
+      auto rewrite = KJ_UNWRAP_OR(
+          rewriter->rewriteIncomingRequest(
+              url, physicalProtocol, headers, metadata.cfBlobJson), {
+        co_return co_await response.sendError(400, "Bad Request", headerTable);
+      });
+      auto worker = service.startRequest(kj::mv(metadata));
+      co_return co_await worker->request(method, url, *rewrite.headers, requestBody,
+                                         *wrappedResponse);
+    } else {
+      auto worker = service.startRequest(kj::mv(metadata));
+      co_return co_await worker->request(method, url, headers, requestBody, *wrappedResponse);
+    }
+  }
+
+  // The HTTP service a client gets from EventDispatcher::getHttpService(), which is how
+  // ExternalServers with `multiplexHttp` send requests.
+  class RpcHttpService final: public kj::HttpService {
+  public:
+    RpcHttpService(HttpListener& parent): parent(parent) {}
+
+    kj::Promise<void> request(
+        kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
+        kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
+      TRACE_EVENT("workerd", "RpcHttpService::request()");
+      // TODO(someday): Describe the client in a cf blob, like Connection does? The capnp server
+      //   is shared by all of the listener's connections, so doesn't know which one this is.
+      return parent.handleRequest(kj::none, method, url, headers, requestBody, response);
+    }
+
+  private:
+    HttpListener& parent;
+  };
+
   class WorkerdBootstrapImpl final: public rpc::WorkerdBootstrap::Server {
   public:
     WorkerdBootstrapImpl(HttpListener& parent): parent(parent) {}
@@ -3196,7 +3656,7 @@ private:
       //   configured, which hints that this service trusts the client to provide the cf blob.)
 
       context.initResults(capnp::MessageSize {4, 1}).setDispatcher(
-          kj::heap<EventDispatcherImpl>(parent, parent.service.startRequest({})));
+          kj::heap<EventDispatcherImpl>(parent));
       return kj::READY_NOW;
     }
 
@@ -3206,12 +3666,15 @@ private:
 
   class EventDispatcherImpl final: public rpc::EventDispatcher::Server {
   public:
-    EventDispatcherImpl(HttpListener& parent, kj::Own<WorkerInterface> worker)
-        : parent(parent), worker(kj::mv(worker)) {}
+    EventDispatcherImpl(HttpListener& parent): parent(parent) {}
 
     kj::Promise<void> getHttpService(GetHttpServiceContext context) override {
+      // Requests arriving this way are handled just like the ones arriving over plain HTTP, which
+      // starts the request to the service itself.
+      KJ_REQUIRE(!used, "EventDispatcher can only be used for one request");
+      used = true;
       context.initResults(capnp::MessageSize{4, 1})
-          .setHttp(parent.httpOverCapnpFactory.kjToCapnp(getWorker()));
+          .setHttp(parent.httpOverCapnpFactory.kjToCapnp(kj::heap<RpcHttpService>(parent)));
       return kj::READY_NOW;
     }
 
@@ -3251,13 +3714,12 @@ private:
 
   private:
     HttpListener& parent;
-    kj::Maybe<kj::Own<WorkerInterface>> worker;
+    bool used = false;
 
     kj::Own<WorkerInterface> getWorker() {
-      auto result = kj::mv(KJ_ASSERT_NONNULL(worker,
-          "EventDispatcher can only be used for one request"));
-      worker = kj::none;
-      return result;
+      KJ_REQUIRE(!used, "EventDispatcher can only be used for one request");
+      used = true;
+      return parent.service.startRequest({});
     }
 
     [[noreturn]] void throwUnsupported() {
@@ -3277,32 +3739,6 @@ private:
     kj::Maybe<kj::String> cfBlobJson;
     ListedHttpServer listedHttp;
 
-    class ResponseWrapper final: public kj::HttpService::Response {
-    public:
-      ResponseWrapper(kj::HttpService::Response& inner, HttpRewriter& rewriter)
-          : inner(inner), rewriter(rewriter) {}
-
-      kj::Own<kj::AsyncOutputStream> send(
-          uint statusCode, kj::StringPtr statusText, const kj::HttpHeaders& headers,
-          kj::Maybe<uint64_t> expectedBodySize = kj::none) override {
-        TRACE_EVENT("workerd", "ResponseWrapper::send()");
-        auto rewrite = headers.cloneShallow();
-        rewriter.rewriteResponse(rewrite);
-        return inner.send(statusCode, statusText, rewrite, expectedBodySize);
-      }
-
-      kj::Own<kj::WebSocket> acceptWebSocket(const kj::HttpHeaders& headers) override {
-        TRACE_EVENT("workerd", "ResponseWrapper::acceptWebSocket()");
-        auto rewrite = headers.cloneShallow();
-        rewriter.rewriteResponse(rewrite);
-        return inner.acceptWebSocket(rewrite);
-      }
-
-    private:
-      kj::HttpService::Response& inner;
-      HttpRewriter& rewriter;
-    };
-
     // ---------------------------------------------------------------------------
     // implements kj::HttpService
 
@@ -3310,28 +3746,8 @@ private:
         kj::HttpMethod method, kj::StringPtr url, const kj::HttpHeaders& headers,
         kj::AsyncInputStream& requestBody, kj::HttpService::Response& response) override {
       TRACE_EVENT("workerd", "Connection:request()");
-      IoChannelFactory::SubrequestMetadata metadata;
-      metadata.cfBlobJson = cfBlobJson.map([](kj::StringPtr s) { return kj::str(s); });
-
-      Response* wrappedResponse = &response;
-      kj::Own<ResponseWrapper> ownResponse;
-      if (parent.rewriter->needsRewriteResponse()) {
-        wrappedResponse = ownResponse = kj::heap<ResponseWrapper>(response, *parent.rewriter);
-      }
-
-      if (parent.rewriter->needsRewriteRequest() || cfBlobJson != kj::none) {
-        auto rewrite = KJ_UNWRAP_OR(
-            parent.rewriter->rewriteIncomingRequest(
-                url, parent.physicalProtocol, headers, metadata.cfBlobJson), {
-          co_return co_await response.sendError(400, "Bad Request", parent.headerTable);
-        });
-        auto worker = parent.service.startRequest(kj::mv(metadata));
-        co_return co_await worker->request(method, url, *rewrite.headers, requestBody,
-                                           *wrappedResponse);
-      } else {
-        auto worker = parent.service.startRequest(kj::mv(metadata));
-        co_return co_await worker->request(method, url, headers, requestBody, *wrappedResponse);
-      }
+      return parent.handleRequest(cfBlobJson.map([](kj::StringPtr s) { return kj::str(s); }),
+                                  method, url, headers, requestBody, response);
     }
 
     kj::Promise<void> connect(kj::StringPtr host,
@@ -3375,6 +3791,98 @@ kj::Promise<void> Server::listenHttp(
   co_return co_await obj->run();
 }
 
+// Applies a socket's `tcpDeferAcceptSeconds` and `tcpFastOpenQueueLength`. Both can be set on a
+// socket that's already listening. Failures are only logged, since the address may turn out not
+// to be a TCP one, e.g. if it's overridden on the command line.
+static void setTcpListenOptions(kj::ConnectionReceiver& listener, kj::StringPtr socketName,
+                                uint deferAcceptSeconds, uint fastOpenQueueLength) {
+#if __linux__
+  KJ_IF_SOME(exception, kj::runCatchingExceptions([&]() {
+    if (deferAcceptSeconds > 0) {
+      int value = deferAcceptSeconds;
+      listener.setsockopt(IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, sizeof(value));
+    }
+    if (fastOpenQueueLength > 0) {
+      int value = fastOpenQueueLength;
+      listener.setsockopt(IPPROTO_TCP, TCP_FASTOPEN, &value, sizeof(value));
+    }
+  })) {
+    KJ_LOG(WARNING, "couldn't set TCP options of socket", socketName, exception);
+  }
+#else
+  KJ_LOG(WARNING, "TCP_DEFER_ACCEPT and TCP_FASTOPEN are only supported on Linux", socketName);
+#endif
+}
+
+namespace {
+
+// Keeps at most `maxConnections` of the connections accepted from a socket open at once. At the
+// limit, it stops accepting, so new clients wait in the kernel's listen backlog (and once that's
+// full, the kernel turns them away) rather than slowing down the connections already open.
+class ConnectionLimiter final: public kj::ConnectionReceiver {
+public:
+  ConnectionLimiter(kj::Own<kj::ConnectionReceiver> inner, uint maxConnections)
+      : inner(kj::mv(inner)), maxConnections(maxConnections), state(kj::refcounted<State>()) {}
+
+  kj::Promise<kj::Own<kj::AsyncIoStream>> accept() override {
+    co_await waitForRoom();
+    co_return track(co_await inner->accept());
+  }
+
+  kj::Promise<kj::AuthenticatedStream> acceptAuthenticated() override {
+    co_await waitForRoom();
+    auto result = co_await inner->acceptAuthenticated();
+    result.stream = track(kj::mv(result.stream));
+    co_return kj::mv(result);
+  }
+
+  uint getPort() override { return inner->getPort(); }
+
+  void getsockopt(int level, int option, void* value, uint* length) override {
+    inner->getsockopt(level, option, value, length);
+  }
+  void setsockopt(int level, int option, const void* value, uint length) override {
+    inner->setsockopt(level, option, value, length);
+  }
+  void getsockname(struct sockaddr* addr, uint* length) override {
+    inner->getsockname(addr, length);
+  }
+
+private:
+  // Shared with the open connections, which may outlive the listener, e.g. while draining.
+  struct State: public kj::Refcounted {
+    uint openConnections = 0;
+
+    // Set while waiting for a connection to close before accepting more.
+    kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> connectionClosed;
+  };
+
+  kj::Own<kj::ConnectionReceiver> inner;
+  uint maxConnections;
+  kj::Own<State> state;
+
+  kj::Promise<void> waitForRoom() {
+    while (state->openConnections >= maxConnections) {
+      auto paf = kj::newPromiseAndFulfiller<void>();
+      state->connectionClosed = kj::mv(paf.fulfiller);
+      co_await paf.promise;
+    }
+  }
+
+  kj::Own<kj::AsyncIoStream> track(kj::Own<kj::AsyncIoStream> stream) {
+    ++state->openConnections;
+    return stream.attach(kj::defer([state = kj::addRef(*state)]() mutable {
+      --state->openConnections;
+      KJ_IF_SOME(f, state->connectionClosed) {
+        f->fulfill();
+        state->connectionClosed = kj::none;
+      }
+    }));
+  }
+};
+
+}  // namespace
+
 // =======================================================================================
 // Server::run()
 
@@ -3485,6 +3993,12 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
     kj::StringPtr name = serviceConf.getName();
     kj::HashMap<kj::String, ActorConfig> serviceActorConfigs;
 
+    // Metrics are only collected if there's a service to serve them, and must be set up before
+    // any Worker is created.
+    if (serviceConf.isMetrics() && metrics == kj::none) {
+      metrics = kj::heap<Metrics>();
+    }
+
     if (serviceConf.isWorker()) {
       auto workerConf = serviceConf.getWorker();
       bool hadDurable = false;
@@ -3571,17 +4085,25 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
 
   // Make the default "internet" service if it's not there already.
   services.findOrCreate("internet"_kj, [&]() {
-    auto publicNetwork = network.restrictPeers({"public"_kj});
-
-    kj::TlsContext::Options options;
-    options.useSystemTrustStore = true;
-
-    kj::Own<kj::TlsContext> tls = kj::heap<kj::TlsContext>(kj::mv(options));
+    // A default Network reader gives the default TTL and timeout.
+    config::Network::Reader defaults;
+    auto networkMetrics = getNetworkMetrics(metrics, "internet"_kj);
+    auto observer = makeNetworkObserver(networkMetrics);
+    auto publicNetwork = dnsCache->restrictPeers({"public"_kj}, nullptr,
+        defaults.getDnsCacheTtlSeconds() * kj::SECONDS, *observer).attach(kj::mv(observer));
+
+    // Equivalent to a Network with `tlsOptions = (trustBrowserCas = true)`, and shares its TLS
+    // context with any that the config defines.
+    capnp::MallocMessageBuilder tlsMessage;
+    auto tlsOptions = tlsMessage.initRoot<config::TlsOptions>();
+    tlsOptions.setTrustBrowserCas(true);
+    auto tls = makeTlsContext(tlsOptions.asReader());
     auto tlsNetwork = tls->wrapNetwork(*publicNetwork);
 
     auto service = kj::heap<NetworkService>(
         globalContext->headerTable, timer, entropySource,
-        kj::mv(publicNetwork), kj::mv(tlsNetwork), *tls).attach(kj::mv(tls));
+        kj::mv(publicNetwork), kj::mv(tlsNetwork), *tls,
+        defaults.getIdleTimeoutSeconds() * kj::SECONDS, networkMetrics).attach(kj::mv(tls));
 
     return decltype(services)::Entry {
       kj::str("internet"_kj),
@@ -3592,6 +4114,10 @@ void Server::startServices(jsg::V8System& v8System, config::Config::Reader confi
   // Start the alarm scheduler before linking services
   startAlarmScheduler(config);
 
+  if (config.hasSqlite()) {
+    warmDatabaseLimit = config.getSqlite().getWarmDatabaseLimit();
+  }
+
   // Third pass: Cross-link services.
   for (auto& service: services) {
     service.value->link();
@@ -3670,6 +4196,26 @@ kj::Promise<void> Server::listenOnSockets(config::Config::Reader config,
       })(network.parseAddress(addrStr, defaultPort));
     }
 
+    uint deferAcceptSeconds = sock.getTcpDeferAcceptSeconds();
+    uint fastOpenQueueLength = sock.getTcpFastOpenQueueLength();
+    if (deferAcceptSeconds > 0 || fastOpenQueueLength > 0) {
+      listener = ([](PromisedReceived promise, kj::StringPtr name,
+                     uint deferAcceptSeconds, uint fastOpenQueueLength) -> PromisedReceived {
+        auto port = co_await promise;
+        setTcpListenOptions(*port, name, deferAcceptSeconds, fastOpenQueueLength);
+        co_return kj::mv(port);
+      })(kj::mv(listener), name, deferAcceptSeconds, fastOpenQueueLength);
+    }
+
+    // Applied below the TLS wrapper, which accepts and handshakes with connections on its own,
+    // regardless of how fast they're taken from it.
+    uint maxConnections = sock.getMaxConnections();
+    if (maxConnections > 0) {
+      listener = ([](PromisedReceived promise, uint maxConnections) -> PromisedReceived {
+        co_return kj::heap<ConnectionLimiter>(co_await promise, maxConnections);
+      })(kj::mv(listener), maxConnections);
+    }
+
     KJ_IF_SOME(t, tls) {
       listener = ([](kj::Promise<kj::Own<kj::ConnectionReceiver>> promise,
                      kj::Own<kj::TlsContext> tls)
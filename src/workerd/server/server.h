@@ -28,6 +28,10 @@ namespace workerd::server {
 
 using api::pyodide::PythonConfig;
 
+class Metrics;
+class CpuWatchdog;
+class DnsCache;
+
 // Implements the single-tenant Workers Runtime server / CLI.
 //
 // The purpose of this class is to implement the core logic independently of the CLI itself,
@@ -84,6 +88,10 @@ public:
                          kj::StringPtr servicePattern = "*"_kj,
                          kj::StringPtr entrypointPattern = "*"_kj);
 
+  // Number of TLS contexts shared by uses of identical TlsOptions, i.e. not counting those made
+  // for TlsOptions with `shareSessionCache = false`.
+  size_t sharedTlsContextCountForTest() const { return tlsContexts.size(); }
+
   struct Durable {
     kj::String uniqueKey;
     bool isEvictable;
@@ -114,6 +122,13 @@ private:
 
   kj::Own<api::MemoryCacheProvider> memoryCacheProvider;
 
+  // Shared by the Network services. Declared before `services` because it must outlive them.
+  kj::Own<DnsCache> dnsCache;
+
+  // TLS contexts shared by all uses of the same TlsOptions, keyed by their text form. Declared
+  // before `services` and the listeners because it must outlive their connections.
+  kj::HashMap<kj::String, kj::Own<kj::TlsContext>> tlsContexts;
+
   kj::HashMap<kj::String, kj::OneOf<kj::String, kj::Own<kj::ConnectionReceiver>>> socketOverrides;
   kj::HashMap<kj::String, kj::String> directoryOverrides;
 
@@ -139,8 +154,24 @@ private:
   // correctly construct dependent services.
   kj::HashMap<kj::String, kj::HashMap<kj::String, ActorConfig>> actorConfigs;
 
+  // `sqlite.warmDatabaseLimit` from the config. Each Worker with on-disk Durable Object storage
+  // keeps up to this many databases of evicted objects open.
+  uint warmDatabaseLimit = 0;
+
+  // Set if the config has a `metrics` service. Declared before `services` because the observers
+  // of Workers record into it.
+  kj::Maybe<kj::Own<Metrics>> metrics;
+
+  // Created when the first Worker with a CPU limit is, and shared by all of them. Declared before
+  // `services` because it must outlive their isolates.
+  kj::Maybe<kj::Own<CpuWatchdog>> cpuWatchdog;
+
   kj::HashMap<kj::String, kj::Own<Service>> services;
 
+  // Created by lookupService() for designators with `coalesceRequests` set. Declared after
+  // `services`, which they wrap.
+  kj::Vector<kj::Own<Service>> coalescingServices;
+
   kj::Own<kj::PromiseFulfiller<void>> fatalFulfiller;
 
   // Initialized in startAlarmScheduler().
@@ -177,6 +208,7 @@ private:
   kj::Promise<void> handleDrain(kj::Promise<void> drainWhen);
 
   kj::Own<kj::TlsContext> makeTlsContext(config::TlsOptions::Reader conf);
+  kj::Own<kj::TlsContext> newTlsContext(config::TlsOptions::Reader conf);
   kj::Promise<kj::Own<kj::NetworkAddress>> makeTlsNetworkAddress(
       config::TlsOptions::Reader conf, kj::StringPtr addrStr,
       kj::Maybe<kj::StringPtr> certificateHost, uint defaultPort = 0);
@@ -187,10 +219,14 @@ private:
   kj::Own<Service> makeExternalService(
       kj::StringPtr name, config::ExternalServer::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
-  kj::Own<Service> makeNetworkService(config::Network::Reader conf);
+  kj::Own<Service> makeNetworkService(kj::StringPtr name, config::Network::Reader conf);
   kj::Own<Service> makeDiskDirectoryService(
       kj::StringPtr name, config::DiskDirectory::Reader conf,
       kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeMetricsService(kj::HttpHeaderTable::Builder& headerTableBuilder);
+  kj::Own<Service> makeCacheService(
+      kj::StringPtr name, config::Cache::Reader conf,
+      kj::HttpHeaderTable::Builder& headerTableBuilder);
   kj::Own<Service> makeWorker(kj::StringPtr name, config::Worker::Reader conf,
       capnp::List<config::Extension>::Reader extensions);
   kj::Own<Service> makeService(
@@ -212,6 +248,9 @@ private:
   class ExternalTcpService;
   class NetworkService;
   class DiskDirectoryService;
+  class MetricsService;
+  class CacheService;
+  class CoalescingService;
   class WorkerService;
   class WorkerEntrypointService;
   class HttpListener;
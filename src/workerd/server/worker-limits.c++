@@ -0,0 +1,312 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "worker-limits.h"
+#include <kj/function.h>
+
+namespace workerd::server {
+
+namespace {
+
+kj::TimePoint now() {
+  return kj::systemPreciseMonotonicClock().now();
+}
+
+}  // namespace
+
+// =======================================================================================
+
+class CpuWatchdog::Armed final {
+public:
+  Armed(const CpuWatchdog& watchdog, v8::Isolate* isolate, kj::TimePoint deadline)
+      : watchdog(watchdog), isolate(isolate), deadline(deadline) {
+    auto lock = watchdog.state.lockExclusive();
+    lock->armed.add(this);
+    ++lock->generation;
+  }
+
+  ~Armed() noexcept(false) {
+    bool didFire;
+    {
+      auto lock = watchdog.state.lockExclusive();
+      auto& armed = lock->armed;
+      for (auto i: kj::indices(armed)) {
+        if (armed[i] == this) {
+          armed[i] = armed.back();
+          armed.removeLast();
+          break;
+        }
+      }
+      didFire = fired;
+    }
+    if (didFire) {
+      isolate->CancelTerminateExecution();
+    }
+  }
+
+  const CpuWatchdog& watchdog;
+  v8::Isolate* isolate;
+  kj::TimePoint deadline;
+
+  // Only accessed with the watchdog's lock held.
+  bool fired = false;
+};
+
+CpuWatchdog::CpuWatchdog(): thread([this]() { run(); }) {}
+
+CpuWatchdog::~CpuWatchdog() noexcept(false) {
+  state.lockExclusive()->shutdown = true;
+  // `thread` is joined when it's destroyed, right after this.
+}
+
+kj::Own<void> CpuWatchdog::arm(v8::Isolate* isolate, kj::TimePoint deadline) const {
+  return kj::heap<Armed>(*this, isolate, deadline);
+}
+
+void CpuWatchdog::run() const {
+  auto lock = state.lockExclusive();
+  while (!lock->shutdown) {
+    auto current = now();
+    kj::Maybe<kj::TimePoint> next;
+    for (auto armed: lock->armed) {
+      if (armed->fired) continue;
+      if (armed->deadline <= current) {
+        // TerminateExecution() is the one isolate method that's safe to call from any thread.
+        armed->isolate->TerminateExecution();
+        armed->fired = true;
+      } else KJ_IF_SOME(n, next) {
+        if (armed->deadline < n) next = armed->deadline;
+      } else {
+        next = armed->deadline;
+      }
+    }
+
+    // Sleep until the next deadline, or until a new one might be earlier.
+    auto woken = [generation = lock->generation](const State& state) {
+      return state.shutdown || state.generation != generation;
+    };
+    KJ_IF_SOME(n, next) {
+      lock.wait(woken, n - current);
+    } else {
+      lock.wait(woken);
+    }
+  }
+}
+
+// =======================================================================================
+
+class WorkerLimitEnforcer::RequestLimitEnforcer final: public LimitEnforcer {
+public:
+  RequestLimitEnforcer(const WorkerLimitEnforcer& limits, kj::Own<LimitEnforcer> inner)
+      : limits(limits), inner(kj::mv(inner)) {
+    auto paf = kj::newPromiseAndFulfiller<void>();
+    exceededFulfiller = kj::mv(paf.fulfiller);
+    exceededPromise = paf.promise.fork();
+  }
+
+  kj::Own<void> enterJs(jsg::Lock& lock, IoContext& context) override {
+    auto innerScope = inner->enterJs(lock, context);
+    auto heapLimitHits = limits.heapLimitHits;
+    auto start = now();
+
+    kj::Maybe<kj::Own<void>> armed;
+    KJ_IF_SOME(limit, limits.cpuLimit) {
+      auto remaining = cpuUsed < limit ? limit - cpuUsed : 0 * kj::SECONDS;
+      armed = KJ_ASSERT_NONNULL(limits.watchdog).arm(lock.v8Isolate, start + remaining);
+    }
+
+    return kj::heap(kj::defer([this, heapLimitHits, start, armed = kj::mv(armed),
+                               innerScope = kj::mv(innerScope)]() mutable {
+      armed = kj::none;
+      cpuUsed += now() - start;
+      if (exceeded != kj::none) return;
+
+      if (limits.heapLimitHits != heapLimitHits) {
+        fail(EventOutcome::EXCEEDED_MEMORY,
+            JSG_KJ_EXCEPTION(OVERLOADED, Error, "Worker exceeded memory limit."));
+      } else KJ_IF_SOME(limit, limits.cpuLimit) {
+        if (cpuUsed >= limit) {
+          fail(EventOutcome::EXCEEDED_CPU,
+              JSG_KJ_EXCEPTION(OVERLOADED, Error, "Worker exceeded CPU time limit."));
+        }
+      }
+    }));
+  }
+
+  void topUpActor() override {
+    inner->topUpActor();
+    if (exceeded == kj::none) {
+      cpuUsed = 0 * kj::SECONDS;
+    }
+  }
+
+  void newSubrequest(bool isInHouse) override { inner->newSubrequest(isInHouse); }
+  void newKvRequest(KvOpType op) override { inner->newKvRequest(op); }
+  void newAnalyticsEngineRequest() override { inner->newAnalyticsEngineRequest(); }
+  kj::Promise<void> limitDrain() override { return inner->limitDrain(); }
+  kj::Promise<void> limitScheduled() override { return inner->limitScheduled(); }
+  kj::Duration getAlarmLimit() override { return inner->getAlarmLimit(); }
+  size_t getBufferingLimit() override { return inner->getBufferingLimit(); }
+  kj::Maybe<TeeSpillOptions> getTeeSpillOptions() override {
+    return inner->getTeeSpillOptions();
+  }
+
+  kj::Maybe<EventOutcome> getLimitsExceeded() override {
+    KJ_IF_SOME(e, exceeded) {
+      return e.outcome;
+    }
+    return inner->getLimitsExceeded();
+  }
+
+  kj::Promise<void> onLimitsExceeded() override {
+    return exceededPromise.addBranch().exclusiveJoin(inner->onLimitsExceeded());
+  }
+
+  void requireLimitsNotExceeded() override {
+    KJ_IF_SOME(e, exceeded) {
+      kj::throwFatalException(kj::cp(e.exception));
+    }
+    inner->requireLimitsNotExceeded();
+  }
+
+  void reportMetrics(RequestObserver& requestMetrics) override {
+    inner->reportMetrics(requestMetrics);
+  }
+
+  void reportOffloadedCpuTime(kj::Duration time) override {
+    // Charged to the request, but only enforced the next time it leaves JavaScript.
+    cpuUsed += time;
+    inner->reportOffloadedCpuTime(time);
+  }
+
+private:
+  const WorkerLimitEnforcer& limits;
+  kj::Own<LimitEnforcer> inner;
+
+  // Time spent in JavaScript since the request started or, for actors, since the last top-up.
+  kj::Duration cpuUsed = 0 * kj::SECONDS;
+
+  struct Exceeded {
+    EventOutcome outcome;
+    kj::Exception exception;
+  };
+  kj::Maybe<Exceeded> exceeded;
+
+  kj::Own<kj::PromiseFulfiller<void>> exceededFulfiller;
+  kj::ForkedPromise<void> exceededPromise = nullptr;
+
+  void fail(EventOutcome outcome, kj::Exception exception) {
+    exceeded = Exceeded { outcome, kj::cp(exception) };
+    exceededFulfiller->reject(kj::mv(exception));
+  }
+};
+
+WorkerLimitEnforcer::WorkerLimitEnforcer(
+    config::Worker::Limits::Reader conf, kj::Maybe<const CpuWatchdog&> watchdog)
+    : heapLimit(size_t(conf.getHeapSizeMb()) << 20),
+      actorCacheOptions({
+        .softLimit = size_t(conf.getActorCacheSoftLimitMb()) << 20,
+        .hardLimit = size_t(conf.getActorCacheHardLimitMb()) << 20,
+        .staleTimeout = 30 * kj::SECONDS,
+        .dirtyListByteLimit = 8 * (1ull << 20), // 8 MiB
+        .maxKeysPerRpc = 128,
+
+        // For now, we use `neverFlush` to implement in-memory-only actors.
+        // See WorkerService::getActor().
+        .neverFlush = true
+      }),
+      watchdog(watchdog) {
+  if (conf.getCpuMsPerRequest() > 0) {
+    KJ_REQUIRE(watchdog != kj::none, "a CPU limit needs a CpuWatchdog");
+    cpuLimit = conf.getCpuMsPerRequest() * kj::MILLISECONDS;
+  }
+}
+
+kj::Own<LimitEnforcer> WorkerLimitEnforcer::wrapRequest(kj::Own<LimitEnforcer> inner) const {
+  if (cpuLimit == kj::none && heapLimit == 0) {
+    return kj::mv(inner);
+  }
+  return kj::heap<RequestLimitEnforcer>(*this, kj::mv(inner));
+}
+
+v8::Isolate::CreateParams WorkerLimitEnforcer::getCreateParams() {
+  v8::Isolate::CreateParams params;
+  if (heapLimit > 0) {
+    params.constraints.ConfigureDefaultsFromHeapSize(0, heapLimit);
+  }
+  return params;
+}
+
+void WorkerLimitEnforcer::customizeIsolate(v8::Isolate* isolatePtr) {
+  isolate = isolatePtr;
+  if (heapLimit > 0) {
+    // Without a callback, V8 crashes the process when the heap hits its limit.
+    isolate->AddNearHeapLimitCallback(&nearHeapLimit, this);
+    isolate->AutomaticallyRestoreInitialHeapLimit();
+  }
+}
+
+size_t WorkerLimitEnforcer::nearHeapLimit(
+    void* data, size_t currentHeapLimit, size_t initialHeapLimit) {
+  auto& self = *reinterpret_cast<WorkerLimitEnforcer*>(data);
+  ++self.heapLimitHits;
+  self.isolate->TerminateExecution();
+
+  // Give the terminated JavaScript room to unwind. AutomaticallyRestoreInitialHeapLimit() lowers
+  // the limit again once garbage collection has shrunk the heap.
+  return currentHeapLimit + initialHeapLimit / 2;
+}
+
+ActorCacheSharedLruOptions WorkerLimitEnforcer::getActorCacheLruOptions() {
+  return actorCacheOptions;
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterStartup(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  auto heapLimitHits = this->heapLimitHits;
+  auto start = now();
+
+  kj::Maybe<kj::Own<void>> armed;
+  KJ_IF_SOME(limit, cpuLimit) {
+    armed = KJ_ASSERT_NONNULL(watchdog).arm(lock.v8Isolate, start + limit);
+  }
+
+  return kj::heap(kj::defer([this, &error, heapLimitHits, start, armed = kj::mv(armed)]() mutable {
+    armed = kj::none;
+    if (this->heapLimitHits != heapLimitHits) {
+      error = JSG_KJ_EXCEPTION(OVERLOADED, Error, "Script startup exceeded memory limit.");
+    } else KJ_IF_SOME(limit, cpuLimit) {
+      if (now() - start >= limit) {
+        error = JSG_KJ_EXCEPTION(OVERLOADED, Error, "Script startup exceeded CPU time limit.");
+      }
+    }
+  }));
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterStartupJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterStartup(lock, error);
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterStartupPython(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterStartup(lock, error);
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterDynamicImportJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return enterStartup(lock, error);
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterLoggingJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return {};
+}
+
+kj::Own<void> WorkerLimitEnforcer::enterInspectorJs(
+    jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const {
+  return {};
+}
+
+}  // namespace workerd::server
@@ -0,0 +1,97 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <workerd/io/limit-enforcer.h>
+#include <workerd/io/actor-cache.h>
+#include <workerd/server/workerd.capnp.h>
+#include <kj/mutex.h>
+#include <kj/thread.h>
+
+namespace workerd::server {
+
+// Terminates JavaScript that has run past its deadline. V8 can only interrupt an isolate from
+// another thread, so the watchdog owns one, which sleeps until the earliest deadline armed by
+// any isolate in the process.
+class CpuWatchdog {
+public:
+  CpuWatchdog();
+  ~CpuWatchdog() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(CpuWatchdog);
+
+  // Arranges for `isolate->TerminateExecution()` to be called once the monotonic clock passes
+  // `deadline`, unless the returned object is dropped first. It must be dropped under the isolate
+  // lock, before the isolate is destroyed.
+  //
+  // If the watchdog did fire, dropping the returned object cancels the termination again, so
+  // that it can't hit whatever JavaScript runs next in case the deadline passed after the
+  // JavaScript it was meant for had already returned.
+  kj::Own<void> arm(v8::Isolate* isolate, kj::TimePoint deadline) const;
+
+private:
+  class Armed;
+
+  struct State {
+    kj::Vector<Armed*> armed;
+    uint64_t generation = 0;  // Bumped by arm() to wake the thread up.
+    bool shutdown = false;
+  };
+  kj::MutexGuarded<State> state;
+
+  // Declared last so that it's joined before `state` is destroyed.
+  kj::Thread thread;
+
+  void run() const;
+};
+
+// Enforces the limits configured in a Worker's `limits`. With the default config, this enforces
+// nothing but the actor cache's memory limits, like workerd always did.
+class WorkerLimitEnforcer final: public IsolateLimitEnforcer {
+public:
+  // `watchdog` is required if `conf` has a CPU limit.
+  WorkerLimitEnforcer(config::Worker::Limits::Reader conf, kj::Maybe<const CpuWatchdog&> watchdog);
+
+  // Wraps the LimitEnforcer of a request so that the request is subject to this Worker's CPU and
+  // memory limits. `inner` enforces everything else. Returns `inner` itself if this Worker has no
+  // such limits.
+  kj::Own<LimitEnforcer> wrapRequest(kj::Own<LimitEnforcer> inner) const;
+
+  v8::Isolate::CreateParams getCreateParams() override;
+  void customizeIsolate(v8::Isolate* isolate) override;
+  ActorCacheSharedLruOptions getActorCacheLruOptions() override;
+  kj::Own<void> enterStartupJs(jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterStartupPython(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterDynamicImportJs(
+      jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterLoggingJs(jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  kj::Own<void> enterInspectorJs(jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const override;
+  void completedRequest(kj::StringPtr id) const override {}
+  bool exitJs(jsg::Lock& lock) const override { return false; }
+  void reportMetrics(IsolateObserver& isolateMetrics) const override {}
+  kj::Maybe<size_t> checkPbkdfIterations(jsg::Lock& lock, size_t iterations) const override {
+    // No limit on the number of iterations in workerd
+    return kj::none;
+  }
+
+private:
+  class RequestLimitEnforcer;
+
+  kj::Maybe<kj::Duration> cpuLimit;
+  size_t heapLimit;  // In bytes; 0 to use V8's default.
+  ActorCacheSharedLruOptions actorCacheOptions;
+  kj::Maybe<const CpuWatchdog&> watchdog;
+  v8::Isolate* isolate = nullptr;  // Set by customizeIsolate().
+
+  // Number of times the isolate's heap reached `heapLimit`. Only accessed under the isolate lock,
+  // so a change between entering and leaving JavaScript means the JavaScript in between hit it.
+  uint heapLimitHits = 0;
+
+  static size_t nearHeapLimit(void* data, size_t currentHeapLimit, size_t initialHeapLimit);
+
+  kj::Own<void> enterStartup(jsg::Lock& lock, kj::Maybe<kj::Exception>& error) const;
+};
+
+}  // namespace workerd::server
@@ -22,6 +22,7 @@
 #include <workerd/io/compatibility-date.capnp.h>
 #include <workerd/io/supported-compatibility-date.capnp.h>
 #include <workerd/util/autogate.h>
+#include <workerd/util/sqlite-pcache.h>
 #include <pyodide/generated/pyodide_extra.capnp.h>
 
 #ifdef WORKERD_EXPERIMENTAL_ENABLE_WEBGPU
@@ -723,7 +724,9 @@ public:
         // TraceConfig structure here rather than just the categories.
         .addOptionWithArg({"p", "perfetto-trace"}, CLI_METHOD(enablePerfetto),
                            "<path>=<categories>",
-                           "Enable perfetto tracing output to the specified file.")
+                           "Enable perfetto tracing output to the specified file. Include the "
+                           "\"workerd.profile\" category to also record sampled JS CPU and heap "
+                           "allocation profiles, attributed to requests.")
 #endif
         .addOption({'w', "watch"}, CLI_METHOD(watch),
                    "Watch configuration files (and server binary) and reload if they change. "
@@ -1203,6 +1206,13 @@ public:
 #endif
       TRACE_EVENT("workerd", "serveImpl()");
       auto config = getConfig();
+      if (config.hasSqlite()) {
+        // Must happen before anything opens a database.
+        size_t pageCacheSize = config.getSqlite().getPageCacheSize();
+        if (pageCacheSize > 0) {
+          SqlitePageCache::install(pageCacheSize);
+        }
+      }
       auto platform = jsg::defaultPlatform(0);
       WorkerdPlatform v8Platform(*platform);
       jsg::V8System v8System(v8Platform,
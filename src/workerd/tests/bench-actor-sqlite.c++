@@ -0,0 +1,88 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/io/actor-sqlite.h>
+#include <workerd/io/io-gate.h>
+#include <kj/filesystem.h>
+
+// storage.get() on a SQLite-backed Durable Object, reading the same hundred keys over and over,
+// with and without ActorSqlite's read cache. The values are 1KiB, about the size of a small
+// serialized object.
+
+namespace workerd {
+namespace {
+
+constexpr size_t KEY_COUNT = 100;
+constexpr size_t VALUE_SIZE = 1024;
+
+struct ActorSqliteBenchmark: public benchmark::Fixture {
+  virtual ~ActorSqliteBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    dir = kj::newInMemoryDirectory(kj::nullClock());
+    vfs = kj::heap<SqliteDatabase::Vfs>(*dir);
+    gate = kj::heap<OutputGate>();
+    lru = kj::heap<ActorCache::SharedLru>(ActorCache::SharedLru::Options {
+      .softLimit = 16 * 1024 * 1024,
+      .hardLimit = 128 * 1024 * 1024,
+      .staleTimeout = 30 * kj::SECONDS,
+      .dirtyListByteLimit = 8 * 1024 * 1024,
+      .maxKeysPerRpc = 128,
+    });
+
+    kj::Maybe<const ActorCache::SharedLru&> readCacheLru;
+    if (state.range(0)) readCacheLru = *lru;
+    actor = kj::heap<ActorSqlite>(
+        kj::heap<SqliteDatabase>(*vfs, kj::Path({"foo"}),
+            kj::WriteMode::CREATE | kj::WriteMode::MODIFY),
+        *gate, []() -> kj::Promise<void> { return kj::READY_NOW; },
+        ActorSqlite::Hooks::DEFAULT, readCacheLru);
+
+    for (auto i: kj::zeroTo(KEY_COUNT)) {
+      auto value = kj::heapArray<kj::byte>(VALUE_SIZE);
+      memset(value.begin(), i, value.size());
+      actor->put(kj::str("key", i), kj::mv(value), {});
+    }
+    gate->wait().wait(*ws);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    actor = nullptr;
+    lru = nullptr;
+    gate = nullptr;
+    vfs = nullptr;
+    dir = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Own<const kj::Directory> dir;
+  kj::Own<SqliteDatabase::Vfs> vfs;
+  kj::Own<OutputGate> gate;
+  kj::Own<ActorCache::SharedLru> lru;
+  kj::Own<ActorSqlite> actor;
+};
+
+BENCHMARK_DEFINE_F(ActorSqliteBenchmark, get)(benchmark::State& state) {
+  state.SetLabel(state.range(0) ? "cached" : "uncached");
+  auto keys = KJ_MAP(i, kj::zeroTo(KEY_COUNT)) { return kj::str("key", i); };
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (auto& key: keys) {
+      auto result = actor->get(kj::str(key), {});
+      auto& value = KJ_ASSERT_NONNULL(result.get<kj::Maybe<ActorCacheOps::Value>>());
+      bytes += value.size();
+    }
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_REGISTER_F(ActorSqliteBenchmark, get)->DenseRange(0, 1);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,119 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/server/cache-store.h>
+#include <stdlib.h>
+
+// Latency of a Cache API hit, from the GET that api::Cache::match() sends to the body having been
+// read, with the store in memory or on disk.
+
+namespace workerd::server {
+namespace {
+
+constexpr size_t ENTRY_COUNT = 1000;
+
+struct CacheStoreBenchmark: public benchmark::Fixture {
+  virtual ~CacheStoreBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    kj::HttpHeaderTable::Builder builder;
+    ids = kj::heap<CacheStore::HeaderIds>(builder);
+    table = builder.build();
+
+    if (state.range(1)) {
+      fs = kj::newDiskFilesystem();
+      const char* tmp = getenv("TEST_TMPDIR");
+      auto path = fs->getCurrentPath().eval(tmp == nullptr ? "/tmp" : tmp)
+          .append("bench-cache-store");
+      dir = fs->getRoot().openSubdir(kj::mv(path),
+          kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    } else {
+      dir = kj::newInMemoryDirectory(kj::systemPreciseCalendarClock());
+    }
+    store = kj::heap<CacheStore>(*ids, *dir, kj::systemPreciseCalendarClock(),
+        CacheStore::Options { .maxSize = uint64_t(1) << 40, .maxEntrySize = uint64_t(1) << 30 });
+
+    auto body = kj::str(kj::repeat('x', state.range(0)));
+    for (auto i: kj::zeroTo(ENTRY_COUNT)) {
+      auto payload = kj::str(
+          "HTTP/1.1 200 OK\r\n"
+          "Content-Type: text/plain\r\n"
+          "Cache-Control: max-age=3600\r\n"
+          "ETag: \"", i, "\"\r\n"
+          "Content-Length: ", body.size(), "\r\n"
+          "\r\n", body);
+      auto client = kj::newHttpClient(*store);
+      auto request = client->request(kj::HttpMethod::PUT, url(i), kj::HttpHeaders(*table),
+                                     uint64_t(payload.size()));
+      request.body->write(payload.asBytes()).wait(*ws);
+      request.body = nullptr;
+      KJ_ASSERT(request.response.wait(*ws).statusCode == 204);
+    }
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    store = nullptr;
+    for (auto& name: dir->listNames()) {
+      dir->remove(kj::Path({name}));
+    }
+    dir = nullptr;
+    fs = nullptr;
+    table = nullptr;
+    ids = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  static kj::String url(size_t i) {
+    return kj::str("https://example.com/", i);
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Own<CacheStore::HeaderIds> ids;
+  kj::Own<kj::HttpHeaderTable> table;
+  kj::Own<kj::Filesystem> fs;
+  kj::Own<const kj::Directory> dir;
+  kj::Own<CacheStore> store;
+};
+
+// Arguments are the body size, and whether the store is on disk.
+BENCHMARK_DEFINE_F(CacheStoreBenchmark, hit)(benchmark::State& state) {
+  kj::HttpHeaders headers(*table);
+  headers.set(ids->cacheControl, "only-if-cached");
+  auto client = kj::newHttpClient(*store);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto request = client->request(kj::HttpMethod::GET, url(i++ % ENTRY_COUNT), headers,
+                                   uint64_t(0));
+    auto response = request.response.wait(*ws);
+    KJ_ASSERT(response.statusCode == 200);
+    benchmark::DoNotOptimize(response.body->readAllBytes().wait(*ws));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_REGISTER_F(CacheStoreBenchmark, hit)
+    ->ArgsProduct({{1024, 65536, 1 << 20}, {0, 1}});
+
+// A conditional GET that's answered with a 304, so no body is read.
+BENCHMARK_DEFINE_F(CacheStoreBenchmark, notModified)(benchmark::State& state) {
+  auto client = kj::newHttpClient(*store);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto n = i++ % ENTRY_COUNT;
+    kj::HttpHeaders headers(*table);
+    headers.set(ids->cacheControl, "only-if-cached");
+    headers.set(ids->ifNoneMatch, kj::str("\"", n, "\""));
+    auto request = client->request(kj::HttpMethod::GET, url(n), headers, uint64_t(0));
+    auto response = request.response.wait(*ws);
+    KJ_ASSERT(response.statusCode == 304);
+  }
+}
+BENCHMARK_REGISTER_F(CacheStoreBenchmark, notModified)->Args({1024, 0})->Args({1024, 1});
+
+} // namespace
+} // namespace workerd::server
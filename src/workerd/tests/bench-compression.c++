@@ -0,0 +1,103 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// Throughput and compression ratio of CompressionStream / DecompressionStream for gzip, brotli
+// and zstd at their default settings. The payload is a JSON API response of about 256KB, the kind
+// of body we would recompress at the edge. The "ratio" counter is uncompressed / compressed size.
+
+namespace workerd {
+namespace {
+
+constexpr kj::StringPtr FORMATS[] = { "gzip"_kj, "br"_kj, "zstd"_kj };
+
+struct CompressionBenchmark: public benchmark::Fixture {
+  virtual ~CompressionBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const items = [];
+        for (let i = 0; i < 1500; i++) {
+          items.push({
+            id: i,
+            name: `item-${i}`,
+            tags: ['alpha', 'beta', 'gamma'].slice(i % 3),
+            price: (i * 7919 % 10000) / 100,
+            description: `Description of item ${i}, which is not very interesting.`,
+          });
+        }
+        const payload = new TextEncoder().encode(JSON.stringify({ items }));
+        const compressed = {};
+
+        async function pipe(stream, data) {
+          const writer = stream.writable.getWriter();
+          writer.write(data);
+          writer.close();
+          return new Uint8Array(await new Response(stream.readable).arrayBuffer());
+        }
+
+        export default {
+          async fetch(request) {
+            const url = new URL(request.url);
+            const format = url.searchParams.get('format');
+            if (url.pathname === '/compress') {
+              const result = await pipe(new CompressionStream(format), payload);
+              return new Response(`${payload.byteLength} ${result.byteLength}`);
+            } else {
+              compressed[format] ??= await pipe(new CompressionStream(format), payload);
+              const result = await pipe(new DecompressionStream(format), compressed[format]);
+              return new Response(`${result.byteLength}`);
+            }
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(CompressionBenchmark, compress)(benchmark::State& state) {
+  auto format = FORMATS[state.range(0)];
+  state.SetLabel(format.cStr());
+  auto url = kj::str("http://www.example.com/compress?format=", format);
+  size_t bytes = 0;
+  double ratio = 0;
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+    auto space = KJ_ASSERT_NONNULL(result.body.findFirst(' '));
+    auto inputSize = kj::str(result.body.slice(0, space)).parseAs<size_t>();
+    auto outputSize = result.body.slice(space + 1).parseAs<size_t>();
+    bytes += inputSize;
+    ratio = double(inputSize) / outputSize;
+  }
+  state.SetBytesProcessed(bytes);
+  state.counters["ratio"] = ratio;
+}
+BENCHMARK_REGISTER_F(CompressionBenchmark, compress)->DenseRange(0, 2);
+
+BENCHMARK_DEFINE_F(CompressionBenchmark, decompress)(benchmark::State& state) {
+  auto format = FORMATS[state.range(0)];
+  state.SetLabel(format.cStr());
+  auto url = kj::str("http://www.example.com/decompress?format=", format);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+    bytes += result.body.parseAs<size_t>();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_REGISTER_F(CompressionBenchmark, decompress)->DenseRange(0, 2);
+
+} // namespace
+} // namespace workerd
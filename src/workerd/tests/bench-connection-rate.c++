@@ -0,0 +1,68 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <kj/async-io.h>
+#include <kj/compat/http.h>
+
+// Rate of new connections, each carrying one HTTP request, to a kj::HttpServer listening on
+// loopback, as a Socket's listener serves them. The argument is how many clients connect at once,
+// to compare the accept loop under a burst of connections with one connection at a time.
+
+namespace workerd {
+namespace {
+
+class OkService final: public kj::HttpService {
+public:
+  explicit OkService(kj::HttpHeaderTable& headerTable): headerTable(headerTable) {}
+
+  kj::Promise<void> request(kj::HttpMethod method, kj::StringPtr url,
+                            const kj::HttpHeaders& headers, kj::AsyncInputStream& requestBody,
+                            Response& response) override {
+    kj::HttpHeaders responseHeaders(headerTable);
+    auto body = response.send(200, "OK", responseHeaders, 2);
+    co_await body->write("ok"_kjb);
+  }
+
+private:
+  kj::HttpHeaderTable& headerTable;
+};
+
+kj::Promise<void> connectAndRequest(kj::NetworkAddress& address,
+                                    kj::HttpHeaderTable& headerTable) {
+  auto stream = co_await address.connect();
+  auto client = kj::newHttpClient(headerTable, *stream);
+  auto response = co_await client->request(
+      kj::HttpMethod::GET, "/", kj::HttpHeaders(headerTable)).response;
+  benchmark::DoNotOptimize(co_await response.body->readAllText());
+}
+
+// The argument is the number of concurrent clients.
+static void BM_ConnectionRate(benchmark::State& state) {
+  auto io = kj::setupAsyncIo();
+  auto& ws = io.waitScope;
+  size_t concurrency = state.range(0);
+
+  kj::HttpHeaderTable headerTable;
+  OkService service(headerTable);
+  kj::HttpServer server(io.provider->getTimer(), headerTable, service);
+
+  auto listener = io.provider->getNetwork().parseAddress("127.0.0.1", 0).wait(ws)->listen();
+  auto address = io.provider->getNetwork()
+      .parseAddress("127.0.0.1", listener->getPort()).wait(ws);
+  auto serving = server.listenHttp(*listener).eagerlyEvaluate(nullptr);
+
+  for (auto _ : state) {
+    auto requests = kj::heapArrayBuilder<kj::Promise<void>>(concurrency);
+    for (size_t i = 0; i < concurrency; i++) {
+      requests.add(connectAndRequest(*address, headerTable));
+    }
+    kj::joinPromises(requests.finish()).wait(ws);
+  }
+  state.SetItemsProcessed(state.iterations() * concurrency);
+}
+WD_BENCHMARK(BM_ConnectionRate)->Arg(1)->Arg(16)->Arg(128);
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,77 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/util/autogate.h>
+
+// A benchmark for the latency of CPU-heavy crypto operations, with offloading to the crypto
+// thread pool disabled (arg 0) and enabled (arg 1). Each request kicks off a burst of concurrent
+// PBKDF2 derivations, as a login endpoint under load would, and responds once they all finish.
+// Without offloading they run back to back while holding the isolate lock; with it they run in
+// parallel on the pool. Wall-clock time is what matters here, since the work happens on other
+// threads.
+
+namespace workerd {
+namespace {
+
+struct CryptoOffloadBenchmark: public benchmark::Fixture {
+  virtual ~CryptoOffloadBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const encoder = new TextEncoder();
+        export default {
+          async fetch(request) {
+            const count = parseInt(new URL(request.url).searchParams.get('count'));
+            const key = await crypto.subtle.importKey(
+                'raw', encoder.encode('hunter2'), 'PBKDF2', false, ['deriveBits']);
+            const derivations = [];
+            for (let i = 0; i < count; i++) {
+              derivations.push(crypto.subtle.deriveBits({
+                name: 'PBKDF2', hash: 'SHA-256', salt: encoder.encode(`salt${i}`),
+                iterations: 100000,
+              }, key, 256));
+            }
+            await Promise.all(derivations);
+            return new Response('OK');
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+    // TestFixture resets the autogates when it is constructed.
+    if (state.range(0)) {
+      util::Autogate::initAutogateNamesForTest({"crypto-offload"_kj});
+    }
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+    util::Autogate::deinitAutogate();
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_DEFINE_F(CryptoOffloadBenchmark, single)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET,
+        "http://www.example.com/?count=1"_kj, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+}
+BENCHMARK_REGISTER_F(CryptoOffloadBenchmark, single)->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_DEFINE_F(CryptoOffloadBenchmark, burst)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET,
+        "http://www.example.com/?count=8"_kj, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+}
+BENCHMARK_REGISTER_F(CryptoOffloadBenchmark, burst)->Arg(0)->Arg(1)->UseRealTime();
+
+} // namespace
+} // namespace workerd
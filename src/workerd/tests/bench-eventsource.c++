@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// A benchmark for EventSource stream parsing. Each request feeds a synthetic, high-frequency
+// server-sent event stream through EventSource.from() and waits for every message to be
+// dispatched.
+
+namespace workerd {
+namespace {
+
+struct EventSourceBenchmark: public benchmark::Fixture {
+  virtual ~EventSourceBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const EVENTS_PER_CHUNK = 100;
+        const CHUNKS = 50;
+
+        // Build the stream once: chunk boundaries deliberately fall in the middle of lines.
+        let text = '';
+        for (let i = 0; i < EVENTS_PER_CHUNK * CHUNKS; i++) {
+          text += `id: ${i}\nevent: tick\ndata: {"seq":${i},"value":${i * 7}}\ndata: more\n\n`;
+        }
+        const bytes = new TextEncoder().encode(text);
+        const chunkSize = Math.ceil(bytes.length / CHUNKS);
+
+        export default {
+          async fetch(request) {
+            let offset = 0;
+            const stream = new ReadableStream({
+              pull(c) {
+                c.enqueue(bytes.slice(offset, offset + chunkSize));
+                offset += chunkSize;
+                if (offset >= bytes.length) c.close();
+              }
+            });
+
+            const { promise, resolve } = Promise.withResolvers();
+            const eventsource = EventSource.from(stream);
+            let count = 0;
+            eventsource.addEventListener('tick', () => {
+              if (++count === EVENTS_PER_CHUNK * CHUNKS) {
+                eventsource.close();
+                resolve();
+              }
+            });
+            await promise;
+            return new Response(`${count}`);
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(EventSourceBenchmark, parseStream)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, "http://www.example.com"_kj, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+}
+
+} // namespace
+} // namespace workerd
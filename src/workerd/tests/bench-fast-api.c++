@@ -0,0 +1,82 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// A microbenchmark for the per-call overhead of JSG methods from optimized JavaScript.
+// `performance.now()` is declared with JSG_FAST_METHOD, so once the loop is optimized V8 calls it
+// through the fast API path. `Date.now()` is a V8 builtin and serves as the lower bound, and
+// `performance.timeOrigin` is a regular JSG property for comparison with the slow callback path.
+
+namespace workerd {
+namespace {
+
+constexpr size_t CALLS_PER_REQUEST = 100000;
+
+struct FastApiBenchmark: public benchmark::Fixture {
+  virtual ~FastApiBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const loops = {
+          performanceNow(n) {
+            let sum = 0;
+            for (let i = 0; i < n; i++) sum += performance.now();
+            return sum;
+          },
+          timeOrigin(n) {
+            let sum = 0;
+            for (let i = 0; i < n; i++) sum += performance.timeOrigin;
+            return sum;
+          },
+          dateNow(n) {
+            let sum = 0;
+            for (let i = 0; i < n; i++) sum += Date.now();
+            return sum;
+          },
+        };
+        export default {
+          async fetch(request) {
+            const url = new URL(request.url);
+            const n = parseInt(url.searchParams.get('n'));
+            loops[url.pathname.slice(1)](n);
+            return new Response('OK');
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void run(benchmark::State& state, kj::StringPtr loop) {
+    auto url = kj::str("http://www.example.com/", loop, "?n=", CALLS_PER_REQUEST);
+    for (auto _ : state) {
+      auto result = fixture->runRequest(kj::HttpMethod::GET, url, ""_kj);
+      KJ_EXPECT(result.statusCode == 200);
+    }
+    state.SetItemsProcessed(state.iterations() * CALLS_PER_REQUEST);
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(FastApiBenchmark, performanceNow)(benchmark::State& state) {
+  run(state, "performanceNow"_kj);
+}
+
+BENCHMARK_F(FastApiBenchmark, timeOrigin)(benchmark::State& state) {
+  run(state, "timeOrigin"_kj);
+}
+
+BENCHMARK_F(FastApiBenchmark, dateNow)(benchmark::State& state) {
+  run(state, "dateNow"_kj);
+}
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,103 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/io/hibernation-manager.h>
+
+// Sending one message to every hibernating WebSocket of a Durable Object, as a chat room or game
+// lobby does, for growing numbers of WebSockets: with broadcast(), and by waking each of them with
+// getWebSockets() and calling send(). Each iteration lasts until every peer has received the
+// message, and `heapGrowth` counts the V8 heap used by the end of the run beyond what it started
+// with.
+
+namespace workerd {
+namespace {
+
+constexpr auto MESSAGE = "{\"type\":\"update\",\"payload\":\"0123456789abcdef0123456789abcdef\"}"_kj;
+
+size_t usedHeapSize(jsg::Lock& js) {
+  v8::HeapStatistics stats;
+  js.v8Isolate->GetHeapStatistics(&stats);
+  return stats.used_heap_size();
+}
+
+struct HibernationBroadcastBenchmark: public benchmark::Fixture {
+  virtual ~HibernationBroadcastBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>(TestFixture::SetupParams {
+      .actorId = kj::str("broadcast-bench"),
+    });
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      auto& actor = KJ_ASSERT_NONNULL(env.context.getActor());
+      manager = kj::refcounted<HibernationManagerImpl>(actor.getLoopback(), 0);
+      for (auto i KJ_UNUSED: kj::zeroTo(state.range(0))) {
+        auto pipe = kj::newWebSocketPipe();
+        peers.add(kj::mv(pipe.ends[1]));
+        manager->acceptWebSocket(jsg::alloc<api::WebSocket>(kj::mv(pipe.ends[0])), nullptr);
+      }
+      manager->hibernateWebSockets(env.lock);
+    });
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      manager->hibernateWebSockets(env.lock);
+      manager = nullptr;
+    });
+    peers.clear();
+    fixture = nullptr;
+  }
+
+  kj::Promise<void> allReceived() {
+    auto promises = KJ_MAP(peer, peers) { return peer->receive().ignoreResult(); };
+    return kj::joinPromises(kj::mv(promises));
+  }
+
+  kj::Own<TestFixture> fixture;
+  kj::Own<HibernationManagerImpl> manager;
+  kj::Vector<kj::Own<kj::WebSocket>> peers;
+};
+
+BENCHMARK_DEFINE_F(HibernationBroadcastBenchmark, broadcast)(benchmark::State& state) {
+  size_t heapBefore = 0;
+  size_t heapAfter = 0;
+  for (auto _ : state) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      if (heapBefore == 0) heapBefore = usedHeapSize(env.js);
+      manager->broadcast(env.js, kj::str(MESSAGE), kj::none);
+      heapAfter = usedHeapSize(env.js);
+      return allReceived();
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["heapGrowth"] = double(heapAfter) - double(heapBefore);
+}
+BENCHMARK_REGISTER_F(HibernationBroadcastBenchmark, broadcast)
+    ->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_DEFINE_F(HibernationBroadcastBenchmark, getWebSockets)(benchmark::State& state) {
+  size_t heapBefore = 0;
+  size_t heapAfter = 0;
+  for (auto _ : state) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      if (heapBefore == 0) heapBefore = usedHeapSize(env.js);
+      // The previous iteration woke everything up, so put it back to sleep first.
+      manager->hibernateWebSockets(env.lock);
+      for (auto& ws: manager->getWebSockets(env.js, kj::none)) {
+        ws->send(env.js, kj::str(MESSAGE));
+      }
+      heapAfter = usedHeapSize(env.js);
+      return allReceived();
+    });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["heapGrowth"] = double(heapAfter) - double(heapBefore);
+}
+BENCHMARK_REGISTER_F(HibernationBroadcastBenchmark, getWebSockets)
+    ->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace workerd
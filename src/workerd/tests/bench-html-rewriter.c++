@@ -0,0 +1,60 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// A benchmark for the per-response setup cost of HTMLRewriter: each request builds a fresh
+// rewriter with a realistic number of selectors and transforms a small document, so the measured
+// time is dominated by handler registration rather than by parsing HTML.
+
+namespace workerd {
+namespace {
+
+struct HtmlRewriterBenchmark: public benchmark::Fixture {
+  virtual ~HtmlRewriterBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        const SELECTORS = [];
+        for (let i = 0; i < 40; i++) {
+          SELECTORS.push(`div.item-${i} > a[href^="https://"]`);
+        }
+        const HTML = '<html><head><title>t</title></head><body>' +
+            '<div class="item-1"><a href="https://example.com/">link</a></div>' +
+            '</body></html>';
+
+        export default {
+          async fetch(request) {
+            const rewriter = new HTMLRewriter();
+            for (const selector of SELECTORS) {
+              rewriter.on(selector, { element(e) { e.setAttribute("data-seen", "1"); } });
+            }
+            const response = rewriter.transform(new Response(HTML, {
+              headers: { "content-type": "text/html" },
+            }));
+            return new Response(await response.text());
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(HtmlRewriterBenchmark, perResponseSetup)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto result = fixture->runRequest(kj::HttpMethod::GET, "http://www.example.com"_kj, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+  }
+}
+
+} // namespace
+} // namespace workerd
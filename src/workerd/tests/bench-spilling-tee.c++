@@ -0,0 +1,84 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/util/spilling-tee.h>
+#include <workerd/util/stream-utils.h>
+#include <stdlib.h>
+
+// Teeing 64MiB where one branch is read to the end before the other starts, the way a Worker
+// that caches a response body while also returning it ends up reading the clone: buffered all in
+// memory by kj::newTee(), or mostly on disk by newSpillingTee().
+
+namespace workerd {
+namespace {
+
+constexpr size_t TOTAL_BYTES = 64 * 1024 * 1024;
+
+void readAll(kj::AsyncInputStream& in, kj::ArrayPtr<kj::byte> buffer, kj::WaitScope& ws) {
+  while (in.tryRead(buffer.begin(), 1, buffer.size()).wait(ws) > 0) {}
+}
+
+struct AsymmetricTeeBenchmark: public benchmark::Fixture {
+  virtual ~AsymmetricTeeBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    data = kj::heapArray<kj::byte>(TOTAL_BYTES);
+    memset(data.begin(), 'x', data.size());
+    buffer = kj::heapArray<kj::byte>(65536);
+
+    fs = kj::newDiskFilesystem();
+    const char* tmp = getenv("TEST_TMPDIR");
+    auto path = fs->getCurrentPath().eval(tmp == nullptr ? "/tmp" : tmp);
+    dir = fs->getRoot().openSubdir(path);
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    dir = nullptr;
+    fs = nullptr;
+    buffer = nullptr;
+    data = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  void readBranches(kj::Tee tee) {
+    readAll(*tee.branches[0], buffer, *ws);
+    readAll(*tee.branches[1], buffer, *ws);
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Array<kj::byte> data;
+  kj::Array<kj::byte> buffer;
+  kj::Own<kj::Filesystem> fs;
+  kj::Own<const kj::Directory> dir;
+};
+
+BENCHMARK_DEFINE_F(AsymmetricTeeBenchmark, inMemory)(benchmark::State& state) {
+  for (auto _ : state) {
+    readBranches(kj::newTee(newMemoryInputStream(data)));
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+BENCHMARK_REGISTER_F(AsymmetricTeeBenchmark, inMemory)->Unit(benchmark::kMillisecond);
+
+// Argument is the memory limit in KiB.
+BENCHMARK_DEFINE_F(AsymmetricTeeBenchmark, spilling)(benchmark::State& state) {
+  for (auto _ : state) {
+    readBranches(newSpillingTee(newMemoryInputStream(data), {
+      .memoryLimit = size_t(state.range(0)) * 1024,
+      .bufferLimit = kj::maxValue,
+      .newSpillFile = [this]() { return dir->createTemporary(); },
+    }));
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+BENCHMARK_REGISTER_F(AsymmetricTeeBenchmark, spilling)
+    ->Arg(256)->Arg(1024)->Arg(8192)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace workerd
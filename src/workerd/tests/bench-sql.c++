@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+#include <workerd/api/sql.h>
+#include <workerd/util/sqlite-columnar.h>
+
+// Turning the results of a SQL query into JavaScript values, as row objects and by column, and
+// into the binary columnar format that exportColumns() streams.
+
+namespace workerd {
+namespace {
+
+constexpr size_t ROW_COUNT = 10000;
+
+struct SqlBenchmark: public benchmark::Fixture {
+  virtual ~SqlBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    fixture = kj::heap<TestFixture>();
+    dir = kj::newInMemoryDirectory(kj::nullClock());
+    vfs = kj::heap<SqliteDatabase::Vfs>(*dir);
+    db = kj::heap<SqliteDatabase>(*vfs, kj::Path({"bench"}),
+        kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    db->run(R"(
+      CREATE TABLE things (id INTEGER PRIMARY KEY, score REAL, name TEXT, count INTEGER);
+      WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i < 9999)
+      INSERT INTO things SELECT i, i * 0.5, 'thing ' || i, i % 17 FROM n;
+    )");
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    db = nullptr;
+    vfs = nullptr;
+    dir = nullptr;
+    fixture = nullptr;
+  }
+
+  jsg::Ref<api::SqlStorage::Cursor> query() {
+    return jsg::alloc<api::SqlStorage::Cursor>(*db, SqliteDatabase::TRUSTED,
+        "SELECT id, score, name, count FROM things",
+        kj::Array<api::SqlStorage::BindingValue>());
+  }
+
+  kj::Own<TestFixture> fixture;
+  kj::Own<const kj::Directory> dir;
+  kj::Own<SqliteDatabase::Vfs> vfs;
+  kj::Own<SqliteDatabase> db;
+};
+
+BENCHMARK_F(SqlBenchmark, rows)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    for (auto _ : state) {
+      env.js.withinHandleScope([&] {
+        auto rows = query()->rows(env.js);
+        while (!rows->next(env.js).done) {}
+      });
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * ROW_COUNT);
+}
+
+BENCHMARK_F(SqlBenchmark, rawColumns)(benchmark::State& state) {
+  fixture->runInIoContext([&](const TestFixture::Environment& env) {
+    for (auto _ : state) {
+      env.js.withinHandleScope([&] {
+        benchmark::DoNotOptimize(query()->rawColumns(env.js));
+      });
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * ROW_COUNT);
+}
+
+BENCHMARK_F(SqlBenchmark, exportColumns)(benchmark::State& state) {
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto query = db->run("SELECT id, score, name, count FROM things");
+    SqliteColumnar::Writer writer(query);
+    while (true) {
+      auto chunk = KJ_UNWRAP_OR(writer.next(), break);
+      bytes += chunk.size();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * ROW_COUNT);
+  state.SetBytesProcessed(bytes);
+}
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,100 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/api/global-scope.h>
+#include <workerd/io/trace.h>
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// A benchmark for the cost of delivering traces to a tail worker. Each iteration hands a batch
+// of traces (each with a fetch event, a handful of logs and an exception) to the tail() handler.
+// The handler follows the common pattern of only inspecting failed requests in detail, so the
+// `filter` case measures the per-trace overhead when the tail worker looks at nothing but
+// `outcome`, and `readAll` measures the case where every field gets materialized.
+
+namespace workerd {
+namespace {
+
+constexpr size_t TRACES_PER_BATCH = 100;
+constexpr size_t LOGS_PER_TRACE = 10;
+
+kj::Own<Trace> makeTrace(EventOutcome outcome) {
+  auto trace = kj::refcounted<Trace>(kj::none, kj::str("traced-worker"), kj::none, kj::none,
+      kj::none, nullptr, kj::none);
+  trace->eventTimestamp = kj::UNIX_EPOCH + 1 * kj::SECONDS;
+  auto headers = kj::heapArrayBuilder<Trace::FetchEventInfo::Header>(3);
+  headers.add(kj::str("accept"), kj::str("*/*"));
+  headers.add(kj::str("authorization"), kj::str("Bearer abc"));
+  headers.add(kj::str("user-agent"), kj::str("bench"));
+  trace->eventInfo = Trace::FetchEventInfo(kj::HttpMethod::GET,
+      kj::str("https://example.com/some/path?query=1"),
+      kj::str(R"({"colo":"SFO","country":"US","asn":13335})"), headers.finish());
+  for (uint i = 0; i < LOGS_PER_TRACE; i++) {
+    trace->logs.add(kj::UNIX_EPOCH + i * kj::MILLISECONDS, LogLevel::LOG,
+        kj::str(R"(["log line", )", i, R"(, {"nested": true}])"));
+  }
+  trace->exceptions.add(kj::UNIX_EPOCH, kj::str("Error"), kj::str("something went wrong"),
+      kj::str("Error: something went wrong\n    at fetch (worker.js:1:1)"));
+  trace->outcome = outcome;
+  return trace;
+}
+
+struct TailBenchmark: public benchmark::Fixture {
+  virtual ~TailBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    TestFixture::SetupParams params = {
+      .mainModuleSource = R"(
+        export default {
+          tail(events) {
+            let seen = 0;
+            for (const event of events) {
+              if (event.outcome !== 'exception') continue;
+              const request = event.event.request;
+              seen += request.url.length + Object.keys(request.headers).length;
+              seen += request.cf.colo.length;
+              for (const log of event.logs) seen += log.message.length;
+              for (const ex of event.exceptions) seen += ex.message.length;
+            }
+            globalThis.seen = seen;
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  void deliver(kj::ArrayPtr<kj::Own<Trace>> traces) {
+    fixture->runInIoContext([&](const TestFixture::Environment& env) {
+      auto handler = env.lock.getExportedHandler(kj::none, kj::none);
+      env.lock.getGlobalScope().sendTraces(traces, env.lock, handler);
+    });
+  }
+
+  kj::Own<TestFixture> fixture;
+};
+
+BENCHMARK_F(TailBenchmark, filter)(benchmark::State& state) {
+  auto traces = KJ_MAP(i, kj::zeroTo(TRACES_PER_BATCH)) { return makeTrace(EventOutcome::OK); };
+  for (auto _ : state) {
+    deliver(traces);
+  }
+  state.SetItemsProcessed(state.iterations() * TRACES_PER_BATCH);
+}
+
+BENCHMARK_F(TailBenchmark, readAll)(benchmark::State& state) {
+  auto traces = KJ_MAP(i, kj::zeroTo(TRACES_PER_BATCH)) {
+    return makeTrace(EventOutcome::EXCEPTION);
+  };
+  for (auto _ : state) {
+    deliver(traces);
+  }
+  state.SetItemsProcessed(state.iterations() * TRACES_PER_BATCH);
+}
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/api/streams/transform.h>
+
+// Streaming 16MiB through the identity pipe behind `new TransformStream()`, the way a proxy
+// Worker's response body goes out: pumped to a sink, or read a buffer at a time, as it was before
+// pumpTo() forwarded writes directly.
+
+namespace workerd {
+namespace {
+
+constexpr size_t TOTAL_BYTES = 16 * 1024 * 1024;
+
+class NullSink final: public api::WritableStreamSink {
+public:
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override { return kj::READY_NOW; }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> end() override { return kj::READY_NOW; }
+  void abort(kj::Exception reason) override {}
+};
+
+kj::Promise<void> writeAll(api::WritableStreamSink& out, kj::ArrayPtr<const kj::byte> chunk) {
+  for (size_t written = 0; written < TOTAL_BYTES; written += chunk.size()) {
+    co_await out.write(chunk);
+  }
+  co_await out.end();
+}
+
+kj::Promise<void> readAll(api::ReadableStreamSource& in) {
+  kj::byte buffer[4096];
+  while (co_await in.tryRead(buffer, 1, sizeof(buffer)) > 0) {}
+}
+
+struct IdentityPipeBenchmark: public benchmark::Fixture {
+  virtual ~IdentityPipeBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    loop = kj::heap<kj::EventLoop>();
+    ws = kj::heap<kj::WaitScope>(*loop);
+    chunk = kj::heapArray<kj::byte>(state.range(0));
+    memset(chunk.begin(), 'x', chunk.size());
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    chunk = nullptr;
+    ws = nullptr;
+    loop = nullptr;
+  }
+
+  kj::Own<kj::EventLoop> loop;
+  kj::Own<kj::WaitScope> ws;
+  kj::Array<kj::byte> chunk;
+};
+
+BENCHMARK_DEFINE_F(IdentityPipeBenchmark, pump)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto pipe = api::newIdentityPipe();
+    NullSink sink;
+    auto writing = writeAll(*pipe.out, chunk);
+    auto pumping = pipe.in->pumpTo(sink, true)
+        .then([](api::DeferredProxy<void> proxy) { return kj::mv(proxy.proxyTask); });
+    kj::joinPromises(kj::arr(kj::mv(writing), kj::mv(pumping))).wait(*ws);
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+BENCHMARK_REGISTER_F(IdentityPipeBenchmark, pump)->Arg(4096)->Arg(65536);
+
+BENCHMARK_DEFINE_F(IdentityPipeBenchmark, read)(benchmark::State& state) {
+  for (auto _ : state) {
+    auto pipe = api::newIdentityPipe();
+    auto writing = writeAll(*pipe.out, chunk);
+    auto reading = readAll(*pipe.in);
+    kj::joinPromises(kj::arr(kj::mv(writing), kj::mv(reading))).wait(*ws);
+  }
+  state.SetBytesProcessed(state.iterations() * TOTAL_BYTES);
+}
+BENCHMARK_REGISTER_F(IdentityPipeBenchmark, read)->Arg(4096)->Arg(65536);
+
+} // namespace
+} // namespace workerd
@@ -0,0 +1,303 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include <workerd/tests/bench-tools.h>
+#include <workerd/tests/test-fixture.h>
+
+// node:zlib against what workers bundled before it existed: a pure-JS inflate (a port of tinf,
+// the same algorithm as the tiny-inflate package) standing in for the polyfills. The polyfill
+// doesn't verify the gzip CRC, so it gets off lightly. The payload is a ~200KB JSON document.
+
+namespace workerd {
+namespace {
+
+constexpr kj::StringPtr INFLATE_IMPLS[] = { "gunzipSync"_kj, "Gunzip"_kj, "polyfill"_kj };
+constexpr kj::StringPtr DEFLATE_IMPLS[] = { "gzipSync"_kj, "brotliCompressSync"_kj };
+
+struct ZlibBenchmark: public benchmark::Fixture {
+  virtual ~ZlibBenchmark() noexcept(true) {}
+
+  void SetUp(benchmark::State& state) noexcept(true) override {
+    auto flags = message.initRoot<CompatibilityFlags>();
+    flags.setNodeJsCompat(true);
+    flags.setNodeJsZlib(true);
+
+    TestFixture::SetupParams params = {
+      .featureFlags = flags.asReader(),
+      .mainModuleSource = R"(
+        import { Buffer } from 'node:buffer';
+        import * as zlib from 'node:zlib';
+
+        const items = [];
+        for (let i = 0; i < 1500; i++) {
+          items.push({
+            id: i,
+            name: `item-${i}`,
+            tags: ['alpha', 'beta', 'gamma'].slice(i % 3),
+            price: (i * 7919 % 10000) / 100,
+            description: `Description of item ${i}, which is not very interesting.`,
+          });
+        }
+        const payload = Buffer.from(JSON.stringify({ items }));
+        const compressed = zlib.gzipSync(payload);
+
+        // ---- tinf ----
+        function Tree() {
+          this.table = new Uint16Array(16);
+          this.trans = new Uint16Array(288);
+        }
+        const sltree = new Tree();
+        const sdtree = new Tree();
+        const codeTree = new Tree();
+        const lengthBits = new Uint8Array(30);
+        const lengthBase = new Uint16Array(30);
+        const distBits = new Uint8Array(30);
+        const distBase = new Uint16Array(30);
+        const clcidx = new Uint8Array(
+            [16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15]);
+        const lengths = new Uint8Array(288 + 32);
+        const offs = new Uint16Array(16);
+
+        function buildBitsBase(bits, base, delta, first) {
+          for (let i = 0; i < delta; ++i) bits[i] = 0;
+          for (let i = 0; i < 30 - delta; ++i) bits[i + delta] = i / delta | 0;
+          for (let sum = first, i = 0; i < 30; ++i) {
+            base[i] = sum;
+            sum += 1 << bits[i];
+          }
+        }
+
+        function buildFixedTrees(lt, dt) {
+          for (let i = 0; i < 7; ++i) lt.table[i] = 0;
+          lt.table[7] = 24;
+          lt.table[8] = 152;
+          lt.table[9] = 112;
+          for (let i = 0; i < 24; ++i) lt.trans[i] = 256 + i;
+          for (let i = 0; i < 144; ++i) lt.trans[24 + i] = i;
+          for (let i = 0; i < 8; ++i) lt.trans[24 + 144 + i] = 280 + i;
+          for (let i = 0; i < 112; ++i) lt.trans[24 + 144 + 8 + i] = 144 + i;
+          for (let i = 0; i < 5; ++i) dt.table[i] = 0;
+          dt.table[5] = 32;
+          for (let i = 0; i < 32; ++i) dt.trans[i] = i;
+        }
+
+        function buildTree(t, lengths, off, num) {
+          for (let i = 0; i < 16; ++i) t.table[i] = 0;
+          for (let i = 0; i < num; ++i) t.table[lengths[off + i]]++;
+          t.table[0] = 0;
+          for (let sum = 0, i = 0; i < 16; ++i) {
+            offs[i] = sum;
+            sum += t.table[i];
+          }
+          for (let i = 0; i < num; ++i) {
+            if (lengths[off + i]) t.trans[offs[lengths[off + i]]++] = i;
+          }
+        }
+
+        function getBit(d) {
+          if (!d.bitcount--) {
+            d.tag = d.source[d.sourceIndex++];
+            d.bitcount = 7;
+          }
+          const bit = d.tag & 1;
+          d.tag >>>= 1;
+          return bit;
+        }
+
+        function readBits(d, num, base) {
+          if (!num) return base;
+          while (d.bitcount < 24) {
+            d.tag |= d.source[d.sourceIndex++] << d.bitcount;
+            d.bitcount += 8;
+          }
+          const val = d.tag & (0xffff >>> (16 - num));
+          d.tag >>>= num;
+          d.bitcount -= num;
+          return val + base;
+        }
+
+        function decodeSymbol(d, t) {
+          while (d.bitcount < 24) {
+            d.tag |= d.source[d.sourceIndex++] << d.bitcount;
+            d.bitcount += 8;
+          }
+          let sum = 0, cur = 0, len = 0;
+          let tag = d.tag;
+          do {
+            cur = 2 * cur + (tag & 1);
+            tag >>>= 1;
+            ++len;
+            sum += t.table[len];
+            cur -= t.table[len];
+          } while (cur >= 0);
+          d.tag = tag;
+          d.bitcount -= len;
+          return t.trans[sum + cur];
+        }
+
+        function decodeTrees(d, lt, dt) {
+          const hlit = readBits(d, 5, 257);
+          const hdist = readBits(d, 5, 1);
+          const hclen = readBits(d, 4, 4);
+          for (let i = 0; i < 19; ++i) lengths[i] = 0;
+          for (let i = 0; i < hclen; ++i) lengths[clcidx[i]] = readBits(d, 3, 0);
+          buildTree(codeTree, lengths, 0, 19);
+          for (let num = 0; num < hlit + hdist;) {
+            const sym = decodeSymbol(d, codeTree);
+            if (sym === 16) {
+              const prev = lengths[num - 1];
+              for (let length = readBits(d, 2, 3); length; --length) lengths[num++] = prev;
+            } else if (sym === 17) {
+              for (let length = readBits(d, 3, 3); length; --length) lengths[num++] = 0;
+            } else if (sym === 18) {
+              for (let length = readBits(d, 7, 11); length; --length) lengths[num++] = 0;
+            } else {
+              lengths[num++] = sym;
+            }
+          }
+          buildTree(lt, lengths, 0, hlit);
+          buildTree(dt, lengths, hlit, hdist);
+        }
+
+        function inflateBlockData(d, lt, dt) {
+          for (;;) {
+            let sym = decodeSymbol(d, lt);
+            if (sym === 256) return;
+            if (sym < 256) {
+              d.dest[d.destLen++] = sym;
+            } else {
+              sym -= 257;
+              const length = readBits(d, lengthBits[sym], lengthBase[sym]);
+              const dist = decodeSymbol(d, dt);
+              const start = d.destLen - readBits(d, distBits[dist], distBase[dist]);
+              for (let i = start; i < start + length; ++i) d.dest[d.destLen++] = d.dest[i];
+            }
+          }
+        }
+
+        function inflateUncompressedBlock(d) {
+          while (d.bitcount > 8) {
+            d.sourceIndex--;
+            d.bitcount -= 8;
+          }
+          const length = 256 * d.source[d.sourceIndex + 1] + d.source[d.sourceIndex];
+          d.sourceIndex += 4;
+          for (let i = length; i; --i) d.dest[d.destLen++] = d.source[d.sourceIndex++];
+          d.bitcount = 0;
+        }
+
+        function tinfInflate(source, dest) {
+          const d = {
+            source, sourceIndex: 0, tag: 0, bitcount: 0, dest, destLen: 0,
+            ltree: new Tree(), dtree: new Tree(),
+          };
+          let bfinal;
+          do {
+            bfinal = getBit(d);
+            const btype = readBits(d, 2, 0);
+            if (btype === 0) {
+              inflateUncompressedBlock(d);
+            } else if (btype === 1) {
+              inflateBlockData(d, sltree, sdtree);
+            } else if (btype === 2) {
+              decodeTrees(d, d.ltree, d.dtree);
+              inflateBlockData(d, d.ltree, d.dtree);
+            } else {
+              throw new Error('invalid block type');
+            }
+          } while (!bfinal);
+          return dest.subarray(0, d.destLen);
+        }
+
+        buildFixedTrees(sltree, sdtree);
+        buildBitsBase(lengthBits, lengthBase, 4, 3);
+        buildBitsBase(distBits, distBase, 2, 1);
+        lengthBits[28] = 0;
+        lengthBase[28] = 258;
+        // ---- end tinf ----
+
+        function polyfillGunzip(data) {
+          // zlib.gzipSync() writes a bare 10 byte header, and the trailer ends with the length.
+          const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+          const size = view.getUint32(data.byteLength - 4, true);
+          return tinfInflate(data.subarray(10, data.byteLength - 8), new Uint8Array(size));
+        }
+
+        function streamGunzip(data) {
+          return new Promise((resolve, reject) => {
+            const chunks = [];
+            const gunzip = zlib.createGunzip();
+            gunzip.on('data', (chunk) => chunks.push(chunk));
+            gunzip.on('end', () => resolve(Buffer.concat(chunks)));
+            gunzip.on('error', reject);
+            for (let i = 0; i < data.length; i += 16384) {
+              gunzip.write(data.subarray(i, i + 16384));
+            }
+            gunzip.end();
+          });
+        }
+
+        if (!payload.equals(polyfillGunzip(compressed))) {
+          throw new Error('polyfill output does not match');
+        }
+
+        export default {
+          async fetch(request) {
+            const url = new URL(request.url);
+            const impl = url.searchParams.get('impl');
+            let result;
+            if (impl === 'gunzipSync') {
+              result = zlib.gunzipSync(compressed);
+            } else if (impl === 'Gunzip') {
+              result = await streamGunzip(compressed);
+            } else if (impl === 'polyfill') {
+              result = polyfillGunzip(compressed);
+            } else if (impl === 'gzipSync') {
+              result = zlib.gzipSync(payload);
+            } else if (impl === 'brotliCompressSync') {
+              result = zlib.brotliCompressSync(payload, {
+                params: { [zlib.constants.BROTLI_PARAM_QUALITY]: 4 },
+              });
+            }
+            return new Response(`${payload.byteLength} ${result.byteLength}`);
+          },
+        };
+      )"_kj};
+    fixture = kj::heap<TestFixture>(kj::mv(params));
+  }
+
+  void TearDown(benchmark::State& state) noexcept(true) override {
+    fixture = nullptr;
+  }
+
+  capnp::MallocMessageBuilder message;
+  kj::Own<TestFixture> fixture;
+};
+
+void run(benchmark::State& state, TestFixture& fixture, kj::StringPtr impl) {
+  state.SetLabel(impl.cStr());
+  auto url = kj::str("http://www.example.com/?impl=", impl);
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto result = fixture.runRequest(kj::HttpMethod::GET, url, ""_kj);
+    KJ_EXPECT(result.statusCode == 200);
+    auto space = KJ_ASSERT_NONNULL(result.body.findFirst(' '));
+    bytes += kj::str(result.body.slice(0, space)).parseAs<size_t>();
+  }
+  // Counted in uncompressed bytes either way, so that the directions are comparable.
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_DEFINE_F(ZlibBenchmark, inflate)(benchmark::State& state) {
+  run(state, *fixture, INFLATE_IMPLS[state.range(0)]);
+}
+BENCHMARK_REGISTER_F(ZlibBenchmark, inflate)->DenseRange(0, 2);
+
+BENCHMARK_DEFINE_F(ZlibBenchmark, deflate)(benchmark::State& state) {
+  run(state, *fixture, DEFLATE_IMPLS[state.range(0)]);
+}
+BENCHMARK_REGISTER_F(ZlibBenchmark, deflate)->DenseRange(0, 1);
+
+} // namespace
+} // namespace workerd
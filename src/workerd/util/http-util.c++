@@ -0,0 +1,85 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "http-util.h"
+#include <kj/debug.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <time.h>
+
+namespace workerd {
+
+namespace {
+
+constexpr kj::StringPtr MONTHS[] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+// Days since 1970-01-01, from http://howardhinnant.github.io/date_algorithms.html. (timegm() is
+// not available on Windows.)
+int64_t daysFromCivil(int64_t y, uint m, uint d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  uint yoe = y - era * 400;
+  uint doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  uint doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + int64_t(doe) - 719468;
+}
+
+}  // namespace
+
+kj::String httpTime(kj::Date date) {
+  time_t time = (date - kj::UNIX_EPOCH) / kj::SECONDS;
+#if _WIN32
+  // `gmtime` is thread-safe on Windows: https://learn.microsoft.com/en-us/cpp/c-runtime-library/reference/gmtime-gmtime32-gmtime64?view=msvc-170#return-value
+  auto tm = *gmtime(&time);
+#else
+  struct tm tm;
+  KJ_ASSERT(gmtime_r(&time, &tm) == &tm);
+#endif
+  char buf[256]{};
+  size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  KJ_ASSERT(n > 0);
+  return kj::heapString(buf, n);
+}
+
+kj::Maybe<kj::Date> parseHttpTime(kj::StringPtr text) {
+  char weekday[4], monthName[4];
+  int day, year, hour, minute, second;
+  if (sscanf(text.cStr(), "%3s, %d %3s %d %d:%d:%d GMT",
+             weekday, &day, monthName, &year, &hour, &minute, &second) != 7) {
+    return kj::none;
+  }
+  // Seconds go up to 60 for leap seconds.
+  if (day < 1 || day > 31 || year < 0 || year > 9999 ||
+      hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60) {
+    return kj::none;
+  }
+  for (auto month: kj::indices(MONTHS)) {
+    if (MONTHS[month] == monthName) {
+      int64_t days = daysFromCivil(year, month + 1, day);
+      return kj::UNIX_EPOCH + (days * 86400 + hour * 3600 + minute * 60 + second) * kj::SECONDS;
+    }
+  }
+  return kj::none;
+}
+
+bool equalsIgnoreCase(kj::StringPtr a, kj::StringPtr b) {
+  if (a.size() != b.size()) return false;
+  for (auto i: kj::indices(a)) {
+    if (tolower(a[i]) != tolower(b[i])) return false;
+  }
+  return true;
+}
+
+kj::Maybe<kj::String> findHeader(const kj::HttpHeaders& headers, kj::StringPtr name) {
+  kj::Vector<kj::StringPtr> values;
+  headers.forEach([&](kj::StringPtr n, kj::StringPtr value) {
+    if (equalsIgnoreCase(n, name)) values.add(value);
+  });
+  if (values.size() == 0) return kj::none;
+  return kj::strArray(values, ", ");
+}
+
+}  // namespace workerd
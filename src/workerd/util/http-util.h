@@ -8,6 +8,39 @@
 
 namespace workerd {
 
+// Returns a time string in the format HTTP likes to use (an IMF-fixdate), e.g.
+// "Sun, 06 Nov 1994 08:49:37 GMT".
+kj::String httpTime(kj::Date date);
+
+// Parses an IMF-fixdate, the only format HTTP/1.1 senders may generate. Returns kj::none if
+// `text` isn't one.
+kj::Maybe<kj::Date> parseHttpTime(kj::StringPtr text);
+
+// Compares two header names (or other ASCII tokens), ignoring case.
+bool equalsIgnoreCase(kj::StringPtr a, kj::StringPtr b);
+
+// Calls `func` with each element of a comma-separated header value, trimmed.
+template <typename Func>
+void forEachListElement(kj::StringPtr value, Func&& func) {
+  while (value.size() > 0) {
+    size_t end = value.findFirst(',').orDefault(value.size());
+    size_t begin = 0;
+    size_t trimmedEnd = end;
+    while (begin < trimmedEnd && (value[begin] == ' ' || value[begin] == '\t')) begin++;
+    while (trimmedEnd > begin && (value[trimmedEnd - 1] == ' ' || value[trimmedEnd - 1] == '\t')) {
+      trimmedEnd--;
+    }
+    if (trimmedEnd > begin) {
+      func(kj::heapString(value.slice(begin, trimmedEnd)));
+    }
+    value = end < value.size() ? value.slice(end + 1) : ""_kj;
+  }
+}
+
+// Returns all values of the header named `name`, which needn't be in the header table, joined
+// into one list.
+kj::Maybe<kj::String> findHeader(const kj::HttpHeaders& headers, kj::StringPtr name);
+
 // Attaches the given object to a `Request` so that it lives as long as the request's properties.
 // The given object must support `kj::addRef()` (e.g. `kj::Refcount`).
 template<typename T>
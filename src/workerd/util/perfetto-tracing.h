@@ -9,7 +9,9 @@
 
 PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE(
     workerd::traces,
-    perfetto::Category("workerd"));
+    perfetto::Category("workerd"),
+    perfetto::Category("workerd.profile")
+        .SetDescription("Sampled JS CPU and heap allocation profiles, attributed to requests"));
 
 namespace kj {
   class StringPtr;
@@ -0,0 +1,166 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "spilling-tee.h"
+#include "stream-utils.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+kj::Array<kj::byte> makeData(size_t size) {
+  auto data = kj::heapArray<kj::byte>(size);
+  for (auto i: kj::indices(data)) {
+    data[i] = kj::byte(i * 7 + i / 251);
+  }
+  return data;
+}
+
+kj::Array<kj::byte> readAll(kj::AsyncInputStream& in, size_t bufferSize, kj::WaitScope& ws) {
+  kj::Vector<kj::byte> result;
+  auto buffer = kj::heapArray<kj::byte>(bufferSize);
+  for (;;) {
+    auto n = in.tryRead(buffer.begin(), 1, buffer.size()).wait(ws);
+    if (n == 0) break;
+    result.addAll(buffer.first(n));
+  }
+  return result.releaseAsArray();
+}
+
+// Spills to an in-memory directory, keeping a handle on the file to check on it.
+struct SpillDir {
+  kj::Own<const kj::Directory> dir = kj::newInMemoryDirectory(kj::nullClock());
+  kj::Maybe<kj::Own<const kj::File>> file;
+  uint filesCreated = 0;
+
+  SpillingTeeOptions options(size_t memoryLimit, uint64_t bufferLimit = kj::maxValue) {
+    return {
+      .memoryLimit = memoryLimit,
+      .bufferLimit = bufferLimit,
+      .newSpillFile = [this]() {
+        ++filesCreated;
+        auto result = dir->createTemporary();
+        file = result->clone();
+        return result;
+      },
+    };
+  }
+};
+
+KJ_TEST("newSpillingTee() with a branch read after the other") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  SpillDir spill;
+
+  auto data = makeData(1 << 20);
+  auto tee = newSpillingTee(newMemoryInputStream(data), spill.options(64 * 1024));
+
+  KJ_EXPECT(readAll(*tee.branches[0], 10000, ws).asPtr() == data.asPtr());
+  KJ_EXPECT(spill.filesCreated == 1);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(spill.file)->stat().size > data.size() / 2);
+
+  KJ_EXPECT(readAll(*tee.branches[1], 3000, ws).asPtr() == data.asPtr());
+
+  // Once the lagging branch caught up, the spill file was emptied.
+  KJ_EXPECT(KJ_ASSERT_NONNULL(spill.file)->stat().size == 0);
+}
+
+KJ_TEST("newSpillingTee() with interleaved reads") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  SpillDir spill;
+
+  auto data = makeData(300 * 1024);
+  auto tee = newSpillingTee(newMemoryInputStream(data), spill.options(16 * 1024));
+
+  // Branch 0 reads four times as fast as branch 1, with reads small enough to be buffered in
+  // chunks, and large enough to be read directly.
+  kj::Vector<kj::byte> results[2];
+  bool done[2] = {false, false};
+  auto buffer = kj::heapArray<kj::byte>(20000);
+  size_t sizes[2] = {100, 5000};
+  while (!done[0] || !done[1]) {
+    for (auto i: kj::zeroTo(2)) {
+      for (auto j KJ_UNUSED: kj::zeroTo(i == 0 ? 4 : 1)) {
+        if (done[i]) break;
+        auto n = tee.branches[i]->tryRead(buffer.begin(), 1, sizes[i]).wait(ws);
+        if (n == 0) {
+          done[i] = true;
+        } else {
+          results[i].addAll(buffer.first(n));
+        }
+      }
+    }
+    kj::swap(sizes[0], sizes[1]);
+  }
+
+  KJ_EXPECT(results[0].asPtr() == data.asPtr());
+  KJ_EXPECT(results[1].asPtr() == data.asPtr());
+  KJ_EXPECT(spill.filesCreated == 1);
+}
+
+KJ_TEST("newSpillingTee() doesn't spill if branches keep up") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  SpillDir spill;
+
+  auto data = makeData(1 << 20);
+  auto tee = newSpillingTee(newMemoryInputStream(data), spill.options(64 * 1024));
+
+  kj::Vector<kj::byte> results[2];
+  auto buffer = kj::heapArray<kj::byte>(8192);
+  for (;;) {
+    auto n0 = tee.branches[0]->tryRead(buffer.begin(), 1, buffer.size()).wait(ws);
+    results[0].addAll(buffer.first(n0));
+    auto n1 = tee.branches[1]->tryRead(buffer.begin(), 1, buffer.size()).wait(ws);
+    results[1].addAll(buffer.first(n1));
+    if (n0 == 0 && n1 == 0) break;
+  }
+
+  KJ_EXPECT(results[0].asPtr() == data.asPtr());
+  KJ_EXPECT(results[1].asPtr() == data.asPtr());
+  KJ_EXPECT(spill.filesCreated == 0);
+}
+
+KJ_TEST("newSpillingTee() with a dropped branch") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  SpillDir spill;
+
+  auto data = makeData(1 << 20);
+  auto tee = newSpillingTee(newMemoryInputStream(data), spill.options(64 * 1024));
+
+  auto buffer = kj::heapArray<kj::byte>(100000);
+  tee.branches[0]->tryRead(buffer.begin(), buffer.size(), buffer.size()).wait(ws);
+  KJ_EXPECT(KJ_ASSERT_NONNULL(spill.file)->stat().size > 0);
+
+  // Nothing needs to be buffered anymore.
+  tee.branches[1] = nullptr;
+  KJ_EXPECT(KJ_ASSERT_NONNULL(spill.file)->stat().size == 0);
+
+  auto rest = readAll(*tee.branches[0], 10000, ws);
+  KJ_EXPECT(rest.asPtr() == data.slice(buffer.size(), data.size()));
+  KJ_EXPECT(KJ_ASSERT_NONNULL(spill.file)->stat().size == 0);
+}
+
+KJ_TEST("newSpillingTee() buffer limit") {
+  kj::EventLoop loop;
+  kj::WaitScope ws(loop);
+  SpillDir spill;
+
+  auto data = makeData(1 << 20);
+  auto tee = newSpillingTee(newMemoryInputStream(data), spill.options(64 * 1024, 256 * 1024));
+
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded", readAll(*tee.branches[0], 10000, ws));
+
+  // The lagging branch can still read what was buffered before failing too.
+  auto buffer = kj::heapArray<kj::byte>(256 * 1024);
+  auto n = tee.branches[1]->tryRead(buffer.begin(), buffer.size(), buffer.size()).wait(ws);
+  KJ_EXPECT(buffer.first(n) == data.first(n));
+  KJ_EXPECT_THROW_MESSAGE("tee buffer size limit exceeded",
+      tee.branches[1]->tryRead(buffer.begin(), buffer.size(), buffer.size()).wait(ws));
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,272 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "spilling-tee.h"
+#include <kj/debug.h>
+#include <deque>
+
+namespace workerd {
+
+namespace {
+
+// Reads from the input are at least this large when the other branch will need the data too, so
+// that a branch doing tiny reads doesn't fill the other's buffer with tiny chunks.
+constexpr size_t MIN_PULL_SIZE = 4096;
+
+// Disk space is released in steps of this size as the lagging branch consumes the spill file.
+constexpr uint64_t RELEASE_STEP = 1 << 20;
+
+// State shared by both branches. Stream offsets are counted from the start of the input.
+//
+// Data that a branch hasn't read yet lives in two places: the oldest part in the spill file,
+// covering [fileBase, spilledEnd), and the newer part in `chunks`, covering [spilledEnd, end).
+// Whenever `chunks` grows beyond the memory limit, all of it is appended to the spill file.
+class SpillingTee final: public kj::Refcounted {
+public:
+  SpillingTee(kj::Own<kj::AsyncInputStream> input, SpillingTeeOptions options)
+      : input(kj::mv(input)), options(kj::mv(options)) {}
+
+  kj::Promise<size_t> tryRead(uint branch, kj::ArrayPtr<kj::byte> buffer, size_t minBytes) {
+    size_t total = 0;
+    for (;;) {
+      total += readBuffered(branch, buffer.slice(total, buffer.size()));
+      if (total >= minBytes || (eof && positions[branch] == end)) {
+        co_return total;
+      }
+      KJ_IF_SOME(e, error) {
+        kj::throwFatalException(kj::cp(e));
+      }
+
+      if (pulling) {
+        // The other branch is reading from the input, and will buffer what it gets for us.
+        auto paf = kj::newPromiseAndFulfiller<void>();
+        waiter = kj::mv(paf.fulfiller);
+        co_await paf.promise;
+      } else {
+        total += co_await pull(branch, buffer.slice(total, buffer.size()));
+      }
+    }
+  }
+
+  kj::Maybe<uint64_t> tryGetLength(uint branch) {
+    KJ_IF_SOME(length, input->tryGetLength()) {
+      return length + (end - positions[branch]);
+    }
+    return kj::none;
+  }
+
+  void detach(uint branch) {
+    attached[branch] = false;
+    trim();
+  }
+
+private:
+  kj::Own<kj::AsyncInputStream> input;
+  SpillingTeeOptions options;
+
+  uint64_t positions[2] = {0, 0};
+  bool attached[2] = {true, true};
+  uint64_t end = 0;
+  bool eof = false;
+  kj::Maybe<kj::Exception> error;
+
+  // True while a branch is reading from `input`. The other branch waits on `waiter`.
+  bool pulling = false;
+  kj::Maybe<kj::Own<kj::PromiseFulfiller<void>>> waiter;
+
+  struct Chunk {
+    uint64_t offset;
+    kj::Array<kj::byte> data;
+  };
+  std::deque<Chunk> chunks;
+  size_t memoryBytes = 0;
+
+  kj::Maybe<kj::Own<const kj::File>> spillFile;
+  uint64_t fileBase = 0;
+  uint64_t spilledEnd = 0;
+  uint64_t releasedTo = 0;  // Disk space of the spill file before this offset has been released.
+
+  // Reads from the input on behalf of `branch`, which has read everything buffered. Returns the
+  // number of bytes placed directly in `out`, which may be zero if they were buffered instead.
+  kj::Promise<size_t> pull(uint branch, kj::ArrayPtr<kj::byte> out) {
+    pulling = true;
+    KJ_DEFER({
+      pulling = false;
+      KJ_IF_SOME(w, waiter) {
+        w->fulfill();
+      }
+      waiter = kj::none;
+    });
+
+    uint other = 1 - branch;
+    if (attached[other] && out.size() < MIN_PULL_SIZE) {
+      auto chunk = kj::heapArray<kj::byte>(MIN_PULL_SIZE);
+      auto n = co_await readInput(chunk);
+      if (attached[other]) {
+        append(other, kj::heapArray(chunk.first(n)));
+      } else {
+        // The other branch went away while we were reading, so there's no one to buffer for.
+        // Keep the data for ourselves anyway.
+        append(branch, kj::heapArray(chunk.first(n)));
+      }
+      co_return 0;
+    }
+
+    auto n = co_await readInput(out);
+    positions[branch] += n;
+    if (attached[other]) {
+      append(other, kj::heapArray(out.first(n)));
+    } else {
+      end += n;
+    }
+    co_return n;
+  }
+
+  kj::Promise<size_t> readInput(kj::ArrayPtr<kj::byte> out) {
+    size_t n;
+    try {
+      n = co_await input->tryRead(out.begin(), 1, out.size());
+    } catch (...) {
+      auto exception = kj::getCaughtExceptionAsKj();
+      error = kj::cp(exception);
+      kj::throwFatalException(kj::mv(exception));
+    }
+    if (n == 0) {
+      eof = true;
+    }
+    co_return n;
+  }
+
+  // Buffers `data`, which starts at `end`, for `branch`.
+  void append(uint branch, kj::Array<kj::byte> data) {
+    if (data.size() == 0) return;
+    memoryBytes += data.size();
+    chunks.push_back({ end, kj::mv(data) });
+    end = chunks.back().offset + chunks.back().data.size();
+
+    if (end - positions[branch] > options.bufferLimit) {
+      auto exception = KJ_EXCEPTION(FAILED, "tee buffer size limit exceeded");
+      error = kj::cp(exception);
+      kj::throwFatalException(kj::mv(exception));
+    }
+
+    if (memoryBytes > options.memoryLimit) {
+      spill();
+    }
+  }
+
+  // Copies as much buffered data as fits into `out`, and advances `branch` past it.
+  size_t readBuffered(uint branch, kj::ArrayPtr<kj::byte> out) {
+    auto& position = positions[branch];
+    size_t amount = kj::min(out.size(), end - position);
+    size_t done = 0;
+
+    if (position < spilledEnd) {
+      size_t fromFile = kj::min(amount, spilledEnd - position);
+      auto& file = *KJ_ASSERT_NONNULL(spillFile);
+      size_t n = file.read(position - fileBase, out.first(fromFile));
+      KJ_ASSERT(n == fromFile, "tee spill file was truncated");
+      done = fromFile;
+    }
+
+    for (auto& chunk: chunks) {
+      if (done == amount) break;
+      uint64_t chunkEnd = chunk.offset + chunk.data.size();
+      if (chunkEnd <= position + done) continue;
+      auto from = chunk.data.slice(position + done - chunk.offset, chunk.data.size());
+      size_t n = kj::min(from.size(), amount - done);
+      memcpy(out.begin() + done, from.begin(), n);
+      done += n;
+    }
+
+    position += done;
+    if (done > 0) {
+      trim();
+    }
+    return done;
+  }
+
+  // Discards buffered data that no attached branch still needs.
+  void trim() {
+    uint64_t keepFrom = end;
+    for (auto i: kj::zeroTo(2)) {
+      if (attached[i]) keepFrom = kj::min(keepFrom, positions[i]);
+    }
+
+    while (!chunks.empty() && chunks.front().offset + chunks.front().data.size() <= keepFrom) {
+      memoryBytes -= chunks.front().data.size();
+      chunks.pop_front();
+    }
+
+    KJ_IF_SOME(file, spillFile) {
+      if (keepFrom >= spilledEnd) {
+        if (spilledEnd > fileBase) {
+          // Everything spilled has been read. Start over with an empty file.
+          file->truncate(0);
+          fileBase = releasedTo = spilledEnd;
+        }
+      } else if (keepFrom - releasedTo >= RELEASE_STEP) {
+        // On Linux, zero() punches a hole, which frees the disk space without moving anything.
+        file->zero(releasedTo - fileBase, keepFrom - releasedTo);
+        releasedTo = keepFrom;
+      }
+    }
+  }
+
+  // Moves all of `chunks` to the end of the spill file.
+  void spill() {
+    if (spillFile == kj::none) {
+      spillFile = options.newSpillFile();
+    }
+    auto& file = *KJ_ASSERT_NONNULL(spillFile);
+
+    if (spilledEnd == fileBase) {
+      // The file is empty, so it can start wherever the buffered data does.
+      fileBase = releasedTo = spilledEnd = chunks.front().offset;
+    }
+    KJ_ASSERT(chunks.front().offset == spilledEnd);
+
+    for (auto& chunk: chunks) {
+      file.write(chunk.offset - fileBase, chunk.data);
+    }
+    spilledEnd = end;
+    chunks.clear();
+    memoryBytes = 0;
+  }
+};
+
+class SpillingTeeBranch final: public kj::AsyncInputStream {
+public:
+  SpillingTeeBranch(kj::Own<SpillingTee> tee, uint index)
+      : tee(kj::mv(tee)), index(index) {}
+
+  ~SpillingTeeBranch() noexcept(false) {
+    tee->detach(index);
+  }
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    return tee->tryRead(index, kj::arrayPtr(reinterpret_cast<kj::byte*>(buffer), maxBytes),
+                        minBytes);
+  }
+
+  kj::Maybe<uint64_t> tryGetLength() override {
+    return tee->tryGetLength(index);
+  }
+
+private:
+  kj::Own<SpillingTee> tee;
+  uint index;
+};
+
+}  // namespace
+
+kj::Tee newSpillingTee(kj::Own<kj::AsyncInputStream> input, SpillingTeeOptions options) {
+  auto tee = kj::refcounted<SpillingTee>(kj::mv(input), kj::mv(options));
+  return {{
+    kj::heap<SpillingTeeBranch>(kj::addRef(*tee), 0),
+    kj::heap<SpillingTeeBranch>(kj::mv(tee), 1),
+  }};
+}
+
+}  // namespace workerd
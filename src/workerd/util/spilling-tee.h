@@ -0,0 +1,35 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/async-io.h>
+#include <kj/filesystem.h>
+#include <kj/function.h>
+
+namespace workerd {
+
+struct SpillingTeeOptions {
+  // Bytes a lagging branch may have buffered in memory. Beyond this, the buffer is moved to the
+  // spill file, so memory use stays around this size no matter how far the branches drift apart.
+  size_t memoryLimit;
+
+  // Bytes a lagging branch may have buffered in total, in memory and on disk. Beyond this, reading
+  // fails with "tee buffer size limit exceeded", like with kj::newTee().
+  uint64_t bufferLimit;
+
+  // Creates the file to spill to, typically with kj::Directory::createTemporary(). Called the
+  // first time the memory limit is exceeded, if ever.
+  kj::Function<kj::Own<const kj::File>()> newSpillFile;
+};
+
+// Like kj::newTee(), but when one branch falls far behind the other, the data buffered for it is
+// spilled to a file instead of held in memory. Data is spilled in batches of `memoryLimit` bytes,
+// and disk space is released as the lagging branch catches up.
+//
+// The spill file is accessed through the synchronous kj::File interface, so it should live on a
+// local filesystem, where writes normally only reach the page cache.
+kj::Tee newSpillingTee(kj::Own<kj::AsyncInputStream> input, SpillingTeeOptions options);
+
+}  // namespace workerd
@@ -0,0 +1,109 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "sqlite-columnar.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// "SQLC" and the version byte.
+constexpr size_t MAGIC_AND_VERSION_SIZE = 5;
+
+kj::Array<byte> exportQuery(SqliteDatabase::Query&& query, uint batchRows) {
+  SqliteColumnar::Writer writer(query, batchRows);
+  kj::Vector<byte> result;
+  for (;;) {
+    auto chunk = KJ_UNWRAP_OR(writer.next(), break);
+    result.addAll(chunk);
+  }
+  return result.releaseAsArray();
+}
+
+kj::String dump(SqliteDatabase& db, kj::StringPtr table, kj::StringPtr third) {
+  auto query = db.run(SqliteDatabase::TRUSTED, kj::str(
+      "SELECT quote(a), quote(b), quote(", third, ") FROM ", table, " ORDER BY rowid"));
+  kj::Vector<kj::String> rows;
+  for (; !query.isDone(); query.nextRow()) {
+    rows.add(kj::str(query.getText(0), ",", query.getText(1), ",", query.getText(2)));
+  }
+  return kj::strArray(rows, "\n");
+}
+
+KJ_TEST("SqliteColumnar round trip") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  db.run(R"(
+    CREATE TABLE src (a, b, c);
+    CREATE TABLE dst (a, b, "weird ""name""");
+    INSERT INTO src VALUES (1, 'one', x'01');
+    INSERT INTO src VALUES (NULL, 'two', NULL);
+    INSERT INTO src VALUES (3, NULL, x'');
+    INSERT INTO src VALUES (4.5, '', x'0304');
+    INSERT INTO src VALUES (-5, 'five', 5);
+  )");
+
+  // Small batches, so that some have a single kind per column and some are mixed.
+  auto data = exportQuery(db.run(
+      "SELECT a, b, c AS \"weird \"\"name\"\"\" FROM src ORDER BY rowid"), 2);
+  KJ_EXPECT(data.first(4) == "SQLC"_kj.asBytes());
+
+  KJ_EXPECT(SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "dst", data) == 5);
+  auto expected = dump(db, "src", "c");
+  auto actual = dump(db, "dst", "\"weird \"\"name\"\"\"");
+  KJ_EXPECT(actual == expected, actual, expected);
+
+  // An empty result is just the header.
+  auto empty = exportQuery(db.run("SELECT a FROM src WHERE 0"), 2);
+  KJ_EXPECT(SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "dst", empty) == 0);
+}
+
+KJ_TEST("SqliteColumnar rejects bad input") {
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+
+  db.run(R"(
+    CREATE TABLE src (a);
+    INSERT INTO src VALUES ('abc');
+  )");
+  auto data = exportQuery(db.run("SELECT a FROM src"), 16);
+
+  KJ_EXPECT_THROW_MESSAGE("not in columnar format",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "src", "hello"_kj.asBytes()));
+  KJ_EXPECT_THROW_MESSAGE("truncated",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "src", data.first(data.size() - 1)));
+  // Counts are checked against what the data could hold before anything is allocated for them.
+  auto withU32 = [&](size_t offset, uint32_t value) {
+    auto copy = kj::heapArray<byte>(data);
+    for (auto i: kj::zeroTo(4)) copy[offset + i] = value >> (i * 8);
+    return copy;
+  };
+  size_t columnCountOffset = MAGIC_AND_VERSION_SIZE;
+  size_t rowCountOffset = columnCountOffset + 4 + 4 + 1;  // One column, named "a".
+  auto manyColumns = withU32(columnCountOffset, 0xffffffff);
+  KJ_EXPECT_THROW_MESSAGE("truncated",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "src", manyColumns));
+  auto oversizedBatch = withU32(rowCountOffset, SqliteColumnar::MAX_BATCH_ROWS + 1);
+  KJ_EXPECT_THROW_MESSAGE("too many rows",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "src", oversizedBatch));
+  auto truncatedBatch = withU32(rowCountOffset, SqliteColumnar::MAX_BATCH_ROWS);
+  KJ_EXPECT_THROW_MESSAGE("truncated",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "src", truncatedBatch));
+
+  KJ_EXPECT_THROW_MESSAGE("no such table",
+      SqliteColumnar::ingest(db, SqliteDatabase::TRUSTED, "missing", data));
+
+  // The regulator decides which tables may be written.
+  class Regulator: public SqliteDatabase::Regulator {
+    bool isAllowedName(kj::StringPtr name) override { return name != "src"; }
+  } regulator;
+  KJ_EXPECT_THROW_MESSAGE("not authorized",
+      SqliteColumnar::ingest(db, regulator, "src", data));
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,393 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "sqlite-columnar.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+namespace {
+
+using Kind = SqliteColumnar::Kind;
+using ValuePtr = SqliteDatabase::Query::ValuePtr;
+
+constexpr kj::StringPtr MAGIC = "SQLC"_kj;
+
+// A batch ends early once its columns hold this many bytes, so that tables of large values are
+// still streamed in reasonably sized pieces.
+constexpr size_t BATCH_BYTES = 1024 * 1024;
+
+class Output {
+public:
+  void u8(uint8_t value) { bytes.add(value); }
+
+  void u32(uint32_t value) {
+    for (auto i: kj::zeroTo(4)) bytes.add(value >> (i * 8));
+  }
+
+  void u64(uint64_t value) {
+    for (auto i: kj::zeroTo(8)) bytes.add(value >> (i * 8));
+  }
+
+  void add(kj::ArrayPtr<const byte> data) { bytes.addAll(data); }
+
+  kj::Array<byte> finish() { return bytes.releaseAsArray(); }
+
+private:
+  kj::Vector<byte> bytes;
+};
+
+class Input {
+public:
+  Input(SqliteDatabase::Regulator& regulator, kj::ArrayPtr<const byte> data)
+      : regulator(regulator), data(data) {}
+
+  bool atEnd() { return data.size() == 0; }
+  size_t remaining() { return data.size(); }
+
+  kj::ArrayPtr<const byte> bytes(size_t size) {
+    if (size > data.size()) fail("Columnar data is truncated.");
+    auto result = data.first(size);
+    data = data.slice(size, data.size());
+    return result;
+  }
+
+  uint8_t u8() { return bytes(1)[0]; }
+
+  uint32_t u32() {
+    auto b = bytes(4);
+    uint32_t result = 0;
+    for (auto i: kj::zeroTo(4)) result |= uint32_t(b[i]) << (i * 8);
+    return result;
+  }
+
+  uint64_t u64() {
+    auto b = bytes(8);
+    uint64_t result = 0;
+    for (auto i: kj::zeroTo(8)) result |= uint64_t(b[i]) << (i * 8);
+    return result;
+  }
+
+  [[noreturn]] void fail(kj::StringPtr message) {
+    regulator.onError(message);
+    kj::throwFatalException(KJ_EXCEPTION(FAILED, message));
+  }
+
+private:
+  SqliteDatabase::Regulator& regulator;
+  kj::ArrayPtr<const byte> data;
+};
+
+uint64_t doubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double bitsDouble(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// One column of a batch being written. Values are copied out of the query as rows go by, since
+// SQLite only keeps a row's strings and blobs until it moves on to the next one.
+struct ColumnBuffer {
+  kj::Vector<Kind> kinds;
+
+  // Integers and reals, as their bit patterns. Zero for rows of other kinds.
+  kj::Vector<uint64_t> numbers;
+
+  // The bytes of text and blob values, and where each row's bytes start.
+  kj::Vector<byte> bytes;
+  kj::Vector<uint32_t> starts;
+
+  // A bit for each kind of value seen in the batch.
+  uint kindsSeen = 0;
+
+  void add(ValuePtr value) {
+    starts.add(bytes.size());
+    Kind kind = Kind::NULL_;
+    uint64_t number = 0;
+    KJ_SWITCH_ONEOF(value) {
+      KJ_CASE_ONEOF(blob, kj::ArrayPtr<const byte>) {
+        kind = Kind::BLOB;
+        bytes.addAll(blob);
+      }
+      KJ_CASE_ONEOF(text, kj::StringPtr) {
+        kind = Kind::TEXT;
+        bytes.addAll(text.asBytes());
+      }
+      KJ_CASE_ONEOF(i, int64_t) {
+        kind = Kind::INTEGER;
+        number = i;
+      }
+      KJ_CASE_ONEOF(d, double) {
+        kind = Kind::REAL;
+        number = doubleBits(d);
+      }
+      KJ_CASE_ONEOF(_, decltype(nullptr)) {}
+    }
+    kinds.add(kind);
+    numbers.add(number);
+    if (kind != Kind::NULL_) kindsSeen |= 1u << uint(kind);
+  }
+
+  Kind batchKind() {
+    if (kindsSeen == 0) return Kind::NULL_;
+    if ((kindsSeen & (kindsSeen - 1)) != 0) return Kind::MIXED;
+    return static_cast<Kind>(__builtin_ctz(kindsSeen));
+  }
+
+  kj::ArrayPtr<const byte> valueBytes(uint row) {
+    size_t end = row + 1 < starts.size() ? starts[row + 1] : bytes.size();
+    return bytes.asPtr().slice(starts[row], end);
+  }
+
+  void write(Output& out) {
+    auto kind = batchKind();
+    out.u8(static_cast<uint8_t>(kind));
+
+    for (size_t i = 0; i < kinds.size(); i += 8) {
+      uint8_t bits = 0;
+      for (auto j: kj::zeroTo(kj::min(size_t(8), kinds.size() - i))) {
+        if (kinds[i + j] != Kind::NULL_) bits |= 1 << j;
+      }
+      out.u8(bits);
+    }
+
+    switch (kind) {
+      case Kind::NULL_:
+        break;
+      case Kind::INTEGER:
+      case Kind::REAL:
+        for (auto n: numbers) out.u64(n);
+        break;
+      case Kind::TEXT:
+      case Kind::BLOB:
+        for (auto start: starts) out.u32(start);
+        out.u32(bytes.size());
+        out.add(bytes);
+        break;
+      case Kind::MIXED:
+        for (auto k: kinds) out.u8(static_cast<uint8_t>(k));
+        for (auto i: kj::indices(kinds)) {
+          switch (kinds[i]) {
+            case Kind::NULL_:
+            case Kind::MIXED:
+              break;
+            case Kind::INTEGER:
+            case Kind::REAL:
+              out.u64(numbers[i]);
+              break;
+            case Kind::TEXT:
+            case Kind::BLOB: {
+              auto value = valueBytes(i);
+              out.u32(value.size());
+              out.add(value);
+              break;
+            }
+          }
+        }
+        break;
+    }
+  }
+};
+
+// SQLite binds text by pointer and length, but kj::StringPtr must be NUL-terminated, so text is
+// copied into `arena` with a NUL after each value.
+kj::StringPtr copyText(kj::Vector<kj::Array<char>>& arena, kj::ArrayPtr<const byte> bytes) {
+  auto& copy = arena.add(kj::heapArray<char>(bytes.size() + 1));
+  memcpy(copy.begin(), bytes.begin(), bytes.size());
+  copy[bytes.size()] = '\0';
+  return kj::StringPtr(copy.begin(), bytes.size());
+}
+
+// Decodes one column of a batch into a value per row.
+kj::Array<ValuePtr> readColumn(
+    Input& in, uint rowCount, kj::Vector<kj::Array<char>>& arena) {
+  auto kind = in.u8();
+  auto validity = in.bytes((size_t(rowCount) + 7) / 8);
+  auto isValid = [&](uint row) -> bool { return validity[row / 8] & (1 << (row % 8)); };
+
+  auto values = kj::heapArrayBuilder<ValuePtr>(rowCount);
+  switch (static_cast<Kind>(kind)) {
+    case Kind::NULL_:
+      for (auto i KJ_UNUSED: kj::zeroTo(rowCount)) values.add(nullptr);
+      break;
+
+    case Kind::INTEGER:
+      for (auto i: kj::zeroTo(rowCount)) {
+        int64_t n = in.u64();
+        if (isValid(i)) values.add(n); else values.add(nullptr);
+      }
+      break;
+
+    case Kind::REAL:
+      for (auto i: kj::zeroTo(rowCount)) {
+        double d = bitsDouble(in.u64());
+        if (isValid(i)) values.add(d); else values.add(nullptr);
+      }
+      break;
+
+    case Kind::TEXT:
+    case Kind::BLOB: {
+      auto offsets = kj::heapArray<uint32_t>(size_t(rowCount) + 1);
+      for (auto& offset: offsets) offset = in.u32();
+      for (auto i: kj::zeroTo(rowCount)) {
+        if (offsets[i] > offsets[i + 1]) in.fail("Columnar data has invalid offsets.");
+      }
+      auto bytes = in.bytes(offsets[rowCount]);
+      for (auto i: kj::zeroTo(rowCount)) {
+        if (!isValid(i)) {
+          values.add(nullptr);
+          continue;
+        }
+        auto value = bytes.slice(offsets[i], offsets[i + 1]);
+        if (static_cast<Kind>(kind) == Kind::TEXT) {
+          values.add(copyText(arena, value));
+        } else {
+          values.add(value);
+        }
+      }
+      break;
+    }
+
+    case Kind::MIXED: {
+      auto kinds = in.bytes(rowCount);
+      for (auto i: kj::zeroTo(rowCount)) {
+        switch (static_cast<Kind>(kinds[i])) {
+          case Kind::NULL_:
+            values.add(nullptr);
+            break;
+          case Kind::INTEGER:
+            values.add(static_cast<int64_t>(in.u64()));
+            break;
+          case Kind::REAL:
+            values.add(bitsDouble(in.u64()));
+            break;
+          case Kind::TEXT:
+            values.add(copyText(arena, in.bytes(in.u32())));
+            break;
+          case Kind::BLOB:
+            values.add(in.bytes(in.u32()));
+            break;
+          default:
+            in.fail("Columnar data has an invalid value kind.");
+        }
+      }
+      break;
+    }
+
+    default:
+      in.fail("Columnar data has an invalid column kind.");
+  }
+  return values.finish();
+}
+
+kj::String quoteIdentifier(Input& in, kj::ArrayPtr<const char> name) {
+  kj::Vector<char> result(name.size() + 3);
+  result.add('"');
+  for (char c: name) {
+    if (c == '\0') in.fail("Columnar data has a name containing a NUL character.");
+    if (c == '"') result.add('"');
+    result.add(c);
+  }
+  result.add('"');
+  result.add('\0');
+  return kj::String(result.releaseAsArray());
+}
+
+}  // namespace
+
+SqliteColumnar::Writer::Writer(SqliteDatabase::Query& query, uint batchRows)
+    : query(query), batchRows(batchRows) {
+  KJ_REQUIRE(batchRows > 0 && batchRows <= MAX_BATCH_ROWS);
+}
+
+kj::Maybe<kj::Array<byte>> SqliteColumnar::Writer::next() {
+  Output out;
+
+  if (!headerDone) {
+    headerDone = true;
+    out.add(MAGIC.asBytes());
+    out.u8(VERSION);
+    out.u32(query.columnCount());
+    for (auto i: kj::zeroTo(query.columnCount())) {
+      auto name = query.getColumnName(i);
+      out.u32(name.size());
+      out.add(name.asBytes());
+    }
+    return out.finish();
+  }
+
+  if (query.isDone()) return kj::none;
+
+  auto columns = kj::heapArray<ColumnBuffer>(query.columnCount());
+  uint rowCount = 0;
+  size_t bytes = 0;
+  while (rowCount < batchRows && bytes < BATCH_BYTES && !query.isDone()) {
+    for (auto i: kj::indices(columns)) {
+      auto& column = columns[i];
+      size_t before = column.bytes.size();
+      column.add(query.getValue(i));
+      bytes += column.bytes.size() - before + sizeof(uint64_t);
+    }
+    ++rowCount;
+    query.nextRow();
+  }
+
+  out.u32(rowCount);
+  for (auto& column: columns) {
+    column.write(out);
+  }
+  return out.finish();
+}
+
+uint64_t SqliteColumnar::ingest(SqliteDatabase& db, SqliteDatabase::Regulator& regulator,
+                                kj::StringPtr table, kj::ArrayPtr<const byte> data) {
+  Input in(regulator, data);
+
+  if (in.bytes(MAGIC.size()) != MAGIC.asBytes()) in.fail("Data is not in columnar format.");
+  if (in.u8() != VERSION) in.fail("Columnar data has an unsupported version.");
+  uint columnCount = in.u32();
+  if (columnCount == 0) in.fail("Columnar data has no columns.");
+  // Each name takes at least its length, so don't trust a count the data couldn't hold.
+  if (columnCount > in.remaining() / sizeof(uint32_t)) in.fail("Columnar data is truncated.");
+
+  auto names = kj::heapArrayBuilder<kj::String>(columnCount);
+  for (auto i KJ_UNUSED: kj::zeroTo(columnCount)) {
+    names.add(quoteIdentifier(in, in.bytes(in.u32()).asChars()));
+  }
+  auto placeholders = KJ_MAP(i, kj::zeroTo(columnCount)) { return "?"_kj; };
+  auto statement = db.prepare(regulator, kj::str(
+      "INSERT INTO ", quoteIdentifier(in, table), " (", kj::strArray(names.finish(), ", "),
+      ") VALUES (", kj::strArray(placeholders, ", "), ")"));
+
+  uint64_t rowsWritten = 0;
+  auto bindings = kj::heapArray<ValuePtr>(columnCount);
+  while (!in.atEnd()) {
+    uint rowCount = in.u32();
+    if (rowCount > MAX_BATCH_ROWS) in.fail("Columnar data has a batch with too many rows.");
+    // Every column of the batch takes at least a kind and a validity bitmap.
+    if (size_t(columnCount) * (1 + (size_t(rowCount) + 7) / 8) > in.remaining()) {
+      in.fail("Columnar data is truncated.");
+    }
+    kj::Vector<kj::Array<char>> arena;
+    auto columns = KJ_MAP(i, kj::zeroTo(columnCount)) {
+      return readColumn(in, rowCount, arena);
+    };
+
+    for (auto row: kj::zeroTo(rowCount)) {
+      for (auto i: kj::indices(columns)) {
+        bindings[i] = columns[i][row];
+      }
+      statement.run(bindings.asPtr().asConst());
+    }
+    rowsWritten += rowCount;
+  }
+  return rowsWritten;
+}
+
+}  // namespace workerd
@@ -0,0 +1,82 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include "sqlite.h"
+#include <kj/vector.h>
+
+namespace workerd {
+
+// A compact columnar encoding of query results, for moving whole tables in and out of a database
+// without handling each row in JavaScript.
+//
+// The encoding is little-endian throughout. It starts with a header:
+//
+//     "SQLC"  u8 version  u32 columnCount  (u32 nameLength  name)*
+//
+// followed by any number of batches, each holding at most MAX_BATCH_ROWS rows:
+//
+//     u32 rowCount  column*
+//
+// Each column of a batch is:
+//
+//     u8 kind  validity  data
+//
+// `validity` is a bitmap of ceil(rowCount / 8) bytes, least-significant bit first, where a set
+// bit means the row's value is not NULL. What `data` holds depends on `kind`:
+//
+//   NULL:     Nothing; every value in the batch is NULL.
+//   INTEGER:  rowCount i64s. NULL rows hold zero.
+//   REAL:     rowCount f64s. NULL rows hold zero.
+//   TEXT:     rowCount + 1 u32 offsets into the bytes that follow, then the bytes. Row i spans
+//   BLOB:     [offsets[i], offsets[i + 1]). NULL rows are empty.
+//   MIXED:    A u8 kind per row, then for each non-NULL row in order, an i64, an f64, or a u32
+//             length followed by that many bytes.
+//
+// SQLite columns are not typed, so the kind is chosen per batch from the values actually found,
+// and a column only falls back to MIXED when a batch holds values of more than one type.
+class SqliteColumnar {
+public:
+  enum class Kind: uint8_t {
+    NULL_ = 0,
+    INTEGER = 1,
+    REAL = 2,
+    TEXT = 3,
+    BLOB = 4,
+    MIXED = 5,
+  };
+
+  static constexpr uint8_t VERSION = 1;
+  static constexpr uint MAX_BATCH_ROWS = 1024;
+
+  // Encodes the results of a query, a batch at a time, so that large results never need to be
+  // held in memory at once.
+  class Writer {
+  public:
+    // `query` must outlive the Writer, and is advanced through all of its rows.
+    explicit Writer(SqliteDatabase::Query& query, uint batchRows = MAX_BATCH_ROWS);
+
+    // Returns the header on the first call, then a batch per call until the query runs out of
+    // rows, then kj::none.
+    kj::Maybe<kj::Array<byte>> next();
+
+  private:
+    SqliteDatabase::Query& query;
+    uint batchRows;
+    bool headerDone = false;
+  };
+
+  // Inserts every row of `data` (in the above encoding) into `table`, whose columns are named by
+  // the header. The statement is prepared under `regulator`, so the table name is subject to the
+  // same rules as any other query. Returns the number of rows inserted.
+  //
+  // Rows are inserted one by one, so callers wanting the import to be atomic (and fast) should
+  // run it inside a transaction or savepoint. Malformed data is reported through
+  // `regulator.onError()`, like SQL errors.
+  static uint64_t ingest(SqliteDatabase& db, SqliteDatabase::Regulator& regulator,
+                         kj::StringPtr table, kj::ArrayPtr<const byte> data);
+};
+
+}  // namespace workerd
@@ -0,0 +1,123 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "sqlite-pcache.h"
+#include "sqlite.h"
+#include <kj/test.h>
+
+namespace workerd {
+namespace {
+
+// Room for a couple dozen pages, while each database below is about 250 pages.
+constexpr size_t MAX_BYTES = 128 * 1024;
+
+void ensureInstalled() {
+  static bool doOnce KJ_UNUSED = []() {
+    SqlitePageCache::install(MAX_BYTES);
+    return true;
+  }();
+}
+
+void fill(SqliteDatabase& db) {
+  db.run(R"(
+    CREATE TABLE things (id INTEGER PRIMARY KEY, value INTEGER, data BLOB);
+    WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i < 999)
+    INSERT INTO things SELECT i, i * 7, zeroblob(1000) FROM n;
+  )");
+}
+
+// Reads every row, which can only come out right if evicted pages were re-read correctly.
+void check(SqliteDatabase& db, int64_t rows = 1000) {
+  auto query = db.run("SELECT count(*), sum(value), sum(length(data)) FROM things");
+  KJ_ASSERT(!query.isDone());
+  KJ_EXPECT(query.getInt64(0) == rows);
+  KJ_EXPECT(query.getInt64(1) == 7 * rows * (rows - 1) / 2);
+  KJ_EXPECT(query.getInt64(2) == 1000 * rows);
+}
+
+KJ_TEST("SQLite shared page cache") {
+  ensureInstalled();
+  KJ_EXPECT(SqlitePageCache::isInstalled());
+
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+
+  {
+    SqliteDatabase db1(vfs, kj::Path({"db1"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    SqliteDatabase db2(vfs, kj::Path({"db2"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+    fill(db1);
+    fill(db2);
+
+    auto before = SqlitePageCache::getStats();
+    check(db1);
+    check(db2);
+    check(db1);
+    auto after = SqlitePageCache::getStats();
+
+    // Both databases together are far bigger than the pool, so they took turns evicting each
+    // other.
+    KJ_EXPECT(after.evictions > before.evictions);
+    KJ_EXPECT(after.misses > before.misses);
+    KJ_EXPECT(after.maxBytes == MAX_BYTES);
+
+    KJ_EXPECT(after.pageCount > 0);
+    KJ_EXPECT(after.bytes > 0);
+
+    auto stats1 = db1.getCacheStats();
+    KJ_EXPECT(stats1.misses > 0);
+    KJ_EXPECT(stats1.bytesUsed > 0);
+
+    // A small table stays resident however often it's read.
+    db2.run("CREATE TABLE small (id INTEGER PRIMARY KEY, value INTEGER)");
+    db2.run("INSERT INTO small VALUES (1, 2)");
+    auto beforeSmall = SqlitePageCache::getStats();
+    auto stats2 = db2.getCacheStats();
+    for (auto i KJ_UNUSED: kj::zeroTo(10)) {
+      auto query = db2.run("SELECT value FROM small WHERE id = 1");
+      KJ_ASSERT(!query.isDone());
+      KJ_EXPECT(query.getInt(0) == 2);
+    }
+    auto afterSmall = SqlitePageCache::getStats();
+    KJ_EXPECT(afterSmall.hits > beforeSmall.hits);
+    KJ_EXPECT(afterSmall.misses == beforeSmall.misses);
+
+    // The same shows in db2's own stats, and none of it in db1's.
+    auto stats2After = db2.getCacheStats();
+    KJ_EXPECT(stats2After.hits > stats2.hits);
+    KJ_EXPECT(stats2After.misses == stats2.misses);
+    auto stats1After = db1.getCacheStats();
+    KJ_EXPECT(stats1After.hits == stats1.hits);
+    KJ_EXPECT(stats1After.misses == stats1.misses);
+  }
+
+  // Closing the databases gives everything back.
+  auto stats = SqlitePageCache::getStats();
+  KJ_EXPECT(stats.pageCount == 0);
+  KJ_EXPECT(stats.bytes == 0);
+}
+
+KJ_TEST("SQLite shared page cache discards rolled back pages") {
+  ensureInstalled();
+
+  auto dir = kj::newInMemoryDirectory(kj::nullClock());
+  SqliteDatabase::Vfs vfs(*dir);
+  SqliteDatabase db(vfs, kj::Path({"foo"}), kj::WriteMode::CREATE | kj::WriteMode::MODIFY);
+  fill(db);
+
+  // Growing the file and rolling back truncates the cache.
+  db.run("BEGIN TRANSACTION");
+  db.run(R"(
+    WITH RECURSIVE n(i) AS (SELECT 1000 UNION ALL SELECT i + 1 FROM n WHERE i < 1999)
+    INSERT INTO things SELECT i, i * 7, zeroblob(1000) FROM n;
+  )");
+  check(db, 2000);
+  db.run("ROLLBACK TRANSACTION");
+  check(db);
+
+  db.run("DELETE FROM things WHERE id >= 500");
+  check(db, 500);
+}
+
+}  // namespace
+}  // namespace workerd
@@ -0,0 +1,282 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "sqlite-pcache.h"
+#include <sqlite3.h>
+#include <kj/debug.h>
+#include <kj/list.h>
+#include <kj/map.h>
+#include <kj/mutex.h>
+#include <kj/vector.h>
+
+namespace workerd {
+
+namespace {
+
+// The implementation of sqlite3_pcache_methods2, see:
+//     https://www.sqlite.org/c3ref/pcache_methods2.html
+//
+// All caches share one mutex, since eviction moves pages between them. SQLite calls into the cache
+// on every page access, but the critical sections are short and databases are rarely used from
+// many threads at once.
+
+struct Cache;
+
+// SQLite sees only the sqlite3_pcache_page part: `pBuf` and `pExtra` both point into `buffer`.
+struct Page: public sqlite3_pcache_page {
+  Cache* cache;
+  unsigned key;
+  bool pinned = true;
+
+  kj::Array<kj::byte> buffer;
+
+  // Links the page into `State::lru` while it is unpinned, if its cache is purgeable.
+  kj::ListLink<Page> link;
+
+  Page(Cache& cache, unsigned key, size_t pageSize, size_t extraSize)
+      : cache(&cache), key(key), buffer(kj::heapArray<kj::byte>(pageSize + extraSize)) {
+    pBuf = buffer.begin();
+    pExtra = buffer.begin() + pageSize;
+  }
+
+  size_t size() const { return sizeof(*this) + buffer.size(); }
+};
+
+struct Cache {
+  size_t pageSize;
+  size_t extraSize;
+
+  // False for temporary and in-memory databases, whose pages exist nowhere else.
+  bool purgeable;
+
+  kj::HashMap<unsigned, kj::Own<Page>> pages;
+
+  Cache(size_t pageSize, size_t extraSize, bool purgeable)
+      : pageSize(pageSize), extraSize(extraSize), purgeable(purgeable) {}
+};
+
+struct State {
+  size_t maxBytes = 0;
+  size_t bytes = 0;
+
+  // Unpinned pages of purgeable caches, least-recently-used first.
+  kj::List<Page, &Page::link> lru;
+
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t pageCount = 0;
+};
+
+// Never destroyed, since databases may still be open when the process exits.
+kj::MutexGuarded<State>& getState() {
+  static auto& state = *new kj::MutexGuarded<State>();
+  return state;
+}
+
+bool installed = false;
+
+Cache& getCache(sqlite3_pcache* cache) {
+  return *reinterpret_cast<Cache*>(cache);
+}
+
+// Forgets `page`, which the caller is about to destroy or reuse.
+void unlinkPage(State& s, Page& page) {
+  if (page.link.isLinked()) {
+    s.lru.remove(page);
+  }
+  s.bytes -= page.size();
+  --s.pageCount;
+}
+
+// Removes the page from its cache and returns it.
+kj::Own<Page> takePage(State& s, Cache& cache, unsigned key) {
+  auto& slot = KJ_ASSERT_NONNULL(cache.pages.find(key));
+  auto page = kj::mv(slot);
+  cache.pages.erase(key);
+  unlinkPage(s, *page);
+  return page;
+}
+
+// Evicts least-recently-used pages until the pool fits its budget with `extra` more bytes, or
+// there is nothing left to evict. Returns the last evicted page if its buffer is `reuseSize`
+// bytes, so that the caller can recycle it rather than allocate.
+kj::Maybe<kj::Own<Page>> evict(State& s, size_t extra, size_t reuseSize = 0) {
+  kj::Maybe<kj::Own<Page>> result;
+  while (s.bytes + extra > s.maxBytes && !s.lru.empty()) {
+    auto& victim = s.lru.front();
+    auto page = takePage(s, *victim.cache, victim.key);
+    ++s.evictions;
+    if (page->buffer.size() == reuseSize) {
+      result = kj::mv(page);
+    }
+  }
+  return result;
+}
+
+const sqlite3_pcache_methods2 METHODS = {
+  .iVersion = 1,
+  .pArg = nullptr,
+
+  .xInit = [](void*) noexcept -> int { return SQLITE_OK; },
+  .xShutdown = [](void*) noexcept {},
+
+  .xCreate = [](int szPage, int szExtra, int bPurgeable) noexcept -> sqlite3_pcache* {
+    // Owned by SQLite until it calls xDestroy.
+    return reinterpret_cast<sqlite3_pcache*>(new Cache(szPage, szExtra, bPurgeable));
+  },
+
+  // The global budget is what bounds the cache; the per-connection suggestion doesn't apply.
+  .xCachesize = [](sqlite3_pcache*, int) noexcept {},
+
+  .xPagecount = [](sqlite3_pcache* pcache) noexcept -> int {
+    auto lock = getState().lockExclusive();
+    return getCache(pcache).pages.size();
+  },
+
+  .xFetch = [](sqlite3_pcache* pcache, unsigned key,
+               int createFlag) noexcept -> sqlite3_pcache_page* {
+    auto& cache = getCache(pcache);
+    auto lock = getState().lockExclusive();
+
+    KJ_IF_SOME(page, cache.pages.find(key)) {
+      if (page->link.isLinked()) {
+        lock->lru.remove(*page);
+      }
+      page->pinned = true;
+      ++lock->hits;
+      return page.get();
+    }
+
+    if (createFlag == 0) return nullptr;
+
+    // With createFlag == 1 SQLite only wants a page if it's cheap, and will otherwise try to free
+    // pages of its own before asking again with createFlag == 2, which we must honor if we can.
+    size_t size = sizeof(Page) + cache.pageSize + cache.extraSize;
+    kj::Own<Page> page;
+    auto maybeRecycled = evict(*lock, size, cache.pageSize + cache.extraSize);
+    KJ_IF_SOME(recycled, maybeRecycled) {
+      page = kj::mv(recycled);
+      page->cache = &cache;
+      page->key = key;
+      page->pinned = true;
+      page->pExtra = page->buffer.begin() + cache.pageSize;
+    } else {
+      if (lock->bytes + size > lock->maxBytes && createFlag == 1) return nullptr;
+      page = kj::heap<Page>(cache, key, cache.pageSize, cache.extraSize);
+    }
+
+    // SQLite expects the start of the extra space to be zeroed on new pages.
+    memset(page->pExtra, 0, cache.extraSize);
+
+    ++lock->misses;
+    ++lock->pageCount;
+    lock->bytes += page->size();
+    sqlite3_pcache_page* result = page.get();
+    cache.pages.insert(key, kj::mv(page));
+    return result;
+  },
+
+  .xUnpin = [](sqlite3_pcache* pcache, sqlite3_pcache_page* pPage, int discard) noexcept {
+    auto& cache = getCache(pcache);
+    auto& page = *static_cast<Page*>(pPage);
+    auto lock = getState().lockExclusive();
+
+    page.pinned = false;
+    if (discard) {
+      takePage(*lock, cache, page.key);
+    } else if (cache.purgeable) {
+      lock->lru.add(page);
+      evict(*lock, 0);
+    }
+  },
+
+  .xRekey = [](sqlite3_pcache* pcache, sqlite3_pcache_page* pPage,
+               unsigned oldKey, unsigned newKey) noexcept {
+    auto& cache = getCache(pcache);
+    auto lock = getState().lockExclusive();
+
+    // SQLite guarantees that a page already at `newKey` is not pinned.
+    if (cache.pages.find(newKey) != kj::none) {
+      takePage(*lock, cache, newKey);
+    }
+
+    auto& slot = KJ_ASSERT_NONNULL(cache.pages.find(oldKey));
+    KJ_ASSERT(slot.get() == static_cast<Page*>(pPage));
+    auto page = kj::mv(slot);
+    cache.pages.erase(oldKey);
+    page->key = newKey;
+    cache.pages.insert(newKey, kj::mv(page));
+  },
+
+  .xTruncate = [](sqlite3_pcache* pcache, unsigned iLimit) noexcept {
+    auto& cache = getCache(pcache);
+    auto lock = getState().lockExclusive();
+
+    kj::Vector<unsigned> keys;
+    for (auto& entry: cache.pages) {
+      if (entry.key >= iLimit) keys.add(entry.key);
+    }
+    for (auto key: keys) {
+      takePage(*lock, cache, key);
+    }
+  },
+
+  .xDestroy = [](sqlite3_pcache* pcache) noexcept {
+    auto& cache = getCache(pcache);
+    {
+      auto lock = getState().lockExclusive();
+      for (auto& entry: cache.pages) {
+        unlinkPage(*lock, *entry.value);
+      }
+      cache.pages.clear();
+    }
+    delete &cache;
+  },
+
+  .xShrink = [](sqlite3_pcache* pcache) noexcept {
+    auto& cache = getCache(pcache);
+    if (!cache.purgeable) return;
+    auto lock = getState().lockExclusive();
+
+    kj::Vector<unsigned> keys;
+    for (auto& entry: cache.pages) {
+      if (!entry.value->pinned) keys.add(entry.key);
+    }
+    for (auto key: keys) {
+      takePage(*lock, cache, key);
+    }
+  },
+};
+
+}  // namespace
+
+void SqlitePageCache::install(size_t maxBytes) {
+  KJ_REQUIRE(!installed, "SqlitePageCache::install() may only be called once");
+  getState().lockExclusive()->maxBytes = maxBytes;
+
+  // Fails with SQLITE_MISUSE if SQLite has already been initialized.
+  int err = sqlite3_config(SQLITE_CONFIG_PCACHE2, &METHODS);
+  KJ_REQUIRE(err == SQLITE_OK,
+      "SqlitePageCache::install() must be called before SQLite is first used", sqlite3_errstr(err));
+  installed = true;
+}
+
+bool SqlitePageCache::isInstalled() {
+  return installed;
+}
+
+SqlitePageCache::Stats SqlitePageCache::getStats() {
+  auto lock = getState().lockShared();
+  return {
+    .hits = lock->hits,
+    .misses = lock->misses,
+    .evictions = lock->evictions,
+    .pageCount = lock->pageCount,
+    .bytes = lock->bytes,
+    .maxBytes = lock->maxBytes,
+  };
+}
+
+}  // namespace workerd
@@ -0,0 +1,50 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+
+#include <kj/common.h>
+
+namespace workerd {
+
+// A page cache shared by every SQLite database in the process.
+//
+// By default SQLite gives each connection its own page cache. With one database per Durable
+// Object, that spreads memory thinly across thousands of caches, and a database that is read
+// constantly gets no more of it than one that was opened once. Installing this cache replaces
+// SQLite's with a single pool of pages under one global LRU, so hot databases keep their pages
+// at the expense of cold ones.
+//
+// Page memory is not allocated through SQLite, so it doesn't count toward SQLite's heap limits.
+// The pool's own byte budget bounds it instead, except that pages SQLite has pinned (and pages of
+// temporary databases, which can't be re-read from disk) are never evicted, so the pool can go
+// over budget while they are in use.
+class SqlitePageCache {
+public:
+  // Replaces SQLite's page cache with the shared one, holding roughly `maxBytes` of pages. Must be
+  // called at most once, before anything else in the process uses SQLite.
+  static void install(size_t maxBytes);
+
+  static bool isInstalled();
+
+  struct Stats {
+    // Page lookups that found the page in the pool, and lookups that had to create it (meaning
+    // SQLite read it from disk, or it is a new page). Per-database numbers are available from
+    // SqliteDatabase::getCacheStats().
+    uint64_t hits;
+    uint64_t misses;
+
+    // Pages dropped to make room for others.
+    uint64_t evictions;
+
+    size_t pageCount;
+    size_t bytes;
+    size_t maxBytes;
+  };
+
+  // Process-wide stats. All zero if the cache isn't installed.
+  static Stats getStats();
+};
+
+}  // namespace workerd
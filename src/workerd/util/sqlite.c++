@@ -423,6 +423,21 @@ void SqliteDatabase::notifyWrite() {
   }
 }
 
+void SqliteDatabase::notifyIfRollback(sqlite3_stmt* statement) {
+  KJ_IF_SOME(cb, onRollbackCallback) {
+    // Transaction control statements are all read-only as far as SQLite is concerned, so this
+    // keeps the string comparison off the path of every write.
+    if (sqlite3_stmt_readonly(statement) &&
+        kj::StringPtr(sqlite3_sql(statement)).startsWith("ROLLBACK")) {
+      cb();
+    }
+  }
+}
+
+bool SqliteDatabase::isInTransaction() {
+  return !sqlite3_get_autocommit(db);
+}
+
 kj::StringPtr SqliteDatabase::getCurrentQueryForDebug() {
   KJ_IF_SOME(s, currentStatement) {
     return sqlite3_normalized_sql(&s);
@@ -431,6 +446,20 @@ kj::StringPtr SqliteDatabase::getCurrentQueryForDebug() {
   }
 }
 
+SqliteDatabase::CacheStats SqliteDatabase::getCacheStats() {
+  auto get = [&](int op) -> uint64_t {
+    int current = 0;
+    int highwater = 0;
+    SQLITE_CALL(sqlite3_db_status(db, op, &current, &highwater, false));
+    return current;
+  };
+  return {
+    .hits = get(SQLITE_DBSTATUS_CACHE_HIT),
+    .misses = get(SQLITE_DBSTATUS_CACHE_MISS),
+    .bytesUsed = get(SQLITE_DBSTATUS_CACHE_USED),
+  };
+}
+
 // Set up the regulator that will be used for authorizer callbacks while preparing this
 // statement.
 kj::Own<sqlite3_stmt> SqliteDatabase::prepareSql(
@@ -473,6 +502,7 @@ kj::Own<sqlite3_stmt> SqliteDatabase::prepareSql(
               cb();
             }
           }
+          notifyIfRollback(result);
 
           // This isn't the last statement in the code. Execute it immediately.
           int err = sqlite3_step(result);
@@ -840,6 +870,9 @@ void SqliteDatabase::setupSecurity() {
   // Annoyingly, this sets a process-wide limit. We'll set 128MB "soft" limit (to try to control
   // how much page caching SQLite does) and 512MB "hard" limit (to block DoS attacks from taking
   // down the whole system).
+  //
+  // If SqlitePageCache is installed, pages are allocated outside SQLite's heap and are bounded by
+  // the page cache's own budget instead, shared across all databases.
   // TODO(perf): Revisit as popularity grows. Maybe make configurable? Maybe patch SQLite to allow
   //   these to be controlled per-database? Is page caching even all that important when the kernel
   //   does its own page caching?
@@ -908,6 +941,7 @@ void SqliteDatabase::Query::checkRequirements(size_t size) {
       cb();
     }
   }
+  db.notifyIfRollback(statement);
 }
 
 void SqliteDatabase::Query::init(kj::ArrayPtr<const ValuePtr> bindings) {
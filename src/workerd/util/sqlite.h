@@ -91,11 +91,43 @@ public:
   // start before the SAVEPOINT.
   void notifyWrite();
 
+  // Invokes the given callback whenever a ROLLBACK statement -- of a whole transaction or back to
+  // a savepoint -- is about to execute.
+  //
+  // Durable Objects uses this to drop cached reads, which may reflect writes being rolled back.
+  // Only trusted code can run transaction statements, and it spells them in upper case.
+  void onRollback(kj::Function<void()> callback) { onRollbackCallback = kj::mv(callback); }
+
+  // Drops the onWrite() and onRollback() callbacks, for when whatever they refer to goes away
+  // while the database stays open.
+  void clearCallbacks() {
+    onWriteCallback = kj::none;
+    onRollbackCallback = kj::none;
+  }
+
+  // True if a transaction is open, i.e. SQLite is not in autocommit mode.
+  bool isInTransaction();
+
   // Get the currently-executing SQL query for debug purposes. The query is normalized to hide
   // any literal values that might contain sensitive information. This is intended to be safe for
   // debug logs.
   kj::StringPtr getCurrentQueryForDebug();
 
+  struct CacheStats {
+    // Page lookups that found the page in the page cache, and lookups that had to read it from the
+    // file.
+    uint64_t hits;
+    uint64_t misses;
+
+    // Memory used by this database's pages in the page cache.
+    size_t bytesUsed;
+  };
+
+  // Page cache stats for this database since it was opened. These work the same whether the page
+  // cache is SQLite's own or the shared one from SqlitePageCache, whose own stats cover every
+  // database at once.
+  CacheStats getCacheStats();
+
   // Helper to execute a chunk of SQL that may not be complete.
   // Executes every valid statement provided, and returns the remaining portion of the input
   // that was not processed. This is used for streaming SQL ingestion.
@@ -114,6 +146,10 @@ private:
   kj::Maybe<sqlite3_stmt&> currentStatement;
 
   kj::Maybe<kj::Function<void()>> onWriteCallback;
+  kj::Maybe<kj::Function<void()>> onRollbackCallback;
+
+  // Invoke the onRollback() callback if `statement` is a ROLLBACK.
+  void notifyIfRollback(sqlite3_stmt* statement);
 
   void close();
 
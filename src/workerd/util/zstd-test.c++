@@ -0,0 +1,147 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "zstd.h"
+#include <kj/test.h>
+#include <kj/vector.h>
+
+namespace workerd {
+namespace {
+
+class MockInputStream final: public kj::AsyncInputStream {
+public:
+  MockInputStream(kj::ArrayPtr<const kj::byte> bytes, size_t blockSize)
+      : bytes(bytes), blockSize(blockSize) {}
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override {
+    // Clamp max read to blockSize.
+    size_t n = kj::min(blockSize, maxBytes);
+
+    // Unless that's less than minBytes -- in which case, use minBytes.
+    n = kj::max(n, minBytes);
+
+    // But also don't read more data than we have.
+    n = kj::min(n, bytes.size());
+
+    memcpy(buffer, bytes.begin(), n);
+    bytes = bytes.slice(n, bytes.size());
+    return n;
+  }
+
+private:
+  kj::ArrayPtr<const kj::byte> bytes;
+  size_t blockSize;
+};
+
+class MockOutputStream final: public kj::AsyncOutputStream {
+public:
+  kj::Vector<kj::byte> bytes;
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> data) override {
+    bytes.addAll(data);
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override {
+    for (auto& piece: pieces) bytes.addAll(piece);
+    return kj::READY_NOW;
+  }
+  kj::Promise<void> whenWriteDisconnected() override { return kj::NEVER_DONE; }
+};
+
+kj::Array<kj::byte> makeInput() {
+  // Repetitive enough to compress well, long enough to span several internal buffers.
+  kj::Vector<kj::byte> text;
+  for (auto i: kj::zeroTo(20000)) {
+    text.addAll(kj::str("line ", i % 97, " of the test input\n").asBytes());
+  }
+  return text.releaseAsArray();
+}
+
+KJ_TEST("zstd async round trip") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto input = makeInput();
+
+  MockOutputStream compressed;
+  {
+    ZstdAsyncOutputStream zstd(compressed);
+    zstd.write(input.slice(0, 1000)).wait(waitScope);
+    zstd.write(input.slice(1000, input.size())).wait(waitScope);
+    zstd.end().wait(waitScope);
+  }
+  KJ_EXPECT(compressed.bytes.size() < input.size() / 10);
+
+  for (size_t blockSize: { size_t(1), size_t(7), size_t(4096), size_t(100000) }) {
+    MockInputStream rawInput(compressed.bytes, blockSize);
+    ZstdAsyncInputStream zstd(rawInput);
+    auto result = zstd.readAllBytes().wait(waitScope);
+    KJ_EXPECT(result == input, blockSize);
+  }
+}
+
+KJ_TEST("zstd sync round trip") {
+  auto input = makeInput();
+
+  kj::VectorOutputStream compressed;
+  {
+    ZstdOutputStream zstd(compressed, 1);
+    zstd.write(input);
+  }
+
+  kj::VectorOutputStream decompressed;
+  {
+    ZstdOutputStream zstd(decompressed, ZstdOutputStream::DECOMPRESS);
+    zstd.write(compressed.getArray());
+    zstd.flush();
+  }
+  KJ_EXPECT(decompressed.getArray() == input.asPtr());
+}
+
+KJ_TEST("zstd concatenated frames") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  MockOutputStream compressed;
+  for (auto part: { "foo"_kj, "bar"_kj }) {
+    ZstdAsyncOutputStream zstd(compressed);
+    zstd.write(part.asBytes()).wait(waitScope);
+    zstd.end().wait(waitScope);
+  }
+
+  MockInputStream rawInput(compressed.bytes, 4096);
+  ZstdAsyncInputStream zstd(rawInput);
+  KJ_EXPECT(zstd.readAllText().wait(waitScope) == "foobar");
+}
+
+KJ_TEST("zstd truncated input") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto input = makeInput();
+  MockOutputStream compressed;
+  {
+    ZstdAsyncOutputStream zstd(compressed);
+    zstd.write(input).wait(waitScope);
+    zstd.end().wait(waitScope);
+  }
+
+  MockInputStream rawInput(compressed.bytes.asPtr().slice(0, compressed.bytes.size() - 1), 4096);
+  ZstdAsyncInputStream zstd(rawInput);
+  KJ_EXPECT_THROW_MESSAGE("zstd compressed stream ended prematurely",
+      zstd.readAllBytes().wait(waitScope));
+}
+
+KJ_TEST("zstd rejects garbage") {
+  kj::EventLoop loop;
+  kj::WaitScope waitScope(loop);
+
+  auto garbage = "this is not zstd data"_kj;
+  MockInputStream rawInput(garbage.asBytes(), 4096);
+  ZstdAsyncInputStream zstd(rawInput);
+  KJ_EXPECT_THROW_MESSAGE("zstd decompression failed", zstd.readAllBytes().wait(waitScope));
+}
+
+}  // namespace
+}  // namespace workerd
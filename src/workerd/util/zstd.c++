@@ -0,0 +1,205 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#include "zstd.h"
+#include <kj/debug.h>
+
+namespace workerd {
+
+namespace _ {  // private
+
+ZstdOutputContext::ZstdOutputContext(kj::Maybe<int> compressionLevel) {
+  KJ_IF_SOME(level, compressionLevel) {
+    cctx = ZSTD_createCCtx();
+    KJ_REQUIRE(cctx != nullptr, "zstd state allocation failed");
+    auto result = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    KJ_REQUIRE(!ZSTD_isError(result), "invalid zstd compression level", level);
+    if (level > 19) {
+      // The "ultra" levels default to windows larger than content-encoding decoders are required
+      // to accept. Lower levels already stay within the limit.
+      result = ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog,
+          ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG);
+      KJ_ASSERT(!ZSTD_isError(result), ZSTD_getErrorName(result));
+    }
+  } else {
+    dctx = ZSTD_createDCtx();
+    KJ_REQUIRE(dctx != nullptr, "zstd state allocation failed");
+    auto result = ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax,
+        ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG);
+    KJ_ASSERT(!ZSTD_isError(result), ZSTD_getErrorName(result));
+  }
+}
+
+ZstdOutputContext::~ZstdOutputContext() noexcept(false) {
+  ZSTD_freeCCtx(cctx);
+  ZSTD_freeDCtx(dctx);
+}
+
+void ZstdOutputContext::setInput(const void* in, size_t size) {
+  input = { .src = in, .size = size, .pos = 0 };
+}
+
+kj::Tuple<bool, kj::ArrayPtr<const kj::byte>> ZstdOutputContext::pumpOnce(
+    ZSTD_EndDirective directive) {
+  ZSTD_outBuffer output = { .dst = buffer, .size = sizeof(buffer), .pos = 0 };
+
+  bool more;
+  if (cctx != nullptr) {
+    auto remaining = ZSTD_compressStream2(cctx, &output, &input, directive);
+    KJ_REQUIRE(!ZSTD_isError(remaining), "zstd compression failed",
+        ZSTD_getErrorName(remaining));
+    if (directive == ZSTD_e_continue) {
+      // zstd may hold on to data internally until it has a full block; we only need to come back
+      // while there is input left or the output buffer filled up.
+      more = input.pos < input.size || output.pos == output.size;
+    } else {
+      more = remaining != 0;
+    }
+  } else {
+    auto result = ZSTD_decompressStream(dctx, &output, &input);
+    KJ_REQUIRE(!ZSTD_isError(result), "zstd decompression failed", ZSTD_getErrorName(result));
+    more = input.pos < input.size || output.pos == output.size;
+  }
+
+  return kj::tuple(more, kj::arrayPtr(buffer, output.pos));
+}
+
+}  // namespace _
+
+// =======================================================================================
+
+ZstdOutputStream::ZstdOutputStream(kj::OutputStream& inner, int compressionLevel)
+    : inner(inner), ctx(compressionLevel), compressing(true) {}
+
+ZstdOutputStream::ZstdOutputStream(kj::OutputStream& inner, decltype(DECOMPRESS))
+    : inner(inner), ctx(kj::none), compressing(false) {}
+
+ZstdOutputStream::~ZstdOutputStream() noexcept(false) {
+  if (compressing) {
+    unwindDetector.catchExceptionsIfUnwinding([&]() {
+      pump(ZSTD_e_end);
+    });
+  }
+}
+
+void ZstdOutputStream::write(kj::ArrayPtr<const kj::byte> data) {
+  ctx.setInput(data.begin(), data.size());
+  pump(ZSTD_e_continue);
+}
+
+void ZstdOutputStream::flush() {
+  pump(ZSTD_e_flush);
+  inner.flush();
+}
+
+void ZstdOutputStream::pump(ZSTD_EndDirective directive) {
+  bool more;
+  do {
+    auto result = ctx.pumpOnce(directive);
+    more = kj::get<0>(result);
+    auto chunk = kj::get<1>(result);
+    if (chunk.size() > 0) {
+      inner.write(chunk);
+    }
+  } while (more);
+}
+
+// =======================================================================================
+
+ZstdAsyncInputStream::ZstdAsyncInputStream(kj::AsyncInputStream& inner)
+    : inner(inner), ctx(ZSTD_createDCtx()) {
+  KJ_REQUIRE(ctx != nullptr, "zstd state allocation failed");
+  auto result = ZSTD_DCtx_setParameter(ctx, ZSTD_d_windowLogMax,
+      ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG);
+  KJ_ASSERT(!ZSTD_isError(result), ZSTD_getErrorName(result));
+}
+
+ZstdAsyncInputStream::~ZstdAsyncInputStream() noexcept(false) {
+  ZSTD_freeDCtx(ctx);
+}
+
+kj::Promise<size_t> ZstdAsyncInputStream::tryRead(void* out, size_t minBytes, size_t maxBytes) {
+  if (maxBytes == 0) return size_t(0);
+  return readImpl(reinterpret_cast<kj::byte*>(out), minBytes, maxBytes, 0);
+}
+
+kj::Promise<size_t> ZstdAsyncInputStream::readImpl(
+    kj::byte* out, size_t minBytes, size_t maxBytes, size_t alreadyRead) {
+  if (input.pos == input.size && !outputPending) {
+    return inner.tryRead(buffer, 1, sizeof(buffer))
+        .then([this,out,minBytes,maxBytes,alreadyRead](size_t amount) -> kj::Promise<size_t> {
+      if (amount == 0) {
+        if (!atValidEndpoint) {
+          return KJ_EXCEPTION(DISCONNECTED, "zstd compressed stream ended prematurely");
+        }
+        return alreadyRead;
+      } else {
+        input = { .src = buffer, .size = amount, .pos = 0 };
+        return readImpl(out, minBytes, maxBytes, alreadyRead);
+      }
+    });
+  }
+
+  ZSTD_outBuffer output = { .dst = out, .size = maxBytes, .pos = 0 };
+  auto consumedBefore = input.pos;
+  auto result = ZSTD_decompressStream(ctx, &output, &input);
+  KJ_REQUIRE(!ZSTD_isError(result), "zstd decompression failed", ZSTD_getErrorName(result));
+
+  // A zero return means a frame was fully decoded and flushed. Any further input is taken to be
+  // the start of another frame, which ZSTD_decompressStream() handles on its own. A call that
+  // made no progress says nothing new about where we are, and its return value is only a hint.
+  if (input.pos != consumedBefore || output.pos > 0) {
+    atValidEndpoint = result == 0;
+  }
+
+  // If we filled the caller's buffer, the decoder may be holding more output without needing
+  // more input.
+  outputPending = output.pos == output.size;
+
+  size_t n = output.pos;
+  if (n >= minBytes) {
+    return n + alreadyRead;
+  } else {
+    return readImpl(out + n, minBytes - n, maxBytes - n, alreadyRead + n);
+  }
+}
+
+// =======================================================================================
+
+ZstdAsyncOutputStream::ZstdAsyncOutputStream(kj::AsyncOutputStream& inner, int compressionLevel)
+    : inner(inner), ctx(compressionLevel) {}
+
+kj::Promise<void> ZstdAsyncOutputStream::write(kj::ArrayPtr<const kj::byte> buffer) {
+  ctx.setInput(buffer.begin(), buffer.size());
+  return pump(ZSTD_e_continue);
+}
+
+kj::Promise<void> ZstdAsyncOutputStream::write(
+    kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) {
+  if (pieces.size() == 0) return kj::READY_NOW;
+  return write(pieces[0]).then([this,pieces]() {
+    return write(pieces.slice(1, pieces.size()));
+  });
+}
+
+kj::Promise<void> ZstdAsyncOutputStream::pump(ZSTD_EndDirective directive) {
+  auto result = ctx.pumpOnce(directive);
+  auto more = kj::get<0>(result);
+  auto chunk = kj::get<1>(result);
+  if (chunk.size() == 0) {
+    if (more) {
+      return pump(directive);
+    } else {
+      return kj::READY_NOW;
+    }
+  } else {
+    auto promise = inner.write(chunk);
+    if (more) {
+      promise = promise.then([this,directive]() { return pump(directive); });
+    }
+    return promise;
+  }
+}
+
+}  // namespace workerd
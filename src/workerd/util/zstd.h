@@ -0,0 +1,117 @@
+// Copyright (c) 2024 Cloudflare, Inc.
+// Licensed under the Apache 2.0 license found in the LICENSE file or at:
+//     https://opensource.org/licenses/Apache-2.0
+
+#pragma once
+// Zstandard stream wrappers, shaped after the gzip and brotli wrappers in kj/compat. KJ doesn't
+// ship zstd support, so these back the "zstd" Content-Encoding.
+
+#include <kj/async-io.h>
+#include <kj/io.h>
+#include <kj/tuple.h>
+#include <zstd.h>
+
+namespace workerd {
+
+// RFC 8878 section 3.1.1.1.2 caps the window size for the "zstd" content coding at 8MB, so
+// decoders reject frames that want more than this.
+constexpr int ZSTD_CONTENT_ENCODING_MAX_WINDOW_LOG = 23;
+
+namespace _ {  // private
+
+class ZstdOutputContext final {
+public:
+  // Compresses at `compressionLevel`, or decompresses if it is none.
+  explicit ZstdOutputContext(kj::Maybe<int> compressionLevel);
+  ~ZstdOutputContext() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ZstdOutputContext);
+
+  void setInput(const void* in, size_t size);
+
+  // Runs the codec once over the pending input. Returns whether calling again may produce more
+  // output, along with the output produced by this call. `directive` is ignored when decompressing.
+  kj::Tuple<bool, kj::ArrayPtr<const kj::byte>> pumpOnce(ZSTD_EndDirective directive);
+
+private:
+  ZSTD_CCtx* cctx = nullptr;
+  ZSTD_DCtx* dctx = nullptr;
+  ZSTD_inBuffer input = {};
+  kj::byte buffer[4096];
+};
+
+}  // namespace _
+
+class ZstdOutputStream final: public kj::OutputStream {
+public:
+  enum { DECOMPRESS };
+
+  ZstdOutputStream(kj::OutputStream& inner, int compressionLevel = ZSTD_CLEVEL_DEFAULT);
+  ZstdOutputStream(kj::OutputStream& inner, decltype(DECOMPRESS));
+  ~ZstdOutputStream() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ZstdOutputStream);
+
+  void write(kj::ArrayPtr<const kj::byte> data) override;
+
+  // Write all data buffered so far to the inner stream.
+  void flush();
+
+private:
+  kj::OutputStream& inner;
+  _::ZstdOutputContext ctx;
+  bool compressing;
+  kj::UnwindDetector unwindDetector;
+
+  void pump(ZSTD_EndDirective directive);
+};
+
+class ZstdAsyncInputStream final: public kj::AsyncInputStream {
+public:
+  explicit ZstdAsyncInputStream(kj::AsyncInputStream& inner);
+  ~ZstdAsyncInputStream() noexcept(false);
+  KJ_DISALLOW_COPY_AND_MOVE(ZstdAsyncInputStream);
+
+  kj::Promise<size_t> tryRead(void* buffer, size_t minBytes, size_t maxBytes) override;
+
+private:
+  kj::AsyncInputStream& inner;
+  ZSTD_DCtx* ctx;
+  ZSTD_inBuffer input = {};
+  kj::byte buffer[4096];
+
+  // True when the input so far ends on a frame boundary, so EOF here is not premature.
+  bool atValidEndpoint = false;
+
+  // True when the last decode filled its output buffer, so it must be called again before
+  // reading more input.
+  bool outputPending = false;
+
+  kj::Promise<size_t> readImpl(kj::byte* out, size_t minBytes, size_t maxBytes,
+                               size_t alreadyRead);
+};
+
+class ZstdAsyncOutputStream final: public kj::AsyncOutputStream {
+public:
+  explicit ZstdAsyncOutputStream(kj::AsyncOutputStream& inner,
+                                 int compressionLevel = ZSTD_CLEVEL_DEFAULT);
+  KJ_DISALLOW_COPY_AND_MOVE(ZstdAsyncOutputStream);
+
+  kj::Promise<void> write(kj::ArrayPtr<const kj::byte> buffer) override;
+  kj::Promise<void> write(kj::ArrayPtr<const kj::ArrayPtr<const kj::byte>> pieces) override;
+
+  kj::Promise<void> whenWriteDisconnected() override { return inner.whenWriteDisconnected(); }
+
+  // Write all data buffered so far to the inner stream.
+  kj::Promise<void> flush() { return pump(ZSTD_e_flush); }
+
+  // Finish the frame. Must be called before the stream is destroyed, or the output will be
+  // truncated.
+  kj::Promise<void> end() { return pump(ZSTD_e_end); }
+
+private:
+  kj::AsyncOutputStream& inner;
+  _::ZstdOutputContext ctx;
+
+  kj::Promise<void> pump(ZSTD_EndDirective directive);
+};
+
+}  // namespace workerd